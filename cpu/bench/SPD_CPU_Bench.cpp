@@ -0,0 +1,135 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Times a Dispatch of a size x size source on one thread.
+// SPD_CPU_Bench [size] [repeats], 4096 and 5 by default.
+
+#include "../test/SPD_CPU_Test.h"
+
+#include <stdlib.h>
+#include <chrono>
+#include <functional>
+
+using namespace FFX_CPU;
+
+// average time of repeats runs in ms, after one run to warm up the caches and the page tables
+static double Time(int repeats, const std::function<void()> &run)
+{
+    run();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++)
+        run();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / repeats;
+}
+
+// Same source with every instruction set, the speedup is over the scalar kernels.
+// Instruction sets the CPU does not support are clamped by OnCreate and time the same as the best supported one.
+static void BenchISA(uint32_t size, int repeats)
+{
+    static const SPD_ISA isas[] = { SPD_ISA::SPD_Scalar, SPD_ISA::SPD_SSE41, SPD_ISA::SPD_AVX2, SPD_ISA::SPD_AVX512 };
+    static const char *isaNames[] = { "scalar", "SSE4.1", "AVX2", "AVX-512" };
+
+    printf("instruction sets, %ux%u, ms per Dispatch (speedup over scalar)\n", size, size);
+    printf("%-20s", "format");
+    for (const char *pName : isaNames)
+        printf("%18s", pName);
+    printf("\n");
+
+    for (const SPD_TestFormat &format : s_testFormats)
+    {
+        int mips = SpdTestMipCount(size, size);
+        SPD_TestImage src;
+        src.Allocate(size, size, format.format);
+        src.Randomize(format.format, 1);
+        SPD_TestMips dst;
+        dst.Allocate(size, size, mips, format.format);
+
+        printf("%-20s", format.pName);
+        double scalar = 0.0;
+        for (SPD_ISA isa : isas)
+        {
+            SPD_CPU spd;
+            spd.OnCreate(format.format, false, 1, isa);
+            double ms = Time(repeats, [&]() { spd.Dispatch(src.image, dst.images.data(), mips); });
+            spd.OnDestroy();
+            if (isa == SPD_ISA::SPD_Scalar)
+                scalar = ms;
+            printf("%10.2f (%4.1fx)", ms, scalar / ms);
+        }
+        printf("\n");
+    }
+}
+
+// One Dispatch of all mips against a pass per mip, each pass a DispatchMipRange of one mip from the one above.
+// The bytes are the texels every version reads and writes, the caches are not modeled.
+static void BenchFused(uint32_t size, int repeats)
+{
+    printf("fused tiles against a pass per mip, %ux%u, one thread\n", size, size);
+    printf("%-20s%12s%12s%12s%12s%10s\n", "format", "fused ms", "fused MB", "passes ms", "passes MB", "speedup");
+
+    for (const SPD_TestFormat &format : s_testFormats)
+    {
+        int mips = SpdTestMipCount(size, size);
+        SPD_TestImage src;
+        src.Allocate(size, size, format.format);
+        src.Randomize(format.format, 1);
+        SPD_TestMips dst;
+        dst.Allocate(size, size, mips, format.format);
+
+        double srcBytes = double(src.data.size());
+        double mipBytes = 0.0;
+        double parentBytes = 0.0; // mips 0..mips-2, which the passes read again
+        for (int i = 0; i < mips; i++)
+        {
+            mipBytes += double(dst.mips[i].data.size());
+            if (i + 1 < mips)
+                parentBytes += double(dst.mips[i].data.size());
+        }
+
+        SPD_CPU spd;
+        spd.OnCreate(format.format, false, 1);
+        double fused = Time(repeats, [&]() { spd.Dispatch(src.image, dst.images.data(), mips); });
+        double passes = Time(repeats, [&]()
+        {
+            spd.Dispatch(src.image, dst.images.data(), 1);
+            for (int i = 1; i < mips; i++)
+                spd.DispatchMipRange(dst.images.data(), i - 1, 1);
+        });
+        spd.OnDestroy();
+
+        printf("%-20s%12.2f%12.1f%12.2f%12.1f%9.2fx\n", format.pName,
+            fused, (srcBytes + mipBytes) / 1e6, passes, (srcBytes + parentBytes + mipBytes) / 1e6, passes / fused);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t size = argc > 1 ? uint32_t(atoi(argv[1])) : 4096;
+    int repeats = argc > 2 ? atoi(argv[2]) : 5;
+    if (size < 1 || size > 4096 || repeats < 1)
+    {
+        printf("usage: SPD_CPU_Bench [size 1..4096] [repeats]\n");
+        return 1;
+    }
+
+    BenchISA(size, repeats);
+    printf("\n");
+    BenchFused(size, repeats);
+    return 0;
+}
@@ -0,0 +1,1514 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "stdafx.h"
+#include "SPD_CPU.h"
+#include "SPD_CPU_Kernels.h"
+#include "SPD_CPU_ThreadPool.h"
+#include "SPD_CPU_MappedFile.h"
+#include "SPD_CPU_MipChain.h"
+
+namespace FFX_CPU
+{
+    //--------------------------------------------------------------------------------------
+    // Texel formats
+    //--------------------------------------------------------------------------------------
+    // Load, Store and Reduce4 are the hooks of the format, the H versions the ones of the packed mode.
+    // Reduce4 is the average, Unit is the value of 1.0 in the lanes of the hooks.
+    // The kernel path works on rows of Texel::Lane values with Texel::channels values per texel:
+    // SourceRow, ReadRow and WriteRow move rows between an image and the kernels, the Intermediate holds 16x16 texels.
+    struct SPD_TexelFloat
+    {
+        typedef AF1 Lane;
+        static const AU1 channels = 4;
+        static const bool packable = true;
+
+        static void Reduce4(outAF4 d, inAF4 v0, inAF4 v1, inAF4 v2, inAF4 v3)
+        {
+            SpdReduceAverage4(d, v0, v1, v2, v3);
+        }
+        static AF1 Unit() { return 1.0f; }
+
+        static void ReduceRowsColumnOrder(const SPD_Kernels &kernels, AF1 *pDst, const AF1 *pTop, const AF1 *pBottom, AU1 count) { kernels.ReduceRowsColumnOrder(pDst, pTop, pBottom, count); }
+        static void ReduceRowsRowOrder(const SPD_Kernels &kernels, AF1 *pDst, const AF1 *pTop, const AF1 *pBottom, AU1 count) { kernels.ReduceRowsRowOrder(pDst, pTop, pBottom, count); }
+        static AF1 (*Intermediate(SPD_ThreadPool &pool, AU1 workerIndex))[16][4] { return pool.GetIntermediate(workerIndex).v; }
+    };
+
+    struct SPD_TexelR32G32B32A32 : SPD_TexelFloat
+    {
+        static const size_t size = 16;
+        static void Load(outAF4 d, const void *p) { memcpy(d, p, sizeof(AF1) * 4); }
+        static void Store(void *p, inAF4 v) { memcpy(p, v, sizeof(AF1) * 4); }
+        static void LoadH(outAH4 d, const void *p) { varAF4(v); Load(v, p); opAH4_AF4(d, v); }
+        static void StoreH(void *p, inAH4 v) { varAF4(f); opAF4_AH4(f, v); Store(p, f); }
+
+        static const AF1 *SourceRow(const SPD_Kernels &, AF1 *, const void *p, AU1) { return (const AF1*)p; }
+        static void ReadRow(const SPD_Kernels &, AF1 *pDst, const void *p, AU1 count) { memcpy(pDst, p, count * size); }
+        static void WriteRow(const SPD_Kernels &, void *p, const AF1 *pSrc, AU1 count) { memcpy(p, pSrc, count * size); }
+    };
+
+    struct SPD_TexelR16G16B16A16 : SPD_TexelFloat
+    {
+        static const size_t size = 8;
+        static void Load(outAF4 d, const void *p) { varAH4(h); LoadH(h, p); opAF4_AH4(d, h); }
+        static void Store(void *p, inAF4 v) { varAH4(h); opAH4_AF4(h, v); StoreH(p, h); }
+        static void LoadH(outAH4 d, const void *p) { memcpy(d, p, sizeof(AW1) * 4); }
+        static void StoreH(void *p, inAH4 v) { memcpy(p, v, sizeof(AW1) * 4); }
+
+        // converted to fp32 in pScratch, the kernels reduce in fp32 and only the stores are fp16
+        static const AF1 *SourceRow(const SPD_Kernels &kernels, AF1 *pScratch, const void *p, AU1 count) { ReadRow(kernels, pScratch, p, count); return pScratch; }
+        static void ReadRow(const SPD_Kernels &kernels, AF1 *pDst, const void *p, AU1 count) { kernels.ConvertF16ToF32(pDst, (const AW1*)p, count * 4); }
+        static void WriteRow(const SPD_Kernels &kernels, void *p, const AF1 *pSrc, AU1 count) { kernels.ConvertF32ToF16((AW1*)p, pSrc, count * 4); }
+    };
+
+    // UNORM formats: the values are UNORM16 integers (0..65535) in the float lanes of the hooks and in the
+    // 32-bit lanes of the kernels, sRGB is linear. The average rounds to nearest, so hooks and kernels match.
+    // fp16 can not hold them, there is no packed mode.
+    template<AU1 C>
+    struct SPD_TexelUnorm
+    {
+        typedef AU1 Lane;
+        static const AU1 channels = C;
+        static const bool packable = false;
+
+        static void Reduce4(outAF4 d, inAF4 v0, inAF4 v1, inAF4 v2, inAF4 v3)
+        {
+            for (int i = 0; i < 4; i++) d[i] = AF1((AU1(v0[i]) + AU1(v1[i]) + AU1(v2[i]) + AU1(v3[i]) + 2) >> 2);
+        }
+        static AF1 Unit() { return 65535.0f; }
+        // the other reductions are not integers, rounded to nearest, sums saturate
+        static AU1 ToU(AF1 v) { return v < 65535.0f ? (v > 0.0f ? AU1(v + 0.5f) : 0) : 65535; }
+        // never packed, zero so that the packed paths instantiated for the format read defined values
+        static void LoadH(outAH4 d, const void *) { assert(false); d[0] = d[1] = d[2] = d[3] = 0; }
+        static void StoreH(void *, inAH4) { assert(false); }
+
+        static void ReduceRowsColumnOrder(const SPD_Kernels &kernels, AU1 *pDst, const AU1 *pTop, const AU1 *pBottom, AU1 count) { (C == 4 ? kernels.ReduceRowsRGBAU : kernels.ReduceRowsRU)(pDst, pTop, pBottom, count); }
+        static void ReduceRowsRowOrder(const SPD_Kernels &kernels, AU1 *pDst, const AU1 *pTop, const AU1 *pBottom, AU1 count) { ReduceRowsColumnOrder(kernels, pDst, pTop, pBottom, count); }
+        static AU1 (*Intermediate(SPD_ThreadPool &pool, AU1 workerIndex))[16][4] { return pool.GetIntermediateU(workerIndex); }
+    };
+
+    template<bool sRGB>
+    struct SPD_TexelR8G8B8A8 : SPD_TexelUnorm<4>
+    {
+        static const size_t size = 4;
+        static void Load(outAF4 d, const void *p)
+        {
+            AU1 u[4];
+            (sRGB ? SPD_ConvertSRGB8ToU_Scalar : SPD_ConvertUnorm8ToU_Scalar)(u, (const uint8_t*)p, 4);
+            for (int i = 0; i < 4; i++) d[i] = AF1(u[i]);
+        }
+        static void Store(void *p, inAF4 v)
+        {
+            AU1 u[4] = { ToU(v[0]), ToU(v[1]), ToU(v[2]), ToU(v[3]) };
+            (sRGB ? SPD_ConvertUToSRGB8_Scalar : SPD_ConvertUToUnorm8_Scalar)((uint8_t*)p, u, 4);
+        }
+
+        static const AU1 *SourceRow(const SPD_Kernels &kernels, AU1 *pScratch, const void *p, AU1 count) { ReadRow(kernels, pScratch, p, count); return pScratch; }
+        static void ReadRow(const SPD_Kernels &kernels, AU1 *pDst, const void *p, AU1 count) { (sRGB ? kernels.ConvertSRGB8ToU : kernels.ConvertUnorm8ToU)(pDst, (const uint8_t*)p, count * 4); }
+        static void WriteRow(const SPD_Kernels &kernels, void *p, const AU1 *pSrc, AU1 count) { (sRGB ? kernels.ConvertUToSRGB8 : kernels.ConvertUToUnorm8)((uint8_t*)p, pSrc, count * 4); }
+    };
+
+    struct SPD_TexelR16 : SPD_TexelUnorm<1>
+    {
+        static const size_t size = 2;
+        static void Load(outAF4 d, const void *p) { AW1 w; memcpy(&w, p, sizeof(w)); d[0] = AF1(w); d[1] = d[2] = d[3] = 0.0f; }
+        static void Store(void *p, inAF4 v) { AW1 w = AW1(ToU(v[0])); memcpy(p, &w, sizeof(w)); }
+
+        static const AU1 *SourceRow(const SPD_Kernels &kernels, AU1 *pScratch, const void *p, AU1 count) { ReadRow(kernels, pScratch, p, count); return pScratch; }
+        static void ReadRow(const SPD_Kernels &kernels, AU1 *pDst, const void *p, AU1 count) { kernels.ConvertUnorm16ToU(pDst, (const AW1*)p, count); }
+        static void WriteRow(const SPD_Kernels &kernels, void *p, const AU1 *pSrc, AU1 count) { kernels.ConvertUToUnorm16((AW1*)p, pSrc, count); }
+    };
+
+    //--------------------------------------------------------------------------------------
+    // SPD hooks on system memory images
+    //--------------------------------------------------------------------------------------
+    template<class Texel>
+    struct SPD_ImageHooks
+    {
+        const SPD_Image *pSrc; // one per slice
+        AU1 srcY; // row of the source image held by the first row of pSrc
+        const SPD_Image *pDst; // mip i of the slice s is pDst[s * dstStride + i]
+        AU1 dstStride;
+        std::atomic<AU1> *pCounter; // one per slice
+        std::atomic<AU1> *pBlockCounter; // blockCount per slice, extended mode only
+        AU1 blockCount;
+        size_t texelSize;
+        SPD_Reduction reduction;
+        SPD_WeightFn pWeight;
+        std::atomic<AU1> *pHistogram; // histogramBins per slice, histogram only
+        AU1 histogramBins;
+        AU1 *pHistogramCounts; // histogramBins per slice of the last run
+        SPD_Exposure *pExposure; // one per slice
+        std::atomic<AU1> *pCoverage; // coverageEntries per slice, coverage only
+        AU1 coverageEntries;
+        AF1 *pAlphaScales; // dstStride per slice
+        const AU1 *pResidency; // one bit per tile, residencyPitch words per row and tilesY rows per slice, NULL if all are resident
+        AU1 residencyPitch;
+        AF1 *pQuads; // 16x16 texels of mip 7 per slice, split tail only
+        AU1 tilesX;
+        AU1 tilesY;
+        AF1 residencyFill[4]; // in the lanes of the hooks
+        AW1 residencyFillH[4];
+
+        const void *Address(const SPD_Image &image, ASU1 x, ASU1 y)
+        {
+            if (AU1(x) >= image.Width || AU1(y) >= image.Height)
+                return NULL;
+            return (const uint8_t*)image.pData + size_t(y) * image.RowPitch + size_t(x) * texelSize;
+        }
+
+        void SpdLoadSourceImage(outAF4 d, ASU1 x, ASU1 y, AU1 slice)
+        {
+            const void *p = Address(pSrc[slice], x, y - ASU1(srcY));
+            if (p) Texel::Load(d, p); else d[0] = d[1] = d[2] = d[3] = 0.0f;
+        }
+        void SpdLoad(outAF4 d, ASU1 x, ASU1 y, AU1 slice)
+        {
+            const void *p = Address(pDst[slice * dstStride + 5], x, y);
+            if (p) Texel::Load(d, p); else d[0] = d[1] = d[2] = d[3] = 0.0f;
+        }
+        void SpdLoadMip(outAF4 d, ASU1 x, ASU1 y, AU1 mip, AU1 slice)
+        {
+            const void *p = Address(pDst[slice * dstStride + mip], x, y);
+            if (p) Texel::Load(d, p); else d[0] = d[1] = d[2] = d[3] = 0.0f;
+        }
+        void SpdStore(ASU1 x, ASU1 y, inAF4 value, AU1 mip, AU1 slice)
+        {
+            const void *p = Address(pDst[slice * dstStride + mip], x, y);
+            if (p) Texel::Store((void*)p, value);
+        }
+        void SpdStoreQuad(ASU1 x, ASU1 y, inAF4 value, AU1 slice) { memcpy(&pQuads[((slice * 16 + y) * 16 + x) * 4], value, sizeof(AF1) * 4); }
+        void SpdLoadQuad(outAF4 d, ASU1 x, ASU1 y, AU1 slice) { memcpy(d, &pQuads[((slice * 16 + y) * 16 + x) * 4], sizeof(AF1) * 4); }
+        void SpdReduce4(outAF4 d, inAF4 v0, inAF4 v1, inAF4 v2, inAF4 v3)
+        {
+            switch (reduction)
+            {
+            case SPD_Reduction::SPD_Min:
+                SpdReduceMin4(d, v0, v1, v2, v3);
+                break;
+            case SPD_Reduction::SPD_Max:
+                SpdReduceMax4(d, v0, v1, v2, v3);
+                break;
+            case SPD_Reduction::SPD_MinMax:
+                SpdReduceMinMax4(d, v0, v1, v2, v3);
+                break;
+            case SPD_Reduction::SPD_Sum:
+                SpdReduceSum4(d, v0, v1, v2, v3);
+                break;
+            case SPD_Reduction::SPD_Luminance:
+            case SPD_Reduction::SPD_Weighted:
+            {
+                AF1 w[4] = { Weight(v0), Weight(v1), Weight(v2), Weight(v3) };
+                SpdReduceWeighted4(d, v0, v1, v2, v3, w);
+                break;
+            }
+            case SPD_Reduction::SPD_Premultiplied:
+                SpdReducePremultiplied4(d, v0, v1, v2, v3);
+                break;
+            case SPD_Reduction::SPD_Normal:
+                ReduceNormal4(d, v0, v1, v2, v3);
+                break;
+            default:
+                Texel::Reduce4(d, v0, v1, v2, v3);
+                break;
+            }
+        }
+        // the normals of UNORM formats are decoded to -1..1 and the roughness to 0..1, zero stays zero (outside of the source)
+        void ReduceNormal4(outAF4 d, inAF4 v0, inAF4 v1, inAF4 v2, inAF4 v3)
+        {
+            AF1 unit = Texel::Unit();
+            if (unit == 1.0f)
+            {
+                SpdReduceNormal4(d, v0, v1, v2, v3);
+                return;
+            }
+            AF1 n[4][4];
+            const AF1 *v[4] = { v0, v1, v2, v3 };
+            for (int j = 0; j < 4; j++)
+            {
+                bool zero = v[j][0] == 0.0f && v[j][1] == 0.0f && v[j][2] == 0.0f && v[j][3] == 0.0f;
+                for (int i = 0; i < 3; i++) n[j][i] = zero ? 0.0f : v[j][i] * (2.0f / unit) - 1.0f;
+                n[j][3] = v[j][3] / unit;
+            }
+            SpdReduceNormal4(d, n[0], n[1], n[2], n[3]);
+            if (d[0] == 0.0f && d[1] == 0.0f && d[2] == 0.0f) return;
+            for (int i = 0; i < 3; i++) d[i] = (d[i] * 0.5f + 0.5f) * unit;
+            d[3] *= unit;
+        }
+        // the weights see the texels in 0..1, same as a shader sees a UNORM texture
+        AF1 Weight(inAF4 v)
+        {
+            AF1 n[4] = { v[0] / Texel::Unit(), v[1] / Texel::Unit(), v[2] / Texel::Unit(), v[3] / Texel::Unit() };
+            return reduction == SPD_Reduction::SPD_Luminance ? SpdLuminanceWeight(n) : pWeight(n);
+        }
+
+        void SpdLoadSourceImageH(outAH4 d, ASU1 x, ASU1 y, AU1 slice)
+        {
+            const void *p = Address(pSrc[slice], x, y - ASU1(srcY));
+            if (p) Texel::LoadH(d, p); else d[0] = d[1] = d[2] = d[3] = 0;
+        }
+        void SpdLoadH(outAH4 d, ASU1 x, ASU1 y, AU1 slice)
+        {
+            const void *p = Address(pDst[slice * dstStride + 5], x, y);
+            if (p) Texel::LoadH(d, p); else d[0] = d[1] = d[2] = d[3] = 0;
+        }
+        void SpdLoadMipH(outAH4 d, ASU1 x, ASU1 y, AU1 mip, AU1 slice)
+        {
+            const void *p = Address(pDst[slice * dstStride + mip], x, y);
+            if (p) Texel::LoadH(d, p); else d[0] = d[1] = d[2] = d[3] = 0;
+        }
+        void SpdStoreH(ASU1 x, ASU1 y, inAH4 value, AU1 mip, AU1 slice)
+        {
+            const void *p = Address(pDst[slice * dstStride + mip], x, y);
+            if (p) Texel::StoreH((void*)p, value);
+        }
+        // fp16 converts to fp32 and back exactly
+        void SpdStoreQuadH(ASU1 x, ASU1 y, inAH4 value, AU1 slice) { opAF4_AH4(&pQuads[((slice * 16 + y) * 16 + x) * 4], value); }
+        void SpdLoadQuadH(outAH4 d, ASU1 x, ASU1 y, AU1 slice) { opAH4_AF4(d, &pQuads[((slice * 16 + y) * 16 + x) * 4]); }
+        void SpdReduce4H(outAH4 d, inAH4 v0, inAH4 v1, inAH4 v2, inAH4 v3)
+        {
+            varAF4(f0); varAF4(f1); varAF4(f2); varAF4(f3); varAF4(r);
+            opAF4_AH4(f0, v0); opAF4_AH4(f1, v1); opAF4_AH4(f2, v2); opAF4_AH4(f3, v3);
+            SpdReduce4(r, f0, f1, f2, f3);
+            opAH4_AF4(d, r);
+        }
+
+        // release publishes the mips 0..5 of this tile, acquire makes the ones of all other tiles visible to the last one
+        AU1 SpdIncreaseAtomicCounter(AU1 slice) { return pCounter[slice].fetch_add(1, std::memory_order_acq_rel); }
+        AU1 SpdIncreaseBlockCounter(AU1 block, AU1 slice) { return pBlockCounter[slice * blockCount + block].fetch_add(1, std::memory_order_acq_rel); }
+        // only the last work group is left, the next dispatch is ordered by the pool
+        void SpdResetAtomicCounter(AU1 slice) { pCounter[slice].store(0, std::memory_order_relaxed); }
+        void SpdResetBlockCounter(AU1 block, AU1 slice) { pBlockCounter[slice * blockCount + block].store(0, std::memory_order_relaxed); }
+
+        // the counter of the slice orders the bins, they need no ordering of their own
+        void SpdHistogramAddGlobal(AU1 bin, AU1 count, AU1 slice) { pHistogram[slice * histogramBins + bin].fetch_add(count, std::memory_order_relaxed); }
+        AU1 SpdHistogramLoadGlobal(AU1 bin, AU1 slice) { return pHistogram[slice * histogramBins + bin].load(std::memory_order_relaxed); }
+        // keeps the bin for GetHistogram
+        void SpdHistogramResetGlobal(AU1 bin, AU1 slice) { pHistogramCounts[slice * histogramBins + bin] = pHistogram[slice * histogramBins + bin].exchange(0, std::memory_order_relaxed); }
+        void SpdCoverageAddGlobal(AU1 index, AU1 count, AU1 slice) { pCoverage[slice * coverageEntries + index].fetch_add(count, std::memory_order_relaxed); }
+        AU1 SpdCoverageLoadGlobal(AU1 index, AU1 slice) { return pCoverage[slice * coverageEntries + index].load(std::memory_order_relaxed); }
+        void SpdCoverageResetGlobal(AU1 index, AU1 slice) { pCoverage[slice * coverageEntries + index].store(0, std::memory_order_relaxed); }
+        void SpdStoreAlphaScale(AF1 scale, AU1 mip, AU1 slice) { pAlphaScales[slice * dstStride + mip] = scale; }
+        AF1 SpdLoadAlphaScale(AU1 mip, AU1 slice) { return pAlphaScales[slice * dstStride + mip]; }
+        void SpdStoreExposure(inAF4 value, AU1 slice)
+        {
+            SPD_Exposure exposure = { value[0] / Texel::Unit(), value[1] / Texel::Unit(), value[2] / Texel::Unit(), value[3] / Texel::Unit() };
+            pExposure[slice] = exposure;
+        }
+
+        // the tiles outside of the source are resident, so their texels of mip 5 read zero
+        AU1 SpdTileResident(AU1 x, AU1 y, AU1 slice)
+        {
+            if (!pResidency || x >= tilesX || y >= tilesY)
+                return 1;
+            return (pResidency[(slice * tilesY + y) * residencyPitch + x / 32] >> (x % 32)) & 1;
+        }
+        void SpdResidencyFill(outAF4 d, AU1) { memcpy(d, residencyFill, sizeof(residencyFill)); }
+        void SpdResidencyFillH(outAH4 d, AU1) { memcpy(d, residencyFillH, sizeof(residencyFillH)); }
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Kernel path with the average reduction, same results as the hooks
+    //--------------------------------------------------------------------------------------
+    template<class Texel>
+    static uint8_t *Row(const SPD_Image &image, AU1 x, AU1 y)
+    {
+        return (uint8_t*)image.pData + size_t(y) * image.RowPitch + size_t(x) * Texel::size;
+    }
+
+    // stores the part of a row that is inside of the image
+    template<class Texel>
+    static void StoreRow(const SPD_Kernels &kernels, const SPD_Image &image, AU1 x, AU1 y, const typename Texel::Lane *pRow, AU1 count)
+    {
+        if (y >= image.Height || x >= image.Width)
+            return;
+        if (count > image.Width - x)
+            count = image.Width - x;
+        Texel::WriteRow(kernels, Row<Texel>(image, x, y), pRow, count);
+    }
+
+    // reduces the 16x16 intermediate in place, see SpdDownsampleNextFour
+    template<class Texel>
+    static void DownsampleNextFourKernels(const SPD_Kernels &kernels, typename Texel::Lane (*lds)[16][4], const SPD_Image *pDst, AU1 wgX, AU1 wgY, AU1 baseMip, AU1 mips)
+    {
+        for (AU1 i = 0; i < 4; i++)
+        {
+            AU1 mip = baseMip + i;
+            if (mips <= mip) return;
+
+            AU1 size = 8 >> i;
+            for (AU1 y = 0; y < size; y++)
+            {
+                typename Texel::Lane row[8][4];
+                Texel::ReduceRowsRowOrder(kernels, row[0], lds[y * 2][0], lds[y * 2 + 1][0], size);
+                memcpy(lds[y], row, size * Texel::channels * sizeof(row[0][0]));
+                StoreRow<Texel>(kernels, pDst[mip], wgX * size, wgY * size + y, row[0], size);
+            }
+        }
+    }
+
+    // mips 0..5 of a 64x64 tile that is completely inside of the source
+    // Every source row is read once. Mip 0 is reduced further while it is still in the stack buffer, so the
+    // working set of a tile is the 64 source rows (64KB for RGBA32F), two rows of mip 0 (1KB) and the LDS replacement (4KB).
+    template<class Texel>
+    static void DownsampleTileKernels(const SPD_Kernels &kernels, typename Texel::Lane (*lds)[16][4], const SPD_Image &src, AU1 srcY, const SPD_Image *pDst, AU1 wgX, AU1 wgY, AU1 mips)
+    {
+        // mips 0-1 stage
+        for (AU1 y = 0; y < 16; y++)
+        {
+            typename Texel::Lane rows0[2][32][4];
+            for (AU1 j = 0; j < 2; j++)
+            {
+                AU1 y0 = y * 2 + j;
+                const uint8_t *pTop = Row<Texel>(src, wgX * 64, wgY * 64 - srcY + y0 * 2);
+                const uint8_t *pBottom = Row<Texel>(src, wgX * 64, wgY * 64 - srcY + y0 * 2 + 1);
+
+                // source rows of a tile are a pitch apart, so the hardware prefetcher does not see them as one stream
+                if (y0 < 31)
+                {
+                    for (AU1 x = 0; x < 64 * Texel::size; x += 64)
+                    {
+                        SPD_PREFETCH(pTop + 2 * src.RowPitch + x);
+                        SPD_PREFETCH(pBottom + 2 * src.RowPitch + x);
+                    }
+                }
+
+                typename Texel::Lane top[64][4];
+                typename Texel::Lane bottom[64][4];
+                Texel::ReduceRowsColumnOrder(kernels, rows0[j][0], Texel::SourceRow(kernels, top[0], pTop, 64), Texel::SourceRow(kernels, bottom[0], pBottom, 64), 32);
+                Texel::WriteRow(kernels, Row<Texel>(pDst[0], wgX * 32, wgY * 32 + y0), rows0[j][0], 32);
+            }
+
+            if (mips <= 1)
+                continue;
+
+            Texel::ReduceRowsRowOrder(kernels, lds[y][0], rows0[0][0], rows0[1][0], 16);
+            Texel::WriteRow(kernels, Row<Texel>(pDst[1], wgX * 16, wgY * 16 + y), lds[y][0], 16);
+        }
+
+        // mips 2-5 stage
+        DownsampleNextFourKernels<Texel>(kernels, lds, pDst, wgX, wgY, 2, mips);
+    }
+
+    // mips baseMip..baseMip + 5 of the block (blockX, blockY) from the up to 64x64 texels of mip baseMip - 1,
+    // see SpdDownsampleMips_6_7 (mips 6..11 of the only block) and SpdDownsampleBlockMips (extended mode)
+    // pResidency replaces the texels of mip 5 of the tiles that are not resident with the fill, see SpdDownsampleResident.
+    template<class Texel>
+    static void DownsampleTailKernels(const SPD_Kernels &kernels, typename Texel::Lane (*lds)[16][4], const SPD_Image *pDst, AU1 blockX, AU1 blockY, AU1 baseMip, AU1 mips, SPD_ImageHooks<Texel> *pResidency = NULL, AU1 slice = 0)
+    {
+        if (pResidency && !pResidency->pResidency)
+            pResidency = NULL;
+        const SPD_Image &src = pDst[baseMip - 1];
+        AU1 srcX = blockX * 64;
+        AU1 width = src.Width > srcX ? src.Width - srcX : 0;
+        if (width > 64)
+            width = 64;
+        for (AU1 y = 0; y < 16; y++)
+        {
+            // 4 rows of the source mip, padded with zeros to 64 texels (SpdLoad outside of the image reads zero)
+            typename Texel::Lane rows5[4][64][4];
+            memset(rows5, 0, sizeof(rows5));
+            for (AU1 j = 0; j < 4; j++)
+            {
+                AU1 y5 = blockY * 64 + y * 4 + j;
+                if (y5 < src.Height && width > 0)
+                    Texel::ReadRow(kernels, rows5[j][0], Row<Texel>(src, srcX, y5), width);
+                if (!pResidency || baseMip != 6)
+                    continue;
+                // also the tiles on the right edge without a texel of mip 5, same as SpdResidencyHooks
+                AU1 tiles = pResidency->tilesX > srcX ? AMinU1(pResidency->tilesX - srcX, 64) : 0;
+                for (AU1 x = 0; x < tiles; x++)
+                {
+                    if (pResidency->SpdTileResident(srcX + x, y5, slice))
+                        continue;
+                    for (AU1 c = 0; c < Texel::channels; c++)
+                        rows5[j][0][x * Texel::channels + c] = typename Texel::Lane(pResidency->residencyFill[c]);
+                }
+            }
+
+            typename Texel::Lane rows6[2][32][4];
+            for (AU1 j = 0; j < 2; j++)
+            {
+                Texel::ReduceRowsColumnOrder(kernels, rows6[j][0], rows5[j * 2][0], rows5[j * 2 + 1][0], 32);
+                StoreRow<Texel>(kernels, pDst[baseMip], blockX * 32, blockY * 32 + y * 2 + j, rows6[j][0], 32);
+            }
+
+            if (mips <= baseMip + 1) continue;
+
+            Texel::ReduceRowsRowOrder(kernels, lds[y][0], rows6[0][0], rows6[1][0], 16);
+            StoreRow<Texel>(kernels, pDst[baseMip + 1], blockX * 16, blockY * 16 + y, lds[y][0], 16);
+        }
+
+        DownsampleNextFourKernels<Texel>(kernels, lds, pDst, blockX, blockY, baseMip + 2, mips);
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Histogram, see SPD_CPU::SetHistogram
+    //--------------------------------------------------------------------------------------
+    struct SPD_Histogram
+    {
+        SpdHistogramParams params; // the range is the one of the texels in 0..1, 0 bins is disabled
+        std::atomic<AU1> *pBins; // params.bins per slice, zeroed once, the last work group resets them
+        uint32_t binCount;
+        std::vector<uint32_t> counts; // params.bins per slice of the last run
+        std::vector<SPD_Exposure> exposure; // one per slice of the last run
+
+        SPD_Histogram() : pBins(NULL), binCount(0) { params.bins = 0; }
+        ~SPD_Histogram() { delete[] pBins; }
+
+        void Reset(uint32_t sliceCount)
+        {
+            uint32_t count = sliceCount * params.bins;
+            if (binCount < count)
+            {
+                delete[] pBins;
+                pBins = new std::atomic<AU1>[count];
+                binCount = count;
+                for (uint32_t i = 0; i < count; i++)
+                    pBins[i].store(0, std::memory_order_relaxed);
+            }
+            counts.assign(count, 0);
+            SPD_Exposure zero = { 0.0f, 0.0f, 0.0f, 0.0f };
+            exposure.assign(sliceCount, zero);
+        }
+    };
+
+    // Alpha test coverage, see SPD_CPU::SetAlphaCoverage
+    struct SPD_Coverage
+    {
+        SpdCoverageParams params; // alpha in 0..1, the reference 0 is disabled
+        std::atomic<AU1> *pCounts; // SPD_COVERAGE_ENTRIES(params.bins) per slice, zeroed once, the last work group resets them
+        uint32_t countSize;
+        int mips;
+        std::vector<float> alphaScales; // mips per slice of the last run
+
+        SPD_Coverage() : pCounts(NULL), countSize(0), mips(0) { params.bins = SPD_COVERAGE_MAX_BINS; params.alphaReference = 0.0f; }
+        ~SPD_Coverage() { delete[] pCounts; }
+
+        void Reset(uint32_t sliceCount, uint32_t width, uint32_t height, int mipCount)
+        {
+            uint32_t count = sliceCount * SPD_COVERAGE_ENTRIES(params.bins);
+            if (countSize < count)
+            {
+                delete[] pCounts;
+                pCounts = new std::atomic<AU1>[count];
+                countSize = count;
+                for (uint32_t i = 0; i < count; i++)
+                    pCounts[i].store(0, std::memory_order_relaxed);
+            }
+            params.width = width;
+            params.height = height;
+            mips = mipCount;
+            alphaScales.assign(sliceCount * mipCount, 1.0f);
+        }
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Dispatch
+    //--------------------------------------------------------------------------------------
+    // SPD_FILTER_* of the wider filters, 0 for the 2x2 reductions
+    static inline AU1 GetFilter(SPD_Reduction reduction)
+    {
+        switch (reduction)
+        {
+        case SPD_Reduction::SPD_Binomial:
+            return SPD_FILTER_BINOMIAL;
+        case SPD_Reduction::SPD_Kaiser:
+            return SPD_FILTER_KAISER;
+        case SPD_Reduction::SPD_Lanczos:
+            return SPD_FILTER_LANCZOS;
+        default:
+            return 0;
+        }
+    }
+
+    template<class Texel>
+    struct SPD_DispatchContext
+    {
+        SPD_ImageHooks<Texel> hooks;
+        SPD_ThreadPool *pPool;
+        const SPD_Kernels *pKernels;
+        AU1 dispatchX;
+        AU1 firstWorkGroupY;
+        AU1 sliceWorkGroups; // work groups of one slice in this run
+        AU1 numWorkGroups; // work groups of one slice in total
+        AU1 dispatchY; // numWorkGroups / dispatchX
+        AU1 mips;
+        bool packed;
+        bool extended; // more than 64x64 work groups, see SpdDownsampleExtended
+        bool histogram; // see SpdDownsampleHistogram, the range of histogramParams is the one of the hooks
+        SpdHistogramParams histogramParams;
+        bool coverage; // see SpdDownsampleCoverage, the alpha of coverageParams is the one of the hooks
+        SpdCoverageParams coverageParams;
+        AU1 filter; // SPD_FILTER_*, 0 for the 2x2 reductions
+        const AU1 *pDirtyTiles; // see SpdDownsampleDirty, one work group per entry, NULL for all tiles
+        bool residency; // see SpdDownsampleResident, the bitmap and the fill are the ones of the hooks
+        bool splitTail; // see SpdDownsampleSplitTail, the block counters count the quads of 4x4 work groups
+        AU1 waveSize; // see SpdDownsampleWave, 0 for SpdDownsample
+    };
+
+    // One work group, run by the worker with the index workerIndex on its own LDS replacement
+    template<class Texel>
+    static void DispatchWorkGroup(void *pContext, AU1 workGroup, AU1 workerIndex)
+    {
+        SPD_DispatchContext<Texel> &ctx = *(SPD_DispatchContext<Texel>*)pContext;
+        SPD_ImageHooks<Texel> spd = ctx.hooks;
+        SpdIntermediate &lds = ctx.pPool->GetIntermediate(workerIndex);
+        typename Texel::Lane (*ldsKernels)[16][4] = Texel::Intermediate(*ctx.pPool, workerIndex);
+        AU1 slice = workGroup / ctx.sliceWorkGroups;
+        workGroup -= slice * ctx.sliceWorkGroups;
+        const SPD_Image &src = spd.pSrc[slice];
+        const SPD_Image *pDst = spd.pDst + slice * spd.dstStride;
+
+        varAU2(workGroupID) = initAU2(workGroup % ctx.dispatchX, ctx.firstWorkGroupY + workGroup / ctx.dispatchX);
+        varAU2(numWorkGroups) = initAU2(ctx.dispatchX, ctx.dispatchY);
+        varAU2(size) = initAU2(src.Width, src.Height);
+        if (ctx.pDirtyTiles)
+        {
+            workGroupID[0] = ctx.pDirtyTiles[workGroup] & 0xffff;
+            workGroupID[1] = ctx.pDirtyTiles[workGroup] >> 16;
+        }
+        if (ctx.filter)
+        {
+            SpdDownsampleFilter(spd, ctx.pPool->GetIntermediateFilter(workerIndex), workGroupID, ctx.mips, ctx.numWorkGroups, slice, size, ctx.filter);
+            return;
+        }
+        if (ctx.histogram)
+        {
+            // the histogram counts the texels of mip 0 as they are stored, which the kernels skip
+            if (ctx.packed)
+                SpdDownsampleHistogramH(spd, ctx.pPool->GetIntermediateH(workerIndex), workGroupID, ctx.mips, ctx.numWorkGroups, slice, ctx.histogramParams);
+            else
+                SpdDownsampleHistogram(spd, lds, workGroupID, ctx.mips, ctx.numWorkGroups, slice, ctx.histogramParams);
+            return;
+        }
+        if (ctx.coverage)
+        {
+            // the source texels are counted as they are loaded, which the kernels skip
+            if (ctx.packed)
+                SpdDownsampleCoverageH(spd, ctx.pPool->GetIntermediateH(workerIndex), workGroupID, ctx.mips, ctx.numWorkGroups, slice, ctx.coverageParams);
+            else
+                SpdDownsampleCoverage(spd, lds, workGroupID, ctx.mips, ctx.numWorkGroups, slice, ctx.coverageParams);
+            return;
+        }
+        if (ctx.packed)
+        {
+            if (ctx.residency)
+                SpdDownsampleResidentH(spd, ctx.pPool->GetIntermediateH(workerIndex), workGroupID, ctx.mips, numWorkGroups, slice);
+            else if (ctx.pDirtyTiles)
+                SpdDownsampleDirtyH(spd, ctx.pPool->GetIntermediateH(workerIndex), ctx.pDirtyTiles, workGroup, ctx.mips, ctx.numWorkGroups, slice, size);
+            else if (ctx.extended)
+                SpdDownsampleExtendedH(spd, ctx.pPool->GetIntermediateH(workerIndex), workGroupID, ctx.mips, numWorkGroups, slice);
+            else if (ctx.splitTail)
+                SpdDownsampleSplitTailH(spd, ctx.pPool->GetIntermediateH(workerIndex), workGroupID, ctx.mips, numWorkGroups, slice);
+            else if (ctx.waveSize)
+                SpdDownsampleWaveH(spd, ctx.pPool->GetIntermediateH(workerIndex), workGroupID, ctx.mips, ctx.numWorkGroups, slice, ctx.waveSize);
+            else
+                SpdDownsampleH(spd, ctx.pPool->GetIntermediateH(workerIndex), workGroupID, ctx.mips, ctx.numWorkGroups, slice);
+            return;
+        }
+        if (!ctx.pKernels)
+        {
+            if (ctx.residency)
+                SpdDownsampleResident(spd, lds, workGroupID, ctx.mips, numWorkGroups, slice);
+            else if (ctx.pDirtyTiles)
+                SpdDownsampleDirty(spd, lds, ctx.pDirtyTiles, workGroup, ctx.mips, ctx.numWorkGroups, slice, size);
+            else if (ctx.extended)
+                SpdDownsampleExtended(spd, lds, workGroupID, ctx.mips, numWorkGroups, slice);
+            else if (ctx.splitTail)
+                SpdDownsampleSplitTail(spd, lds, workGroupID, ctx.mips, numWorkGroups, slice);
+            else if (ctx.waveSize)
+                SpdDownsampleWave(spd, lds, workGroupID, ctx.mips, ctx.numWorkGroups, slice, ctx.waveSize);
+            else
+                SpdDownsample(spd, lds, workGroupID, ctx.mips, ctx.numWorkGroups, slice);
+            return;
+        }
+
+        // tiles crossing the border of the source go through the hooks, which handle the zero padding
+        bool interior = (workGroupID[0] + 1) * 64 <= src.Width && (workGroupID[1] + 1) * 64 <= spd.srcY + src.Height;
+        // a tile that is not resident is neither read nor written, the tail reads its texel of mip 5 as the fill
+        bool resident = spd.SpdTileResident(workGroupID[0], workGroupID[1], slice) != 0;
+        if (resident && interior)
+        {
+            DownsampleTileKernels<Texel>(*ctx.pKernels, ldsKernels, src, spd.srcY, pDst, workGroupID[0], workGroupID[1], ctx.mips);
+        }
+        else if (resident)
+        {
+            SpdDownsampleMips_0_1(spd, lds.v, workGroupID, ctx.mips, slice);
+            SpdDownsampleNextFour(spd, lds.v, workGroupID, 2, ctx.mips, slice);
+        }
+
+        if (ctx.mips <= 6) return;
+
+        if (ctx.pDirtyTiles)
+        {
+            // the texels above the tiles of the list, from the mips the kernels stored and the edges of the mips in the LDS
+            if (SpdExitWorkgroup(spd, ctx.numWorkGroups, slice)) return;
+
+            SpdDownsampleDirtyAncestors(spd, lds.v, ctx.pDirtyTiles, ctx.mips, ctx.numWorkGroups, slice, size);
+            return;
+        }
+
+        if (ctx.splitTail)
+        {
+            // the last tile of a quad of 4x4 tiles computes mips 6 and 7 of the quad, the last quad mips 8..11 from mip 7
+            SpdDownsampleQuadTail(spd, lds.v, workGroupID, ctx.mips, numWorkGroups, slice);
+            return;
+        }
+
+        if (!ctx.extended)
+        {
+            // the last arriving tile computes mips 6..11 right away, there is no barrier between the tiles and the tail
+            if (SpdExitWorkgroup(spd, ctx.numWorkGroups, slice)) return;
+
+            DownsampleTailKernels<Texel>(*ctx.pKernels, ldsKernels, pDst, 0, 0, 6, ctx.mips, &spd, slice);
+            return;
+        }
+
+        // the last tile of a block of 64x64 tiles computes mips 6..11 of the block, the last block mips 12..17
+        AU1 blockX = workGroupID[0] / 64;
+        AU1 blockY = workGroupID[1] / 64;
+        AU1 blockWidth = AMinU1(64, ctx.dispatchX - blockX * 64);
+        AU1 blockHeight = AMinU1(64, ctx.dispatchY - blockY * 64);
+        AU1 blocksX = (ctx.dispatchX + 63) / 64;
+        if (SpdExitBlock(spd, blockWidth * blockHeight, blockY * blocksX + blockX, slice)) return;
+
+        DownsampleTailKernels<Texel>(*ctx.pKernels, ldsKernels, pDst, blockX, blockY, 6, ctx.mips, &spd, slice);
+
+        if (ctx.mips <= 12) return;
+
+        if (SpdExitWorkgroup(spd, spd.blockCount, slice)) return;
+
+        DownsampleTailKernels<Texel>(*ctx.pKernels, ldsKernels, pDst, 0, 0, 12, ctx.mips);
+    }
+
+    // Rewrites the alpha of the mips of one work group with the scales, see SpdCoverageApply
+    template<class Texel>
+    static void DispatchCoverageWorkGroup(void *pContext, AU1 workGroup, AU1)
+    {
+        SPD_DispatchContext<Texel> &ctx = *(SPD_DispatchContext<Texel>*)pContext;
+        SPD_ImageHooks<Texel> spd = ctx.hooks;
+        AU1 slice = workGroup / ctx.numWorkGroups;
+        workGroup -= slice * ctx.numWorkGroups;
+
+        varAU2(workGroupID) = initAU2(workGroup % ctx.dispatchX, workGroup / ctx.dispatchX);
+        SpdCoverageApply(spd, workGroupID, ctx.mips, slice, ctx.coverageParams);
+    }
+
+    // Runs the tiles of the source rows [srcY, srcY + Height) of all slices, srcY is a multiple of 64.
+    // All slices have the same size, pDst holds the mips of one slice after the other.
+    // numWorkGroups is the count of one whole slice, the last of them computes mips 6..11 of the slice.
+    // pCounters holds one counter per slice, followed by the block counters of all slices in the extended mode.
+    // pHistogram is NULL without the histogram, pCoverage without the alpha coverage.
+    // pDirtyTiles is NULL for all tiles, otherwise the list of numWorkGroups tiles of every slice.
+    // pResidency is NULL if all tiles are resident, otherwise the bitmap of SPD_CPU::SetResidency and pFill its fill.
+    // pQuads runs the tail of SpdDownsampleSplitTail up to 64x64 tiles with 16x16 texels per slice for the mip 7 of the quads,
+    // the block counters are the ones of the quads then. NULL for the single last work group.
+    // waveSize runs SpdDownsampleWave on the hooks instead of SpdDownsample or the kernels, 0 for neither.
+    template<class Texel>
+    static void DispatchTiles(SPD_ThreadPool &pool, const SPD_Image *pSrc, AU1 sliceCount, AU1 srcY, const SPD_Image *pDst, int mips, bool packed, size_t texelSize, const SPD_Kernels *pKernels, SPD_Reduction reduction, SPD_WeightFn pWeight, std::atomic<AU1> *pCounters, AU1 numWorkGroups, SPD_Histogram *pHistogram, SPD_Coverage *pCoverage, const AU1 *pDirtyTiles, const AU1 *pResidency, const AF1 *pFill, AF1 *pQuads, AU1 waveSize)
+    {
+        SPD_DispatchContext<Texel> ctx;
+        ctx.hooks.reduction = reduction;
+        ctx.hooks.pWeight = pWeight;
+        ctx.hooks.pSrc = pSrc;
+        ctx.hooks.srcY = srcY;
+        ctx.hooks.pDst = pDst;
+        ctx.hooks.dstStride = AU1(mips);
+        ctx.hooks.pCounter = pCounters;
+        ctx.hooks.texelSize = texelSize;
+        ctx.pPool = &pool;
+        ctx.pKernels = waveSize ? NULL : pKernels;
+        ctx.dispatchX = (pSrc->Width + 63) >> 6;
+        ctx.firstWorkGroupY = srcY >> 6;
+        ctx.sliceWorkGroups = ctx.dispatchX * ((pSrc->Height + 63) >> 6);
+        ctx.numWorkGroups = numWorkGroups;
+        ctx.dispatchY = numWorkGroups / ctx.dispatchX;
+        ctx.mips = AU1(mips);
+        ctx.packed = packed && Texel::packable;
+        ctx.extended = ctx.dispatchX > 64 || ctx.dispatchY > 64;
+        ctx.hooks.pBlockCounter = pCounters + sliceCount;
+        ctx.hooks.blockCount = ((ctx.dispatchX + 63) / 64) * ((ctx.dispatchY + 63) / 64);
+        ctx.splitTail = pQuads && !ctx.extended && !pDirtyTiles && !pResidency;
+        ctx.hooks.pQuads = pQuads;
+        if (ctx.splitTail)
+            ctx.hooks.blockCount = ((ctx.dispatchX + 3) / 4) * ((ctx.dispatchY + 3) / 4);
+        ctx.waveSize = waveSize;
+        ctx.filter = GetFilter(reduction);
+        ctx.pDirtyTiles = pDirtyTiles;
+        if (pDirtyTiles)
+            ctx.sliceWorkGroups = numWorkGroups;
+        ctx.residency = pResidency != NULL;
+        ctx.hooks.pResidency = pResidency;
+        ctx.hooks.tilesX = ctx.dispatchX;
+        ctx.hooks.tilesY = ctx.dispatchY;
+        ctx.hooks.residencyPitch = (ctx.dispatchX + 31) / 32;
+        if (pResidency)
+        {
+            // the fill is what a texel of mip 5 reads back in the format, UNORM texels in 0..Unit of the hooks
+            varAF4(fill) = initAF4(pFill[0] * Texel::Unit(), pFill[1] * Texel::Unit(), pFill[2] * Texel::Unit(), pFill[3] * Texel::Unit());
+            uint8_t texel[16];
+            Texel::Store(texel, fill);
+            Texel::Load(ctx.hooks.residencyFill, texel);
+            opAH4_AF4(ctx.hooks.residencyFillH, ctx.hooks.residencyFill);
+        }
+        ctx.histogram = pHistogram != NULL;
+        if (pHistogram)
+        {
+            // the hooks see UNORM texels in 0..Unit
+            ctx.histogramParams = pHistogram->params;
+            ctx.histogramParams.minLog2Luminance += ALog2F1(Texel::Unit());
+            ctx.histogramParams.width = pDst[0].Width;
+            ctx.histogramParams.height = pDst[0].Height;
+            ctx.hooks.pHistogram = pHistogram->pBins;
+            ctx.hooks.histogramBins = pHistogram->params.bins;
+            ctx.hooks.pHistogramCounts = &pHistogram->counts[0];
+            ctx.hooks.pExposure = &pHistogram->exposure[0];
+        }
+        ctx.coverage = pCoverage != NULL;
+        if (pCoverage)
+        {
+            // the hooks see UNORM alpha in 0..Unit, the UNORM formats with alpha store 8 bits
+            ctx.coverageParams = pCoverage->params;
+            ctx.coverageParams.alphaReference *= Texel::Unit();
+            ctx.coverageParams.alphaOne = Texel::Unit();
+            ctx.coverageParams.alphaStep = Texel::Unit() == 1.0f ? 0.0f : Texel::Unit() / 255.0f;
+            ctx.coverageParams.alphaPrecision = Texel::size == 8 ? 1.0f / 1024.0f : 1.0f / 1048576.0f;
+            ctx.hooks.pCoverage = pCoverage->pCounts;
+            ctx.hooks.coverageEntries = SPD_COVERAGE_ENTRIES(pCoverage->params.bins);
+            ctx.hooks.pAlphaScales = &pCoverage->alphaScales[0];
+        }
+
+        pool.Run(ctx.sliceWorkGroups * sliceCount, &DispatchWorkGroup<Texel>, &ctx);
+
+        // the scales are known once the last work group ran, with the last band of a stream
+        if (pCoverage && ctx.firstWorkGroupY * ctx.dispatchX + ctx.sliceWorkGroups == numWorkGroups)
+            pool.Run(numWorkGroups * sliceCount, &DispatchCoverageWorkGroup<Texel>, &ctx);
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Depth, see SPD_Format::SPD_R32_FLOAT_DEPTH
+    //--------------------------------------------------------------------------------------
+    static inline bool IsDepth(SPD_Format format)
+    {
+        return format == SPD_Format::SPD_R32_FLOAT_DEPTH || format == SPD_Format::SPD_R32_FLOAT_DEPTH_REVERSED_Z;
+    }
+
+    struct SPD_DepthHooks
+    {
+        const SPD_Image *pSrc; // one per slice
+        const SPD_Image *pDst; // mip i of the slice s is pDst[s * dstStride + i]
+        AU1 dstStride;
+        std::atomic<AU1> *pCounter; // one per slice
+
+        // the footprints are clamped to the source and the mips, the loads need no bounds check
+        static AF1 *Texel(const SPD_Image &image, ASU1 x, ASU1 y)
+        {
+            return (AF1*)((uint8_t*)image.pData + size_t(y) * image.RowPitch) + x;
+        }
+
+        AF1 SpdLoadSourceDepth(ASU1 x, ASU1 y, AU1 slice) { return *Texel(pSrc[slice], x, y); }
+        AF1 SpdLoadDepth(ASU1 x, ASU1 y, AU1 mip, AU1 slice) { return *Texel(pDst[slice * dstStride + mip], x, y); }
+        void SpdStoreDepth(ASU1 x, ASU1 y, AF1 value, AU1 mip, AU1 slice) { *Texel(pDst[slice * dstStride + mip], x, y) = value; }
+        AU1 SpdIncreaseAtomicCounter(AU1 slice) { return pCounter[slice].fetch_add(1, std::memory_order_acq_rel); }
+        void SpdResetAtomicCounter(AU1 slice) { pCounter[slice].store(0, std::memory_order_relaxed); }
+    };
+
+    struct SPD_DepthContext
+    {
+        SPD_DepthHooks hooks;
+        SPD_ThreadPool *pPool;
+        AU1 dispatchX;
+        AU1 sliceWorkGroups;
+        AU1 mips;
+        AU1 width;
+        AU1 height;
+        bool reversedZ;
+    };
+
+    static void DispatchDepthWorkGroup(void *pContext, AU1 workGroup, AU1 workerIndex)
+    {
+        SPD_DepthContext &ctx = *(SPD_DepthContext*)pContext;
+        SPD_DepthHooks spd = ctx.hooks;
+        AU1 slice = workGroup / ctx.sliceWorkGroups;
+        workGroup -= slice * ctx.sliceWorkGroups;
+
+        varAU2(workGroupID) = initAU2(workGroup % ctx.dispatchX, workGroup / ctx.dispatchX);
+        varAU2(size) = initAU2(ctx.width, ctx.height);
+        SpdDownsampleDepth(spd, ctx.pPool->GetIntermediateDepth(workerIndex), workGroupID, ctx.mips, ctx.sliceWorkGroups, slice, size, ctx.reversedZ);
+    }
+
+    // All tiles of all slices in one run, pCounters holds one counter per slice.
+    static void DispatchDepthTiles(SPD_ThreadPool &pool, const SPD_Image *pSrc, AU1 sliceCount, const SPD_Image *pDst, int mips, bool reversedZ, std::atomic<AU1> *pCounters)
+    {
+        SPD_DepthContext ctx;
+        ctx.hooks.pSrc = pSrc;
+        ctx.hooks.pDst = pDst;
+        ctx.hooks.dstStride = AU1(mips);
+        ctx.hooks.pCounter = pCounters;
+        ctx.pPool = &pool;
+        ctx.dispatchX = (pSrc->Width + 63) >> 6;
+        ctx.sliceWorkGroups = ctx.dispatchX * ((pSrc->Height + 63) >> 6);
+        ctx.mips = AU1(mips);
+        ctx.width = pSrc->Width;
+        ctx.height = pSrc->Height;
+        ctx.reversedZ = reversedZ;
+
+        pool.Run(ctx.sliceWorkGroups * sliceCount, &DispatchDepthWorkGroup, &ctx);
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Batch, see SPD_CPU::DispatchBatch
+    //--------------------------------------------------------------------------------------
+    struct SPD_Batch
+    {
+        // first work group of every image in the shared queue, plus the total count at the end
+        std::vector<AU1> firstWorkGroup;
+        // one counter per image or per slice, kept between dispatches, the last work group of a dispatch resets its counter
+        std::atomic<AU1> *pCounters;
+        uint32_t counterCount;
+
+        // 16x16 texels of mip 7 per slice, the split tail carries them from the quads to the last quad
+        std::vector<AF1> quads;
+
+        SPD_Batch() : pCounters(NULL), counterCount(0) {}
+        ~SPD_Batch() { delete[] pCounters; }
+
+        // grows with the largest count so far, the same count again does not allocate, only new counters are zeroed
+        std::atomic<AU1> *GetCounters(uint32_t count)
+        {
+            if (counterCount < count)
+            {
+                delete[] pCounters;
+                pCounters = new std::atomic<AU1>[count];
+                counterCount = count;
+                for (uint32_t i = 0; i < count; i++)
+                    pCounters[i].store(0, std::memory_order_relaxed);
+            }
+            return pCounters;
+        }
+
+        AF1 *GetQuads(uint32_t sliceCount)
+        {
+            if (quads.size() < size_t(sliceCount) * 16 * 16 * 4)
+                quads.resize(size_t(sliceCount) * 16 * 16 * 4);
+            return quads.data();
+        }
+    };
+
+    template<class Texel>
+    struct SPD_BatchContext
+    {
+        const SPD_BatchImage *pImages;
+        uint32_t imageCount;
+        SPD_Batch *pBatch;
+        SPD_ThreadPool *pPool;
+        const SPD_Kernels *pKernels;
+        SPD_Reduction reduction;
+        SPD_WeightFn pWeight;
+        size_t texelSize;
+        bool packed;
+    };
+
+    // One work group of the batch: finds its image and runs it like a work group of Dispatch
+    template<class Texel>
+    static void DispatchBatchWorkGroup(void *pContext, AU1 workGroup, AU1 workerIndex)
+    {
+        SPD_BatchContext<Texel> &batch = *(SPD_BatchContext<Texel>*)pContext;
+        const AU1 *pFirst = &batch.pBatch->firstWorkGroup[0];
+
+        // last image with pFirst[image] <= workGroup, images without tiles are skipped by the search
+        uint32_t lo = 0;
+        uint32_t hi = batch.imageCount;
+        while (hi - lo > 1)
+        {
+            uint32_t mid = (lo + hi) / 2;
+            if (pFirst[mid] <= workGroup)
+                lo = mid;
+            else
+                hi = mid;
+        }
+        const SPD_BatchImage &image = batch.pImages[lo];
+        AU1 numWorkGroups = pFirst[lo + 1] - pFirst[lo];
+
+        // a single tile is its own last arriver, it does not touch the shared counters
+        std::atomic<AU1> localCounter(0);
+
+        SPD_DispatchContext<Texel> ctx;
+        ctx.hooks.pSrc = &image.src;
+        ctx.hooks.srcY = 0;
+        ctx.hooks.pDst = image.pDst;
+        ctx.hooks.dstStride = AU1(image.mips);
+        ctx.hooks.pCounter = numWorkGroups == 1 ? &localCounter : &batch.pBatch->pCounters[lo];
+        ctx.hooks.pBlockCounter = NULL;
+        ctx.hooks.blockCount = 1;
+        ctx.hooks.texelSize = batch.texelSize;
+        ctx.hooks.reduction = batch.reduction;
+        ctx.hooks.pWeight = batch.pWeight;
+        ctx.pPool = batch.pPool;
+        ctx.pKernels = batch.pKernels;
+        ctx.dispatchX = (image.src.Width + 63) >> 6;
+        ctx.firstWorkGroupY = 0;
+        ctx.sliceWorkGroups = numWorkGroups;
+        ctx.numWorkGroups = numWorkGroups;
+        ctx.dispatchY = numWorkGroups / ctx.dispatchX;
+        ctx.mips = AU1(image.mips);
+        ctx.packed = batch.packed && Texel::packable;
+        ctx.extended = false;
+        ctx.histogram = false;
+        ctx.coverage = false;
+        ctx.filter = 0;
+        ctx.pDirtyTiles = NULL;
+        ctx.residency = false;
+        ctx.hooks.pResidency = NULL;
+        ctx.hooks.pQuads = NULL;
+        ctx.splitTail = false;
+        ctx.waveSize = 0;
+
+        DispatchWorkGroup<Texel>(&ctx, workGroup - pFirst[lo], workerIndex);
+    }
+
+    template<class Texel>
+    static void DispatchBatchTiles(SPD_ThreadPool &pool, SPD_Batch &state, const SPD_BatchImage *pImages, uint32_t imageCount, bool packed, size_t texelSize, const SPD_Kernels *pKernels, SPD_Reduction reduction, SPD_WeightFn pWeight)
+    {
+        SPD_BatchContext<Texel> ctx;
+        ctx.pImages = pImages;
+        ctx.imageCount = imageCount;
+        ctx.pBatch = &state;
+        ctx.pPool = &pool;
+        ctx.pKernels = pKernels;
+        ctx.reduction = reduction;
+        ctx.pWeight = pWeight;
+        ctx.texelSize = texelSize;
+        ctx.packed = packed;
+
+        pool.Run(state.firstWorkGroup[imageCount], &DispatchBatchWorkGroup<Texel>, &ctx);
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Streaming state, see SPD_CPU::BeginRows
+    //--------------------------------------------------------------------------------------
+    struct SPD_Stream
+    {
+        SPD_Image dst[SPD_MAX_MIP_LEVELS];
+        int mips;
+        uint32_t width;
+        uint32_t height;
+        uint32_t row; // rows added so far
+        std::atomic<AU1> counter;
+        AU1 numWorkGroups;
+
+        // the current band of 64 source rows, kept between streams
+        std::vector<uint8_t> band;
+        size_t bandPitch;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // SPD_CPU
+    //--------------------------------------------------------------------------------------
+    void SPD_CPU::OnCreate(SPD_Format format, bool packed, uint32_t threadCount, SPD_ISA isa)
+    {
+        m_format = format;
+        m_packed = packed;
+        m_isa = isa;
+        m_threadCount = threadCount ? threadCount : std::thread::hardware_concurrency();
+        if (m_threadCount == 0)
+            m_threadCount = 1;
+
+        m_pPool = new SPD_ThreadPool();
+        m_pPool->OnCreate(m_threadCount);
+        m_pStream = NULL;
+        m_pBatch = NULL;
+        m_pHistogram = new SPD_Histogram();
+        m_pCoverage = new SPD_Coverage();
+        m_pKernels = new SPD_Kernels();
+        SetResidency(NULL);
+        SetSplitTail(false);
+        SetWaveSize(0);
+        SetReduction(SPD_Reduction::SPD_Average);
+    }
+
+    void SPD_CPU::OnDestroy()
+    {
+        delete m_pStream;
+        m_pStream = NULL;
+        delete m_pBatch;
+        m_pBatch = NULL;
+        delete m_pHistogram;
+        m_pHistogram = NULL;
+        delete m_pCoverage;
+        m_pCoverage = NULL;
+        delete m_pKernels;
+        m_pKernels = NULL;
+
+        m_pPool->OnDestroy();
+        delete m_pPool;
+        m_pPool = NULL;
+    }
+
+    void SPD_CPU::SetReduction(SPD_Reduction reduction, SPD_WeightFn pWeight)
+    {
+        assert(reduction != SPD_Reduction::SPD_Weighted || pWeight);
+        m_reduction = reduction;
+        m_pWeight = pWeight;
+
+        // the kernels run the reduction in ReduceRowsColumnOrder and ReduceRowsRowOrder
+        const SPD_Kernels &kernels = SPD_GetKernels(m_isa);
+        *m_pKernels = kernels;
+        const SPD_ReduceRowsFn *pReduceRows = NULL;
+        switch (reduction)
+        {
+        case SPD_Reduction::SPD_Min:
+            pReduceRows = kernels.ReduceRowsMin;
+            break;
+        case SPD_Reduction::SPD_Max:
+            pReduceRows = kernels.ReduceRowsMax;
+            break;
+        case SPD_Reduction::SPD_MinMax:
+            pReduceRows = kernels.ReduceRowsMinMax;
+            break;
+        case SPD_Reduction::SPD_Sum:
+            pReduceRows = kernels.ReduceRowsSum;
+            break;
+        default:
+            break;
+        }
+        if (pReduceRows)
+        {
+            m_pKernels->ReduceRowsColumnOrder = pReduceRows[0];
+            m_pKernels->ReduceRowsRowOrder = pReduceRows[1];
+        }
+    }
+
+    void SPD_CPU::SetHistogram(uint32_t bins, float minLog2Luminance, float log2LuminanceRange, float lowPercentile, float highPercentile)
+    {
+        assert(bins == 0 || (bins >= 2 && bins <= SPD_HISTOGRAM_MAX_BINS && !IsDepth(m_format)));
+        assert(log2LuminanceRange > 0.0f && lowPercentile >= 0.0f && lowPercentile <= highPercentile && highPercentile <= 1.0f);
+        SpdHistogramParams &params = m_pHistogram->params;
+        params.bins = bins;
+        params.minLog2Luminance = minLog2Luminance;
+        params.log2Range = log2LuminanceRange;
+        params.lowPercentile = lowPercentile;
+        params.highPercentile = highPercentile;
+    }
+
+    SPD_Exposure SPD_CPU::GetExposure(uint32_t slice) const
+    {
+        assert(slice < m_pHistogram->exposure.size());
+        return m_pHistogram->exposure[slice];
+    }
+
+    void SPD_CPU::GetHistogram(uint32_t slice, uint32_t *pBins) const
+    {
+        assert(slice < m_pHistogram->exposure.size());
+        uint32_t bins = m_pHistogram->params.bins;
+        for (uint32_t i = 0; i < bins; i++)
+            pBins[i] = m_pHistogram->counts[slice * bins + i];
+    }
+
+    void SPD_CPU::SetAlphaCoverage(float alphaReference)
+    {
+        assert(alphaReference >= 0.0f && alphaReference <= 1.0f && !IsDepth(m_format));
+        m_pCoverage->params.alphaReference = alphaReference;
+    }
+
+    float SPD_CPU::GetAlphaScale(int mip, uint32_t slice) const
+    {
+        assert(mip >= 0 && mip < m_pCoverage->mips && (slice + 1) * m_pCoverage->mips <= m_pCoverage->alphaScales.size());
+        return m_pCoverage->alphaScales[slice * m_pCoverage->mips + mip];
+    }
+
+    void SPD_CPU::SetResidency(const uint32_t *pResidency, const float *pFill)
+    {
+        m_pResidency = pResidency;
+        for (int i = 0; i < 4; i++)
+            m_residencyFill[i] = pFill ? pFill[i] : 0.0f;
+    }
+
+    void SPD_CPU::SetSplitTail(bool splitTail)
+    {
+        m_splitTail = splitTail;
+    }
+
+    void SPD_CPU::SetWaveSize(uint32_t waveSize)
+    {
+        m_waveSize = waveSize;
+    }
+
+    const SPD_Kernels *SPD_CPU::GetKernels() const
+    {
+        bool unorm = m_format != SPD_Format::SPD_R32G32B32A32_FLOAT && m_format != SPD_Format::SPD_R16G16B16A16_FLOAT;
+        switch (m_reduction)
+        {
+        case SPD_Reduction::SPD_Average:
+            return m_pKernels;
+        case SPD_Reduction::SPD_Min:
+        case SPD_Reduction::SPD_Max:
+        case SPD_Reduction::SPD_MinMax:
+        case SPD_Reduction::SPD_Sum:
+            // the integer kernels only average
+            return unorm ? NULL : m_pKernels;
+        default:
+            return NULL;
+        }
+    }
+
+    int SPD_CPU::GetMaxMipLevelCount(uint32_t Width, uint32_t Height)
+    {
+        uint32_t resolution = Width > Height ? Width : Height;
+        int levels = 1 + (int)floor(log2((double)resolution));
+        return (levels < SPD_MAX_MIP_LEVELS ? levels : SPD_MAX_MIP_LEVELS) - 1;
+    }
+
+    uint32_t SPD_CPU::GetBytesPerTexel(SPD_Format format)
+    {
+        switch (format)
+        {
+        case SPD_Format::SPD_R32G32B32A32_FLOAT:
+            return 16;
+        case SPD_Format::SPD_R16G16B16A16_FLOAT:
+            return 8;
+        case SPD_Format::SPD_R8G8B8A8_UNORM:
+        case SPD_Format::SPD_R8G8B8A8_UNORM_SRGB:
+            return 4;
+        case SPD_Format::SPD_R16_UNORM:
+            return 2;
+        case SPD_Format::SPD_R32_FLOAT_DEPTH:
+        case SPD_Format::SPD_R32_FLOAT_DEPTH_REVERSED_Z:
+            return 4;
+        }
+        return 0;
+    }
+
+    void SPD_CPU::DispatchTiles(const SPD_Image *pSrc, uint32_t sliceCount, uint32_t srcY, const SPD_Image *pDst, int mips, std::atomic<AU1> *pCounters, uint32_t numWorkGroups, const uint32_t *pDirtyTiles, bool residency, bool splitTail, uint32_t waveSize)
+    {
+        size_t texelSize = GetBytesPerTexel(m_format);
+        const AU1 *pResidency = residency ? m_pResidency : NULL;
+        SPD_Histogram *pHistogram = m_pHistogram->params.bins ? m_pHistogram : NULL;
+        SPD_Coverage *pCoverage = m_pCoverage->params.alphaReference > 0.0f ? m_pCoverage : NULL;
+        AF1 *pQuads = splitTail ? m_pBatch->GetQuads(sliceCount) : NULL;
+        switch (m_format)
+        {
+        case SPD_Format::SPD_R32G32B32A32_FLOAT:
+            FFX_CPU::DispatchTiles<SPD_TexelR32G32B32A32>(*m_pPool, pSrc, sliceCount, srcY, pDst, mips, m_packed, texelSize, GetKernels(), m_reduction, m_pWeight, pCounters, numWorkGroups, pHistogram, pCoverage, pDirtyTiles, pResidency, m_residencyFill, pQuads, waveSize);
+            break;
+        case SPD_Format::SPD_R16G16B16A16_FLOAT:
+            FFX_CPU::DispatchTiles<SPD_TexelR16G16B16A16>(*m_pPool, pSrc, sliceCount, srcY, pDst, mips, m_packed, texelSize, GetKernels(), m_reduction, m_pWeight, pCounters, numWorkGroups, pHistogram, pCoverage, pDirtyTiles, pResidency, m_residencyFill, pQuads, waveSize);
+            break;
+        case SPD_Format::SPD_R8G8B8A8_UNORM:
+            FFX_CPU::DispatchTiles<SPD_TexelR8G8B8A8<false> >(*m_pPool, pSrc, sliceCount, srcY, pDst, mips, m_packed, texelSize, GetKernels(), m_reduction, m_pWeight, pCounters, numWorkGroups, pHistogram, pCoverage, pDirtyTiles, pResidency, m_residencyFill, pQuads, waveSize);
+            break;
+        case SPD_Format::SPD_R8G8B8A8_UNORM_SRGB:
+            FFX_CPU::DispatchTiles<SPD_TexelR8G8B8A8<true> >(*m_pPool, pSrc, sliceCount, srcY, pDst, mips, m_packed, texelSize, GetKernels(), m_reduction, m_pWeight, pCounters, numWorkGroups, pHistogram, pCoverage, pDirtyTiles, pResidency, m_residencyFill, pQuads, waveSize);
+            break;
+        case SPD_Format::SPD_R16_UNORM:
+            FFX_CPU::DispatchTiles<SPD_TexelR16>(*m_pPool, pSrc, sliceCount, srcY, pDst, mips, m_packed, texelSize, GetKernels(), m_reduction, m_pWeight, pCounters, numWorkGroups, pHistogram, pCoverage, pDirtyTiles, pResidency, m_residencyFill, pQuads, waveSize);
+            break;
+        case SPD_Format::SPD_R32_FLOAT_DEPTH:
+        case SPD_Format::SPD_R32_FLOAT_DEPTH_REVERSED_Z:
+            // the footprints of the last row of a band reach into the next one
+            assert(srcY == 0 && numWorkGroups == ((pSrc->Width + 63) >> 6) * ((pSrc->Height + 63) >> 6));
+            DispatchDepthTiles(*m_pPool, pSrc, sliceCount, pDst, mips, m_format == SPD_Format::SPD_R32_FLOAT_DEPTH_REVERSED_Z, pCounters);
+            break;
+        }
+    }
+
+    void SPD_CPU::Dispatch(const SPD_Image &src, const SPD_Image *pDst, int mips)
+    {
+        Dispatch(&src, 1, pDst, mips);
+    }
+
+    void SPD_CPU::Dispatch(const SPD_Image *pSrc, uint32_t sliceCount, const SPD_Image *pDst, int mips)
+    {
+        assert(mips >= 1 && mips <= SPD_MAX_MIP_LEVELS);
+        assert(pSrc[0].Width <= SPD_MAX_EXTENDED_SIZE && pSrc[0].Height <= SPD_MAX_EXTENDED_SIZE);
+        assert(!IsDepth(m_format) || (pSrc[0].Width <= 4096 && pSrc[0].Height <= 4096));
+        assert(!m_pHistogram->params.bins || (pSrc[0].Width <= 4096 && pSrc[0].Height <= 4096));
+        assert(!GetFilter(m_reduction) || (pSrc[0].Width <= 4096 && pSrc[0].Height <= 4096 && !m_pHistogram->params.bins));
+        assert(m_pCoverage->params.alphaReference == 0.0f || (pSrc[0].Width <= 4096 && pSrc[0].Height <= 4096 && !m_pHistogram->params.bins && !GetFilter(m_reduction)));
+        assert(!m_pResidency || (!IsDepth(m_format) && !m_pHistogram->params.bins && !GetFilter(m_reduction) && m_pCoverage->params.alphaReference == 0.0f));
+        for (uint32_t i = 1; i < sliceCount; i++)
+            assert(pSrc[i].Width == pSrc[0].Width && pSrc[i].Height == pSrc[0].Height);
+        if (sliceCount == 0) return;
+
+        // sources larger than 4096x4096 have one more counter per block of 64x64 tiles and slice, the split tail per quad
+        uint32_t dispatchX = (pSrc[0].Width + 63) >> 6;
+        uint32_t dispatchY = (pSrc[0].Height + 63) >> 6;
+        uint32_t blockCount = dispatchX > 64 || dispatchY > 64 ? ((dispatchX + 63) / 64) * ((dispatchY + 63) / 64) : 0;
+        if (m_splitTail && blockCount == 0)
+            blockCount = ((dispatchX + 3) / 4) * ((dispatchY + 3) / 4);
+
+        if (!m_pBatch)
+            m_pBatch = new SPD_Batch();
+        std::atomic<AU1> *pCounters = m_pBatch->GetCounters(sliceCount * (1 + blockCount));
+        if (m_pHistogram->params.bins)
+            m_pHistogram->Reset(sliceCount);
+        if (m_pCoverage->params.alphaReference > 0.0f)
+            m_pCoverage->Reset(sliceCount, pSrc[0].Width, pSrc[0].Height, mips);
+        DispatchTiles(pSrc, sliceCount, 0, pDst, mips, pCounters, dispatchX * dispatchY, NULL, true, m_splitTail, m_waveSize);
+    }
+
+    void SPD_CPU::DispatchDirty(const SPD_Image &src, const SPD_Image *pDst, int mips, const SPD_Rect *pRects, uint32_t rectCount)
+    {
+        assert(mips >= 1 && mips <= SPD_MAX_MIP_LEVELS);
+        assert(src.Width <= 4096 && src.Height <= 4096);
+        assert(!IsDepth(m_format) && !m_pHistogram->params.bins && !GetFilter(m_reduction) && m_pCoverage->params.alphaReference == 0.0f);
+        static_assert(sizeof(SPD_Rect) == sizeof(AU1) * 4, "SpdSetupDirtyTiles reads the rectangles as x, y, width and height");
+
+        AU1 tiles[SPD_DIRTY_MAX_TILES];
+        AU1 tileCount = SpdSetupDirtyTiles(tiles, (const AU1*)pRects, rectCount, src.Width, src.Height);
+        if (tileCount == 0) return;
+
+        if (!m_pBatch)
+            m_pBatch = new SPD_Batch();
+        std::atomic<AU1> *pCounters = m_pBatch->GetCounters(1);
+        DispatchTiles(&src, 1, 0, pDst, mips, pCounters, tileCount, tiles);
+    }
+
+    void SPD_CPU::Dispatch(const SPD_Image &src, const SPD_MipChain &chain)
+    {
+        Dispatch(src, chain.GetMips(), chain.GetMipCount());
+    }
+
+    void SPD_CPU::DispatchMipRange(const SPD_Image *pMips, int baseMip, int mipCount)
+    {
+        assert(baseMip >= 0 && mipCount >= 1 && baseMip + mipCount < SPD_MAX_MIP_LEVELS);
+        // mip i of the chain is mip i - baseMip - 1 of a dispatch of mip baseMip, the sizes match for any size of the source
+        const SPD_Image &src = pMips[baseMip];
+        assert(pMips[baseMip + 1].Width == GetMipDimension(src.Width, 0) && pMips[baseMip + 1].Height == GetMipDimension(src.Height, 0));
+        Dispatch(src, pMips + baseMip + 1, mipCount);
+    }
+
+    void SPD_CPU::DispatchBatch(const SPD_BatchImage *pImages, uint32_t imageCount)
+    {
+        assert(!IsDepth(m_format) && !m_pHistogram->params.bins && !GetFilter(m_reduction) && m_pCoverage->params.alphaReference == 0.0f);
+        if (imageCount == 0) return;
+
+        if (!m_pBatch)
+            m_pBatch = new SPD_Batch();
+        SPD_Batch &batch = *m_pBatch;
+        batch.GetCounters(imageCount);
+
+        batch.firstWorkGroup.resize(imageCount + 1);
+        AU1 workGroups = 0;
+        for (uint32_t i = 0; i < imageCount; i++)
+        {
+            const SPD_BatchImage &image = pImages[i];
+            assert(image.mips >= 1 && image.mips <= SPD_MAX_MIP_LEVELS);
+            assert(image.src.Width <= 4096 && image.src.Height <= 4096);
+
+            batch.firstWorkGroup[i] = workGroups;
+            workGroups += ((image.src.Width + 63) >> 6) * ((image.src.Height + 63) >> 6);
+        }
+        batch.firstWorkGroup[imageCount] = workGroups;
+
+        size_t texelSize = GetBytesPerTexel(m_format);
+        const SPD_Kernels *pKernels = GetKernels();
+        switch (m_format)
+        {
+        case SPD_Format::SPD_R32G32B32A32_FLOAT:
+            DispatchBatchTiles<SPD_TexelR32G32B32A32>(*m_pPool, batch, pImages, imageCount, m_packed, texelSize, pKernels, m_reduction, m_pWeight);
+            break;
+        case SPD_Format::SPD_R16G16B16A16_FLOAT:
+            DispatchBatchTiles<SPD_TexelR16G16B16A16>(*m_pPool, batch, pImages, imageCount, m_packed, texelSize, pKernels, m_reduction, m_pWeight);
+            break;
+        case SPD_Format::SPD_R8G8B8A8_UNORM:
+            DispatchBatchTiles<SPD_TexelR8G8B8A8<false> >(*m_pPool, batch, pImages, imageCount, m_packed, texelSize, pKernels, m_reduction, m_pWeight);
+            break;
+        case SPD_Format::SPD_R8G8B8A8_UNORM_SRGB:
+            DispatchBatchTiles<SPD_TexelR8G8B8A8<true> >(*m_pPool, batch, pImages, imageCount, m_packed, texelSize, pKernels, m_reduction, m_pWeight);
+            break;
+        case SPD_Format::SPD_R16_UNORM:
+            DispatchBatchTiles<SPD_TexelR16>(*m_pPool, batch, pImages, imageCount, m_packed, texelSize, pKernels, m_reduction, m_pWeight);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void SPD_CPU::BeginRows(uint32_t Width, uint32_t Height, const SPD_Image *pDst, int mips)
+    {
+        assert(mips >= 1 && mips <= SPD_MAX_MIP_LEVELS);
+        assert(Width <= 4096 && Height <= 4096);
+        assert(!IsDepth(m_format) && !GetFilter(m_reduction));
+        assert(!m_pHistogram->params.bins || m_pCoverage->params.alphaReference == 0.0f);
+
+        if (!m_pStream)
+            m_pStream = new SPD_Stream();
+        assert(m_pStream->row == m_pStream->height && "BeginRows called before the previous stream was complete");
+
+        SPD_Stream &stream = *m_pStream;
+        for (int i = 0; i < mips; i++)
+            stream.dst[i] = pDst[i];
+        stream.mips = mips;
+        stream.width = Width;
+        stream.height = Height;
+        stream.row = 0;
+        stream.counter.store(0, std::memory_order_relaxed);
+        if (m_pHistogram->params.bins)
+            m_pHistogram->Reset(1);
+        if (m_pCoverage->params.alphaReference > 0.0f)
+            m_pCoverage->Reset(1, Width, Height, mips);
+        stream.numWorkGroups = ((Width + 63) >> 6) * ((Height + 63) >> 6);
+        stream.bandPitch = size_t(Width) * GetBytesPerTexel(m_format);
+        stream.band.resize(stream.bandPitch * 64);
+    }
+
+    void SPD_CPU::AddRows(const void *pRows, size_t RowPitch, uint32_t rowCount)
+    {
+        SPD_Stream &stream = *m_pStream;
+        assert(stream.row + rowCount <= stream.height);
+
+        const uint8_t *pSrc = (const uint8_t*)pRows;
+        while (rowCount > 0)
+        {
+            uint32_t bandY = stream.row & ~63u;
+            uint32_t bandHeight = stream.height - bandY < 64 ? stream.height - bandY : 64;
+            uint32_t bandRow = stream.row - bandY;
+
+            // a complete band in the rows of the caller is used in place
+            if (bandRow == 0 && rowCount >= bandHeight)
+            {
+                SPD_Image band = { (void*)pSrc, stream.width, bandHeight, RowPitch };
+                DispatchTiles(&band, 1, bandY, stream.dst, stream.mips, &stream.counter, stream.numWorkGroups);
+                stream.row += bandHeight;
+                pSrc += bandHeight * RowPitch;
+                rowCount -= bandHeight;
+                continue;
+            }
+
+            uint32_t count = bandHeight - bandRow < rowCount ? bandHeight - bandRow : rowCount;
+            for (uint32_t y = 0; y < count; y++)
+                memcpy(&stream.band[(bandRow + y) * stream.bandPitch], pSrc + y * RowPitch, stream.bandPitch);
+            stream.row += count;
+            pSrc += count * RowPitch;
+            rowCount -= count;
+
+            if (bandRow + count == bandHeight)
+            {
+                SPD_Image band = { stream.band.data(), stream.width, bandHeight, stream.bandPitch };
+                DispatchTiles(&band, 1, bandY, stream.dst, stream.mips, &stream.counter, stream.numWorkGroups);
+            }
+        }
+    }
+
+    bool SPD_CPU::IsStreamComplete() const
+    {
+        return m_pStream == NULL || m_pStream->row == m_pStream->height;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Out of core
+    //--------------------------------------------------------------------------------------
+    int SPD_CPU::GetMaxFileMipLevelCount(uint32_t Width, uint32_t Height)
+    {
+        uint32_t resolution = Width > Height ? Width : Height;
+        return (int)floor(log2((double)resolution));
+    }
+
+    uint64_t SPD_CPU::GetMipFileOffset(uint32_t Width, uint32_t Height, int mip) const
+    {
+        // mips start on a page boundary, so the hints never touch the pages of another mip
+        const uint64_t alignment = 4096;
+        uint64_t offset = 0;
+        for (int i = 0; i < mip; i++)
+        {
+            uint64_t size = uint64_t(GetMipDimension(Width, i)) * GetMipDimension(Height, i) * GetBytesPerTexel(m_format);
+            offset += (size + alignment - 1) & ~(alignment - 1);
+        }
+        return offset;
+    }
+
+    void SPD_CPU::DispatchBands(SPD_MappedFile &srcFile, const SPD_Image &src, SPD_MappedFile &dstFile, const SPD_Image *pDst, int mips)
+    {
+        std::atomic<AU1> counter(0);
+        uint32_t numWorkGroups = ((src.Width + 63) >> 6) * ((src.Height + 63) >> 6);
+        uint64_t srcOffset = uint64_t((const uint8_t*)src.pData - srcFile.GetData());
+        uint64_t dstOffset = uint64_t((const uint8_t*)pDst[0].pData - dstFile.GetData());
+        uint64_t bandSize = uint64_t(src.RowPitch) * 64;
+
+        srcFile.WillNeed(srcOffset, bandSize);
+        for (uint32_t bandY = 0; bandY < src.Height; bandY += 64)
+        {
+            uint64_t bandOffset = srcOffset + uint64_t(bandY) * src.RowPitch;
+            srcFile.WillNeed(bandOffset + bandSize, bandSize);
+
+            SPD_Image band = { (uint8_t*)src.pData + size_t(bandY) * src.RowPitch, src.Width, src.Height - bandY < 64 ? src.Height - bandY : 64, src.RowPitch };
+            DispatchTiles(&band, 1, bandY, pDst, mips, &counter, numWorkGroups);
+
+            // the band is not read again, and its 32 rows of mip 0 are written back while the next band runs
+            srcFile.DontNeed(bandOffset, bandSize);
+            dstFile.Flush(dstOffset + uint64_t(bandY / 2) * pDst[0].RowPitch, uint64_t(pDst[0].RowPitch) * 32);
+        }
+    }
+
+    bool SPD_CPU::DispatchFile(const char *pSrcPath, uint64_t srcOffset, uint32_t Width, uint32_t Height, const char *pDstPath, int mips)
+    {
+        assert(mips >= 1 && mips <= GetMaxFileMipLevelCount(Width, Height));
+        assert(!IsDepth(m_format) && !m_pHistogram->params.bins && !GetFilter(m_reduction) && m_pCoverage->params.alphaReference == 0.0f);
+
+        size_t texelSize = GetBytesPerTexel(m_format);
+        SPD_MappedFile srcFile;
+        if (!srcFile.OnCreate(pSrcPath, 0))
+            return false;
+        if (srcFile.GetSize() < srcOffset + uint64_t(Width) * Height * texelSize)
+        {
+            srcFile.OnDestroy();
+            return false;
+        }
+
+        SPD_MappedFile dstFile;
+        if (!dstFile.OnCreate(pDstPath, GetMipFileOffset(Width, Height, mips)))
+        {
+            srcFile.OnDestroy();
+            return false;
+        }
+
+        std::vector<SPD_Image> dst(mips);
+        for (int i = 0; i < mips; i++)
+        {
+            dst[i].Width = GetMipDimension(Width, i);
+            dst[i].Height = GetMipDimension(Height, i);
+            dst[i].RowPitch = dst[i].Width * texelSize;
+            dst[i].pData = dstFile.GetData() + GetMipFileOffset(Width, Height, i);
+        }
+
+        // the first level reads the source file, every further one reads mip 5 of the level before
+        SPD_Image src = { srcFile.GetData() + srcOffset, Width, Height, Width * texelSize };
+        SPD_MappedFile *pSrcFile = &srcFile;
+        for (int mip = 0; mip < mips; mip += 6)
+        {
+            // mips 6..11 of a level come from a single tile of mip 5, which covers at most 4096x4096 of the level source
+            int levelMips = mips - mip;
+            if ((src.Width > 4096 || src.Height > 4096) && levelMips > 6)
+                levelMips = 6;
+
+            DispatchBands(*pSrcFile, src, dstFile, &dst[mip], levelMips);
+            if (levelMips != 6 || mip + 6 >= mips)
+                break;
+
+            src = dst[mip + 5];
+            pSrcFile = &dstFile;
+        }
+
+        dstFile.OnDestroy();
+        srcFile.OnDestroy();
+        return true;
+    }
+}
@@ -0,0 +1,254 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+namespace FFX_CPU
+{
+#define SPD_MAX_MIP_LEVELS 18
+// Dispatch: sources larger than 4096x4096 run in the extended mode, which has mips 12..17 as a third stage
+#define SPD_MAX_EXTENDED_SIZE (4096 * 64)
+
+    class SPD_ThreadPool;
+    struct SPD_Kernels;
+    struct SPD_Stream;
+    struct SPD_Batch;
+    class SPD_MappedFile;
+    class SPD_MipChain;
+    struct SPD_Histogram;
+    struct SPD_Coverage;
+
+    enum class SPD_Format
+    {
+        SPD_R32G32B32A32_FLOAT,
+        SPD_R16G16B16A16_FLOAT,
+        // averaged as integers with round to nearest, sRGB in linear space, packed is ignored
+        SPD_R8G8B8A8_UNORM,
+        SPD_R8G8B8A8_UNORM_SRGB,
+        SPD_R16_UNORM,
+        // Hierarchical Z of a depth buffer, see DEPTH VERSION in ffx_spd.h: the farthest depth of a 2x2 footprint,
+        // 3 texels wide or high where the parent size is odd, so the mips stay conservative for any size.
+        // Dispatch only, up to 4096x4096, packed and the reduction are ignored.
+        SPD_R32_FLOAT_DEPTH, // farthest is the maximum
+        SPD_R32_FLOAT_DEPTH_REVERSED_Z, // farthest is the minimum
+    };
+
+    // Instruction set used by the reduction kernels.
+    enum class SPD_ISA
+    {
+        SPD_Auto, // best supported by the CPU
+        SPD_Scalar,
+        SPD_SSE41,
+        SPD_AVX2,
+        SPD_AVX512,
+    };
+
+    // Reduction of the 2x2 texels, see BUILT-IN REDUCTIONS in ffx_spd.h and ffx_spd_cpu.h.
+    // Average, min, max, min/max and sum of the float formats run on the SIMD kernels, everything else on the hooks.
+    enum class SPD_Reduction
+    {
+        SPD_Average,
+        SPD_Min,
+        SPD_Max,
+        SPD_MinMax, // minimum in R and B, maximum in G and A
+        SPD_Sum,
+        SPD_Luminance, // weights 1 / (1 + luma)
+        SPD_Premultiplied, // straight alpha averaged as premultiplied
+        SPD_Weighted, // weights of SPD_WeightFn
+        // Normal maps with the roughness alpha in A, see SPD_REDUCTION_NORMAL in ffx_spd.h: the normals are renormalized and the
+        // length they lose goes into the roughness (Toksvig). UNORM formats hold the normals as n * 0.5 + 0.5.
+        SPD_Normal,
+        // Separable filters over 4x4 and 6x6 texels of the parent instead of the 2x2 average, see FILTER VERSION in ffx_spd.h.
+        // Negative lobes are clamped to 0 with UNORM formats. Dispatch only, up to 4096x4096, packed is ignored.
+        SPD_Binomial, // 1 3 3 1
+        SPD_Kaiser, // Kaiser windowed sinc, radius 3 of the source
+        SPD_Lanczos, // Lanczos 3
+    };
+
+    // Weight of a texel for SPD_Weighted, RGBA with UNORM formats in 0..1.
+    typedef float (*SPD_WeightFn)(const float *pTexel);
+
+    // Exposure of a slice from the luminance histogram of mip 0, see HISTOGRAM in ffx_spd.h.
+    // Rec. 709 luminance of the texels, UNORM formats in 0..1.
+    struct SPD_Exposure
+    {
+        float average; // geometric mean of the texels of mip 0 not below the range
+        float percentileAverage; // geometric mean of the texels between the two percentiles
+        float low; // luminance at the low percentile
+        float high; // luminance at the high percentile
+    };
+
+    // One 2D image in system memory: a source or one mip of the destination.
+    struct SPD_Image
+    {
+        void *pData;
+        uint32_t Width;
+        uint32_t Height;
+        size_t RowPitch; // in bytes
+    };
+
+    // Texels of a source, see SPD_CPU::DispatchDirty.
+    struct SPD_Rect
+    {
+        uint32_t Left;
+        uint32_t Top;
+        uint32_t Width;
+        uint32_t Height;
+    };
+
+    // One image of a batch, see SPD_CPU::DispatchBatch.
+    struct SPD_BatchImage
+    {
+        SPD_Image src;
+        const SPD_Image *pDst;
+        int mips;
+    };
+
+    // Runs ffx_spd_cpu.h on CPU threads: one job per 64x64 tile, the last finished tile computes mips 6..11.
+    // Sources larger than 4096x4096 use the extended mode: the last tile of every block of 64x64 tiles computes
+    // mips 6..11 of the block, and the last block computes mips 12..17, still in a single run.
+    // The worker threads are created in OnCreate and reused by every Dispatch.
+    class SPD_CPU
+    {
+    public:
+        // threadCount 0 uses all hardware threads, the thread calling Dispatch is one of them.
+        // isa is clamped to what the CPU supports, SPD_Scalar gives bit-identical results to the SIMD kernels.
+        void OnCreate(SPD_Format format, bool packed, uint32_t threadCount = 0, SPD_ISA isa = SPD_ISA::SPD_Auto);
+        void OnDestroy();
+
+        // SPD_Average unless set, applies to the following dispatches. pWeight is only used by SPD_Weighted.
+        // UNORM results are rounded to nearest, sums saturate.
+        void SetReduction(SPD_Reduction reduction, SPD_WeightFn pWeight = NULL);
+
+        // Log2 luminance histogram of mip 0 and the exposure in the same run as the mips, applies to the following dispatches.
+        // bins 0 disables it, otherwise 2..256: bin 0 holds the texels darker than minLog2Luminance, which includes black, and
+        // the other bins split the log2 range evenly. Dispatch and streams up to 4096x4096 only, runs on the hooks.
+        void SetHistogram(uint32_t bins, float minLog2Luminance, float log2LuminanceRange, float lowPercentile = 0.5f, float highPercentile = 0.95f);
+        // of the last Dispatch or stream, pBins receives the count of every bin
+        SPD_Exposure GetExposure(uint32_t slice = 0) const;
+        void GetHistogram(uint32_t slice, uint32_t *pBins) const;
+
+        // Alpha test coverage, see COVERAGE in ffx_spd.h: the alpha of every mip is scaled so that the same fraction of its texels
+        // passes alpha >= alphaReference as of the source, applies to the following dispatches. alphaReference 0 disables it,
+        // UNORM formats in 0..1. Dispatch and streams up to 4096x4096 only, not with the histogram, runs on the hooks.
+        void SetAlphaCoverage(float alphaReference);
+        // of the last Dispatch or stream, the scale applied to the alpha of a mip
+        float GetAlphaScale(int mip, uint32_t slice = 0) const;
+
+        // Sparse sources, see RESIDENCY in ffx_spd.h: the 64x64 tiles of the source that are not resident are neither read nor
+        // written in mips 0..5, mips 6 and up see their texel of mip 5 as pFill (RGBA, NULL is zero, UNORM formats in 0..1), also
+        // the ones of the partial tiles on the right and bottom edge, whose texel lies outside of mip 5.
+        // pResidency has one bit per tile, bit x % 32 of word y * ((tilesX + 31) / 32) + x / 32 is set for a resident tile (x, y),
+        // the bitmaps of the slices follow each other. It is read by the following Dispatch calls until it is set to NULL.
+        // Dispatch only, not with the histogram, the alpha coverage, the filters or depth.
+        void SetResidency(const uint32_t *pResidency, const float *pFill = NULL);
+
+        // Split tail, see SPLIT TAIL in ffx_spd.h: the last tile of every quad of 4x4 tiles computes mips 6 and 7 of the quad,
+        // and the last quad only mips 8..11, which shortens the part of a Dispatch that runs on one thread. Applies to the
+        // following Dispatch calls up to 4096x4096, the histogram, the alpha coverage, the filters, depth and the residency
+        // keep their tails. Mips 8 and up are computed from mip 7 before it is stored, the result is the same as without.
+        void SetSplitTail(bool splitTail);
+
+        // Wave shuffles, see WAVE SHUFFLE in ffx_spd.h: mips 2..5 of every tile run the lanes of a GPU wave of waveSize lanes
+        // one by one, to check the shuffle patterns of the shader for that wave size. The result is the same as without, 0 (the
+        // default) turns it off. Applies to the following Dispatch calls up to 4096x4096 that run on the hooks otherwise, the
+        // kernels are not used then. Only meant for testing, it is slower.
+        void SetWaveSize(uint32_t waveSize);
+
+        // pDst[i] is mip i of the result, which has half the resolution of the source (same as SPD_CS::m_result).
+        // Texels outside of the source read as zero, same as a UAV load on the GPU.
+        void Dispatch(const SPD_Image &src, const SPD_Image *pDst, int mips);
+        // all mips of the chain, Dispatch itself does not allocate memory
+        void Dispatch(const SPD_Image &src, const SPD_MipChain &chain);
+        // Texture arrays and cube maps: pSrc[s] is slice s, pDst[s * mips + i] is mip i of slice s, all slices have the same size.
+        // All slices are one run, every slice has its own counter, so the tails of different slices run concurrently.
+        void Dispatch(const SPD_Image *pSrc, uint32_t sliceCount, const SPD_Image *pDst, int mips);
+
+        // Rebuilds mips baseMip + 1 .. baseMip + mipCount of pMips from mip baseMip, e.g. after mip baseMip was streamed in or to
+        // spread the mips of a texture over frames. The source and the mips up to baseMip are not read. This is a Dispatch with
+        // mip baseMip as the source, which is the same as a Dispatch of the whole chain only for baseMip 5 (the chain also
+        // computes mips 6 and up from the stored mip 5). Other base mips add in another order and round differently, and for
+        // sizes that are not powers of two the texels outside of mip baseMip read zero where the chain reduces the source, which
+        // can change the last column or row of the mips by more than rounding (0.44 for 127x4096 from mip 2).
+        void DispatchMipRange(const SPD_Image *pMips, int baseMip, int mipCount);
+
+        // Incremental update after parts of the source changed, see DIRTY TILES in ffx_spd.h: only the 64x64 tiles that intersect
+        // pRects are downsampled, and of mips 6 and up only the texels above them, so the cost follows the changed area.
+        // The other texels of pDst keep the mips of an earlier dispatch of the source. Up to 4096x4096, not with the histogram,
+        // the alpha coverage or the filters. The result is the one of a Dispatch of the whole source for any size with RGBA32F
+        // and packed formats. Mips 7 and up are computed from the stored mips, so unpacked RGBA16F and UNORM formats, which
+        // store less precision than the tail of a Dispatch keeps, can round differently.
+        void DispatchDirty(const SPD_Image &src, const SPD_Image *pDst, int mips, const SPD_Rect *pRects, uint32_t rectCount);
+
+        // Many images of any size in one parallel run, e.g. thousands of icons.
+        // The tiles of all images share one queue, every image has its own counter for the last arriving tile.
+        // Images up to 64x64 are a single job, which computes all of their mips on one thread.
+        void DispatchBatch(const SPD_BatchImage *pImages, uint32_t imageCount);
+
+        // Streaming: the source arrives row by row from the top, e.g. from an image decoder.
+        // Every band of 64 rows is downsampled as soon as it is complete, the last band also computes mips 6..11.
+        // The working memory is one band (64 rows of the source), independent of the height.
+        void BeginRows(uint32_t Width, uint32_t Height, const SPD_Image *pDst, int mips);
+        // Rows have the format of the SPD_CPU, complete bands are read in place without a copy.
+        void AddRows(const void *pRows, size_t RowPitch, uint32_t rowCount);
+        // true once all rows of the stream were added and the mips are done
+        bool IsStreamComplete() const;
+
+        // Out of core: the source and the result are raw texels in files, which are mapped into memory and never copied.
+        // Tiles are run band by band (64 source rows), which bounds the pages in use, and the pages of finished bands are dropped.
+        // Sources larger than 4096x4096 are reduced hierarchically: mip 5 is the source of the next 6 mips, until 1x1.
+        // The result file is created with the size GetMipFileOffset(Width, Height, mips), mip i starts at GetMipFileOffset(Width, Height, i).
+        bool DispatchFile(const char *pSrcPath, uint64_t srcOffset, uint32_t Width, uint32_t Height, const char *pDstPath, int mips);
+        uint64_t GetMipFileOffset(uint32_t Width, uint32_t Height, int mip) const;
+        // mips down to 1x1, without the limit of SPD_MAX_MIP_LEVELS
+        static int GetMaxFileMipLevelCount(uint32_t Width, uint32_t Height);
+
+        static int GetMaxMipLevelCount(uint32_t Width, uint32_t Height);
+        static uint32_t GetMipDimension(uint32_t dimension, int mip) { uint32_t d = dimension >> (mip + 1); return d > 0 ? d : 1; }
+        static uint32_t GetBytesPerTexel(SPD_Format format);
+
+    private:
+        // NULL if the format and the reduction have no kernels, the hooks run instead
+        const SPD_Kernels *GetKernels() const;
+        // pDirtyTiles is the list of SpdSetupDirtyTiles with numWorkGroups entries, NULL for all tiles
+        // residency skips the tiles that are not resident in m_pResidency, splitTail and waveSize are the ones of a Dispatch
+        void DispatchTiles(const SPD_Image *pSrc, uint32_t sliceCount, uint32_t srcY, const SPD_Image *pDst, int mips, std::atomic<uint32_t> *pCounters, uint32_t numWorkGroups, const uint32_t *pDirtyTiles = NULL, bool residency = false, bool splitTail = false, uint32_t waveSize = 0);
+        void DispatchBands(SPD_MappedFile &srcFile, const SPD_Image &src, SPD_MappedFile &dstFile, const SPD_Image *pDst, int mips);
+
+        SPD_Format m_format;
+        bool m_packed;
+        uint32_t m_threadCount;
+        SPD_ISA m_isa;
+        SPD_Reduction m_reduction;
+        SPD_WeightFn m_pWeight;
+        SPD_Kernels *m_pKernels; // of m_isa, with the reduce kernels of m_reduction
+        SPD_ThreadPool *m_pPool;
+        SPD_Stream *m_pStream;
+        SPD_Batch *m_pBatch;
+        SPD_Histogram *m_pHistogram;
+        SPD_Coverage *m_pCoverage;
+        const uint32_t *m_pResidency;
+        float m_residencyFill[4];
+        bool m_splitTail;
+        uint32_t m_waveSize;
+    };
+}
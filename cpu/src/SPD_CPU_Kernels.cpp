@@ -0,0 +1,300 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "stdafx.h"
+#include "SPD_CPU_Kernels.h"
+
+#if SPD_CPU_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace FFX_CPU
+{
+    //--------------------------------------------------------------------------------------
+    // Scalar kernels, reference for all other instruction sets
+    //--------------------------------------------------------------------------------------
+    // channel c of one output texel, the values in the argument order of SpdReduce4, see SpdReduceMin4 etc.
+    template<SPD_Reduction reduction>
+    static AF1 Reduce4_Scalar(AF1 v0, AF1 v1, AF1 v2, AF1 v3, AU1 c)
+    {
+        switch (reduction)
+        {
+        case SPD_Reduction::SPD_Min:
+            return AMinF1(AMinF1(v0, v1), AMinF1(v2, v3));
+        case SPD_Reduction::SPD_Max:
+            return AMaxF1(AMaxF1(v0, v1), AMaxF1(v2, v3));
+        case SPD_Reduction::SPD_MinMax:
+            return (c & 1) ? AMaxF1(AMaxF1(v0, v1), AMaxF1(v2, v3)) : AMinF1(AMinF1(v0, v1), AMinF1(v2, v3));
+        case SPD_Reduction::SPD_Sum:
+            return v0 + v1 + v2 + v3;
+        default:
+            return (v0 + v1 + v2 + v3) * 0.25f;
+        }
+    }
+
+    template<SPD_Reduction reduction, bool columnOrder>
+    static void ReduceRows_Scalar(AF1 *pDst, const AF1 *pTop, const AF1 *pBottom, AU1 count)
+    {
+        for (AU1 i = 0; i < count; i++)
+        {
+            for (AU1 c = 0; c < 4; c++)
+            {
+                AF1 tl = pTop[i * 8 + c];
+                AF1 tr = pTop[i * 8 + 4 + c];
+                AF1 bl = pBottom[i * 8 + c];
+                AF1 br = pBottom[i * 8 + 4 + c];
+                pDst[i * 4 + c] = columnOrder ? Reduce4_Scalar<reduction>(tl, bl, tr, br, c) : Reduce4_Scalar<reduction>(tl, tr, bl, br, c);
+            }
+        }
+    }
+
+    void SPD_ConvertF16ToF32_Scalar(AF1 *pDst, const AW1 *pSrc, AU1 count)
+    {
+        for (AU1 i = 0; i < count; i++)
+            pDst[i] = AF1_AH1_AU1(pSrc[i]);
+    }
+
+    void SPD_ConvertF32ToF16_Scalar(AW1 *pDst, const AF1 *pSrc, AU1 count)
+    {
+        for (AU1 i = 0; i < count; i++)
+            pDst[i] = AW1(AU1_AH1_AF1(pSrc[i]));
+    }
+
+    void SPD_ReduceRowsRGBAU_Scalar(AU1 *pDst, const AU1 *pTop, const AU1 *pBottom, AU1 count)
+    {
+        for (AU1 i = 0; i < count; i++)
+        {
+            for (AU1 c = 0; c < 4; c++)
+            {
+                pDst[i * 4 + c] = (pTop[i * 8 + c] + pTop[i * 8 + 4 + c] + pBottom[i * 8 + c] + pBottom[i * 8 + 4 + c] + 2) >> 2;
+            }
+        }
+    }
+
+    void SPD_ReduceRowsRU_Scalar(AU1 *pDst, const AU1 *pTop, const AU1 *pBottom, AU1 count)
+    {
+        for (AU1 i = 0; i < count; i++)
+            pDst[i] = (pTop[i * 2] + pTop[i * 2 + 1] + pBottom[i * 2] + pBottom[i * 2 + 1] + 2) >> 2;
+    }
+
+    void SPD_ConvertUnorm8ToU_Scalar(AU1 *pDst, const uint8_t *pSrc, AU1 count)
+    {
+        for (AU1 i = 0; i < count; i++)
+            pDst[i] = AU1(pSrc[i]) * 257;
+    }
+
+    // round(x / 257) for x in 0..65535
+    void SPD_ConvertUToUnorm8_Scalar(uint8_t *pDst, const AU1 *pSrc, AU1 count)
+    {
+        for (AU1 i = 0; i < count; i++)
+            pDst[i] = uint8_t((pSrc[i] * 255 + 32895) >> 16);
+    }
+
+    void SPD_ConvertUnorm16ToU_Scalar(AU1 *pDst, const AW1 *pSrc, AU1 count)
+    {
+        for (AU1 i = 0; i < count; i++)
+            pDst[i] = pSrc[i];
+    }
+
+    void SPD_ConvertUToUnorm16_Scalar(AW1 *pDst, const AU1 *pSrc, AU1 count)
+    {
+        for (AU1 i = 0; i < count; i++)
+            pDst[i] = AW1(pSrc[i]);
+    }
+
+    //--------------------------------------------------------------------------------------
+    // sRGB tables
+    //--------------------------------------------------------------------------------------
+    static AU1 EncodeSRGB(AU1 x)
+    {
+        double l = x / 65535.0;
+        double s = l <= 0.0031308 ? l * 12.92 : 1.055 * pow(l, 1.0 / 2.4) - 0.055;
+        return AU1(s * 255.0 + 0.5);
+    }
+
+    static SPD_SRGBTables BuildSRGBTables()
+    {
+        SPD_SRGBTables t;
+        for (AU1 i = 0; i < 256; i++)
+        {
+            double s = i / 255.0;
+            double l = s <= 0.04045 ? s / 12.92 : pow((s + 0.055) / 1.055, 2.4);
+            t.toLinear[i] = AU1(l * 65535.0 + 0.5);
+            t.toLinear[256 + i] = i * 257;
+        }
+
+        // the curve is monotonic and rises less than one code per bucket, so a bucket holds at most one threshold
+        AU1 code = 0;
+        t.threshold[0] = 0;
+        for (AU1 x = 0; x < 65536; x++)
+        {
+            AU1 e = EncodeSRGB(x);
+            while (code < e)
+                t.threshold[++code] = x;
+            if ((x & 15) == 0)
+                t.bucket[x >> 4] = e;
+        }
+        while (code < 256)
+            t.threshold[++code] = 65536;
+        return t;
+    }
+
+    const SPD_SRGBTables &SPD_GetSRGBTables()
+    {
+        static const SPD_SRGBTables s_tables = BuildSRGBTables();
+        return s_tables;
+    }
+
+    void SPD_ConvertSRGB8ToU_Scalar(AU1 *pDst, const uint8_t *pSrc, AU1 count)
+    {
+        const SPD_SRGBTables &t = SPD_GetSRGBTables();
+        for (AU1 i = 0; i < count; i += 4)
+        {
+            pDst[i + 0] = t.toLinear[pSrc[i + 0]];
+            pDst[i + 1] = t.toLinear[pSrc[i + 1]];
+            pDst[i + 2] = t.toLinear[pSrc[i + 2]];
+            pDst[i + 3] = t.toLinear[256 + pSrc[i + 3]];
+        }
+    }
+
+    void SPD_ConvertUToSRGB8_Scalar(uint8_t *pDst, const AU1 *pSrc, AU1 count)
+    {
+        const SPD_SRGBTables &t = SPD_GetSRGBTables();
+        for (AU1 i = 0; i < count; i += 4)
+        {
+            for (AU1 c = 0; c < 3; c++)
+            {
+                AU1 x = pSrc[i + c];
+                AU1 code = t.bucket[x >> 4];
+                pDst[i + c] = uint8_t(code + (x >= t.threshold[code + 1] ? 1 : 0));
+            }
+            pDst[i + 3] = uint8_t((pSrc[i + 3] * 255 + 32895) >> 16);
+        }
+    }
+
+    static const SPD_Kernels s_kernelsScalar =
+    {
+        SPD_ISA::SPD_Scalar,
+        ReduceRows_Scalar<SPD_Reduction::SPD_Average, true>,
+        ReduceRows_Scalar<SPD_Reduction::SPD_Average, false>,
+        { ReduceRows_Scalar<SPD_Reduction::SPD_Min, true>, ReduceRows_Scalar<SPD_Reduction::SPD_Min, false> },
+        { ReduceRows_Scalar<SPD_Reduction::SPD_Max, true>, ReduceRows_Scalar<SPD_Reduction::SPD_Max, false> },
+        { ReduceRows_Scalar<SPD_Reduction::SPD_MinMax, true>, ReduceRows_Scalar<SPD_Reduction::SPD_MinMax, false> },
+        { ReduceRows_Scalar<SPD_Reduction::SPD_Sum, true>, ReduceRows_Scalar<SPD_Reduction::SPD_Sum, false> },
+        SPD_ConvertF16ToF32_Scalar,
+        SPD_ConvertF32ToF16_Scalar,
+        SPD_ReduceRowsRGBAU_Scalar,
+        SPD_ReduceRowsRU_Scalar,
+        SPD_ConvertUnorm8ToU_Scalar,
+        SPD_ConvertUToUnorm8_Scalar,
+        SPD_ConvertSRGB8ToU_Scalar,
+        SPD_ConvertUToSRGB8_Scalar,
+        SPD_ConvertUnorm16ToU_Scalar,
+        SPD_ConvertUToUnorm16_Scalar,
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Runtime detection
+    //--------------------------------------------------------------------------------------
+#if SPD_CPU_X86
+    static void CpuId(AU1 leaf, AU1 subLeaf, AU1 regs[4])
+    {
+#if defined(_MSC_VER)
+        int r[4];
+        __cpuidex(r, (int)leaf, (int)subLeaf);
+        for (int i = 0; i < 4; i++) regs[i] = (AU1)r[i];
+#else
+        __cpuid_count(leaf, subLeaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+    }
+
+    static AL1 XGetBv()
+    {
+#if defined(_MSC_VER)
+        return _xgetbv(0);
+#else
+        AU1 eax, edx;
+        __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return ((AL1)edx << 32) | eax;
+#endif
+    }
+#endif
+
+    SPD_ISA SPD_DetectISA()
+    {
+#if SPD_CPU_X86
+        AU1 regs[4];
+        CpuId(0, 0, regs);
+        AU1 maxLeaf = regs[0];
+        if (maxLeaf < 1)
+            return SPD_ISA::SPD_Scalar;
+
+        CpuId(1, 0, regs);
+        bool sse41 = (regs[2] & (1u << 19)) != 0;
+        bool osxsave = (regs[2] & (1u << 27)) != 0;
+        bool avx = (regs[2] & (1u << 28)) != 0;
+        bool f16c = (regs[2] & (1u << 29)) != 0;
+        if (!sse41)
+            return SPD_ISA::SPD_Scalar;
+        if (!osxsave || !avx || !f16c)
+            return SPD_ISA::SPD_SSE41;
+
+        // OS has to save the YMM (and ZMM) state
+        AL1 xcr0 = XGetBv();
+        if ((xcr0 & 0x6) != 0x6 || maxLeaf < 7)
+            return SPD_ISA::SPD_SSE41;
+
+        CpuId(7, 0, regs);
+        bool avx2 = (regs[1] & (1u << 5)) != 0;
+        bool avx512f = (regs[1] & (1u << 16)) != 0;
+        if (!avx2)
+            return SPD_ISA::SPD_SSE41;
+        if (avx512f && (xcr0 & 0xe6) == 0xe6)
+            return SPD_ISA::SPD_AVX512;
+        return SPD_ISA::SPD_AVX2;
+#else
+        return SPD_ISA::SPD_Scalar;
+#endif
+    }
+
+    const SPD_Kernels &SPD_GetKernels(SPD_ISA isa)
+    {
+        static const SPD_ISA s_detected = SPD_DetectISA();
+        if (isa == SPD_ISA::SPD_Auto || (int)isa > (int)s_detected)
+            isa = s_detected;
+
+        switch (isa)
+        {
+#if SPD_CPU_X86
+        case SPD_ISA::SPD_SSE41:
+            return SPD_GetKernelsSSE41();
+        case SPD_ISA::SPD_AVX2:
+            return SPD_GetKernelsAVX2();
+        case SPD_ISA::SPD_AVX512:
+            return SPD_GetKernelsAVX512();
+#endif
+        default:
+            return s_kernelsScalar;
+        }
+    }
+}
@@ -0,0 +1,115 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#pragma once
+
+#include "SPD_CPU.h"
+
+namespace FFX_CPU
+{
+    // 2x2 reduction of RGBA32F rows, the SIMD version of SpdReduce4 with the average reduction.
+    // pDst[i] = average(pTop[2i], pTop[2i+1], pBottom[2i], pBottom[2i+1]) for count output texels.
+    // The other reductions with kernels (min, max, min/max and sum) use the same layout, see SpdReduceMin4 etc.
+    // The order of the operations follows the argument order SpdReduce4 gets in ffx_spd_cpu.h, so all kernels
+    // produce bit-identical results to the scalar hooks:
+    // ColumnOrder: ((pTop[2i] + pBottom[2i]) + pTop[2i+1]) + pBottom[2i+1] - SpdReduceLoadSourceImage4, SpdReduceLoad4
+    // RowOrder:    ((pTop[2i] + pTop[2i+1]) + pBottom[2i]) + pBottom[2i+1] - SpdReduceIntermediate, mip 1 and 7
+    typedef void (*SPD_ReduceRowsFn)(AF1 *pDst, const AF1 *pTop, const AF1 *pBottom, AU1 count);
+
+    // fp16 <-> fp32 conversion of count values, bit-identical to AF1_AH1_AU1 and AU1_AH1_AF1:
+    // fp32 to fp16 rounds toward zero and clamps INF and NaN to +-65504.
+    // F16C returns signaling NaNs as quiet NaNs, which makes no difference once they are stored as fp16 again.
+    typedef void (*SPD_ConvertF16ToF32Fn)(AF1 *pDst, const AW1 *pSrc, AU1 count);
+    typedef void (*SPD_ConvertF32ToF16Fn)(AW1 *pDst, const AF1 *pSrc, AU1 count);
+
+    // Integer kernels of the UNORM formats: values are UNORM16 (0..65535) in 32-bit lanes, sRGB is linearized first.
+    // The 2x2 reduction rounds to nearest, (a + b + c + d + 2) >> 2. Integer additions do not depend on the order,
+    // so one kernel serves both argument orders. RGBA reduces 4 channels per texel, R one.
+    typedef void (*SPD_ReduceRowsUFn)(AU1 *pDst, const AU1 *pTop, const AU1 *pBottom, AU1 count);
+    // conversions of count values, UNORM8 and UNORM16 to UNORM16 and back with round to nearest
+    typedef void (*SPD_ConvertUnorm8ToUFn)(AU1 *pDst, const uint8_t *pSrc, AU1 count);
+    typedef void (*SPD_ConvertUToUnorm8Fn)(uint8_t *pDst, const AU1 *pSrc, AU1 count);
+    typedef void (*SPD_ConvertUnorm16ToUFn)(AU1 *pDst, const AW1 *pSrc, AU1 count);
+    typedef void (*SPD_ConvertUToUnorm16Fn)(AW1 *pDst, const AU1 *pSrc, AU1 count);
+
+    struct SPD_Kernels
+    {
+        SPD_ISA isa;
+        SPD_ReduceRowsFn ReduceRowsColumnOrder;
+        SPD_ReduceRowsFn ReduceRowsRowOrder;
+        // [0] ColumnOrder, [1] RowOrder
+        SPD_ReduceRowsFn ReduceRowsMin[2];
+        SPD_ReduceRowsFn ReduceRowsMax[2];
+        SPD_ReduceRowsFn ReduceRowsMinMax[2];
+        SPD_ReduceRowsFn ReduceRowsSum[2];
+        SPD_ConvertF16ToF32Fn ConvertF16ToF32;
+        SPD_ConvertF32ToF16Fn ConvertF32ToF16;
+
+        SPD_ReduceRowsUFn ReduceRowsRGBAU;
+        SPD_ReduceRowsUFn ReduceRowsRU;
+        SPD_ConvertUnorm8ToUFn ConvertUnorm8ToU;
+        SPD_ConvertUToUnorm8Fn ConvertUToUnorm8;
+        SPD_ConvertUnorm8ToUFn ConvertSRGB8ToU; // RGBA, the alpha channel is linear
+        SPD_ConvertUToUnorm8Fn ConvertUToSRGB8;
+        SPD_ConvertUnorm16ToUFn ConvertUnorm16ToU;
+        SPD_ConvertUToUnorm16Fn ConvertUToUnorm16;
+    };
+
+    // Detects the best instruction set supported by the CPU and OS (cpuid + xgetbv).
+    SPD_ISA SPD_DetectISA();
+
+    // Returns the kernels for the requested instruction set, clamped to what the CPU supports.
+    const SPD_Kernels &SPD_GetKernels(SPD_ISA isa);
+
+    // Scalar conversions, also used by the instruction sets without F16C.
+    void SPD_ConvertF16ToF32_Scalar(AF1 *pDst, const AW1 *pSrc, AU1 count);
+    void SPD_ConvertF32ToF16_Scalar(AW1 *pDst, const AF1 *pSrc, AU1 count);
+    void SPD_ReduceRowsRGBAU_Scalar(AU1 *pDst, const AU1 *pTop, const AU1 *pBottom, AU1 count);
+    void SPD_ReduceRowsRU_Scalar(AU1 *pDst, const AU1 *pTop, const AU1 *pBottom, AU1 count);
+    void SPD_ConvertUnorm8ToU_Scalar(AU1 *pDst, const uint8_t *pSrc, AU1 count);
+    void SPD_ConvertUToUnorm8_Scalar(uint8_t *pDst, const AU1 *pSrc, AU1 count);
+    void SPD_ConvertUnorm16ToU_Scalar(AU1 *pDst, const AW1 *pSrc, AU1 count);
+    void SPD_ConvertUToUnorm16_Scalar(AW1 *pDst, const AU1 *pSrc, AU1 count);
+    void SPD_ConvertSRGB8ToU_Scalar(AU1 *pDst, const uint8_t *pSrc, AU1 count);
+    void SPD_ConvertUToSRGB8_Scalar(uint8_t *pDst, const AU1 *pSrc, AU1 count);
+
+    // sRGB8 to linear UNORM16 is one lookup. Linear UNORM16 to sRGB8 is a lookup in 4096 buckets plus one
+    // compare against the rounding threshold of the next code. 32-bit entries, so the SIMD kernels can gather them.
+    struct SPD_SRGBTables
+    {
+        AU1 toLinear[512];  // sRGB codes, then UNORM8 codes for the alpha channel
+        AU1 bucket[4096];   // code of the first value of each bucket of 16 linear values
+        AU1 threshold[257]; // first linear value that rounds to the code
+    };
+    const SPD_SRGBTables &SPD_GetSRGBTables();
+
+    // The AVX2 integer kernels, shared with the AVX-512 kernels.
+    void SPD_ReduceRowsRGBAU_AVX2(AU1 *pDst, const AU1 *pTop, const AU1 *pBottom, AU1 count);
+    void SPD_ReduceRowsRU_AVX2(AU1 *pDst, const AU1 *pTop, const AU1 *pBottom, AU1 count);
+    void SPD_ConvertUnorm8ToU_AVX2(AU1 *pDst, const uint8_t *pSrc, AU1 count);
+    void SPD_ConvertUToUnorm8_AVX2(uint8_t *pDst, const AU1 *pSrc, AU1 count);
+    void SPD_ConvertUnorm16ToU_AVX2(AU1 *pDst, const AW1 *pSrc, AU1 count);
+    void SPD_ConvertUToUnorm16_AVX2(AW1 *pDst, const AU1 *pSrc, AU1 count);
+    void SPD_ConvertSRGB8ToU_AVX2(AU1 *pDst, const uint8_t *pSrc, AU1 count);
+    void SPD_ConvertUToSRGB8_AVX2(uint8_t *pDst, const AU1 *pSrc, AU1 count);
+
+    // Per instruction set kernels, only available on x86.
+    const SPD_Kernels &SPD_GetKernelsSSE41();
+    const SPD_Kernels &SPD_GetKernelsAVX2();
+    const SPD_Kernels &SPD_GetKernelsAVX512();
+}
@@ -0,0 +1,273 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// This file is compiled with -mavx2, keep it free of std:: code so no inline function compiled
+// for AVX2 can be picked by the linker for the rest of the library.
+#include "stdafx.h"
+#include "SPD_CPU_Kernels.h"
+#include <immintrin.h>
+
+namespace FFX_CPU
+{
+    // one or two RGBA texels, the values in the argument order of SpdReduce4
+    template<SPD_Reduction reduction>
+    static __m128 Reduce4_AVX2(__m128 v0, __m128 v1, __m128 v2, __m128 v3)
+    {
+        switch (reduction)
+        {
+        case SPD_Reduction::SPD_Min:
+            return _mm_min_ps(_mm_min_ps(v0, v1), _mm_min_ps(v2, v3));
+        case SPD_Reduction::SPD_Max:
+            return _mm_max_ps(_mm_max_ps(v0, v1), _mm_max_ps(v2, v3));
+        case SPD_Reduction::SPD_MinMax:
+            return _mm_blend_ps(_mm_min_ps(_mm_min_ps(v0, v1), _mm_min_ps(v2, v3)), _mm_max_ps(_mm_max_ps(v0, v1), _mm_max_ps(v2, v3)), 0xa);
+        case SPD_Reduction::SPD_Sum:
+            return _mm_add_ps(_mm_add_ps(_mm_add_ps(v0, v1), v2), v3);
+        default:
+            return _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(v0, v1), v2), v3), _mm_set1_ps(0.25f));
+        }
+    }
+
+    template<SPD_Reduction reduction>
+    static __m256 Reduce4_AVX2(__m256 v0, __m256 v1, __m256 v2, __m256 v3)
+    {
+        switch (reduction)
+        {
+        case SPD_Reduction::SPD_Min:
+            return _mm256_min_ps(_mm256_min_ps(v0, v1), _mm256_min_ps(v2, v3));
+        case SPD_Reduction::SPD_Max:
+            return _mm256_max_ps(_mm256_max_ps(v0, v1), _mm256_max_ps(v2, v3));
+        case SPD_Reduction::SPD_MinMax:
+            return _mm256_blend_ps(_mm256_min_ps(_mm256_min_ps(v0, v1), _mm256_min_ps(v2, v3)), _mm256_max_ps(_mm256_max_ps(v0, v1), _mm256_max_ps(v2, v3)), 0xaa);
+        case SPD_Reduction::SPD_Sum:
+            return _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(v0, v1), v2), v3);
+        default:
+            return _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(v0, v1), v2), v3), _mm256_set1_ps(0.25f));
+        }
+    }
+
+    // Two output texels per 256-bit register.
+    // The even and odd texels of a row are split into separate registers, so every lane reduces its
+    // four values in the same order as the scalar kernel.
+    template<SPD_Reduction reduction, bool columnOrder>
+    static void ReduceRows_AVX2(AF1 *pDst, const AF1 *pTop, const AF1 *pBottom, AU1 count)
+    {
+        AU1 i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            __m256 t01 = _mm256_loadu_ps(pTop + i * 8);
+            __m256 t23 = _mm256_loadu_ps(pTop + i * 8 + 8);
+            __m256 b01 = _mm256_loadu_ps(pBottom + i * 8);
+            __m256 b23 = _mm256_loadu_ps(pBottom + i * 8 + 8);
+            __m256 tEven = _mm256_permute2f128_ps(t01, t23, 0x20);
+            __m256 tOdd = _mm256_permute2f128_ps(t01, t23, 0x31);
+            __m256 bEven = _mm256_permute2f128_ps(b01, b23, 0x20);
+            __m256 bOdd = _mm256_permute2f128_ps(b01, b23, 0x31);
+            __m256 v = columnOrder ? Reduce4_AVX2<reduction>(tEven, bEven, tOdd, bOdd) : Reduce4_AVX2<reduction>(tEven, tOdd, bEven, bOdd);
+            _mm256_storeu_ps(pDst + i * 4, v);
+        }
+        for (; i < count; i++)
+        {
+            __m128 t0 = _mm_loadu_ps(pTop + i * 8);
+            __m128 t1 = _mm_loadu_ps(pTop + i * 8 + 4);
+            __m128 b0 = _mm_loadu_ps(pBottom + i * 8);
+            __m128 b1 = _mm_loadu_ps(pBottom + i * 8 + 4);
+            __m128 v = columnOrder ? Reduce4_AVX2<reduction>(t0, b0, t1, b1) : Reduce4_AVX2<reduction>(t0, t1, b0, b1);
+            _mm_storeu_ps(pDst + i * 4, v);
+        }
+    }
+
+    // F16C, 8 values per instruction
+    static void ConvertF16ToF32_AVX2(AF1 *pDst, const AW1 *pSrc, AU1 count)
+    {
+        AU1 i = 0;
+        for (; i + 8 <= count; i += 8)
+            _mm256_storeu_ps(pDst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(pSrc + i))));
+        SPD_ConvertF16ToF32_Scalar(pDst + i, pSrc + i, count - i);
+    }
+
+    static void ConvertF32ToF16_AVX2(AW1 *pDst, const AF1 *pSrc, AU1 count)
+    {
+        const __m128i absMask = _mm_set1_epi16(0x7fff);
+        const __m128i maxHalf = _mm_set1_epi16(0x7bff);
+        AU1 i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(pSrc + i), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+            // INF and NaN become +-65504, same as AU1_AH1_AF1
+            __m128i special = _mm_cmpgt_epi16(_mm_and_si128(h, absMask), maxHalf);
+            __m128i clamped = _mm_or_si128(_mm_andnot_si128(absMask, h), maxHalf);
+            _mm_storeu_si128((__m128i*)(pDst + i), _mm_blendv_epi8(h, clamped, special));
+        }
+        SPD_ConvertF32ToF16_Scalar(pDst + i, pSrc + i, count - i);
+    }
+
+    // integer kernels, values are UNORM16 in 32-bit lanes
+    void SPD_ReduceRowsRGBAU_AVX2(AU1 *pDst, const AU1 *pTop, const AU1 *pBottom, AU1 count)
+    {
+        const __m256i two = _mm256_set1_epi32(2);
+        AU1 i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            __m256i t01 = _mm256_loadu_si256((const __m256i*)(pTop + i * 8));
+            __m256i t23 = _mm256_loadu_si256((const __m256i*)(pTop + i * 8 + 8));
+            __m256i b01 = _mm256_loadu_si256((const __m256i*)(pBottom + i * 8));
+            __m256i b23 = _mm256_loadu_si256((const __m256i*)(pBottom + i * 8 + 8));
+            __m256i t = _mm256_add_epi32(_mm256_permute2x128_si256(t01, t23, 0x20), _mm256_permute2x128_si256(t01, t23, 0x31));
+            __m256i b = _mm256_add_epi32(_mm256_permute2x128_si256(b01, b23, 0x20), _mm256_permute2x128_si256(b01, b23, 0x31));
+            _mm256_storeu_si256((__m256i*)(pDst + i * 4), _mm256_srli_epi32(_mm256_add_epi32(_mm256_add_epi32(t, b), two), 2));
+        }
+        SPD_ReduceRowsRGBAU_Scalar(pDst + i * 4, pTop + i * 8, pBottom + i * 8, count - i);
+    }
+
+    void SPD_ReduceRowsRU_AVX2(AU1 *pDst, const AU1 *pTop, const AU1 *pBottom, AU1 count)
+    {
+        const __m256i two = _mm256_set1_epi32(2);
+        AU1 i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            // hadd works per 128-bit lane, the permute puts the pair sums back in order
+            __m256i t = _mm256_hadd_epi32(_mm256_loadu_si256((const __m256i*)(pTop + i * 2)), _mm256_loadu_si256((const __m256i*)(pTop + i * 2 + 8)));
+            __m256i b = _mm256_hadd_epi32(_mm256_loadu_si256((const __m256i*)(pBottom + i * 2)), _mm256_loadu_si256((const __m256i*)(pBottom + i * 2 + 8)));
+            __m256i v = _mm256_srli_epi32(_mm256_add_epi32(_mm256_add_epi32(t, b), two), 2);
+            _mm256_storeu_si256((__m256i*)(pDst + i), _mm256_permute4x64_epi64(v, 0xd8));
+        }
+        SPD_ReduceRowsRU_Scalar(pDst + i, pTop + i * 2, pBottom + i * 2, count - i);
+    }
+
+    void SPD_ConvertUnorm8ToU_AVX2(AU1 *pDst, const uint8_t *pSrc, AU1 count)
+    {
+        AU1 i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(pSrc + i));
+            __m256i u0 = _mm256_cvtepu8_epi32(v);
+            __m256i u1 = _mm256_cvtepu8_epi32(_mm_srli_si128(v, 8));
+            _mm256_storeu_si256((__m256i*)(pDst + i), _mm256_or_si256(_mm256_slli_epi32(u0, 8), u0));
+            _mm256_storeu_si256((__m256i*)(pDst + i + 8), _mm256_or_si256(_mm256_slli_epi32(u1, 8), u1));
+        }
+        SPD_ConvertUnorm8ToU_Scalar(pDst + i, pSrc + i, count - i);
+    }
+
+    void SPD_ConvertUToUnorm8_AVX2(uint8_t *pDst, const AU1 *pSrc, AU1 count)
+    {
+        const __m256i round = _mm256_set1_epi32(32895);
+        AU1 i = 0;
+        for (; i + 32 <= count; i += 32)
+        {
+            __m256i v[4];
+            for (AU1 j = 0; j < 4; j++)
+            {
+                // (x * 255 + 32895) >> 16 is round(x / 257)
+                __m256i x = _mm256_loadu_si256((const __m256i*)(pSrc + i + j * 8));
+                v[j] = _mm256_srli_epi32(_mm256_add_epi32(_mm256_sub_epi32(_mm256_slli_epi32(x, 8), x), round), 16);
+            }
+            // the packs work per 128-bit lane, the permute restores the order
+            __m256i w = _mm256_packus_epi16(_mm256_packus_epi32(v[0], v[1]), _mm256_packus_epi32(v[2], v[3]));
+            w = _mm256_permutevar8x32_epi32(w, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+            _mm256_storeu_si256((__m256i*)(pDst + i), w);
+        }
+        SPD_ConvertUToUnorm8_Scalar(pDst + i, pSrc + i, count - i);
+    }
+
+    void SPD_ConvertUnorm16ToU_AVX2(AU1 *pDst, const AW1 *pSrc, AU1 count)
+    {
+        AU1 i = 0;
+        for (; i + 8 <= count; i += 8)
+            _mm256_storeu_si256((__m256i*)(pDst + i), _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(pSrc + i))));
+        SPD_ConvertUnorm16ToU_Scalar(pDst + i, pSrc + i, count - i);
+    }
+
+    void SPD_ConvertUToUnorm16_AVX2(AW1 *pDst, const AU1 *pSrc, AU1 count)
+    {
+        AU1 i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            __m256i v0 = _mm256_loadu_si256((const __m256i*)(pSrc + i));
+            __m256i v1 = _mm256_loadu_si256((const __m256i*)(pSrc + i + 8));
+            __m256i w = _mm256_permute4x64_epi64(_mm256_packus_epi32(v0, v1), 0xd8);
+            _mm256_storeu_si256((__m256i*)(pDst + i), w);
+        }
+        SPD_ConvertUToUnorm16_Scalar(pDst + i, pSrc + i, count - i);
+    }
+
+    // sRGB with gathers from the 32-bit tables, 2 texels per register, the alpha lanes are linear
+    void SPD_ConvertSRGB8ToU_AVX2(AU1 *pDst, const uint8_t *pSrc, AU1 count)
+    {
+        const SPD_SRGBTables &t = SPD_GetSRGBTables();
+        const __m256i alphaOffset = _mm256_setr_epi32(0, 0, 0, 256, 0, 0, 0, 256);
+        AU1 i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256i index = _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(pSrc + i))), alphaOffset);
+            _mm256_storeu_si256((__m256i*)(pDst + i), _mm256_i32gather_epi32((const int*)t.toLinear, index, 4));
+        }
+        SPD_ConvertSRGB8ToU_Scalar(pDst + i, pSrc + i, count - i);
+    }
+
+    void SPD_ConvertUToSRGB8_AVX2(uint8_t *pDst, const AU1 *pSrc, AU1 count)
+    {
+        const SPD_SRGBTables &t = SPD_GetSRGBTables();
+        const __m256i alpha = _mm256_setr_epi32(0, 0, 0, -1, 0, 0, 0, -1);
+        const __m256i one = _mm256_set1_epi32(1);
+        const __m256i round = _mm256_set1_epi32(32895);
+        AU1 i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256i x = _mm256_loadu_si256((const __m256i*)(pSrc + i));
+            __m256i code = _mm256_i32gather_epi32((const int*)t.bucket, _mm256_srli_epi32(x, 4), 4);
+            __m256i threshold = _mm256_i32gather_epi32((const int*)t.threshold, _mm256_add_epi32(code, one), 4);
+            // x >= threshold adds one, the compare mask is -1
+            code = _mm256_sub_epi32(code, _mm256_cmpgt_epi32(x, _mm256_sub_epi32(threshold, one)));
+            __m256i a = _mm256_srli_epi32(_mm256_add_epi32(_mm256_sub_epi32(_mm256_slli_epi32(x, 8), x), round), 16);
+            __m256i v = _mm256_blendv_epi8(code, a, alpha);
+
+            __m256i w = _mm256_packus_epi16(_mm256_packus_epi32(v, v), _mm256_packus_epi32(v, v));
+            __m128i bytes = _mm_unpacklo_epi32(_mm256_castsi256_si128(w), _mm256_extracti128_si256(w, 1));
+            _mm_storel_epi64((__m128i*)(pDst + i), bytes);
+        }
+        SPD_ConvertUToSRGB8_Scalar(pDst + i, pSrc + i, count - i);
+    }
+
+    static const SPD_Kernels s_kernelsAVX2 =
+    {
+        SPD_ISA::SPD_AVX2,
+        ReduceRows_AVX2<SPD_Reduction::SPD_Average, true>,
+        ReduceRows_AVX2<SPD_Reduction::SPD_Average, false>,
+        { ReduceRows_AVX2<SPD_Reduction::SPD_Min, true>, ReduceRows_AVX2<SPD_Reduction::SPD_Min, false> },
+        { ReduceRows_AVX2<SPD_Reduction::SPD_Max, true>, ReduceRows_AVX2<SPD_Reduction::SPD_Max, false> },
+        { ReduceRows_AVX2<SPD_Reduction::SPD_MinMax, true>, ReduceRows_AVX2<SPD_Reduction::SPD_MinMax, false> },
+        { ReduceRows_AVX2<SPD_Reduction::SPD_Sum, true>, ReduceRows_AVX2<SPD_Reduction::SPD_Sum, false> },
+        ConvertF16ToF32_AVX2,
+        ConvertF32ToF16_AVX2,
+        SPD_ReduceRowsRGBAU_AVX2,
+        SPD_ReduceRowsRU_AVX2,
+        SPD_ConvertUnorm8ToU_AVX2,
+        SPD_ConvertUToUnorm8_AVX2,
+        SPD_ConvertSRGB8ToU_AVX2,
+        SPD_ConvertUToSRGB8_AVX2,
+        SPD_ConvertUnorm16ToU_AVX2,
+        SPD_ConvertUToUnorm16_AVX2,
+    };
+
+    const SPD_Kernels &SPD_GetKernelsAVX2()
+    {
+        return s_kernelsAVX2;
+    }
+}
@@ -0,0 +1,152 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// This file is compiled with -mavx512f, keep it free of std:: code so no inline function compiled
+// for AVX-512 can be picked by the linker for the rest of the library.
+#include "stdafx.h"
+#include "SPD_CPU_Kernels.h"
+#include <immintrin.h>
+
+namespace FFX_CPU
+{
+    // one or four RGBA texels, the values in the argument order of SpdReduce4
+    template<SPD_Reduction reduction>
+    static __m128 Reduce4_AVX512(__m128 v0, __m128 v1, __m128 v2, __m128 v3)
+    {
+        switch (reduction)
+        {
+        case SPD_Reduction::SPD_Min:
+            return _mm_min_ps(_mm_min_ps(v0, v1), _mm_min_ps(v2, v3));
+        case SPD_Reduction::SPD_Max:
+            return _mm_max_ps(_mm_max_ps(v0, v1), _mm_max_ps(v2, v3));
+        case SPD_Reduction::SPD_MinMax:
+            return _mm_blend_ps(_mm_min_ps(_mm_min_ps(v0, v1), _mm_min_ps(v2, v3)), _mm_max_ps(_mm_max_ps(v0, v1), _mm_max_ps(v2, v3)), 0xa);
+        case SPD_Reduction::SPD_Sum:
+            return _mm_add_ps(_mm_add_ps(_mm_add_ps(v0, v1), v2), v3);
+        default:
+            return _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(v0, v1), v2), v3), _mm_set1_ps(0.25f));
+        }
+    }
+
+    // The masked forms with a zero source avoid a false -Wmaybe-uninitialized of GCC in the unmasked intrinsics.
+    static __m512 Min_AVX512(__m512 a, __m512 b) { return _mm512_mask_min_ps(_mm512_setzero_ps(), 0xffff, a, b); }
+    static __m512 Max_AVX512(__m512 a, __m512 b) { return _mm512_mask_max_ps(_mm512_setzero_ps(), 0xffff, a, b); }
+
+    template<SPD_Reduction reduction>
+    static __m512 Reduce4_AVX512(__m512 v0, __m512 v1, __m512 v2, __m512 v3)
+    {
+        switch (reduction)
+        {
+        case SPD_Reduction::SPD_Min:
+            return Min_AVX512(Min_AVX512(v0, v1), Min_AVX512(v2, v3));
+        case SPD_Reduction::SPD_Max:
+            return Max_AVX512(Max_AVX512(v0, v1), Max_AVX512(v2, v3));
+        case SPD_Reduction::SPD_MinMax:
+            return _mm512_mask_blend_ps(0xaaaa, Min_AVX512(Min_AVX512(v0, v1), Min_AVX512(v2, v3)), Max_AVX512(Max_AVX512(v0, v1), Max_AVX512(v2, v3)));
+        case SPD_Reduction::SPD_Sum:
+            return _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(v0, v1), v2), v3);
+        default:
+            return _mm512_mul_ps(_mm512_add_ps(_mm512_add_ps(_mm512_add_ps(v0, v1), v2), v3), _mm512_set1_ps(0.25f));
+        }
+    }
+
+    // Four output texels per 512-bit register, see ReduceRows_AVX2 for the even/odd split.
+    template<SPD_Reduction reduction, bool columnOrder>
+    static void ReduceRows_AVX512(AF1 *pDst, const AF1 *pTop, const AF1 *pBottom, AU1 count)
+    {
+        const __m512i even = _mm512_setr_epi32(0, 1, 2, 3, 8, 9, 10, 11, 16, 17, 18, 19, 24, 25, 26, 27);
+        const __m512i odd = _mm512_setr_epi32(4, 5, 6, 7, 12, 13, 14, 15, 20, 21, 22, 23, 28, 29, 30, 31);
+        AU1 i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m512 t0 = _mm512_loadu_ps(pTop + i * 8);
+            __m512 t1 = _mm512_loadu_ps(pTop + i * 8 + 16);
+            __m512 b0 = _mm512_loadu_ps(pBottom + i * 8);
+            __m512 b1 = _mm512_loadu_ps(pBottom + i * 8 + 16);
+            __m512 tEven = _mm512_permutex2var_ps(t0, even, t1);
+            __m512 tOdd = _mm512_permutex2var_ps(t0, odd, t1);
+            __m512 bEven = _mm512_permutex2var_ps(b0, even, b1);
+            __m512 bOdd = _mm512_permutex2var_ps(b0, odd, b1);
+            __m512 v = columnOrder ? Reduce4_AVX512<reduction>(tEven, bEven, tOdd, bOdd) : Reduce4_AVX512<reduction>(tEven, tOdd, bEven, bOdd);
+            _mm512_storeu_ps(pDst + i * 4, v);
+        }
+        for (; i < count; i++)
+        {
+            __m128 t0 = _mm_loadu_ps(pTop + i * 8);
+            __m128 t1 = _mm_loadu_ps(pTop + i * 8 + 4);
+            __m128 b0 = _mm_loadu_ps(pBottom + i * 8);
+            __m128 b1 = _mm_loadu_ps(pBottom + i * 8 + 4);
+            __m128 v = columnOrder ? Reduce4_AVX512<reduction>(t0, b0, t1, b1) : Reduce4_AVX512<reduction>(t0, t1, b0, b1);
+            _mm_storeu_ps(pDst + i * 4, v);
+        }
+    }
+
+    // 16 values per instruction
+    // The masked forms with a zero source avoid a false -Wmaybe-uninitialized of GCC in the unmasked intrinsics.
+    static void ConvertF16ToF32_AVX512(AF1 *pDst, const AW1 *pSrc, AU1 count)
+    {
+        AU1 i = 0;
+        for (; i + 16 <= count; i += 16)
+            _mm512_storeu_ps(pDst + i, _mm512_mask_cvtph_ps(_mm512_setzero_ps(), 0xffff, _mm256_loadu_si256((const __m256i*)(pSrc + i))));
+        SPD_ConvertF16ToF32_Scalar(pDst + i, pSrc + i, count - i);
+    }
+
+    static void ConvertF32ToF16_AVX512(AW1 *pDst, const AF1 *pSrc, AU1 count)
+    {
+        const __m256i absMask = _mm256_set1_epi16(0x7fff);
+        const __m256i maxHalf = _mm256_set1_epi16(0x7bff);
+        AU1 i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            __m256i h = _mm512_mask_cvtps_ph(_mm256_setzero_si256(), 0xffff, _mm512_loadu_ps(pSrc + i), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+            // INF and NaN become +-65504, same as AU1_AH1_AF1
+            __m256i special = _mm256_cmpgt_epi16(_mm256_and_si256(h, absMask), maxHalf);
+            __m256i clamped = _mm256_or_si256(_mm256_andnot_si256(absMask, h), maxHalf);
+            _mm256_storeu_si256((__m256i*)(pDst + i), _mm256_blendv_epi8(h, clamped, special));
+        }
+        SPD_ConvertF32ToF16_Scalar(pDst + i, pSrc + i, count - i);
+    }
+
+    static const SPD_Kernels s_kernelsAVX512 =
+    {
+        SPD_ISA::SPD_AVX512,
+        ReduceRows_AVX512<SPD_Reduction::SPD_Average, true>,
+        ReduceRows_AVX512<SPD_Reduction::SPD_Average, false>,
+        { ReduceRows_AVX512<SPD_Reduction::SPD_Min, true>, ReduceRows_AVX512<SPD_Reduction::SPD_Min, false> },
+        { ReduceRows_AVX512<SPD_Reduction::SPD_Max, true>, ReduceRows_AVX512<SPD_Reduction::SPD_Max, false> },
+        { ReduceRows_AVX512<SPD_Reduction::SPD_MinMax, true>, ReduceRows_AVX512<SPD_Reduction::SPD_MinMax, false> },
+        { ReduceRows_AVX512<SPD_Reduction::SPD_Sum, true>, ReduceRows_AVX512<SPD_Reduction::SPD_Sum, false> },
+        ConvertF16ToF32_AVX512,
+        ConvertF32ToF16_AVX512,
+        // the integer kernels are bound by memory, AVX2 is fast enough
+        SPD_ReduceRowsRGBAU_AVX2,
+        SPD_ReduceRowsRU_AVX2,
+        SPD_ConvertUnorm8ToU_AVX2,
+        SPD_ConvertUToUnorm8_AVX2,
+        SPD_ConvertSRGB8ToU_AVX2,
+        SPD_ConvertUToSRGB8_AVX2,
+        SPD_ConvertUnorm16ToU_AVX2,
+        SPD_ConvertUToUnorm16_AVX2,
+    };
+
+    const SPD_Kernels &SPD_GetKernelsAVX512()
+    {
+        return s_kernelsAVX512;
+    }
+}
@@ -0,0 +1,175 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// This file is compiled with -msse4.1, keep it free of std:: code so no inline function compiled
+// for SSE4.1 can be picked by the linker for the rest of the library.
+#include "stdafx.h"
+#include "SPD_CPU_Kernels.h"
+#include <smmintrin.h>
+
+namespace FFX_CPU
+{
+    // one RGBA texel, the values in the argument order of SpdReduce4
+    template<SPD_Reduction reduction>
+    static __m128 Reduce4_SSE41(__m128 v0, __m128 v1, __m128 v2, __m128 v3)
+    {
+        switch (reduction)
+        {
+        case SPD_Reduction::SPD_Min:
+            return _mm_min_ps(_mm_min_ps(v0, v1), _mm_min_ps(v2, v3));
+        case SPD_Reduction::SPD_Max:
+            return _mm_max_ps(_mm_max_ps(v0, v1), _mm_max_ps(v2, v3));
+        case SPD_Reduction::SPD_MinMax:
+            return _mm_blend_ps(_mm_min_ps(_mm_min_ps(v0, v1), _mm_min_ps(v2, v3)), _mm_max_ps(_mm_max_ps(v0, v1), _mm_max_ps(v2, v3)), 0xa);
+        case SPD_Reduction::SPD_Sum:
+            return _mm_add_ps(_mm_add_ps(_mm_add_ps(v0, v1), v2), v3);
+        default:
+            return _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(v0, v1), v2), v3), _mm_set1_ps(0.25f));
+        }
+    }
+
+    // one output texel per 128-bit register
+    template<SPD_Reduction reduction, bool columnOrder>
+    static void ReduceRows_SSE41(AF1 *pDst, const AF1 *pTop, const AF1 *pBottom, AU1 count)
+    {
+        for (AU1 i = 0; i < count; i++)
+        {
+            __m128 t0 = _mm_loadu_ps(pTop + i * 8);
+            __m128 t1 = _mm_loadu_ps(pTop + i * 8 + 4);
+            __m128 b0 = _mm_loadu_ps(pBottom + i * 8);
+            __m128 b1 = _mm_loadu_ps(pBottom + i * 8 + 4);
+            __m128 v = columnOrder ? Reduce4_SSE41<reduction>(t0, b0, t1, b1) : Reduce4_SSE41<reduction>(t0, t1, b0, b1);
+            _mm_storeu_ps(pDst + i * 4, v);
+        }
+    }
+
+    // integer kernels, values are UNORM16 in 32-bit lanes
+    static void ReduceRowsRGBAU_SSE41(AU1 *pDst, const AU1 *pTop, const AU1 *pBottom, AU1 count)
+    {
+        const __m128i two = _mm_set1_epi32(2);
+        for (AU1 i = 0; i < count; i++)
+        {
+            __m128i t0 = _mm_loadu_si128((const __m128i*)(pTop + i * 8));
+            __m128i t1 = _mm_loadu_si128((const __m128i*)(pTop + i * 8 + 4));
+            __m128i b0 = _mm_loadu_si128((const __m128i*)(pBottom + i * 8));
+            __m128i b1 = _mm_loadu_si128((const __m128i*)(pBottom + i * 8 + 4));
+            __m128i v = _mm_add_epi32(_mm_add_epi32(t0, t1), _mm_add_epi32(b0, b1));
+            _mm_storeu_si128((__m128i*)(pDst + i * 4), _mm_srli_epi32(_mm_add_epi32(v, two), 2));
+        }
+    }
+
+    static void ReduceRowsRU_SSE41(AU1 *pDst, const AU1 *pTop, const AU1 *pBottom, AU1 count)
+    {
+        const __m128i two = _mm_set1_epi32(2);
+        AU1 i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            // horizontal adds of neighbouring pairs
+            __m128i t = _mm_hadd_epi32(_mm_loadu_si128((const __m128i*)(pTop + i * 2)), _mm_loadu_si128((const __m128i*)(pTop + i * 2 + 4)));
+            __m128i b = _mm_hadd_epi32(_mm_loadu_si128((const __m128i*)(pBottom + i * 2)), _mm_loadu_si128((const __m128i*)(pBottom + i * 2 + 4)));
+            _mm_storeu_si128((__m128i*)(pDst + i), _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(t, b), two), 2));
+        }
+        SPD_ReduceRowsRU_Scalar(pDst + i, pTop + i * 2, pBottom + i * 2, count - i);
+    }
+
+    static void ConvertUnorm8ToU_SSE41(AU1 *pDst, const uint8_t *pSrc, AU1 count)
+    {
+        AU1 i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(pSrc + i));
+            for (AU1 j = 0; j < 4; j++)
+            {
+                __m128i u = _mm_cvtepu8_epi32(v);
+                _mm_storeu_si128((__m128i*)(pDst + i + j * 4), _mm_or_si128(_mm_slli_epi32(u, 8), u));
+                v = _mm_srli_si128(v, 4);
+            }
+        }
+        SPD_ConvertUnorm8ToU_Scalar(pDst + i, pSrc + i, count - i);
+    }
+
+    static void ConvertUToUnorm8_SSE41(uint8_t *pDst, const AU1 *pSrc, AU1 count)
+    {
+        const __m128i round = _mm_set1_epi32(32895);
+        AU1 i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            __m128i v[4];
+            for (AU1 j = 0; j < 4; j++)
+            {
+                // (x * 255 + 32895) >> 16 is round(x / 257)
+                __m128i x = _mm_loadu_si128((const __m128i*)(pSrc + i + j * 4));
+                v[j] = _mm_srli_epi32(_mm_add_epi32(_mm_sub_epi32(_mm_slli_epi32(x, 8), x), round), 16);
+            }
+            __m128i w = _mm_packus_epi16(_mm_packus_epi32(v[0], v[1]), _mm_packus_epi32(v[2], v[3]));
+            _mm_storeu_si128((__m128i*)(pDst + i), w);
+        }
+        SPD_ConvertUToUnorm8_Scalar(pDst + i, pSrc + i, count - i);
+    }
+
+    static void ConvertUnorm16ToU_SSE41(AU1 *pDst, const AW1 *pSrc, AU1 count)
+    {
+        AU1 i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(pSrc + i));
+            _mm_storeu_si128((__m128i*)(pDst + i), _mm_cvtepu16_epi32(v));
+            _mm_storeu_si128((__m128i*)(pDst + i + 4), _mm_cvtepu16_epi32(_mm_srli_si128(v, 8)));
+        }
+        SPD_ConvertUnorm16ToU_Scalar(pDst + i, pSrc + i, count - i);
+    }
+
+    static void ConvertUToUnorm16_SSE41(AW1 *pDst, const AU1 *pSrc, AU1 count)
+    {
+        AU1 i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i v0 = _mm_loadu_si128((const __m128i*)(pSrc + i));
+            __m128i v1 = _mm_loadu_si128((const __m128i*)(pSrc + i + 4));
+            _mm_storeu_si128((__m128i*)(pDst + i), _mm_packus_epi32(v0, v1));
+        }
+        SPD_ConvertUToUnorm16_Scalar(pDst + i, pSrc + i, count - i);
+    }
+
+    static const SPD_Kernels s_kernelsSSE41 =
+    {
+        SPD_ISA::SPD_SSE41,
+        ReduceRows_SSE41<SPD_Reduction::SPD_Average, true>,
+        ReduceRows_SSE41<SPD_Reduction::SPD_Average, false>,
+        { ReduceRows_SSE41<SPD_Reduction::SPD_Min, true>, ReduceRows_SSE41<SPD_Reduction::SPD_Min, false> },
+        { ReduceRows_SSE41<SPD_Reduction::SPD_Max, true>, ReduceRows_SSE41<SPD_Reduction::SPD_Max, false> },
+        { ReduceRows_SSE41<SPD_Reduction::SPD_MinMax, true>, ReduceRows_SSE41<SPD_Reduction::SPD_MinMax, false> },
+        { ReduceRows_SSE41<SPD_Reduction::SPD_Sum, true>, ReduceRows_SSE41<SPD_Reduction::SPD_Sum, false> },
+        SPD_ConvertF16ToF32_Scalar, // no F16C
+        SPD_ConvertF32ToF16_Scalar,
+        ReduceRowsRGBAU_SSE41,
+        ReduceRowsRU_SSE41,
+        ConvertUnorm8ToU_SSE41,
+        ConvertUToUnorm8_SSE41,
+        SPD_ConvertSRGB8ToU_Scalar,
+        SPD_ConvertUToSRGB8_Scalar,
+        ConvertUnorm16ToU_SSE41,
+        ConvertUToUnorm16_SSE41,
+    };
+
+    const SPD_Kernels &SPD_GetKernelsSSE41()
+    {
+        return s_kernelsSSE41;
+    }
+}
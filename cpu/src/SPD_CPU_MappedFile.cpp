@@ -0,0 +1,177 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "stdafx.h"
+#include "SPD_CPU_MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace FFX_CPU
+{
+#ifdef _WIN32
+    bool SPD_MappedFile::OnCreate(const char *pPath, uint64_t size)
+    {
+        m_pData = NULL;
+        m_writable = size != 0;
+        m_hMapping = NULL;
+        m_hFile = CreateFileA(pPath, m_writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ, NULL, m_writable ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (m_hFile == INVALID_HANDLE_VALUE)
+            return false;
+
+        if (!m_writable)
+        {
+            LARGE_INTEGER fileSize;
+            GetFileSizeEx(m_hFile, &fileSize);
+            size = uint64_t(fileSize.QuadPart);
+        }
+        m_size = size;
+
+        // CreateFileMapping grows the file to the size of the mapping
+        m_hMapping = CreateFileMappingA(m_hFile, NULL, m_writable ? PAGE_READWRITE : PAGE_READONLY, DWORD(size >> 32), DWORD(size), NULL);
+        if (m_hMapping)
+            m_pData = (uint8_t*)MapViewOfFile(m_hMapping, m_writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+        if (!m_pData)
+        {
+            OnDestroy();
+            return false;
+        }
+        return true;
+    }
+
+    void SPD_MappedFile::OnDestroy()
+    {
+        if (m_pData)
+            UnmapViewOfFile(m_pData);
+        if (m_hMapping)
+            CloseHandle(m_hMapping);
+        if (m_hFile != INVALID_HANDLE_VALUE)
+            CloseHandle(m_hFile);
+        m_pData = NULL;
+        m_hMapping = NULL;
+        m_hFile = INVALID_HANDLE_VALUE;
+    }
+
+    bool SPD_MappedFile::PageRange(uint64_t &, uint64_t &) const
+    {
+        return false;
+    }
+
+    void SPD_MappedFile::WillNeed(uint64_t, uint64_t) {}
+    void SPD_MappedFile::DontNeed(uint64_t, uint64_t) {}
+
+    void SPD_MappedFile::Flush(uint64_t offset, uint64_t size)
+    {
+        if (m_writable && offset < m_size)
+            FlushViewOfFile(m_pData + offset, SIZE_T(size < m_size - offset ? size : m_size - offset));
+    }
+#else
+    bool SPD_MappedFile::OnCreate(const char *pPath, uint64_t size)
+    {
+        m_pData = NULL;
+        m_writable = size != 0;
+        m_fd = open(pPath, m_writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+        if (m_fd < 0)
+            return false;
+
+        if (m_writable)
+        {
+            if (ftruncate(m_fd, off_t(size)) != 0)
+            {
+                OnDestroy();
+                return false;
+            }
+        }
+        else
+        {
+            struct stat st;
+            if (fstat(m_fd, &st) != 0)
+            {
+                OnDestroy();
+                return false;
+            }
+            size = uint64_t(st.st_size);
+        }
+        m_size = size;
+
+        void *p = mmap(NULL, size_t(size), m_writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, m_fd, 0);
+        if (p == MAP_FAILED)
+        {
+            OnDestroy();
+            return false;
+        }
+        m_pData = (uint8_t*)p;
+        return true;
+    }
+
+    void SPD_MappedFile::OnDestroy()
+    {
+        if (m_pData)
+            munmap(m_pData, size_t(m_size));
+        if (m_fd >= 0)
+            close(m_fd);
+        m_pData = NULL;
+        m_fd = -1;
+    }
+
+    // the pages covering the range, clipped to the mapping
+    bool SPD_MappedFile::PageRange(uint64_t &offset, uint64_t &size) const
+    {
+        static const uint64_t pageSize = uint64_t(sysconf(_SC_PAGESIZE));
+        if (offset >= m_size || size == 0)
+            return false;
+        uint64_t end = offset + size < m_size ? offset + size : m_size;
+        offset &= ~(pageSize - 1);
+        size = end - offset;
+        return true;
+    }
+
+    void SPD_MappedFile::WillNeed(uint64_t offset, uint64_t size)
+    {
+        if (PageRange(offset, size))
+            madvise(m_pData + offset, size_t(size), MADV_WILLNEED);
+    }
+
+    void SPD_MappedFile::DontNeed(uint64_t offset, uint64_t size)
+    {
+        // the mapping is shared, so dirty pages stay in the page cache until they are written back
+        if (PageRange(offset, size))
+        {
+            madvise(m_pData + offset, size_t(size), MADV_DONTNEED);
+#ifdef POSIX_FADV_DONTNEED
+            // also drop the clean pages from the page cache, otherwise a large source fills it
+            posix_fadvise(m_fd, off_t(offset), off_t(size), POSIX_FADV_DONTNEED);
+#endif
+        }
+    }
+
+    void SPD_MappedFile::Flush(uint64_t offset, uint64_t size)
+    {
+        if (m_writable && PageRange(offset, size))
+            msync(m_pData + offset, size_t(size), MS_ASYNC);
+    }
+#endif
+}
@@ -0,0 +1,55 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#pragma once
+
+namespace FFX_CPU
+{
+    // A file mapped into memory, used for sources and pyramids that do not fit into RAM.
+    // The hints only change what the OS keeps in the page cache, they are ignored where not supported.
+    class SPD_MappedFile
+    {
+    public:
+        // size 0 maps an existing file read only, otherwise the file is created (or resized) with that size
+        bool OnCreate(const char *pPath, uint64_t size);
+        void OnDestroy();
+
+        uint8_t *GetData() const { return m_pData; }
+        uint64_t GetSize() const { return m_size; }
+
+        // the range is read soon, start reading it ahead
+        void WillNeed(uint64_t offset, uint64_t size);
+        // the range is not read again, its pages can be dropped
+        void DontNeed(uint64_t offset, uint64_t size);
+        // start writing the dirty pages of the range back, does not wait
+        void Flush(uint64_t offset, uint64_t size);
+
+    private:
+        bool PageRange(uint64_t &offset, uint64_t &size) const;
+
+        uint8_t *m_pData;
+        uint64_t m_size;
+        bool m_writable;
+#ifdef _WIN32
+        void *m_hFile;
+        void *m_hMapping;
+#else
+        int m_fd;
+#endif
+    };
+}
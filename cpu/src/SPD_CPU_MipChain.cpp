@@ -0,0 +1,126 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "stdafx.h"
+#include "SPD_CPU_MipChain.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace FFX_CPU
+{
+    void SPD_MipChain::OnCreate()
+    {
+        m_mipCount = 0;
+        m_size = 0;
+        m_pMemory = NULL;
+        m_capacity = 0;
+        m_hugePages = false;
+    }
+
+    void SPD_MipChain::OnDestroy()
+    {
+        Free();
+        m_mipCount = 0;
+        m_size = 0;
+    }
+
+    void SPD_MipChain::Free()
+    {
+        if (!m_pMemory)
+            return;
+#ifdef _WIN32
+        VirtualFree(m_pMemory, 0, MEM_RELEASE);
+#else
+        munmap(m_pMemory, m_capacity);
+#endif
+        m_pMemory = NULL;
+        m_capacity = 0;
+    }
+
+    bool SPD_MipChain::Allocate(SPD_Format format, uint32_t Width, uint32_t Height, int mips, bool hugePages)
+    {
+        assert(mips >= 1 && mips <= SPD_MAX_MIP_LEVELS);
+
+        const size_t cacheLine = 64;
+        const size_t page = 4096;
+        size_t texelSize = SPD_CPU::GetBytesPerTexel(format);
+        size_t offsets[SPD_MAX_MIP_LEVELS];
+        size_t size = 0;
+        for (int i = 0; i < mips; i++)
+        {
+            m_mips[i].Width = SPD_CPU::GetMipDimension(Width, i);
+            m_mips[i].Height = SPD_CPU::GetMipDimension(Height, i);
+            m_mips[i].RowPitch = m_mips[i].Width * texelSize;
+
+            size_t mipSize = m_mips[i].RowPitch * m_mips[i].Height;
+            size_t alignment = mipSize >= page ? page : cacheLine;
+            offsets[i] = (size + alignment - 1) & ~(alignment - 1);
+            size = offsets[i] + mipSize;
+        }
+
+        if (size > m_capacity || hugePages != m_hugePages)
+        {
+            Free();
+
+            // mappings start on a page, huge pages need the size in 2MB steps
+            size_t granularity = hugePages ? size_t(2) << 20 : page;
+            size_t capacity = (size + granularity - 1) & ~(granularity - 1);
+#ifdef _WIN32
+            void *p = NULL;
+            SIZE_T largePage = GetLargePageMinimum();
+            if (hugePages && largePage)
+            {
+                // needs the lock pages in memory privilege, falls back to normal pages without it
+                capacity = (size + largePage - 1) & ~(largePage - 1);
+                p = VirtualAlloc(NULL, capacity, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            }
+            if (!p)
+                p = VirtualAlloc(NULL, capacity, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+            void *p = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED)
+                p = NULL;
+#ifdef MADV_HUGEPAGE
+            if (p && hugePages)
+                madvise(p, capacity, MADV_HUGEPAGE);
+#endif
+#endif
+            if (!p)
+            {
+                m_mipCount = 0;
+                m_size = 0;
+                return false;
+            }
+            m_pMemory = p;
+            m_capacity = capacity;
+            m_hugePages = hugePages;
+        }
+
+        for (int i = 0; i < mips; i++)
+            m_mips[i].pData = (uint8_t*)m_pMemory + offsets[i];
+        m_mipCount = mips;
+        m_size = size;
+        return true;
+    }
+}
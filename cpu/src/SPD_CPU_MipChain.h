@@ -0,0 +1,54 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#pragma once
+
+#include "SPD_CPU.h"
+
+namespace FFX_CPU
+{
+    // All mips of a result in one allocation, the CPU side of SPD_CS::m_result.
+    // Mips smaller than a page start on a cache line, the others on a page. The allocation is kept and
+    // reused by every Allocate that fits, so a chain of constant size allocates once.
+    class SPD_MipChain
+    {
+    public:
+        void OnCreate();
+        void OnDestroy();
+
+        // Mips of a source of Width x Height, hugePages backs the chain with 2MB pages where the OS supports it.
+        // Returns false when the memory could not be allocated.
+        bool Allocate(SPD_Format format, uint32_t Width, uint32_t Height, int mips, bool hugePages = false);
+
+        const SPD_Image *GetMips() const { return m_mips; }
+        const SPD_Image &GetMip(int mip) const { return m_mips[mip]; }
+        int GetMipCount() const { return m_mipCount; }
+        size_t GetSize() const { return m_size; }
+
+    private:
+        void Free();
+
+        SPD_Image m_mips[SPD_MAX_MIP_LEVELS];
+        int m_mipCount;
+        size_t m_size;
+
+        void *m_pMemory;
+        size_t m_capacity;
+        bool m_hugePages;
+    };
+}
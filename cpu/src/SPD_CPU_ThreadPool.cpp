@@ -0,0 +1,180 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "stdafx.h"
+#include "SPD_CPU_ThreadPool.h"
+
+namespace FFX_CPU
+{
+    static AL1 PackRange(AU1 begin, AU1 end) { return AL1(begin) | (AL1(end) << 32); }
+    static AU1 RangeBegin(AL1 range) { return AU1(range); }
+    static AU1 RangeEnd(AL1 range) { return AU1(range >> 32); }
+
+    void SPD_ThreadPool::OnCreate(uint32_t threadCount)
+    {
+        m_workerCount = threadCount > 0 ? threadCount : 1;
+        m_generation = 0;
+        m_busyWorkers = 0;
+        m_quit = false;
+        m_fn = NULL;
+        m_pContext = NULL;
+
+        // workers are cache line aligned, so the ranges of different workers never share a line
+        m_pWorkersMemory = ::operator new(sizeof(Worker) * m_workerCount + alignof(Worker));
+        m_pWorkers = (Worker*)(((uintptr_t)m_pWorkersMemory + alignof(Worker) - 1) & ~(uintptr_t)(alignof(Worker) - 1));
+        for (AU1 i = 0; i < m_workerCount; i++)
+        {
+            new (&m_pWorkers[i]) Worker();
+            m_pWorkers[i].range.store(0, std::memory_order_relaxed);
+        }
+
+        for (AU1 i = 1; i < m_workerCount; i++)
+            m_threads.emplace_back(&SPD_ThreadPool::WorkerMain, this, i);
+    }
+
+    void SPD_ThreadPool::OnDestroy()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_wake.notify_all();
+        for (std::thread &t : m_threads)
+            t.join();
+        m_threads.clear();
+
+        for (AU1 i = 0; i < m_workerCount; i++)
+            m_pWorkers[i].~Worker();
+        ::operator delete(m_pWorkersMemory);
+        m_pWorkersMemory = NULL;
+        m_pWorkers = NULL;
+    }
+
+    bool SPD_ThreadPool::PopItem(Worker &worker, AU1 &item)
+    {
+        AL1 range = worker.range.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            AU1 begin = RangeBegin(range);
+            AU1 end = RangeEnd(range);
+            if (begin >= end)
+                return false;
+            if (worker.range.compare_exchange_weak(range, PackRange(begin + 1, end), std::memory_order_relaxed))
+            {
+                item = begin;
+                return true;
+            }
+        }
+    }
+
+    bool SPD_ThreadPool::StealItem(AU1 thief, AU1 &item)
+    {
+        for (AU1 i = 1; i < m_workerCount; i++)
+        {
+            Worker &victim = m_pWorkers[(thief + i) % m_workerCount];
+            AL1 range = victim.range.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                AU1 begin = RangeBegin(range);
+                AU1 end = RangeEnd(range);
+                if (begin >= end)
+                    break;
+
+                // take the back half, the victim keeps working on the front
+                AU1 split = end - (end - begin + 1) / 2;
+                if (victim.range.compare_exchange_weak(range, PackRange(begin, split), std::memory_order_relaxed))
+                {
+                    // the own range is empty, so nobody else changes it concurrently
+                    m_pWorkers[thief].range.store(PackRange(split + 1, end), std::memory_order_relaxed);
+                    item = split;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void SPD_ThreadPool::Execute(AU1 workerIndex)
+    {
+        Worker &worker = m_pWorkers[workerIndex];
+        AU1 item;
+        for (;;)
+        {
+            if (PopItem(worker, item) || StealItem(workerIndex, item))
+                m_fn(m_pContext, item, workerIndex);
+            else
+                break;
+        }
+    }
+
+    void SPD_ThreadPool::WorkerMain(AU1 workerIndex)
+    {
+        AU1 generation = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [&]() { return m_quit || m_generation != generation; });
+                if (m_quit)
+                    return;
+                generation = m_generation;
+            }
+
+            Execute(workerIndex);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_busyWorkers == 0)
+                m_done.notify_one();
+        }
+    }
+
+    void SPD_ThreadPool::Run(AU1 count, JobFn fn, void *pContext)
+    {
+        // split the items into one contiguous range per worker
+        for (AU1 i = 0; i < m_workerCount; i++)
+        {
+            AU1 begin = AU1(AL1(count) * i / m_workerCount);
+            AU1 end = AU1(AL1(count) * (i + 1) / m_workerCount);
+            m_pWorkers[i].range.store(PackRange(begin, end), std::memory_order_relaxed);
+        }
+
+        if (m_workerCount == 1)
+        {
+            m_fn = fn;
+            m_pContext = pContext;
+            Execute(0);
+            return;
+        }
+
+        {
+            // the mutex also publishes the ranges and the job to the workers
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_fn = fn;
+            m_pContext = pContext;
+            m_busyWorkers = m_workerCount - 1;
+            m_generation++;
+        }
+        m_wake.notify_all();
+
+        Execute(0);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [&]() { return m_busyWorkers == 0; });
+    }
+}
@@ -0,0 +1,80 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#pragma once
+
+namespace FFX_CPU
+{
+    // Persistent workers that run the tiles of a dispatch with work stealing.
+    // Every worker owns a contiguous range of items (neighbouring tiles) and takes items from its front.
+    // A worker that runs out steals the back half of the range of another worker.
+    // The calling thread of Run() is worker 0.
+    class SPD_ThreadPool
+    {
+    public:
+        // Called once for every item, workerIndex selects the scratch memory of the worker.
+        typedef void (*JobFn)(void *pContext, AU1 item, AU1 workerIndex);
+
+        void OnCreate(uint32_t threadCount);
+        void OnDestroy();
+
+        // Runs fn for the items [0, count) and returns when all of them are done.
+        void Run(AU1 count, JobFn fn, void *pContext);
+
+        uint32_t GetWorkerCount() const { return m_workerCount; }
+
+        // Preallocated LDS replacement of a worker
+        SpdIntermediate &GetIntermediate(AU1 workerIndex) { return m_pWorkers[workerIndex].lds; }
+        SpdIntermediateH &GetIntermediateH(AU1 workerIndex) { return m_pWorkers[workerIndex].ldsH; }
+        AU1 (*GetIntermediateU(AU1 workerIndex))[16][4] { return m_pWorkers[workerIndex].ldsU; }
+        SpdIntermediateDepth &GetIntermediateDepth(AU1 workerIndex) { return m_pWorkers[workerIndex].ldsDepth; }
+        SpdIntermediateFilter &GetIntermediateFilter(AU1 workerIndex) { return m_pWorkers[workerIndex].ldsFilter; }
+
+    private:
+        struct alignas(64) Worker
+        {
+            // [begin, end) packed as begin | end << 32, changed with compare and swap only
+            std::atomic<AL1> range;
+            SpdIntermediate lds;
+            SpdIntermediateH ldsH;
+            AU1 ldsU[16][16][4]; // integer kernels of the UNORM formats
+            SpdIntermediateDepth ldsDepth;
+            SpdIntermediateFilter ldsFilter;
+        };
+
+        bool PopItem(Worker &worker, AU1 &item);
+        bool StealItem(AU1 thief, AU1 &item);
+        void Execute(AU1 workerIndex);
+        void WorkerMain(AU1 workerIndex);
+
+        uint32_t m_workerCount;
+        void *m_pWorkersMemory;
+        Worker *m_pWorkers;
+        std::vector<std::thread> m_threads;
+
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_done;
+        AU1 m_generation;
+        AU1 m_busyWorkers;
+        bool m_quit;
+
+        JobFn m_fn;
+        void *m_pContext;
+    };
+}
@@ -0,0 +1,150 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#pragma once
+
+// Shared code of the tests, every test is one executable that returns nonzero if a check failed.
+
+#include "SPD_CPU.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace FFX_CPU
+{
+    static int s_testFailures = 0;
+
+#define SPD_TEST_CHECK(condition, ...) \
+    do { if (!(condition)) { printf("FAILED %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); s_testFailures++; } } while (0)
+
+    static inline int SpdTestResult()
+    {
+        printf(s_testFailures ? "%d checks failed\n" : "passed\n", s_testFailures);
+        return s_testFailures ? 1 : 0;
+    }
+
+    struct SPD_TestFormat
+    {
+        SPD_Format format;
+        const char *pName;
+    };
+
+    static const SPD_TestFormat s_testFormats[] =
+    {
+        { SPD_Format::SPD_R32G32B32A32_FLOAT, "R32G32B32A32_FLOAT" },
+        { SPD_Format::SPD_R16G16B16A16_FLOAT, "R16G16B16A16_FLOAT" },
+        { SPD_Format::SPD_R8G8B8A8_UNORM, "R8G8B8A8_UNORM" },
+        { SPD_Format::SPD_R8G8B8A8_UNORM_SRGB, "R8G8B8A8_UNORM_SRGB" },
+        { SPD_Format::SPD_R16_UNORM, "R16_UNORM" },
+    };
+
+    // Same sequence on every platform, unlike rand()
+    struct SPD_TestRandom
+    {
+        uint32_t state;
+
+        explicit SPD_TestRandom(uint32_t seed) : state(seed * 2654435761u + 1) {}
+        uint32_t Next() { state = state * 1664525u + 1013904223u; return state >> 8; }
+        float NextFloat() { return float(Next() & 0xffff) / 65535.0f; }
+    };
+
+    // An image in system memory, texels outside of it are not written by SPD
+    struct SPD_TestImage
+    {
+        std::vector<uint8_t> data;
+        SPD_Image image;
+
+        void Allocate(uint32_t width, uint32_t height, SPD_Format format, uint8_t fill = 0xcd)
+        {
+            size_t pitch = size_t(width) * SPD_CPU::GetBytesPerTexel(format);
+            data.assign(pitch * height, fill);
+            image.pData = data.data();
+            image.Width = width;
+            image.Height = height;
+            image.RowPitch = pitch;
+        }
+
+        // floats in 0..1, fp16 in 0.125..1, any value of the UNORM formats
+        void Randomize(SPD_Format format, uint32_t seed)
+        {
+            SPD_TestRandom random(seed);
+            size_t count = data.size();
+            switch (format)
+            {
+            case SPD_Format::SPD_R32G32B32A32_FLOAT:
+            case SPD_Format::SPD_R32_FLOAT_DEPTH:
+            case SPD_Format::SPD_R32_FLOAT_DEPTH_REVERSED_Z:
+                for (size_t i = 0; i < count; i += 4)
+                {
+                    float v = random.NextFloat();
+                    memcpy(&data[i], &v, 4);
+                }
+                break;
+            case SPD_Format::SPD_R16G16B16A16_FLOAT:
+                for (size_t i = 0; i < count; i += 2)
+                {
+                    uint16_t h = uint16_t(0x3000 + random.Next() % 0x0c00);
+                    memcpy(&data[i], &h, 2);
+                }
+                break;
+            default:
+                for (size_t i = 0; i < count; i++)
+                    data[i] = uint8_t(random.Next());
+                break;
+            }
+        }
+    };
+
+    // All mips of a width x height source
+    struct SPD_TestMips
+    {
+        std::vector<SPD_TestImage> mips;
+        std::vector<SPD_Image> images;
+
+        void Allocate(uint32_t width, uint32_t height, int mipCount, SPD_Format format, uint8_t fill = 0xcd)
+        {
+            mips.resize(mipCount);
+            images.resize(mipCount);
+            for (int i = 0; i < mipCount; i++)
+            {
+                mips[i].Allocate(SPD_CPU::GetMipDimension(width, i), SPD_CPU::GetMipDimension(height, i), format, fill);
+                images[i] = mips[i].image;
+            }
+        }
+
+        int Count() const { return int(mips.size()); }
+
+        // first mip that differs, -1 if none
+        int FirstDifference(const SPD_TestMips &other) const
+        {
+            for (int i = 0; i < Count(); i++)
+            {
+                if (mips[i].data != other.mips[i].data)
+                    return i;
+            }
+            return -1;
+        }
+    };
+
+    static inline int SpdTestMipCount(uint32_t width, uint32_t height)
+    {
+        int mips = SPD_CPU::GetMaxMipLevelCount(width, height);
+        return mips > 0 ? mips : 1;
+    }
+}
@@ -0,0 +1,207 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// The last work group resets the atomic counters: after every dispatch all counters of ffx_spd_cpu.h are zero, and repeated
+// Dispatch calls of the same SPD_CPU give the same mips without a clear of the counters in between. The same holds for the
+// global bins of the histogram and of the alpha coverage: repeated dispatches give the same histogram, exposure and scales.
+
+#include "stdafx.h"
+#include "SPD_CPU_Test.h"
+
+using namespace FFX_CPU;
+
+// RGBA32F hooks of ffx_spd_cpu.h that own their counters, one work group after the other on this thread
+struct CounterHooks
+{
+    const SPD_TestImage *pSrc;
+    SPD_TestMips *pDst;
+    AU1 counter;
+    std::vector<AU1> blockCounters;
+
+    const float *Address(const SPD_Image &image, ASU1 x, ASU1 y) const
+    {
+        if (x < 0 || y < 0 || AU1(x) >= image.Width || AU1(y) >= image.Height) return NULL;
+        return (const float *)((const uint8_t *)image.pData + y * image.RowPitch) + x * 4;
+    }
+    void Load(outAF4 d, const SPD_Image &image, ASU1 x, ASU1 y) const
+    {
+        const float *p = Address(image, x, y);
+        for (int c = 0; c < 4; c++) d[c] = p ? p[c] : 0.0f;
+    }
+
+    void SpdLoadSourceImage(outAF4 d, ASU1 x, ASU1 y, AU1 slice){Load(d, pSrc->image, x, y);}
+    void SpdLoad(outAF4 d, ASU1 x, ASU1 y, AU1 slice){Load(d, pDst->images[5], x, y);}
+    void SpdLoadMip(outAF4 d, ASU1 x, ASU1 y, AU1 mip, AU1 slice){Load(d, pDst->images[mip], x, y);}
+    void SpdStore(ASU1 x, ASU1 y, inAF4 value, AU1 mip, AU1 slice)
+    {
+        float *p = (float *)Address(pDst->images[mip], x, y);
+        if (p) memcpy(p, value, 4 * sizeof(float));
+    }
+    void SpdReduce4(outAF4 d, inAF4 v0, inAF4 v1, inAF4 v2, inAF4 v3){
+        for (int i = 0; i < 4; i++) d[i] = (v0[i] + v1[i] + v2[i] + v3[i]) * 0.25f;}
+    AU1 SpdIncreaseAtomicCounter(AU1 slice){return counter++;}
+    void SpdResetAtomicCounter(AU1 slice){counter = 0;}
+    AU1 SpdIncreaseBlockCounter(AU1 block, AU1 slice){return blockCounters[block]++;}
+    void SpdResetBlockCounter(AU1 block, AU1 slice){blockCounters[block] = 0;}
+};
+
+static void CheckHooks(uint32_t width, uint32_t height, int repeats)
+{
+    SPD_Format format = SPD_Format::SPD_R32G32B32A32_FLOAT;
+    int mips = SpdTestMipCount(width, height);
+    SPD_TestImage src;
+    src.Allocate(width, height, format);
+    src.Randomize(format, width + height);
+    AU1 tilesX = (width + 63) / 64;
+    AU1 tilesY = (height + 63) / 64;
+    bool extended = tilesX > 64 || tilesY > 64;
+
+    SPD_TestMips first;
+    for (int repeat = 0; repeat < repeats; repeat++)
+    {
+        SPD_TestMips dst;
+        dst.Allocate(width, height, mips, format, uint8_t(repeat));
+        CounterHooks hooks = { &src, &dst, 0, std::vector<AU1>(((tilesX + 63) / 64) * ((tilesY + 63) / 64), 0) };
+        SpdIntermediate lds;
+        varAU2(numWorkGroups) = initAU2(tilesX, tilesY);
+        for (AU1 y = 0; y < tilesY; y++)
+        {
+            for (AU1 x = 0; x < tilesX; x++)
+            {
+                varAU2(workGroupID) = initAU2(x, y);
+                if (extended)
+                    SpdDownsampleExtended(hooks, lds, workGroupID, mips, numWorkGroups, 0);
+                else
+                    SpdDownsample(hooks, lds, workGroupID, mips, tilesX * tilesY, 0);
+            }
+        }
+
+        AU1 blockCounters = 0;
+        for (AU1 counter : hooks.blockCounters)
+            blockCounters |= counter;
+        SPD_TEST_CHECK(hooks.counter == 0 && blockCounters == 0, "%ux%u dispatch %d: the counters are not zero afterwards",
+            width, height, repeat);
+        if (repeat == 0)
+            first = dst;
+        int mip = dst.FirstDifference(first);
+        SPD_TEST_CHECK(mip < 0, "%ux%u dispatch %d: differs from the first dispatch at mip %d", width, height, repeat, mip);
+    }
+}
+
+static void CheckDispatch(SPD_Format format, bool packed, bool splitTail, uint32_t waveSize, uint32_t width, uint32_t height, int repeats)
+{
+    int mips = SpdTestMipCount(width, height);
+    SPD_TestImage src;
+    src.Allocate(width, height, format);
+    src.Randomize(format, width * 3 + height);
+
+    SPD_CPU spd;
+    spd.OnCreate(format, packed, 3);
+    spd.SetSplitTail(splitTail);
+    spd.SetWaveSize(waveSize);
+    SPD_TestMips first;
+    for (int repeat = 0; repeat < repeats; repeat++)
+    {
+        // a different fill each time, a tail that does not run leaves it in mips 6 and up
+        SPD_TestMips dst;
+        dst.Allocate(width, height, mips, format, uint8_t(repeat * 37));
+        spd.Dispatch(src.image, dst.images.data(), mips);
+        if (repeat == 0)
+            first = dst;
+        int mip = dst.FirstDifference(first);
+        SPD_TEST_CHECK(mip < 0, "format %d packed %d split tail %d wave size %u %ux%u: dispatch %d differs from the first at mip %d",
+            int(format), int(packed), int(splitTail), waveSize, width, height, repeat, mip);
+    }
+    spd.OnDestroy();
+}
+
+static void CheckBins(SPD_Format format, bool packed, uint32_t width, uint32_t height, int repeats)
+{
+    int mips = SpdTestMipCount(width, height);
+    SPD_TestImage src;
+    src.Allocate(width, height, format);
+    src.Randomize(format, width + height * 5);
+    SPD_TestMips dst;
+    dst.Allocate(width, height, mips, format);
+
+    for (int coverage = 0; coverage < 2; coverage++)
+    {
+        SPD_CPU spd;
+        spd.OnCreate(format, packed, 3);
+        if (coverage)
+            spd.SetAlphaCoverage(0.5f);
+        else
+            spd.SetHistogram(64, -8.0f, 10.0f);
+        std::vector<uint32_t> first, bins(64);
+        for (int repeat = 0; repeat < repeats; repeat++)
+        {
+            spd.Dispatch(src.image, dst.images.data(), mips);
+            std::vector<uint32_t> result;
+            if (coverage)
+            {
+                for (int mip = 0; mip < mips; mip++)
+                {
+                    float scale = spd.GetAlphaScale(mip);
+                    uint32_t bits;
+                    memcpy(&bits, &scale, 4);
+                    result.push_back(bits);
+                }
+            }
+            else
+            {
+                spd.GetHistogram(0, bins.data());
+                SPD_Exposure exposure = spd.GetExposure();
+                result = bins;
+                for (float value : { exposure.average, exposure.percentileAverage })
+                {
+                    uint32_t bits;
+                    memcpy(&bits, &value, 4);
+                    result.push_back(bits);
+                }
+            }
+            if (repeat == 0)
+                first = result;
+            SPD_TEST_CHECK(result == first, "format %d packed %d %ux%u: dispatch %d gives another %s than the first",
+                int(format), int(packed), width, height, repeat, coverage ? "alpha scale" : "histogram or exposure");
+        }
+        spd.OnDestroy();
+    }
+}
+
+int main()
+{
+    static const uint32_t sizes[][2] = { { 64, 64 }, { 1000, 600 }, { 4096, 4096 }, { 127, 4096 }, { 4160, 100 } };
+    static const int repeats = 4;
+
+    for (const uint32_t *size : sizes)
+    {
+        CheckHooks(size[0], size[1], repeats);
+        for (const SPD_TestFormat &format : s_testFormats)
+            CheckDispatch(format.format, false, false, 0, size[0], size[1], repeats);
+        CheckDispatch(SPD_Format::SPD_R16G16B16A16_FLOAT, true, false, 0, size[0], size[1], repeats);
+        if (size[0] <= 4096 && size[1] <= 4096)
+        {
+            CheckDispatch(SPD_Format::SPD_R32G32B32A32_FLOAT, false, true, 0, size[0], size[1], repeats);
+            CheckDispatch(SPD_Format::SPD_R32G32B32A32_FLOAT, false, false, 32, size[0], size[1], repeats);
+            CheckBins(SPD_Format::SPD_R8G8B8A8_UNORM, false, size[0], size[1], repeats);
+            CheckBins(SPD_Format::SPD_R16G16B16A16_FLOAT, true, size[0], size[1], repeats);
+        }
+    }
+    return SpdTestResult();
+}
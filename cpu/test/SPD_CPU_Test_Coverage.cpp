@@ -0,0 +1,160 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// The alpha coverage keeps the fraction of the texels of every mip that passes the alpha test as close to the one of the source
+// as the distinct alpha of the mip allows, RGBA32F and RGBA8, packed or not. Mips 0..5 of RGBA32F only tell the alpha apart
+// in 256 bins. The packed version counts the source texels that pass on their fp16 alpha. Apart from the scaled alpha the mips
+// are the ones of a plain Dispatch.
+
+#include "SPD_CPU_Test.h"
+#include <algorithm>
+#include <math.h>
+
+using namespace FFX_CPU;
+
+// alpha of texel i in 0..1
+static float Alpha(const SPD_TestImage &image, SPD_Format format, size_t i)
+{
+    if (format == SPD_Format::SPD_R32G32B32A32_FLOAT)
+    {
+        float v;
+        memcpy(&v, &image.data[i * 16 + 12], 4);
+        return v;
+    }
+    return float(image.data[i * 4 + 3]) / 255.0f;
+}
+
+// alpha rounded to the nearest fp16, 11 significant bits
+static float Half(float alpha)
+{
+    int exponent;
+    float mantissa = frexpf(alpha, &exponent);
+    return ldexpf(nearbyintf(ldexpf(mantissa, 11)), exponent - 11);
+}
+
+// target texels of the source fraction in count texels: the closest counts at or below and at or above it that a cut
+// between the distinct alpha of the plain mip gives
+static void Bracket(std::vector<float> alpha, double target, size_t &lower, size_t &upper)
+{
+    std::sort(alpha.begin(), alpha.end());
+    size_t count = alpha.size();
+    lower = 0;
+    upper = count;
+    for (size_t i = 0; i <= count; i++)
+    {
+        // the texels i.. pass a cut between alpha[i - 1] and alpha[i]
+        if (i > 0 && i < count && alpha[i - 1] == alpha[i]) continue;
+        size_t above = count - i;
+        if (above <= target) lower = std::max(lower, above);
+        if (above >= target) upper = std::min(upper, above);
+    }
+}
+
+static void Test(SPD_Format format, const char *pName, bool packed, const SPD_TestImage &src, float reference)
+{
+    uint32_t width = src.image.Width;
+    uint32_t height = src.image.Height;
+    int mips = SpdTestMipCount(width, height);
+    SPD_TestMips plain, scaled;
+    plain.Allocate(width, height, mips, format);
+    scaled.Allocate(width, height, mips, format);
+
+    SPD_CPU spd;
+    spd.OnCreate(format, packed, 3);
+    spd.Dispatch(src.image, plain.images.data(), mips);
+    spd.SetAlphaCoverage(reference);
+    spd.Dispatch(src.image, scaled.images.data(), mips);
+
+    size_t covered = 0;
+    for (size_t i = 0; i < size_t(width) * height; i++)
+    {
+        float alpha = Alpha(src, format, i);
+        covered += (packed && format == SPD_Format::SPD_R32G32B32A32_FLOAT ? Half(alpha) : alpha) >= reference;
+    }
+    double coverage = double(covered) / (double(width) * height);
+
+    for (int mip = 0; mip < mips; mip++)
+    {
+        const SPD_TestImage &a = plain.mips[mip];
+        const SPD_TestImage &b = scaled.mips[mip];
+        size_t count = size_t(a.image.Width) * a.image.Height;
+        float scale = spd.GetAlphaScale(mip);
+        std::vector<float> alpha(count);
+        size_t passed = 0;
+        int wrong = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            alpha[i] = Alpha(a, format, i);
+            if (mip < 6) alpha[i] = floorf(alpha[i] * 255.0f + 0.5f);
+            float scaledAlpha = Alpha(b, format, i);
+            passed += scaledAlpha >= reference;
+            // the color is the one of the plain mips, the alpha the scaled one rounded to the format
+            size_t texel = a.data.size() / count;
+            float expected = std::min(Alpha(a, format, i) * scale, 1.0f);
+            float error = format == SPD_Format::SPD_R32G32B32A32_FLOAT ? 1e-6f : 0.5f / 255.0f + 1e-4f;
+            if (memcmp(&a.data[i * texel], &b.data[i * texel], texel - texel / 4) != 0 || fabsf(scaledAlpha - expected) > error)
+                wrong++;
+        }
+        size_t lower, upper;
+        Bracket(alpha, coverage * double(count), lower, upper);
+        SPD_TEST_CHECK(passed >= lower && passed <= upper, "%s %ux%u packed %d reference %.2f mip %d: %zu of %zu texels pass, %zu..%zu expected (scale %f)",
+            pName, width, height, int(packed), reference, mip, passed, count, lower, upper, scale);
+        SPD_TEST_CHECK(wrong == 0, "%s %ux%u packed %d reference %.2f mip %d: %d texels are not the plain ones with the alpha scaled by %f",
+            pName, width, height, int(packed), reference, mip, wrong, scale);
+    }
+    spd.OnDestroy();
+}
+
+int main()
+{
+    static const SPD_TestFormat formats[] =
+    {
+        { SPD_Format::SPD_R32G32B32A32_FLOAT, "R32G32B32A32_FLOAT" },
+        { SPD_Format::SPD_R8G8B8A8_UNORM, "R8G8B8A8_UNORM" },
+    };
+    // width, height, percent of the texels with alpha 1 and the others 0, 0 for random alpha
+    static const uint32_t sources[][3] = { { 1024, 1024, 30 }, { 300, 200, 0 }, { 129, 1000, 10 }, { 4096, 64, 0 } };
+    static const float references[] = { 0.5f, 0.3f, 0.9f };
+
+    for (const SPD_TestFormat &format : formats)
+    {
+        for (const uint32_t *source : sources)
+        {
+            SPD_TestImage src;
+            src.Allocate(source[0], source[1], format.format);
+            src.Randomize(format.format, source[0] + source[1] * 3);
+            SPD_TestRandom random(source[2] + 7);
+            size_t texel = SPD_CPU::GetBytesPerTexel(format.format);
+            for (size_t i = 0; source[2] && i < size_t(source[0]) * source[1]; i++)
+            {
+                float alpha = random.Next() % 100 < source[2] ? 1.0f : 0.0f;
+                if (format.format == SPD_Format::SPD_R32G32B32A32_FLOAT)
+                    memcpy(&src.data[i * texel + 12], &alpha, 4);
+                else
+                    src.data[i * texel + 3] = uint8_t(alpha * 255.0f);
+            }
+            for (int packed = 0; packed < 2; packed++)
+            {
+                for (float reference : references)
+                    Test(format.format, format.pName, packed != 0, src, reference);
+            }
+        }
+    }
+    return SpdTestResult();
+}
@@ -0,0 +1,90 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Hierarchical Z is conservative: every texel of every mip is at least as far as every source texel it covers in uv space,
+// the maximum or with reversed Z the minimum, also for odd widths and heights.
+
+#include "SPD_CPU_Test.h"
+
+using namespace FFX_CPU;
+
+// source texels covered by texel x of a mip of mipSize texels, [first, end)
+static void Footprint(uint32_t x, uint32_t mipSize, uint32_t srcSize, uint32_t &first, uint32_t &end)
+{
+    first = uint32_t(uint64_t(x) * srcSize / mipSize);
+    end = uint32_t((uint64_t(x + 1) * srcSize + mipSize - 1) / mipSize);
+}
+
+static void Check(SPD_Format format, bool reversed, uint32_t width, uint32_t height)
+{
+    int mips = SpdTestMipCount(width, height);
+    SPD_TestImage src;
+    src.Allocate(width, height, format);
+    src.Randomize(format, width * 5 + height);
+    SPD_TestMips dst;
+    dst.Allocate(width, height, mips, format);
+
+    SPD_CPU spd;
+    spd.OnCreate(format, false, 3);
+    spd.Dispatch(src.image, dst.images.data(), mips);
+    spd.OnDestroy();
+
+    const float *pSrc = (const float *)src.data.data();
+    for (int mip = 0; mip < mips; mip++)
+    {
+        const SPD_Image &image = dst.images[mip];
+        const float *pMip = (const float *)image.pData;
+        uint32_t failed = 0;
+        for (uint32_t y = 0; y < image.Height; y++)
+        {
+            uint32_t firstY, endY;
+            Footprint(y, image.Height, height, firstY, endY);
+            for (uint32_t x = 0; x < image.Width; x++)
+            {
+                uint32_t firstX, endX;
+                Footprint(x, image.Width, width, firstX, endX);
+                float depth = pMip[y * image.Width + x];
+                for (uint32_t sy = firstY; sy < endY; sy++)
+                {
+                    for (uint32_t sx = firstX; sx < endX; sx++)
+                    {
+                        float s = pSrc[sy * width + sx];
+                        if (reversed ? s < depth : s > depth)
+                            failed++;
+                    }
+                }
+            }
+        }
+        SPD_TEST_CHECK(failed == 0, "%s %ux%u mip %d: %u source texels are farther than their texel",
+            reversed ? "reversed Z" : "Z", width, height, mip, failed);
+    }
+}
+
+int main()
+{
+    static const uint32_t sizes[][2] = { { 1, 1 }, { 3, 3 }, { 5, 2 }, { 64, 64 }, { 65, 63 }, { 127, 129 }, { 300, 7 }, { 1, 301 },
+        { 1000, 700 }, { 1920, 1080 }, { 255, 2049 } };
+
+    for (const uint32_t *size : sizes)
+    {
+        Check(SPD_Format::SPD_R32_FLOAT_DEPTH, false, size[0], size[1]);
+        Check(SPD_Format::SPD_R32_FLOAT_DEPTH_REVERSED_Z, true, size[0], size[1]);
+    }
+    return SpdTestResult();
+}
@@ -0,0 +1,96 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// DispatchDirty after an edit of the source gives the same mips as a Dispatch of the edited source, for odd and non-square
+// sizes. RGBA32F on the kernels and on the hooks, and the packed formats, whose stored mips are the values of the LDS.
+
+#include "SPD_CPU_Test.h"
+
+using namespace FFX_CPU;
+
+static void Check(SPD_Format format, bool packed, SPD_Reduction reduction, uint32_t width, uint32_t height, const SPD_Rect *pRects, uint32_t rectCount)
+{
+    int mips = SpdTestMipCount(width, height);
+    uint32_t texelSize = SPD_CPU::GetBytesPerTexel(format);
+    SPD_TestImage src;
+    src.Allocate(width, height, format);
+    src.Randomize(format, width + height * 11);
+
+    SPD_CPU spd;
+    spd.OnCreate(format, packed, 3);
+    spd.SetReduction(reduction);
+    SPD_TestMips dirty;
+    dirty.Allocate(width, height, mips, format);
+    spd.Dispatch(src.image, dirty.images.data(), mips);
+
+    // new texels in the rectangles
+    SPD_TestImage edit;
+    edit.Allocate(width, height, format);
+    edit.Randomize(format, width * 3 + height);
+    for (uint32_t i = 0; i < rectCount; i++)
+    {
+        const SPD_Rect &rect = pRects[i];
+        for (uint32_t y = rect.Top; y < rect.Top + rect.Height && y < height; y++)
+        {
+            for (uint32_t x = rect.Left; x < rect.Left + rect.Width && x < width; x++)
+            {
+                size_t offset = (size_t(y) * width + x) * texelSize;
+                memcpy(&src.data[offset], &edit.data[offset], texelSize);
+            }
+        }
+    }
+    spd.DispatchDirty(src.image, dirty.images.data(), mips, pRects, rectCount);
+
+    SPD_TestMips full;
+    full.Allocate(width, height, mips, format);
+    spd.Dispatch(src.image, full.images.data(), mips);
+    spd.OnDestroy();
+
+    int mip = dirty.FirstDifference(full);
+    SPD_TEST_CHECK(mip < 0, "format %d packed %d reduction %d %ux%u: DispatchDirty differs from Dispatch at mip %d",
+        int(format), int(packed), int(reduction), width, height, mip);
+}
+
+int main()
+{
+    static const uint32_t sizes[][2] = { { 100, 37 }, { 191, 64 }, { 300, 7 }, { 1000, 600 }, { 1024, 1000 }, { 1920, 1080 },
+        { 127, 4096 }, { 4096, 127 }, { 255, 2049 }, { 4096, 4096 } };
+
+    for (const uint32_t *size : sizes)
+    {
+        uint32_t width = size[0];
+        uint32_t height = size[1];
+        // one texel, the last column and row of the source, and a rectangle that crosses tiles
+        SPD_Rect rects[] = {
+            { width / 3, height / 2, 1, 1 },
+            { width - 1, 0, 1, height },
+            { 0, height - 1, width, 1 },
+            { width / 4, height / 4, width / 5 + 1, height / 7 + 1 },
+        };
+        for (uint32_t first = 0; first < 4; first++)
+        {
+            Check(SPD_Format::SPD_R32G32B32A32_FLOAT, false, SPD_Reduction::SPD_Average, width, height, rects + first, 1);
+        }
+        Check(SPD_Format::SPD_R32G32B32A32_FLOAT, false, SPD_Reduction::SPD_Average, width, height, rects, 4);
+        Check(SPD_Format::SPD_R32G32B32A32_FLOAT, false, SPD_Reduction::SPD_Luminance, width, height, rects, 4);
+        Check(SPD_Format::SPD_R32G32B32A32_FLOAT, true, SPD_Reduction::SPD_Average, width, height, rects, 4);
+        Check(SPD_Format::SPD_R16G16B16A16_FLOAT, true, SPD_Reduction::SPD_Average, width, height, rects, 4);
+    }
+    return SpdTestResult();
+}
@@ -0,0 +1,178 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// SPD_Binomial, SPD_Kaiser and SPD_Lanczos against a direct separable filter of the parent of every mip, with the weights
+// from their definitions: every texel, also the ones at the seams of the 64x64 tiles and the edges of odd sizes. UNORM mips
+// are clamped to 0..1. Mips 1 and 2 are filtered from the unrounded parent in the intermediate, the stored parent is off by
+// up to half a step of the format, so the filter of it is off by up to half a step times the sum of the absolute weights.
+
+#include "SPD_CPU_Test.h"
+
+#include <algorithm>
+#include <math.h>
+
+using namespace FFX_CPU;
+
+// weights of the parent texels 2p - radius .. 2p + radius + 1 of texel p
+static int Weights(SPD_Reduction filter, double *w)
+{
+    if (filter == SPD_Reduction::SPD_Binomial)
+    {
+        w[0] = w[3] = 1.0 / 8.0;
+        w[1] = w[2] = 3.0 / 8.0;
+        return 1;
+    }
+    // the sinc of the mip, windowed over 3 parent texels, Kaiser with beta 4
+    const double pi = 3.14159265358979323846;
+    double sum = 0.0;
+    for (int t = 0; t < 3; t++)
+    {
+        double d = 0.5 + t;
+        double sinc = sin(pi * d / 2.0) / (pi * d / 2.0);
+        double window = sin(pi * d / 3.0) / (pi * d / 3.0);
+        if (filter == SPD_Reduction::SPD_Kaiser)
+        {
+            // I0(4 sqrt(1 - (d / 3)^2)) / I0(4)
+            double x = 4.0 * sqrt(1.0 - d * d / 9.0);
+            double i0x = 0.0, i04 = 0.0, term = 1.0, term4 = 1.0;
+            for (int k = 1; k < 30; k++)
+            {
+                i0x += term;
+                i04 += term4;
+                term *= (x * x / 4.0) / (double(k) * k);
+                term4 *= 4.0 / (double(k) * k);
+            }
+            window = i0x / i04;
+        }
+        w[2 - t] = w[3 + t] = sinc * window;
+        sum += 2.0 * sinc * window;
+    }
+    for (int t = 0; t < 6; t++)
+        w[t] /= sum;
+    return 2;
+}
+
+static float Load(const SPD_TestImage &image, SPD_Format format, uint32_t x, uint32_t y, int c)
+{
+    const uint8_t *p = image.data.data() + y * image.image.RowPitch + x * SPD_CPU::GetBytesPerTexel(format);
+    if (format == SPD_Format::SPD_R32G32B32A32_FLOAT)
+    {
+        float v;
+        memcpy(&v, p + c * 4, 4);
+        return v;
+    }
+    if (format == SPD_Format::SPD_R16G16B16A16_FLOAT)
+    {
+        uint16_t h;
+        memcpy(&h, p + c * 2, 2);
+        // normal fp16, Randomize gives 0.125..1 and the filters stay above 2^-14
+        uint32_t bits = ((h & 0x8000u) << 16) | ((((h >> 10) & 0x1fu) + 112u) << 23) | ((h & 0x3ffu) << 13);
+        float v;
+        memcpy(&v, &bits, 4);
+        return (h & 0x7fffu) ? v : 0.0f;
+    }
+    return float(p[c]) / 255.0f;
+}
+
+static void Test(SPD_Format format, const char *pName, SPD_Reduction filter, const char *pFilter, uint32_t width, uint32_t height)
+{
+    int mips = SpdTestMipCount(width, height);
+    SPD_TestImage src;
+    src.Allocate(width, height, format);
+    src.Randomize(format, width * 3 + height * 5);
+    SPD_TestMips dst;
+    dst.Allocate(width, height, mips, format);
+
+    SPD_CPU spd;
+    spd.OnCreate(format, false, 3);
+    spd.SetReduction(filter);
+    spd.Dispatch(src.image, dst.images.data(), mips);
+    spd.OnDestroy();
+
+    double w[6];
+    int radius = Weights(filter, w);
+    double absolute = 0.0;
+    for (int t = 0; t < 2 * radius + 2; t++)
+        absolute += fabs(w[t]);
+    bool unorm = format == SPD_Format::SPD_R8G8B8A8_UNORM;
+    double step = unorm ? 1.0 / 255.0 : (format == SPD_Format::SPD_R16G16B16A16_FLOAT ? 1.0 / 1024.0 : 0.0);
+
+    for (int mip = 0; mip < mips; mip++)
+    {
+        const SPD_TestImage &parent = mip == 0 ? src : dst.mips[mip - 1];
+        const SPD_TestImage &a = dst.mips[mip];
+        int lastX = int(parent.image.Width) - 1;
+        int lastY = int(parent.image.Height) - 1;
+        double tolerance = step * (mip == 1 || mip == 2 ? 0.5 + 0.5 * absolute * absolute : 0.5) + 1e-6;
+        int wrong = 0;
+        double worst = 0.0;
+        for (uint32_t y = 0; y < a.image.Height; y++)
+        {
+            for (uint32_t x = 0; x < a.image.Width; x++)
+            {
+                for (int c = 0; c < 4; c++)
+                {
+                    double sum = 0.0;
+                    for (int ty = 0; ty < 2 * radius + 2; ty++)
+                    {
+                        int py = std::min(std::max(int(y) * 2 - radius + ty, 0), lastY);
+                        double row = 0.0;
+                        for (int tx = 0; tx < 2 * radius + 2; tx++)
+                        {
+                            int px = std::min(std::max(int(x) * 2 - radius + tx, 0), lastX);
+                            row += w[tx] * Load(parent, format, uint32_t(px), uint32_t(py), c);
+                        }
+                        sum += w[ty] * row;
+                    }
+                    if (unorm)
+                        sum = std::min(std::max(sum, 0.0), 1.0);
+                    double error = fabs(double(Load(a, format, x, y, c)) - sum);
+                    worst = std::max(worst, error);
+                    wrong += error > tolerance;
+                }
+            }
+        }
+        SPD_TEST_CHECK(wrong == 0, "%s %s %ux%u mip %d: %d channels off by more than %g, up to %g",
+            pName, pFilter, width, height, mip, wrong, tolerance, worst);
+    }
+}
+
+int main()
+{
+    static const SPD_TestFormat formats[] =
+    {
+        { SPD_Format::SPD_R32G32B32A32_FLOAT, "R32G32B32A32_FLOAT" },
+        { SPD_Format::SPD_R16G16B16A16_FLOAT, "R16G16B16A16_FLOAT" },
+        { SPD_Format::SPD_R8G8B8A8_UNORM, "R8G8B8A8_UNORM" },
+    };
+    static const struct { SPD_Reduction filter; const char *pName; } filters[] =
+    {
+        { SPD_Reduction::SPD_Binomial, "SPD_Binomial" },
+        { SPD_Reduction::SPD_Kaiser, "SPD_Kaiser" },
+        { SPD_Reduction::SPD_Lanczos, "SPD_Lanczos" },
+    };
+    // tile seams in both directions, odd sizes, a single column
+    static const uint32_t sizes[][2] = { { 256, 256 }, { 301, 203 }, { 129, 1000 }, { 1, 77 }, { 1024, 64 } };
+
+    for (const SPD_TestFormat &format : formats)
+        for (const auto &filter : filters)
+            for (const uint32_t *size : sizes)
+                Test(format.format, format.pName, filter.filter, filter.pName, size[0], size[1]);
+    return SpdTestResult();
+}
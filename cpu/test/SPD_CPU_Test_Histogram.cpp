@@ -0,0 +1,212 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// SetHistogram, GetHistogram and GetExposure against the luminance of every texel of mip 0, over repeated dispatches. The
+// sources are 2x2 blocks of one color, so mip 0 holds them exactly. Bin 0 holds black and the texels below the range, the
+// texels above it count in the last bin. Texels on the edge of two bins, within the rounding of the hooks, may go either
+// way. The exposure is within half a bin of the log2 luminance of the texels, the percentiles within a bin.
+
+#include "stdafx.h"
+#include "SPD_CPU_Test.h"
+
+#include <algorithm>
+
+using namespace FFX_CPU;
+
+struct HistogramCase
+{
+    uint32_t bins;
+    float minLog2Luminance;
+    float log2Range;
+    int blackPercent; // the other texels have a log2 luminance from 2 below to 1 above the range
+};
+
+static void StoreTexel(SPD_TestImage &image, SPD_Format format, size_t i, const float *rgb)
+{
+    size_t texel = SPD_CPU::GetBytesPerTexel(format);
+    for (int c = 0; c < 4; c++)
+    {
+        float v = c < 3 ? rgb[c] : 1.0f;
+        if (format == SPD_Format::SPD_R32G32B32A32_FLOAT)
+            memcpy(&image.data[i * texel + c * 4], &v, 4);
+        else if (format == SPD_Format::SPD_R16G16B16A16_FLOAT)
+        {
+            uint16_t h = uint16_t(AU1_AH1_AF1(v));
+            memcpy(&image.data[i * texel + c * 2], &h, 2);
+        }
+        else
+            image.data[i * texel + c] = uint8_t(AMinF1(v, 1.0f) * 255.0f + 0.5f);
+    }
+}
+
+static float LoadChannel(const SPD_TestImage &image, SPD_Format format, size_t i, int c)
+{
+    size_t texel = SPD_CPU::GetBytesPerTexel(format);
+    if (format == SPD_Format::SPD_R32G32B32A32_FLOAT)
+    {
+        float v;
+        memcpy(&v, &image.data[i * texel + c * 4], 4);
+        return v;
+    }
+    if (format == SPD_Format::SPD_R16G16B16A16_FLOAT)
+    {
+        uint16_t h;
+        memcpy(&h, &image.data[i * texel + c * 2], 2);
+        return AF1_AH1_AU1(h);
+    }
+    return float(image.data[i * texel + c]) / 255.0f;
+}
+
+static void Test(SPD_Format format, const char *pName, bool packed, uint32_t width, uint32_t height, const HistogramCase &test)
+{
+    int mips = SpdTestMipCount(width, height);
+    SPD_TestImage src;
+    src.Allocate(width, height, format);
+    SPD_TestRandom random(width * 5 + height + test.bins);
+    for (uint32_t y = 0; y < height; y += 2)
+    {
+        for (uint32_t x = 0; x < width; x += 2)
+        {
+            float rgb[3] = { 0.0f, 0.0f, 0.0f };
+            if (int(random.Next() % 100) >= test.blackPercent)
+            {
+                float log2Luminance = test.minLog2Luminance - 2.0f + random.NextFloat() * (test.log2Range + 3.0f);
+                for (int c = 0; c < 3; c++)
+                    rgb[c] = AMinF1(exp2f(log2Luminance) * (0.75f + 0.5f * random.NextFloat()), 1.0f);
+            }
+            for (uint32_t i = 0; i < 4; i++)
+                if (x + (i & 1) < width && y + (i >> 1) < height)
+                    StoreTexel(src, format, (y + (i >> 1)) * width + x + (i & 1), rgb);
+        }
+    }
+
+    // the luminance of every texel of mip 0 is the one of its block, which is stored exactly
+    uint32_t mip0Width = SPD_CPU::GetMipDimension(width, 0);
+    uint32_t mip0Height = SPD_CPU::GetMipDimension(height, 0);
+    float binWidth = test.log2Range / float(test.bins - 1);
+    std::vector<uint32_t> expected(test.bins, 0);
+    std::vector<float> log2Luminances;
+    uint32_t ambiguous = 0;
+    for (uint32_t y = 0; y < mip0Height; y++)
+    {
+        for (uint32_t x = 0; x < mip0Width; x++)
+        {
+            size_t i = size_t(y * 2) * width + x * 2;
+            double luminance = LoadChannel(src, format, i, 0) * 0.2126 + LoadChannel(src, format, i, 1) * 0.7152 + LoadChannel(src, format, i, 2) * 0.0722;
+            double t = luminance > 0.0 ? (log2(luminance) - test.minLog2Luminance) / test.log2Range : -1.0;
+            // fp16 of the packed version moves a texel by up to 2^-11 of its luminance
+            double edge = t * (test.bins - 1);
+            double tolerance = packed ? 1e-3 / test.log2Range * (test.bins - 1) : 1e-3;
+            if (t > -1.0 && t <= 1.0 && fabs(edge - floor(edge + 0.5)) < tolerance)
+                ambiguous++;
+            if (t < 0.0)
+            {
+                expected[0]++;
+                continue;
+            }
+            expected[1 + std::min(uint32_t(std::min(t, 1.0) * (test.bins - 1)), test.bins - 2)]++;
+            log2Luminances.push_back(float(test.minLog2Luminance + std::min(t, 1.0) * test.log2Range));
+        }
+    }
+    std::sort(log2Luminances.begin(), log2Luminances.end());
+    size_t total = log2Luminances.size();
+
+    // geometric means of all texels above bin 0 and of the ones between the percentiles, the percentiles
+    double sum = 0.0;
+    for (float v : log2Luminances)
+        sum += v;
+    double low = double(total) * 0.5;
+    double high = double(total) * 0.95;
+    double clippedSum = 0.0;
+    double clippedCount = 0.0;
+    for (size_t i = 0; i < total; i++)
+    {
+        double inside = std::min(std::max(double(i + 1), low), high) - std::min(std::max(double(i), low), high);
+        clippedSum += inside * log2Luminances[i];
+        clippedCount += inside;
+    }
+
+    SPD_CPU spd;
+    spd.OnCreate(format, packed, 3);
+    spd.SetHistogram(test.bins, test.minLog2Luminance, test.log2Range);
+    for (int repeat = 0; repeat < 3; repeat++)
+    {
+        SPD_TestMips dst;
+        dst.Allocate(width, height, mips, format);
+        spd.Dispatch(src.image, dst.images.data(), mips);
+
+        std::vector<uint32_t> bins(test.bins);
+        spd.GetHistogram(0, bins.data());
+        uint32_t difference = 0;
+        uint64_t count = 0;
+        for (uint32_t bin = 0; bin < test.bins; bin++)
+        {
+            difference += bins[bin] > expected[bin] ? bins[bin] - expected[bin] : expected[bin] - bins[bin];
+            count += bins[bin];
+        }
+        SPD_TEST_CHECK(count == uint64_t(mip0Width) * mip0Height && difference <= 2 * ambiguous,
+            "%s packed %d %ux%u %u bins dispatch %d: %llu texels, %u in bin 0 of %u, %u moved of %u on an edge",
+            pName, int(packed), width, height, test.bins, repeat, (unsigned long long)count, bins[0], expected[0], difference / 2, ambiguous);
+
+        SPD_Exposure exposure = spd.GetExposure();
+        if (total == 0)
+        {
+            SPD_TEST_CHECK(exposure.average == 0.0f && exposure.percentileAverage == 0.0f && exposure.low == 0.0f && exposure.high == 0.0f,
+                "%s packed %d %ux%u %u bins dispatch %d: the exposure of a source below the range is not zero",
+                pName, int(packed), width, height, test.bins, repeat);
+            continue;
+        }
+        float lowLog2 = log2Luminances[std::min(size_t(low), total - 1)];
+        float highLog2 = log2Luminances[size_t(ceil(high)) - 1];
+        float tolerance = binWidth * 0.5f + (packed ? 2e-3f : 1e-4f);
+        SPD_TEST_CHECK(fabsf(log2f(exposure.average) - float(sum / double(total))) <= tolerance &&
+            fabsf(log2f(exposure.percentileAverage) - float(clippedSum / clippedCount)) <= tolerance &&
+            fabsf(log2f(exposure.low) - lowLog2) <= binWidth && fabsf(log2f(exposure.high) - highLog2) <= binWidth,
+            "%s packed %d %ux%u %u bins dispatch %d: log2 exposure %f %f %f %f, %f %f %f %f expected",
+            pName, int(packed), width, height, test.bins, repeat, log2f(exposure.average), log2f(exposure.percentileAverage),
+            log2f(exposure.low), log2f(exposure.high), sum / double(total), clippedSum / clippedCount, lowLog2, highLog2);
+    }
+    spd.OnDestroy();
+}
+
+int main()
+{
+    static const struct { SPD_Format format; const char *pName; bool packed; } formats[] =
+    {
+        { SPD_Format::SPD_R32G32B32A32_FLOAT, "R32G32B32A32_FLOAT", false },
+        { SPD_Format::SPD_R32G32B32A32_FLOAT, "R32G32B32A32_FLOAT", true },
+        { SPD_Format::SPD_R16G16B16A16_FLOAT, "R16G16B16A16_FLOAT", true },
+        { SPD_Format::SPD_R8G8B8A8_UNORM, "R8G8B8A8_UNORM", false },
+    };
+    static const HistogramCase cases[] =
+    {
+        { 64, -8.0f, 8.0f, 10 },
+        { 256, -6.0f, 5.0f, 0 },
+        { 2, -4.0f, 4.0f, 30 },
+        // every texel in bin 0
+        { 128, -8.0f, 8.0f, 100 },
+    };
+    static const uint32_t sizes[][2] = { { 256, 256 }, { 301, 200 }, { 1024, 512 } };
+
+    for (const auto &format : formats)
+        for (const HistogramCase &test : cases)
+            for (const uint32_t *size : sizes)
+                Test(format.format, format.pName, format.packed, size[0], size[1], test);
+    return SpdTestResult();
+}
@@ -0,0 +1,75 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Every instruction set gives the same bytes as the scalar kernels, for every format, packed or not.
+// Instruction sets the CPU does not support are clamped by OnCreate, so they repeat a supported one.
+
+#include "SPD_CPU_Test.h"
+
+using namespace FFX_CPU;
+
+static const SPD_ISA s_isas[] = { SPD_ISA::SPD_SSE41, SPD_ISA::SPD_AVX2, SPD_ISA::SPD_AVX512 };
+static const char *s_isaNames[] = { "SSE4.1", "AVX2", "AVX-512" };
+
+static void Run(SPD_Format format, bool packed, SPD_ISA isa, SPD_Reduction reduction, const SPD_TestImage &src, SPD_TestMips &dst)
+{
+    SPD_CPU spd;
+    spd.OnCreate(format, packed, 2, isa);
+    spd.SetReduction(reduction);
+    spd.Dispatch(src.image, dst.images.data(), dst.Count());
+    spd.OnDestroy();
+}
+
+int main()
+{
+    static const uint32_t sizes[][2] = { { 64, 64 }, { 256, 256 }, { 1920, 1080 }, { 100, 37 }, { 65, 300 }, { 1, 1 } };
+    static const SPD_Reduction reductions[] = { SPD_Reduction::SPD_Average, SPD_Reduction::SPD_Min, SPD_Reduction::SPD_MinMax };
+
+    for (const SPD_TestFormat &format : s_testFormats)
+    {
+        for (const uint32_t *size : sizes)
+        {
+            int mips = SpdTestMipCount(size[0], size[1]);
+            SPD_TestImage src;
+            src.Allocate(size[0], size[1], format.format);
+            src.Randomize(format.format, size[0] * 7 + size[1]);
+
+            for (int packed = 0; packed < 2; packed++)
+            {
+                for (SPD_Reduction reduction : reductions)
+                {
+                    SPD_TestMips scalar;
+                    scalar.Allocate(size[0], size[1], mips, format.format);
+                    Run(format.format, packed != 0, SPD_ISA::SPD_Scalar, reduction, src, scalar);
+
+                    for (int i = 0; i < 3; i++)
+                    {
+                        SPD_TestMips simd;
+                        simd.Allocate(size[0], size[1], mips, format.format);
+                        Run(format.format, packed != 0, s_isas[i], reduction, src, simd);
+                        int mip = simd.FirstDifference(scalar);
+                        SPD_TEST_CHECK(mip < 0, "%s %ux%u packed %d reduction %d: %s differs from scalar at mip %d",
+                            format.pName, size[0], size[1], packed, int(reduction), s_isaNames[i], mip);
+                    }
+                }
+            }
+        }
+    }
+    return SpdTestResult();
+}
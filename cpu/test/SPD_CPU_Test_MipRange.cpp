@@ -0,0 +1,100 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// DispatchMipRange against a Dispatch of the whole chain: baseMip 5 gives the same bytes for every format and size, other
+// base mips of power of two RGBA32F sources only round differently.
+
+#include "SPD_CPU_Test.h"
+
+#include <math.h>
+
+using namespace FFX_CPU;
+
+// mips of a Dispatch of src, then mips baseMip + 1 and up again with DispatchMipRange
+static void Run(SPD_CPU &spd, SPD_Format format, const SPD_TestImage &src, int baseMip, SPD_TestMips &full, SPD_TestMips &range)
+{
+    uint32_t width = src.image.Width;
+    uint32_t height = src.image.Height;
+    int mips = SpdTestMipCount(width, height);
+    full.Allocate(width, height, mips, format);
+    spd.Dispatch(src.image, full.images.data(), mips);
+
+    range.Allocate(width, height, mips, format);
+    for (int i = 0; i <= baseMip; i++)
+        memcpy(range.mips[i].data.data(), full.mips[i].data.data(), full.mips[i].data.size());
+    spd.DispatchMipRange(range.images.data(), baseMip, mips - 1 - baseMip);
+}
+
+int main()
+{
+    static const uint32_t sizes[][2] = { { 1024, 1024 }, { 4096, 64 }, { 1000, 600 }, { 1024, 1000 }, { 127, 4096 },
+        { 1920, 1080 }, { 640, 480 }, { 255, 2049 } };
+
+    for (const SPD_TestFormat &format : s_testFormats)
+    {
+        for (int packed = 0; packed < 2; packed++)
+        {
+            for (const uint32_t *size : sizes)
+            {
+                SPD_TestImage src;
+                src.Allocate(size[0], size[1], format.format);
+                src.Randomize(format.format, size[0] + size[1]);
+
+                SPD_CPU spd;
+                spd.OnCreate(format.format, packed != 0, 2);
+                SPD_TestMips full, range;
+                Run(spd, format.format, src, 5, full, range);
+                spd.OnDestroy();
+
+                int mip = range.FirstDifference(full);
+                SPD_TEST_CHECK(mip < 0, "%s packed %d %ux%u: DispatchMipRange from mip 5 differs from Dispatch at mip %d",
+                    format.pName, packed, size[0], size[1], mip);
+            }
+        }
+    }
+
+    static const uint32_t powersOfTwo[][2] = { { 256, 256 }, { 1024, 512 }, { 4096, 4096 }, { 64, 2048 } };
+    for (const uint32_t *size : powersOfTwo)
+    {
+        SPD_TestImage src;
+        src.Allocate(size[0], size[1], SPD_Format::SPD_R32G32B32A32_FLOAT);
+        src.Randomize(SPD_Format::SPD_R32G32B32A32_FLOAT, size[0] + size[1]);
+        int mips = SpdTestMipCount(size[0], size[1]);
+
+        SPD_CPU spd;
+        spd.OnCreate(SPD_Format::SPD_R32G32B32A32_FLOAT, false, 2);
+        for (int baseMip = 0; baseMip + 1 < mips; baseMip++)
+        {
+            SPD_TestMips full, range;
+            Run(spd, SPD_Format::SPD_R32G32B32A32_FLOAT, src, baseMip, full, range);
+            float maxError = 0.0f;
+            for (int i = baseMip + 1; i < mips; i++)
+            {
+                const float *pFull = (const float *)full.mips[i].data.data();
+                const float *pRange = (const float *)range.mips[i].data.data();
+                for (size_t j = 0; j < full.mips[i].data.size() / sizeof(float); j++)
+                    maxError = fmaxf(maxError, fabsf(pFull[j] - pRange[j]));
+            }
+            SPD_TEST_CHECK(maxError <= 1e-6f, "%ux%u: DispatchMipRange from mip %d differs from Dispatch by %g, more than rounding",
+                size[0], size[1], baseMip, maxError);
+        }
+        spd.OnDestroy();
+    }
+    return SpdTestResult();
+}
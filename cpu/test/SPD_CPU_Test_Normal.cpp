@@ -0,0 +1,220 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// SPD_Normal on normal maps with the roughness alpha in A, float and UNORM: every mip against a direct Toksvig reduction of
+// the 2x2 texels of its parent, the zero texels skipped (also the ones outside of odd sizes). Mip 0 of all formats, all mips
+// of RGBA32F, where the parent in the intermediate is the stored one. The normals of all mips are unit, the roughness of a
+// mip grows with the spread of the normals of the source and from one mip to the next.
+
+#include "stdafx.h"
+#include "SPD_CPU_Test.h"
+
+#include <algorithm>
+
+using namespace FFX_CPU;
+
+// xyz in -1..1 and the roughness, the UNORM formats hold n * 0.5 + 0.5
+static void StoreNormal(SPD_TestImage &image, SPD_Format format, size_t i, const float *v)
+{
+    size_t texel = SPD_CPU::GetBytesPerTexel(format);
+    for (int c = 0; c < 4; c++)
+    {
+        if (format == SPD_Format::SPD_R32G32B32A32_FLOAT)
+            memcpy(&image.data[i * texel + c * 4], &v[c], 4);
+        else if (format == SPD_Format::SPD_R16G16B16A16_FLOAT)
+        {
+            uint16_t h = uint16_t(AU1_AH1_AF1(v[c]));
+            memcpy(&image.data[i * texel + c * 2], &h, 2);
+        }
+        else
+            image.data[i * texel + c] = uint8_t((c < 3 ? v[c] * 0.5f + 0.5f : v[c]) * 255.0f + 0.5f);
+    }
+}
+
+// false for a zero texel and outside of the image
+static bool LoadNormal(const SPD_TestImage &image, SPD_Format format, uint32_t x, uint32_t y, double *v)
+{
+    if (x >= image.image.Width || y >= image.image.Height)
+        return false;
+    const uint8_t *p = image.data.data() + y * image.image.RowPitch + x * SPD_CPU::GetBytesPerTexel(format);
+    bool zero = true;
+    for (int c = 0; c < 4; c++)
+    {
+        if (format == SPD_Format::SPD_R32G32B32A32_FLOAT)
+        {
+            float f;
+            memcpy(&f, p + c * 4, 4);
+            v[c] = f;
+            zero = zero && f == 0.0f;
+        }
+        else if (format == SPD_Format::SPD_R16G16B16A16_FLOAT)
+        {
+            uint16_t h;
+            memcpy(&h, p + c * 2, 2);
+            v[c] = AF1_AH1_AU1(h);
+            zero = zero && (h & 0x7fff) == 0;
+        }
+        else
+        {
+            v[c] = c < 3 ? p[c] / 255.0 * 2.0 - 1.0 : p[c] / 255.0;
+            zero = zero && p[c] == 0;
+        }
+    }
+    return !zero && v[0] * v[0] + v[1] * v[1] + v[2] * v[2] > 0.0;
+}
+
+// average of the normals, renormalized, and the roughness of the average alpha^2 plus the Toksvig variance
+static bool Reduce(const SPD_TestImage &parent, SPD_Format format, uint32_t x, uint32_t y, double *d)
+{
+    double n[3] = { 0.0, 0.0, 0.0 };
+    double variance = 0.0;
+    int count = 0;
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        double v[4];
+        if (!LoadNormal(parent, format, x * 2 + (i & 1), y * 2 + (i >> 1), v))
+            continue;
+        for (int c = 0; c < 3; c++)
+            n[c] += v[c];
+        variance += v[3] * v[3];
+        count++;
+    }
+    if (count == 0)
+        return false;
+    for (int c = 0; c < 3; c++)
+        n[c] /= count;
+    double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    for (int c = 0; c < 3; c++)
+        d[c] = n[c] / length;
+    d[3] = sqrt(std::min(variance / count + (1.0 - length) / length, 1.0));
+    return true;
+}
+
+// mean roughness of every mip
+static std::vector<double> Test(SPD_Format format, const char *pName, uint32_t width, uint32_t height, float spread, int zeroPercent)
+{
+    int mips = SpdTestMipCount(width, height);
+    SPD_TestImage src;
+    src.Allocate(width, height, format);
+    SPD_TestRandom random(width + height * 3 + uint32_t(spread * 100.0f));
+    for (size_t i = 0; i < size_t(width) * height; i++)
+    {
+        // tilted by up to spread radians, zero texels are skipped
+        float theta = spread * random.NextFloat();
+        float phi = 6.2831853f * random.NextFloat();
+        float v[4] = { sinf(theta) * cosf(phi), sinf(theta) * sinf(phi), cosf(theta), 0.1f + 0.2f * random.NextFloat() };
+        if (int(random.Next() % 100) < zeroPercent)
+            v[0] = v[1] = v[2] = v[3] = 0.0f;
+        StoreNormal(src, format, i, v);
+    }
+    SPD_TestMips dst;
+    dst.Allocate(width, height, mips, format);
+
+    SPD_CPU spd;
+    spd.OnCreate(format, false, 3);
+    spd.SetReduction(SPD_Reduction::SPD_Normal);
+    spd.Dispatch(src.image, dst.images.data(), mips);
+    spd.OnDestroy();
+
+    bool fp32 = format == SPD_Format::SPD_R32G32B32A32_FLOAT;
+    double tolerance = fp32 ? 1e-5 : (format == SPD_Format::SPD_R16G16B16A16_FLOAT ? 2e-3 : 1.5 / 255.0);
+    std::vector<double> roughness;
+    for (int mip = 0; mip < mips; mip++)
+    {
+        const SPD_TestImage &parent = mip == 0 ? src : dst.mips[mip - 1];
+        const SPD_TestImage &a = dst.mips[mip];
+        int wrong = 0;
+        int notUnit = 0;
+        double sum = 0.0;
+        uint32_t count = 0;
+        for (uint32_t y = 0; y < a.image.Height; y++)
+        {
+            for (uint32_t x = 0; x < a.image.Width; x++)
+            {
+                double v[4], expected[4];
+                bool nonzero = LoadNormal(a, format, x, y, v);
+                bool covered = Reduce(parent, format, x, y, expected);
+                if (nonzero)
+                {
+                    notUnit += fabs(sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]) - 1.0) > 2.0 * tolerance;
+                    sum += v[3];
+                    count++;
+                }
+                if (mip > 0 && !fp32)
+                    continue;
+                if (nonzero != covered)
+                {
+                    wrong++;
+                    continue;
+                }
+                for (int c = 0; covered && c < 4; c++)
+                {
+                    if (fabs(v[c] - expected[c]) > tolerance)
+                    {
+                        wrong++;
+                        break;
+                    }
+                }
+            }
+        }
+        SPD_TEST_CHECK(wrong == 0 && notUnit == 0, "%s %ux%u spread %.1f zero %d%% mip %d: %d texels are not the reduction of the parent, %d normals are not unit",
+            pName, width, height, spread, zeroPercent, mip, wrong, notUnit);
+        roughness.push_back(count ? sum / count : 0.0);
+    }
+    return roughness;
+}
+
+int main()
+{
+    static const SPD_TestFormat formats[] =
+    {
+        { SPD_Format::SPD_R32G32B32A32_FLOAT, "R32G32B32A32_FLOAT" },
+        { SPD_Format::SPD_R16G16B16A16_FLOAT, "R16G16B16A16_FLOAT" },
+        { SPD_Format::SPD_R8G8B8A8_UNORM, "R8G8B8A8_UNORM" },
+    };
+    static const float spreads[] = { 0.0f, 0.3f, 0.6f };
+    static const uint32_t sizes[][2] = { { 256, 256 }, { 129, 65 }, { 1000, 600 } };
+
+    for (const SPD_TestFormat &format : formats)
+    {
+        for (const uint32_t *size : sizes)
+        {
+            for (int zeroPercent : { 0, 20 })
+            {
+                std::vector<double> previous;
+                for (float spread : spreads)
+                {
+                    std::vector<double> roughness = Test(format.format, format.pName, size[0], size[1], spread, zeroPercent);
+                    for (size_t mip = 0; mip < roughness.size(); mip++)
+                    {
+                        // the roughness does not shrink from one mip to the next, a wider spread gives a rougher mip
+                        SPD_TEST_CHECK(mip == 0 || roughness[mip] >= roughness[mip - 1] - 1.0 / 255.0,
+                            "%s %ux%u spread %.1f zero %d%%: mip %zu has the roughness %f after %f",
+                            format.pName, size[0], size[1], spread, zeroPercent, mip, roughness[mip], roughness[mip - 1]);
+                        SPD_TEST_CHECK(previous.empty() || roughness[mip] > previous[mip],
+                            "%s %ux%u zero %d%%: the roughness %f of mip %zu with the spread %.1f is not above %f",
+                            format.pName, size[0], size[1], zeroPercent, roughness[mip], mip, spread, previous[mip]);
+                    }
+                    previous = roughness;
+                }
+            }
+        }
+    }
+    return SpdTestResult();
+}
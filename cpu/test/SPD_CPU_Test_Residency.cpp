@@ -0,0 +1,283 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// SetResidency with a random bitmap of tiles that are not resident, which hold 0xff (NaN of the float formats) in the source:
+// mips 0..5 of the resident tiles are the ones of a plain Dispatch, the ones of the other tiles keep their 0xcd. Mips 6 and up
+// against a direct reduction of the texels of mip 5 the tail sees, the stored ones of the resident tiles and the fill of the
+// others, also of the partial tiles without a texel in mip 5. Mips 12 and up of extended sizes from the stored mip 11. An all
+// resident bitmap gives the mips of a plain Dispatch. The kernels, the hooks and the packed hooks, and texture arrays.
+
+#include "stdafx.h"
+#include "SPD_CPU_Test.h"
+
+#include <algorithm>
+
+using namespace FFX_CPU;
+
+// the fill as the format stores it
+static void StoreFill(SPD_TestImage &image, SPD_Format format, uint32_t x, uint32_t y, const float *pFill)
+{
+    size_t texel = SPD_CPU::GetBytesPerTexel(format);
+    uint8_t *p = image.data.data() + y * image.image.RowPitch + x * texel;
+    for (int c = 0; c < 4; c++)
+    {
+        if (format == SPD_Format::SPD_R32G32B32A32_FLOAT)
+            memcpy(p + c * 4, &pFill[c], 4);
+        else if (format == SPD_Format::SPD_R16G16B16A16_FLOAT)
+        {
+            uint16_t h = uint16_t(AU1_AH1_AF1(pFill[c]));
+            memcpy(p + c * 2, &h, 2);
+        }
+        else
+            p[c] = uint8_t(pFill[c] * 255.0f + 0.5f);
+    }
+}
+
+static float Load(const SPD_TestImage &image, SPD_Format format, uint32_t x, uint32_t y, int c)
+{
+    const uint8_t *p = image.data.data() + y * image.image.RowPitch + x * SPD_CPU::GetBytesPerTexel(format);
+    if (format == SPD_Format::SPD_R32G32B32A32_FLOAT)
+    {
+        float v;
+        memcpy(&v, p + c * 4, 4);
+        return v;
+    }
+    if (format == SPD_Format::SPD_R16G16B16A16_FLOAT)
+    {
+        uint16_t h;
+        memcpy(&h, p + c * 2, 2);
+        return AF1_AH1_AU1(h);
+    }
+    return float(p[c]) / 255.0f;
+}
+
+static bool Resident(const std::vector<uint32_t> &bitmap, uint32_t pitch, uint32_t x, uint32_t y)
+{
+    return ((bitmap[y * pitch + x / 32] >> (x % 32)) & 1) != 0;
+}
+
+// the texels of mip (0..5) that tile (tileX, tileY) covers, equal to the ones of b or all 0xcd
+static bool TileEquals(const SPD_TestImage &a, const SPD_TestImage *b, int mip, uint32_t tileX, uint32_t tileY)
+{
+    uint32_t size = 32 >> mip;
+    size_t texel = a.image.RowPitch / a.image.Width;
+    uint32_t x0 = std::min(tileX * size, a.image.Width);
+    uint32_t x1 = std::min(x0 + size, a.image.Width);
+    for (uint32_t y = tileY * size; y < std::min((tileY + 1) * size, a.image.Height); y++)
+    {
+        const uint8_t *p = a.data.data() + y * a.image.RowPitch;
+        for (size_t i = x0 * texel; i < x1 * texel; i++)
+        {
+            if (p[i] != (b ? b->data[y * b->image.RowPitch + i] : 0xcd))
+                return false;
+        }
+    }
+    return true;
+}
+
+// width x height texels of 4 floats, a multiple of 64 in both
+struct Level
+{
+    uint32_t width, height;
+    std::vector<float> v;
+
+    Level(uint32_t w, uint32_t h) : width(w), height(h), v(size_t(w) * h * 4, 0.0f) {}
+    float *At(uint32_t x, uint32_t y) { return &v[(size_t(y) * width + x) * 4]; }
+};
+
+static Level Reduce(Level &parent, SPD_Reduction reduction)
+{
+    Level level(parent.width / 2, parent.height / 2);
+    for (uint32_t y = 0; y < level.height; y++)
+    {
+        for (uint32_t x = 0; x < level.width; x++)
+        {
+            const float *v[4] = { parent.At(x * 2, y * 2), parent.At(x * 2 + 1, y * 2), parent.At(x * 2, y * 2 + 1), parent.At(x * 2 + 1, y * 2 + 1) };
+            for (int c = 0; c < 4; c++)
+            {
+                float r = (v[0][c] + v[1][c] + v[2][c] + v[3][c]) * 0.25f;
+                if (reduction == SPD_Reduction::SPD_Min)
+                    r = std::min(std::min(v[0][c], v[1][c]), std::min(v[2][c], v[3][c]));
+                else if (reduction == SPD_Reduction::SPD_Max)
+                    r = std::max(std::max(v[0][c], v[1][c]), std::max(v[2][c], v[3][c]));
+                level.At(x, y)[c] = r;
+            }
+        }
+    }
+    return level;
+}
+
+// a stored mip against the level, NaN counts as off
+static int CountOff(const SPD_TestImage &mip, SPD_Format format, Level &level, double tolerance)
+{
+    int off = 0;
+    for (uint32_t y = 0; y < mip.image.Height; y++)
+        for (uint32_t x = 0; x < mip.image.Width; x++)
+            for (int c = 0; c < 4; c++)
+                off += !(fabs(double(Load(mip, format, x, y, c)) - level.At(x, y)[c]) <= tolerance);
+    return off;
+}
+
+static void Test(SPD_Format format, const char *pName, bool packed, SPD_Reduction reduction, uint32_t width, uint32_t height, uint32_t sliceCount, int residentPercent)
+{
+    static const float fill[4] = { 0.2f, 0.4f, 0.6f, 1.0f };
+    int mips = SpdTestMipCount(width, height);
+    uint32_t tilesX = (width + 63) / 64;
+    uint32_t tilesY = (height + 63) / 64;
+    uint32_t pitch = (tilesX + 31) / 32;
+    std::vector<uint32_t> bitmap(pitch * tilesY * sliceCount, 0);
+    SPD_TestRandom random(width * 7 + height + sliceCount + residentPercent);
+    for (uint32_t s = 0; s < sliceCount; s++)
+        for (uint32_t y = 0; y < tilesY; y++)
+            for (uint32_t x = 0; x < tilesX; x++)
+                if (int(random.Next() % 100) < residentPercent)
+                    bitmap[(s * tilesY + y) * pitch + x / 32] |= 1u << (x % 32);
+
+    // sparse is src with 0xff in the tiles that are not resident
+    size_t texel = SPD_CPU::GetBytesPerTexel(format);
+    std::vector<SPD_TestImage> src(sliceCount), sparse(sliceCount);
+    std::vector<SPD_Image> srcImages, sparseImages;
+    std::vector<SPD_TestMips> resident(sliceCount), plain(sliceCount);
+    std::vector<SPD_Image> residentDst, plainDst;
+    for (uint32_t s = 0; s < sliceCount; s++)
+    {
+        src[s].Allocate(width, height, format);
+        src[s].Randomize(format, width + height * 3 + s);
+        sparse[s] = src[s];
+        sparse[s].image.pData = sparse[s].data.data();
+        for (uint32_t y = 0; y < height; y++)
+            for (uint32_t x = 0; x < width; x++)
+                if (!Resident(bitmap, pitch, x / 64, s * tilesY + y / 64))
+                    memset(&sparse[s].data[(size_t(y) * width + x) * texel], 0xff, texel);
+        srcImages.push_back(src[s].image);
+        sparseImages.push_back(sparse[s].image);
+        resident[s].Allocate(width, height, mips, format);
+        plain[s].Allocate(width, height, mips, format);
+        residentDst.insert(residentDst.end(), resident[s].images.begin(), resident[s].images.end());
+        plainDst.insert(plainDst.end(), plain[s].images.begin(), plain[s].images.end());
+    }
+
+    SPD_CPU spd;
+    spd.OnCreate(format, packed, 3);
+    spd.SetReduction(reduction);
+    spd.Dispatch(srcImages.data(), sliceCount, plainDst.data(), mips);
+    spd.SetResidency(bitmap.data(), fill);
+    spd.Dispatch(sparseImages.data(), sliceCount, residentDst.data(), mips);
+    spd.OnDestroy();
+
+    // the fill as the format stores it, the packed formats see it in fp16
+    SPD_TestImage fillTexel;
+    fillTexel.Allocate(1, 1, format);
+    StoreFill(fillTexel, format, 0, 0, fill);
+    float stored[4];
+    for (int c = 0; c < 4; c++)
+        stored[c] = Load(fillTexel, format, 0, 0, c);
+    double tolerance = packed ? 4e-3 : (format == SPD_Format::SPD_R8G8B8A8_UNORM ? 1.0 / 255.0 + 1e-5 : 1e-5);
+
+    for (uint32_t s = 0; s < sliceCount; s++)
+    {
+        const SPD_TestMips &a = resident[s];
+        const SPD_TestMips &b = plain[s];
+        if (residentPercent == 100)
+        {
+            int mip = a.FirstDifference(b);
+            SPD_TEST_CHECK(mip < 0, "%s packed %d reduction %d %ux%u slice %u: an all resident bitmap differs from Dispatch at mip %d",
+                pName, int(packed), int(reduction), width, height, s, mip);
+            continue;
+        }
+        int wrong = 0;
+        int written = 0;
+        for (int mip = 0; mip < std::min(mips, 6); mip++)
+        {
+            for (uint32_t y = 0; y < tilesY; y++)
+            {
+                for (uint32_t x = 0; x < tilesX; x++)
+                {
+                    if (Resident(bitmap, pitch, x, s * tilesY + y))
+                        wrong += !TileEquals(a.mips[mip], &b.mips[mip], mip, x, y);
+                    else
+                        written += !TileEquals(a.mips[mip], NULL, mip, x, y);
+                }
+            }
+        }
+        SPD_TEST_CHECK(wrong == 0 && written == 0,
+            "%s packed %d reduction %d %ux%u slice %u resident %d%%: %d resident tiles differ, %d tiles not resident were written in mips 0..5",
+            pName, int(packed), int(reduction), width, height, s, residentPercent, wrong, written);
+        if (mips <= 6)
+            continue;
+
+        // the texels of mip 5 the tail reads, up to 64x64 of every block of 64x64 tiles, zero outside of mip 5 and the tiles
+        const SPD_TestImage &mip5 = a.mips[5];
+        Level level((tilesX + 63) / 64 * 64, (tilesY + 63) / 64 * 64);
+        for (uint32_t y = 0; y < tilesY; y++)
+        {
+            for (uint32_t x = 0; x < tilesX; x++)
+            {
+                bool tile = Resident(bitmap, pitch, x, s * tilesY + y);
+                for (int c = 0; tile && x < mip5.image.Width && y < mip5.image.Height && c < 4; c++)
+                    level.At(x, y)[c] = Load(mip5, format, x, y, c);
+                for (int c = 0; !tile && c < 4; c++)
+                    level.At(x, y)[c] = stored[c];
+            }
+        }
+        int off = 0;
+        int firstOff = -1;
+        for (int mip = 6; mip < mips; mip++)
+        {
+            if (mip == 12)
+            {
+                // the last block reads the stored mip 11
+                const SPD_TestImage &mip11 = a.mips[11];
+                level = Level(64, 64);
+                for (uint32_t y = 0; y < mip11.image.Height; y++)
+                    for (uint32_t x = 0; x < mip11.image.Width; x++)
+                        for (int c = 0; c < 4; c++)
+                            level.At(x, y)[c] = Load(mip11, format, x, y, c);
+            }
+            level = Reduce(level, reduction);
+            int count = CountOff(a.mips[mip], format, level, tolerance);
+            if (count && firstOff < 0)
+                firstOff = mip;
+            off += count;
+        }
+        SPD_TEST_CHECK(off == 0, "%s packed %d reduction %d %ux%u slice %u resident %d%%: %d channels of mips 6 and up are off, first at mip %d",
+            pName, int(packed), int(reduction), width, height, s, residentPercent, off, firstOff);
+    }
+}
+
+int main()
+{
+    static const struct { SPD_Format format; const char *pName; bool packed; SPD_Reduction reduction; } cases[] =
+    {
+        // the kernels, the hooks of UNORM max, the packed hooks
+        { SPD_Format::SPD_R32G32B32A32_FLOAT, "R32G32B32A32_FLOAT", false, SPD_Reduction::SPD_Average },
+        { SPD_Format::SPD_R8G8B8A8_UNORM, "R8G8B8A8_UNORM", false, SPD_Reduction::SPD_Average },
+        { SPD_Format::SPD_R8G8B8A8_UNORM, "R8G8B8A8_UNORM", false, SPD_Reduction::SPD_Max },
+        { SPD_Format::SPD_R32G32B32A32_FLOAT, "R32G32B32A32_FLOAT", true, SPD_Reduction::SPD_Average },
+        { SPD_Format::SPD_R16G16B16A16_FLOAT, "R16G16B16A16_FLOAT", true, SPD_Reduction::SPD_Min },
+    };
+    // partial tiles on the right and bottom edge, more than 64 tiles in x (extended), a texture array
+    static const uint32_t sizes[][3] = { { 256, 256, 1 }, { 1000, 600, 1 }, { 301, 1030, 2 }, { 4160, 200, 1 }, { 2048, 2048, 1 } };
+
+    for (const auto &test : cases)
+        for (const uint32_t *size : sizes)
+            for (int residentPercent : { 0, 30, 70, 100 })
+                Test(test.format, test.pName, test.packed, test.reduction, size[0], size[1], size[2], residentPercent);
+    return SpdTestResult();
+}
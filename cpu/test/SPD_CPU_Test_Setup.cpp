@@ -0,0 +1,232 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// SpdSetup of ffx_spd.h and the workGroupOffset overloads of SpdDownsample / SpdDownsampleH: the dispatch covers the tiles
+// that intersect the rectangle, an empty rectangle dispatches nothing. Over a target with the mips of another source, the
+// tiles of the rectangle get mips 0..5 of a whole dispatch of the new source, the others keep theirs, mips 6 and up are
+// the ones of the mixed mip 5.
+
+#include "stdafx.h"
+#include "ffx_spd.h"
+#include "SPD_CPU_Test.h"
+
+using namespace FFX_CPU;
+
+// RGBA32F hooks of ffx_spd_cpu.h, one work group after the other on this thread, the packed version in fp16
+struct RectHooks
+{
+    const SPD_TestImage *pSrc;
+    SPD_TestMips *pDst;
+    AU1 counter;
+
+    float *Address(const SPD_Image &image, ASU1 x, ASU1 y) const
+    {
+        if (x < 0 || y < 0 || AU1(x) >= image.Width || AU1(y) >= image.Height) return NULL;
+        return (float *)((uint8_t *)image.pData + y * image.RowPitch) + x * 4;
+    }
+    void Load(outAF4 d, const SPD_Image &image, ASU1 x, ASU1 y) const
+    {
+        const float *p = Address(image, x, y);
+        for (int c = 0; c < 4; c++) d[c] = p ? p[c] : 0.0f;
+    }
+    void LoadH(outAH4 d, const SPD_Image &image, ASU1 x, ASU1 y) const
+    {
+        varAF4(f);
+        Load(f, image, x, y);
+        for (int c = 0; c < 4; c++) d[c] = AW1(AU1_AH1_AF1(f[c]));
+    }
+
+    void SpdLoadSourceImage(outAF4 d, ASU1 x, ASU1 y, AU1 slice){Load(d, pSrc->image, x, y);}
+    void SpdLoad(outAF4 d, ASU1 x, ASU1 y, AU1 slice){Load(d, pDst->images[5], x, y);}
+    void SpdStore(ASU1 x, ASU1 y, inAF4 value, AU1 mip, AU1 slice)
+    {
+        float *p = Address(pDst->images[mip], x, y);
+        if (p) memcpy(p, value, 4 * sizeof(float));
+    }
+    void SpdReduce4(outAF4 d, inAF4 v0, inAF4 v1, inAF4 v2, inAF4 v3){
+        for (int i = 0; i < 4; i++) d[i] = (v0[i] + v1[i] + v2[i] + v3[i]) * 0.25f;}
+    void SpdLoadSourceImageH(outAH4 d, ASU1 x, ASU1 y, AU1 slice){LoadH(d, pSrc->image, x, y);}
+    void SpdLoadH(outAH4 d, ASU1 x, ASU1 y, AU1 slice){LoadH(d, pDst->images[5], x, y);}
+    void SpdStoreH(ASU1 x, ASU1 y, inAH4 value, AU1 mip, AU1 slice)
+    {
+        varAF4(f);
+        for (int c = 0; c < 4; c++) f[c] = AF1_AH1_AU1(value[c]);
+        SpdStore(x, y, f, mip, slice);
+    }
+    void SpdReduce4H(outAH4 d, inAH4 v0, inAH4 v1, inAH4 v2, inAH4 v3){
+        for (int i = 0; i < 4; i++) d[i] = AW1(AU1_AH1_AF1((AF1_AH1_AU1(v0[i]) + AF1_AH1_AU1(v1[i]) + AF1_AH1_AU1(v2[i]) + AF1_AH1_AU1(v3[i])) * 0.25f));}
+    AU1 SpdIncreaseAtomicCounter(AU1 slice){return counter++;}
+    void SpdResetAtomicCounter(AU1 slice){counter = 0;}
+};
+
+// all work groups of a dispatch, with the workGroupOffset overloads if offset is not NULL
+static void Run(const SPD_TestImage &src, SPD_TestMips &dst, bool packed, AU1 dispatchX, AU1 dispatchY, AU1 *offset, AU1 mips, AU1 numWorkGroups)
+{
+    RectHooks hooks = { &src, &dst, 0 };
+    SpdIntermediate lds;
+    SpdIntermediateH ldsH;
+    for (AU1 y = 0; y < dispatchY; y++)
+    {
+        for (AU1 x = 0; x < dispatchX; x++)
+        {
+            varAU2(workGroupID) = initAU2(x, y);
+            if (offset && packed)
+                SpdDownsampleH(hooks, ldsH, workGroupID, mips, numWorkGroups, 0, offset);
+            else if (offset)
+                SpdDownsample(hooks, lds, workGroupID, mips, numWorkGroups, 0, offset);
+            else if (packed)
+                SpdDownsampleH(hooks, ldsH, workGroupID, mips, numWorkGroups, 0);
+            else
+                SpdDownsample(hooks, lds, workGroupID, mips, numWorkGroups, 0);
+        }
+    }
+    SPD_TEST_CHECK(hooks.counter == 0, "%ux%u packed %d: the counter is not zero afterwards", src.image.Width, src.image.Height, int(packed));
+}
+
+static const float *Texel(const SPD_TestImage &image, uint32_t x, uint32_t y)
+{
+    return (const float *)(image.data.data() + y * image.image.RowPitch) + x * 4;
+}
+
+static void CheckRect(uint32_t width, uint32_t height, bool packed, const AU1 *rect)
+{
+    SPD_Format format = SPD_Format::SPD_R32G32B32A32_FLOAT;
+    AU1 mips = AU1(SpdTestMipCount(width, height));
+    AU1 tilesX = (width + 63) / 64;
+    AU1 tilesY = (height + 63) / 64;
+    SPD_TestImage before, after;
+    before.Allocate(width, height, format);
+    before.Randomize(format, width + height);
+    after.Allocate(width, height, format);
+    after.Randomize(format, width * 7 + height);
+
+    varAU2(dispatch) = initAU2(0, 0);
+    varAU2(offset) = initAU2(0, 0);
+    varAU2(numWorkGroupsAndMips) = initAU2(0, 0);
+    varAU4(rectInfo) = initAU4(rect[0], rect[1], rect[2], rect[3]);
+    SpdSetup(dispatch, offset, numWorkGroupsAndMips, rectInfo, ASU1(mips));
+    AU1 firstX = rect[0] / 64;
+    AU1 firstY = rect[1] / 64;
+    AU1 countX = (rect[0] + rect[2] + 63) / 64 - firstX;
+    AU1 countY = (rect[1] + rect[3] + 63) / 64 - firstY;
+    SPD_TEST_CHECK(offset[0] == firstX && offset[1] == firstY && dispatch[0] == countX && dispatch[1] == countY &&
+        numWorkGroupsAndMips[0] == countX * countY && numWorkGroupsAndMips[1] == mips,
+        "%ux%u rect %u, %u, %u x %u: SpdSetup gives %u x %u work groups at %u, %u, %u work groups and %u mips",
+        width, height, rect[0], rect[1], rect[2], rect[3], dispatch[0], dispatch[1], offset[0], offset[1],
+        numWorkGroupsAndMips[0], numWorkGroupsAndMips[1]);
+
+    // the mips of the whole source before and after, then the rectangle of after over the mips of before
+    SPD_TestMips plain, full, mixed;
+    plain.Allocate(width, height, int(mips), format);
+    full.Allocate(width, height, int(mips), format);
+    mixed.Allocate(width, height, int(mips), format);
+    Run(before, plain, packed, tilesX, tilesY, NULL, mips, tilesX * tilesY);
+    Run(after, full, packed, tilesX, tilesY, NULL, mips, tilesX * tilesY);
+    Run(before, mixed, packed, tilesX, tilesY, NULL, mips, tilesX * tilesY);
+    Run(after, mixed, packed, dispatch[0], dispatch[1], offset, numWorkGroupsAndMips[1], numWorkGroupsAndMips[0]);
+
+    for (AU1 mip = 0; mip < mips; mip++)
+    {
+        const SPD_TestImage &a = mixed.mips[mip];
+        int wrong = 0;
+        for (uint32_t y = 0; y < a.image.Height; y++)
+        {
+            for (uint32_t x = 0; x < a.image.Width; x++)
+            {
+                if (mip < 6)
+                {
+                    // the mips of the tiles of the rectangle are the ones of after, the others of before
+                    AU1 tileX = x / (32 >> mip);
+                    AU1 tileY = y / (32 >> mip);
+                    bool inside = tileX >= offset[0] && tileX < offset[0] + dispatch[0] && tileY >= offset[1] && tileY < offset[1] + dispatch[1];
+                    wrong += memcmp(Texel(a, x, y), Texel((inside ? full : plain).mips[mip], x, y), 16) != 0;
+                    continue;
+                }
+                // the average of the parent, texels outside of it are zero
+                const SPD_TestImage &parent = mixed.mips[mip - 1];
+                for (int c = 0; c < 4; c++)
+                {
+                    float sum = 0.0f;
+                    for (uint32_t i = 0; i < 4; i++)
+                    {
+                        uint32_t px = x * 2 + (i & 1);
+                        uint32_t py = y * 2 + (i >> 1);
+                        if (px < parent.image.Width && py < parent.image.Height)
+                            sum += Texel(parent, px, py)[c];
+                    }
+                    if (fabsf(Texel(a, x, y)[c] - sum * 0.25f) > (packed ? 1e-3f : 1e-6f))
+                    {
+                        wrong++;
+                        break;
+                    }
+                }
+            }
+        }
+        SPD_TEST_CHECK(wrong == 0, "%ux%u packed %d rect %u, %u, %u x %u mip %u: %d texels differ",
+            width, height, int(packed), rect[0], rect[1], rect[2], rect[3], mip, wrong);
+    }
+}
+
+static void CheckSetup(const AU1 *rect, ASU1 mips, AU1 dispatchX, AU1 dispatchY, AU1 offsetX, AU1 offsetY, AU1 expectedMips)
+{
+    varAU2(dispatch) = initAU2(~0u, ~0u);
+    varAU2(offset) = initAU2(~0u, ~0u);
+    varAU2(numWorkGroupsAndMips) = initAU2(~0u, ~0u);
+    varAU4(rectInfo) = initAU4(rect[0], rect[1], rect[2], rect[3]);
+    SpdSetup(dispatch, offset, numWorkGroupsAndMips, rectInfo, mips);
+    SPD_TEST_CHECK(dispatch[0] == dispatchX && dispatch[1] == dispatchY && offset[0] == offsetX && offset[1] == offsetY &&
+        numWorkGroupsAndMips[0] == dispatchX * dispatchY && numWorkGroupsAndMips[1] == expectedMips,
+        "rect %u, %u, %u x %u mips %d: SpdSetup gives %u x %u work groups at %u, %u, %u work groups and %u mips",
+        rect[0], rect[1], rect[2], rect[3], int(mips), dispatch[0], dispatch[1], offset[0], offset[1],
+        numWorkGroupsAndMips[0], numWorkGroupsAndMips[1]);
+}
+
+int main()
+{
+    // left, top, width, height, mips, the expected dispatch, offset and mips
+    static const AU1 setups[][10] =
+    {
+        { 0, 0, 1920, 1080, AU1(-1), 30, 17, 0, 0, 10 },
+        { 0, 0, 4096, 4096, AU1(-1), 64, 64, 0, 0, 12 },
+        { 0, 0, 1, 1, AU1(-1), 1, 1, 0, 0, 0 },
+        { 63, 64, 2, 1, 5, 2, 1, 0, 1, 5 },
+        { 100, 70, 0, 200, AU1(-1), 0, 0, 1, 1, 0 },
+        { 100, 70, 300, 0, 6, 0, 0, 1, 1, 0 },
+        { 0, 0, 0, 0, AU1(-1), 0, 0, 0, 0, 0 },
+    };
+    for (const AU1 *setup : setups)
+        CheckSetup(setup, ASU1(setup[4]), setup[5], setup[6], setup[7], setup[8], setup[9]);
+
+    static const uint32_t sizes[][2] = { { 1000, 600 }, { 256, 256 } };
+    for (const uint32_t *size : sizes)
+    {
+        const AU1 rects[][4] =
+        {
+            { 0, 0, size[0], size[1] },
+            { 100, 70, 100, 120 },
+            { 63, 0, 2, size[1] },
+            { size[0] - 40, size[1] - 24, 40, 24 },
+            { 0, 0, 1, 1 },
+        };
+        for (int packed = 0; packed < 2; packed++)
+            for (const AU1 *rect : rects)
+                CheckRect(size[0], size[1], packed != 0, rect);
+    }
+    return SpdTestResult();
+}
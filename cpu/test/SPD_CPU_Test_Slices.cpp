@@ -0,0 +1,66 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Slice k of a texture array gives the same mips as a Dispatch of slice k alone.
+
+#include "SPD_CPU_Test.h"
+
+using namespace FFX_CPU;
+
+int main()
+{
+    static const uint32_t sizes[][2] = { { 256, 256 }, { 100, 37 }, { 1000, 600 }, { 64, 1 } };
+    static const uint32_t sliceCount = 6;
+
+    for (const SPD_TestFormat &format : s_testFormats)
+    {
+        for (const uint32_t *size : sizes)
+        {
+            int mips = SpdTestMipCount(size[0], size[1]);
+            SPD_TestImage src[sliceCount];
+            SPD_Image srcImages[sliceCount];
+            SPD_TestMips slices[sliceCount];
+            std::vector<SPD_Image> dst;
+            for (uint32_t s = 0; s < sliceCount; s++)
+            {
+                src[s].Allocate(size[0], size[1], format.format);
+                src[s].Randomize(format.format, size[0] + size[1] * 3 + s);
+                srcImages[s] = src[s].image;
+                slices[s].Allocate(size[0], size[1], mips, format.format);
+                dst.insert(dst.end(), slices[s].images.begin(), slices[s].images.end());
+            }
+
+            SPD_CPU spd;
+            spd.OnCreate(format.format, false, 3);
+            spd.Dispatch(srcImages, sliceCount, dst.data(), mips);
+
+            for (uint32_t s = 0; s < sliceCount; s++)
+            {
+                SPD_TestMips alone;
+                alone.Allocate(size[0], size[1], mips, format.format);
+                spd.Dispatch(src[s].image, alone.images.data(), mips);
+                int mip = slices[s].FirstDifference(alone);
+                SPD_TEST_CHECK(mip < 0, "%s %ux%u: slice %u of %u differs from a Dispatch of the slice at mip %d",
+                    format.pName, size[0], size[1], s, sliceCount, mip);
+            }
+            spd.OnDestroy();
+        }
+    }
+    return SpdTestResult();
+}
@@ -0,0 +1,85 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// The split tail gives the same bytes as the single last tile, for every format and reduction, packed or not.
+// The sizes have partial quads of 4x4 tiles in x and in y, and mips that are not squares.
+
+#include "SPD_CPU_Test.h"
+
+using namespace FFX_CPU;
+
+static void Run(SPD_Format format, bool packed, SPD_Reduction reduction, bool splitTail, const SPD_Image *pSrc, uint32_t sliceCount, std::vector<SPD_Image> &dst, int mips)
+{
+    SPD_CPU spd;
+    spd.OnCreate(format, packed, 3);
+    spd.SetReduction(reduction);
+    spd.SetSplitTail(splitTail);
+    spd.Dispatch(pSrc, sliceCount, dst.data(), mips);
+    spd.OnDestroy();
+}
+
+int main()
+{
+    // width, height, slices
+    static const uint32_t sizes[][3] = { { 1024, 1000, 2 }, { 1000, 600, 1 }, { 127, 4096, 1 }, { 4096, 4096, 1 }, { 1920, 1080, 1 }, { 255, 2049, 1 }, { 100, 37, 1 } };
+    static const SPD_Reduction reductions[] = { SPD_Reduction::SPD_Average, SPD_Reduction::SPD_MinMax };
+
+    for (const SPD_TestFormat &format : s_testFormats)
+    {
+        for (const uint32_t *size : sizes)
+        {
+            uint32_t sliceCount = size[2];
+            int mips = SpdTestMipCount(size[0], size[1]);
+            std::vector<SPD_TestImage> src(sliceCount);
+            std::vector<SPD_Image> srcImages(sliceCount);
+            for (uint32_t s = 0; s < sliceCount; s++)
+            {
+                src[s].Allocate(size[0], size[1], format.format);
+                src[s].Randomize(format.format, size[0] * 5 + size[1] + s);
+                srcImages[s] = src[s].image;
+            }
+
+            for (int packed = 0; packed < 2; packed++)
+            {
+                for (SPD_Reduction reduction : reductions)
+                {
+                    std::vector<SPD_TestMips> single(sliceCount), split(sliceCount);
+                    std::vector<SPD_Image> singleImages, splitImages;
+                    for (uint32_t s = 0; s < sliceCount; s++)
+                    {
+                        single[s].Allocate(size[0], size[1], mips, format.format);
+                        split[s].Allocate(size[0], size[1], mips, format.format);
+                        singleImages.insert(singleImages.end(), single[s].images.begin(), single[s].images.end());
+                        splitImages.insert(splitImages.end(), split[s].images.begin(), split[s].images.end());
+                    }
+                    Run(format.format, packed != 0, reduction, false, srcImages.data(), sliceCount, singleImages, mips);
+                    Run(format.format, packed != 0, reduction, true, srcImages.data(), sliceCount, splitImages, mips);
+
+                    for (uint32_t s = 0; s < sliceCount; s++)
+                    {
+                        int mip = split[s].FirstDifference(single[s]);
+                        SPD_TEST_CHECK(mip < 0, "%s %ux%u slice %u packed %d reduction %d: the split tail differs from the single last tile at mip %d",
+                            format.pName, size[0], size[1], s, packed, int(reduction), mip);
+                    }
+                }
+            }
+        }
+    }
+    return SpdTestResult();
+}
@@ -0,0 +1,74 @@
+// SPD CPU
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// The lanes of a wave of every wave size give the same bytes as the LDS path, for every format and reduction, packed or not.
+
+#include "SPD_CPU_Test.h"
+
+using namespace FFX_CPU;
+
+static const uint32_t s_waveSizes[] = { 16, 32, 64, 128 };
+
+static void Run(SPD_Format format, bool packed, uint32_t waveSize, SPD_Reduction reduction, const SPD_TestImage &src, SPD_TestMips &dst)
+{
+    SPD_CPU spd;
+    spd.OnCreate(format, packed, 2);
+    spd.SetReduction(reduction);
+    spd.SetWaveSize(waveSize);
+    spd.Dispatch(src.image, dst.images.data(), dst.Count());
+    spd.OnDestroy();
+}
+
+int main()
+{
+    static const uint32_t sizes[][2] = { { 1, 1 }, { 3, 5 }, { 64, 64 }, { 65, 63 }, { 300, 200 }, { 1920, 1080 }, { 97, 3001 } };
+    static const SPD_Reduction reductions[] = { SPD_Reduction::SPD_Average, SPD_Reduction::SPD_MinMax };
+
+    for (const SPD_TestFormat &format : s_testFormats)
+    {
+        for (const uint32_t *size : sizes)
+        {
+            int mips = SpdTestMipCount(size[0], size[1]);
+            SPD_TestImage src;
+            src.Allocate(size[0], size[1], format.format);
+            src.Randomize(format.format, size[0] * 3 + size[1]);
+
+            for (int packed = 0; packed < 2; packed++)
+            {
+                for (SPD_Reduction reduction : reductions)
+                {
+                    SPD_TestMips lds;
+                    lds.Allocate(size[0], size[1], mips, format.format);
+                    Run(format.format, packed != 0, 0, reduction, src, lds);
+
+                    for (uint32_t waveSize : s_waveSizes)
+                    {
+                        SPD_TestMips wave;
+                        wave.Allocate(size[0], size[1], mips, format.format);
+                        Run(format.format, packed != 0, waveSize, reduction, src, wave);
+                        int mip = wave.FirstDifference(lds);
+                        SPD_TEST_CHECK(mip < 0, "%s %ux%u packed %d reduction %d: wave size %u differs from the LDS path at mip %d",
+                            format.pName, size[0], size[1], packed, int(reduction), waveSize, mip);
+                    }
+                }
+            }
+        }
+    }
+    return SpdTestResult();
+}
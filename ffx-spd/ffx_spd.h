@@ -27,10 +27,11 @@
 // ===========================
 // // you need to provide as constants:
 // // number of mip levels to be computed (maximum is 12)
-// // number of total thread groups: ((widthInPixels+63)>>6) * ((heightInPixels+63)>>6)
+// // number of thread groups per slice: ((widthInPixels+63)>>6) * ((heightInPixels+63)>>6)
 // ...
-// // Dispatch the shader such that each thread group works on a 64x64 sub-tile of the source image
-// vkCmdDispatch(cmdBuf,(widthInPixels+63)>>6,(heightInPixels+63)>>6,1);
+// // Dispatch the shader such that each thread group works on a 64x64 sub-tile of the source image,
+// // the z dimension is the slice of a texture array / cube map (1 for a 2D texture)
+// vkCmdDispatch(cmdBuf,(widthInPixels+63)>>6,(heightInPixels+63)>>6,slices);
 
 //------------------------------------------------------------------------------------------------------------------------------
 // INTEGRATION SUMMARY FOR GPU
@@ -49,20 +50,20 @@
 // // conversion to linear (load function): x*x
 // // conversion from linear (store function): sqrt()
 
-// // source image
+// // source image (image2DArray / Texture2DArray for texture arrays and cube maps, indexed by the slice)
 // GLSL: layout(set=0,binding=0,rgba16f)uniform image2D imgSrc;
 // [SAMPLER]: layout(set=0,binding=0)uniform texture2D imgSrc;
 // HLSL: [[vk::binding(0)]] Texture2D<float4> imgSrc :register(u0);
 
-// // destination -> 12 is the maximum number of mips supported by DS
+// // destination -> 12 is the maximum number of mips supported by DS, 18 with SPD_EXTENDED (imgDst[18])
 // GLSL: layout(set=0,binding=1,rgba16f) uniform coherent image2D imgDst[12];
 // HLSL: [[vk::binding(1)]] globallycoherent RWTexture2D<float4> imgDst[12] :register(u1);
 
-// // global atomic counter - MUST be initialized to 0
+// // global atomic counter, one per slice - MUST be initialized to 0
 // // GLSL:
 // layout(std430, set=0, binding=2) coherent buffer globalAtomicBuffer
 // {
-//    uint counter;
+//    uint counter[];
 // } globalAtomic;
 // // HLSL:
 // struct globalAtomicBuffer
@@ -81,7 +82,7 @@
 // // GLSL:
 // layout(push_constant) uniform pushConstants {
 //    uint mips; // needed to opt out earlier if mips are < 12
-//    uint numWorkGroups; // number of total thread groups, so numWorkGroupsX * numWorkGroupsY * 1
+//    uint numWorkGroups; // number of thread groups per slice, so numWorkGroupsX * numWorkGroupsY
 // } spdConstants;
 // // HLSL:
 // [[vk::push_constant]]
@@ -135,17 +136,21 @@
 // // conversion to linear (load function): x*x
 // // conversion from linear (store function): sqrt()
 
+// // All hooks get the slice of the work group (workGroupID.z), a 2D texture only has slice 0.
+// // For texture arrays and cube maps load and store the slice, e.g. imageLoad(imgSrc, ASU3(p, slice)),
+// // and count the work groups of every slice separately, so the tails of the slices run independently.
+
 // // Load from source image
-// GLSL: AF4 SpdLoadSourceImage(ASU2 p){return imageLoad(imgSrc, p);}
-// HLSL: AF4 SpdLoadSourceImage(ASU2 tex){return imgSrc[tex];}
+// GLSL: AF4 SpdLoadSourceImage(ASU2 p, AU1 slice){return imageLoad(imgSrc, p);}
+// HLSL: AF4 SpdLoadSourceImage(ASU2 tex, AU1 slice){return imgSrc[tex];}
 // [SAMPLER] don't forget to add the define #SPD_LINEAR_SAMPLER :)
 // GLSL:
-// AF4 SpdLoadSourceImage(ASU2 p){
+// AF4 SpdLoadSourceImage(ASU2 p, AU1 slice){
 //    AF2 textureCoord = p * invInputSize + invInputSize;
 //    return texture(sampler2D(imgSrc, srcSampler), textureCoord);
 // }
 // HLSL:
-// AF4 SpdLoadSourceImage(ASU2 p){
+// AF4 SpdLoadSourceImage(ASU2 p, AU1 slice){
 //    AF2 textureCoord = p * invInputSize + invInputSize;
 //    return imgSrc.SampleLevel(srcSampler, textureCoord, 0);
 // }
@@ -153,20 +158,24 @@
 // // SpdLoad() takes a 32-bit signed integer 2D coordinate and loads color.
 // // Loads the 5th mip level, each value is computed by a different thread group
 // // last thread group will access all its elements and compute the subsequent mips
-// GLSL: AF4 SpdLoad(ASU2 p){return imageLoad(imgDst[5],p);}
-// HLSL: AF4 SpdLoad(ASU2 tex){return imgDst[5][tex];}
+// GLSL: AF4 SpdLoad(ASU2 p, AU1 slice){return imageLoad(imgDst[5],p);}
+// HLSL: AF4 SpdLoad(ASU2 tex, AU1 slice){return imgDst[5][tex];}
 
 // Define the store function
-// GLSL: void SpdStore(ASU2 p, AF4 value, AU1 mip){imageStore(imgDst[mip], p, value);}
-// HLSL: void SpdStore(ASU2 pix, AF4 value, AU1 index){imgDst[index][pix] = value;}
+// GLSL: void SpdStore(ASU2 p, AF4 value, AU1 mip, AU1 slice){imageStore(imgDst[mip], p, value);}
+// HLSL: void SpdStore(ASU2 pix, AF4 value, AU1 index, AU1 slice){imgDst[index][pix] = value;}
 
-// // Define the atomic counter increase function
+// // Define the atomic counter increase and reset functions
+// // The counter is zeroed once when it is created, the last work group resets it for the next dispatch,
+// // so consecutive dispatches need no clear of the counter
 // // GLSL:
-// void SpdIncreaseAtomicCounter(){spd_counter = atomicAdd(globalAtomic.counter, 1);}
+// void SpdIncreaseAtomicCounter(AU1 slice){spd_counter = atomicAdd(globalAtomic.counter[slice], 1);}
 // AU1 SpdGetAtomicCounter() {return spd_counter;}
+// void SpdResetAtomicCounter(AU1 slice){globalAtomic.counter[slice] = 0;}
 // // HLSL:
-// void SpdIncreaseAtomicCounter(){InterlockedAdd(globalAtomic[0].counter, 1, spd_counter);}
+// void SpdIncreaseAtomicCounter(AU1 slice){InterlockedAdd(globalAtomic[slice].counter, 1, spd_counter);}
 // AU1 SpdGetAtomicCounter(){return spd_counter;}
+// void SpdResetAtomicCounter(AU1 slice){globalAtomic[slice].counter = 0;}
 
 // // Define the LDS load and store functions
 // // GLSL:
@@ -179,19 +188,21 @@
 // // Define your reduction function: takes as input the four 2x2 values and returns 1 output value
 // Example below: computes the average value
 // AF4 SpdReduce4(AF4 v0, AF4 v1, AF4 v2, AF4 v3){return (v0+v1+v2+v3)*0.25;}
+// // Or pick a built-in reduction instead of defining SpdReduce4 and SpdReduce4H, see BUILT-IN REDUCTIONS:
+// #define SPD_REDUCTION SPD_REDUCTION_MIN
 
 // // PACKED VERSION
 // Load from source image
-// GLSL: AH4 SpdLoadSourceImageH(ASU2 p){return AH4(imageLoad(imgSrc, p));}
-// HLSL: AH4 SpdLoadSourceImageH(ASU2 tex){return AH4(imgSrc[tex]);}
+// GLSL: AH4 SpdLoadSourceImageH(ASU2 p, AU1 slice){return AH4(imageLoad(imgSrc, p));}
+// HLSL: AH4 SpdLoadSourceImageH(ASU2 tex, AU1 slice){return AH4(imgSrc[tex]);}
 // [SAMPLER]
 // GLSL:
-// AH4 SpdLoadSourceImageH(ASU2 p){
+// AH4 SpdLoadSourceImageH(ASU2 p, AU1 slice){
 //    AF2 textureCoord = p * invInputSize + invInputSize;
 //    return AH4(texture(sampler2D(imgSrc, srcSampler), textureCoord));
 // }
 // HLSL:
-// AH4 SpdLoadSourceImageH(ASU2 p){
+// AH4 SpdLoadSourceImageH(ASU2 p, AU1 slice){
 //    AF2 textureCoord = p * invInputSize + invInputSize;
 //    return AH4(imgSrc.SampleLevel(srcSampler, textureCoord, 0));
 // }
@@ -199,20 +210,24 @@
 // // SpdLoadH() takes a 32-bit signed integer 2D coordinate and loads color.
 // // Loads the 5th mip level, each value is computed by a different thread group
 // // last thread group will access all its elements and compute the subsequent mips
-// GLSL: AH4 SpdLoadH(ASU2 p){return AH4(imageLoad(imgDst[5],p));}
-// HLSL: AH4 SpdLoadH(ASU2 tex){return AH4(imgDst[5][tex]);}
+// GLSL: AH4 SpdLoadH(ASU2 p, AU1 slice){return AH4(imageLoad(imgDst[5],p));}
+// HLSL: AH4 SpdLoadH(ASU2 tex, AU1 slice){return AH4(imgDst[5][tex]);}
 
 // Define the store function
-// GLSL: void SpdStoreH(ASU2 p, AH4 value, AU1 mip){imageStore(imgDst[mip], p, AF4(value));}
-// HLSL: void SpdStoreH(ASU2 pix, AH4 value, AU1 index){imgDst[index][pix] = AF4(value);}
+// GLSL: void SpdStoreH(ASU2 p, AH4 value, AU1 mip, AU1 slice){imageStore(imgDst[mip], p, AF4(value));}
+// HLSL: void SpdStoreH(ASU2 pix, AH4 value, AU1 index, AU1 slice){imgDst[index][pix] = AF4(value);}
 
-// // Define the atomic counter increase function
+// // Define the atomic counter increase and reset functions
+// // The counter is zeroed once when it is created, the last work group resets it for the next dispatch,
+// // so consecutive dispatches need no clear of the counter
 // // GLSL:
-// void SpdIncreaseAtomicCounter(){spd_counter = atomicAdd(globalAtomic.counter, 1);}
+// void SpdIncreaseAtomicCounter(AU1 slice){spd_counter = atomicAdd(globalAtomic.counter[slice], 1);}
 // AU1 SpdGetAtomicCounter() {return spd_counter;}
+// void SpdResetAtomicCounter(AU1 slice){globalAtomic.counter[slice] = 0;}
 // // HLSL:
-// void SpdIncreaseAtomicCounter(){InterlockedAdd(globalAtomic[0].counter, 1, spd_counter);}
+// void SpdIncreaseAtomicCounter(AU1 slice){InterlockedAdd(globalAtomic[slice].counter, 1, spd_counter);}
 // AU1 SpdGetAtomicCounter(){return spd_counter;}
+// void SpdResetAtomicCounter(AU1 slice){globalAtomic[slice].counter = 0;}
 
 // // Define the lds load and store functions
 // // GLSL:
@@ -231,6 +246,207 @@
 // // If you only use PACKED version
 // #define SPD_PACKED_ONLY
 
+// // [EXTENDED] - sources larger than 4096x4096 in a single dispatch, up to 18 mips
+// #define SPD_EXTENDED
+// // The work groups form blocks of 64x64 work groups. The last work group of a block computes mips 6..11 of the block,
+// // the last block of the slice computes mips 12..17 from mip 11.
+// // Additional hooks, mip is 5 or 11 (mip 11 is read back as well, declare it globallycoherent like mip 5):
+// GLSL: AF4 SpdLoadMip(ASU2 p, AU1 mip, AU1 slice){return imageLoad(imgDst[mip],p);}
+// HLSL: AF4 SpdLoadMip(ASU2 tex, AU1 mip, AU1 slice){return imgDst[mip][tex];}
+// PACKED: AH4 SpdLoadMipH(ASU2 p, AU1 mip, AU1 slice)
+// // One more counter per block and slice in a buffer of its own, the counters of the slices stay at counter[slice].
+// // Zeroed once and reset by the last work group of the block like the counter of the slice:
+// // block = blockID.y * ((numWorkGroupsX + 63) / 64) + blockID.x
+// // spd_blockCount = ((numWorkGroupsX + 63) / 64) * ((numWorkGroupsY + 63) / 64), e.g. from the constants
+// GLSL: layout(std430, set=0, binding=5) coherent buffer globalBlockBuffer { uint counter[]; } globalBlock;
+// GLSL: void SpdIncreaseBlockCounter(AU1 block, AU1 slice){spd_counter = atomicAdd(globalBlock.counter[slice * spd_blockCount + block], 1);}
+// GLSL: void SpdResetBlockCounter(AU1 block, AU1 slice){globalBlock.counter[slice * spd_blockCount + block] = 0;}
+// HLSL: [[vk::binding(5)]] globallycoherent RWStructuredBuffer<globalAtomicBuffer> globalBlock;
+// HLSL: void SpdIncreaseBlockCounter(AU1 block, AU1 slice){InterlockedAdd(globalBlock[slice * spd_blockCount + block].counter, 1, spd_counter);}
+// HLSL: void SpdResetBlockCounter(AU1 block, AU1 slice){globalBlock[slice * spd_blockCount + block].counter = 0;}
+// // Call SpdDownsampleExtended / SpdDownsampleExtendedH, numWorkGroups is AU2(numWorkGroupsX, numWorkGroupsY) of one slice.
+
+// // [SPLIT TAIL] - mips 6..11 by the last work groups of the quads of 4x4 work groups and the last quad, see SPLIT TAIL
+// #define SPD_SPLIT_TAIL
+// // Sources up to 4096x4096. The last work group of each quad of 4x4 work groups computes mips 6 and 7 of the quad, the last
+// // quad of the slice computes mips 8..11 from mip 7. SpdIncreaseBlockCounter and SpdResetBlockCounter of SPD_EXTENDED
+// // count the quads in their own buffer, quad = quadID.y * ((numWorkGroupsX + 3) / 4) + quadID.x is the block and
+// // spd_blockCount = ((numWorkGroupsX + 3) / 4) * ((numWorkGroupsY + 3) / 4), up to 256 per slice. Mip 7 of each quad goes
+// // to the last quad unrounded, through 16x16 values per slice in a globallycoherent / coherent buffer:
+// GLSL: layout(std430, set=0, binding=4) coherent buffer SpdQuads { vec4 values[]; } spdQuads;
+// GLSL: void SpdStoreQuad(AU2 quad, AF4 value, AU1 slice){spdQuads.values[(slice * 16 + quad.y) * 16 + quad.x] = value;}
+// GLSL: AF4 SpdLoadQuad(AU2 quad, AU1 slice){return spdQuads.values[(slice * 16 + quad.y) * 16 + quad.x];}
+// HLSL: [[vk::binding(4)]] globallycoherent RWStructuredBuffer<float4> spdQuads;
+// HLSL: void SpdStoreQuad(AU2 quad, AF4 value, AU1 slice){spdQuads[(slice * 16 + quad.y) * 16 + quad.x] = value;}
+// HLSL: AF4 SpdLoadQuad(AU2 quad, AU1 slice){return spdQuads[(slice * 16 + quad.y) * 16 + quad.x];}
+// PACKED: void SpdStoreQuadH(AU2 quad, AH4 value, AU1 slice), AH4 SpdLoadQuadH(AU2 quad, AU1 slice)
+// // Call SpdDownsampleSplitTail / SpdDownsampleSplitTailH, numWorkGroups is AU2(numWorkGroupsX, numWorkGroupsY) of one slice.
+
+// // [HISTOGRAM] - log2 luminance histogram of mip 0 and the exposure in the same dispatch, see HISTOGRAM
+// #define SPD_HISTOGRAM
+// #define SPD_HISTOGRAM_BINS 64 // 64..256, default 64
+// #define SPD_HISTOGRAM_LOW_PERCENTILE 0.5 // percentile average between these two, defaults 0.5 and 0.95
+// #define SPD_HISTOGRAM_HIGH_PERCENTILE 0.95
+// // Only SpdDownsample / SpdDownsampleH, the last work group always runs, also for mips <= 6. Additional hooks:
+// // AF2(log2 of the smallest luminance, log2 range) of the histogram
+// AF2 SpdHistogramRange(AU1 slice){return AF2(-10.0, 20.0);}
+// // size of mip 0, the texels outside are not counted
+// ASU2 SpdHistogramSize(AU1 slice){return ASU2(mip0Size);}
+// // LDS bins
+// GLSL: shared AU1 spd_histogram[SPD_HISTOGRAM_BINS];
+// GLSL: void SpdHistogramStoreLDS(AU1 bin, AU1 count){spd_histogram[bin] = count;}
+// GLSL: void SpdHistogramAddLDS(AU1 bin){atomicAdd(spd_histogram[bin], 1);}
+// GLSL: AU1 SpdHistogramLoadLDS(AU1 bin){return spd_histogram[bin];}
+// HLSL: groupshared AU1 spd_histogram[SPD_HISTOGRAM_BINS];
+// HLSL: void SpdHistogramStoreLDS(AU1 bin, AU1 count){spd_histogram[bin] = count;}
+// HLSL: void SpdHistogramAddLDS(AU1 bin){InterlockedAdd(spd_histogram[bin], 1);}
+// HLSL: AU1 SpdHistogramLoadLDS(AU1 bin){return spd_histogram[bin];}
+// // Global bins of each slice in a coherent buffer, zeroed once, the last work group resets them like the atomic counter
+// GLSL: void SpdHistogramAddGlobal(AU1 bin, AU1 count, AU1 slice){atomicAdd(histogram.bins[slice * SPD_HISTOGRAM_BINS + bin], count);}
+// GLSL: AU1 SpdHistogramLoadGlobal(AU1 bin, AU1 slice){return histogram.bins[slice * SPD_HISTOGRAM_BINS + bin];}
+// GLSL: void SpdHistogramResetGlobal(AU1 bin, AU1 slice){histogram.bins[slice * SPD_HISTOGRAM_BINS + bin] = 0;}
+// HLSL: void SpdHistogramAddGlobal(AU1 bin, AU1 count, AU1 slice){InterlockedAdd(histogram[slice * SPD_HISTOGRAM_BINS + bin], count);}
+// HLSL: AU1 SpdHistogramLoadGlobal(AU1 bin, AU1 slice){return histogram[slice * SPD_HISTOGRAM_BINS + bin];}
+// HLSL: void SpdHistogramResetGlobal(AU1 bin, AU1 slice){histogram[slice * SPD_HISTOGRAM_BINS + bin] = 0;}
+// // AF4(average, percentile average, low percentile, high percentile) luminance, e.g. exposure = 0.18 / value.y
+// GLSL: void SpdStoreExposure(AF4 value, AU1 slice){exposure.values[slice] = value;}
+// HLSL: void SpdStoreExposure(AF4 value, AU1 slice){exposure[slice] = value;}
+
+// // [COVERAGE] - alpha test coverage of the source kept in all mips, see COVERAGE
+// #define SPD_COVERAGE
+// #define SPD_COVERAGE_BINS 256 // alpha histogram of a mip, 64..256, default 256
+// #define SPD_COVERAGE_ALPHA_STEP (1.0 / 255.0) // step of the stored alpha of UNORM mips, default 0 for float mips
+// #define SPD_COVERAGE_ALPHA_PRECISION (1.0 / 1024.0) // relative step of float mips, 1 / 1024 for fp16, default 2^-20 for fp32
+// // Only SpdDownsample / SpdDownsampleH without SPD_LINEAR_SAMPLER, the last work group always runs, also for mips <= 6.
+// // Every work group reads back the mips it stored, declare all of them globallycoherent / coherent and provide
+// // SpdLoadMip / SpdLoadMipH as for SPD_EXTENDED. Additional hooks:
+// // alpha reference of the alpha test, > 0
+// AF1 SpdAlphaReference(AU1 slice){return 0.5;}
+// // size of the source
+// AU2 SpdCoverageSize(AU1 slice){return AU2(srcSize);}
+// // LDS: entry 0 counts the texels of the source, entry 1 + mip * SPD_COVERAGE_BINS + bin the histograms of mips 0..5
+// GLSL: shared AU1 spd_coverage[1 + 6 * SPD_COVERAGE_BINS];
+// GLSL: void SpdCoverageStoreLDS(AU1 index, AU1 count){spd_coverage[index] = count;}
+// GLSL: void SpdCoverageAddLDS(AU1 index, AU1 count){atomicAdd(spd_coverage[index], count);}
+// GLSL: AU1 SpdCoverageLoadLDS(AU1 index){return spd_coverage[index];}
+// HLSL: groupshared AU1 spd_coverage[1 + 6 * SPD_COVERAGE_BINS];
+// HLSL: void SpdCoverageStoreLDS(AU1 index, AU1 count){spd_coverage[index] = count;}
+// HLSL: void SpdCoverageAddLDS(AU1 index, AU1 count){InterlockedAdd(spd_coverage[index], count);}
+// HLSL: AU1 SpdCoverageLoadLDS(AU1 index){return spd_coverage[index];}
+// // The same counts of each slice in a coherent buffer, zeroed once, the last work group resets them like the atomic counter
+// GLSL: void SpdCoverageAddGlobal(AU1 index, AU1 count, AU1 slice){atomicAdd(coverage.counts[slice * (1 + 6 * SPD_COVERAGE_BINS) + index], count);}
+// GLSL: AU1 SpdCoverageLoadGlobal(AU1 index, AU1 slice){return coverage.counts[slice * (1 + 6 * SPD_COVERAGE_BINS) + index];}
+// GLSL: void SpdCoverageResetGlobal(AU1 index, AU1 slice){coverage.counts[slice * (1 + 6 * SPD_COVERAGE_BINS) + index] = 0;}
+// HLSL: void SpdCoverageAddGlobal(AU1 index, AU1 count, AU1 slice){InterlockedAdd(coverage[slice * (1 + 6 * SPD_COVERAGE_BINS) + index], count);}
+// HLSL: AU1 SpdCoverageLoadGlobal(AU1 index, AU1 slice){return coverage[slice * (1 + 6 * SPD_COVERAGE_BINS) + index];}
+// HLSL: void SpdCoverageResetGlobal(AU1 index, AU1 slice){coverage[slice * (1 + 6 * SPD_COVERAGE_BINS) + index] = 0;}
+// // the alpha scale of a mip, the mips keep the plain average: the alpha test of a mip compares alpha * scale with the reference
+// GLSL: void SpdStoreAlphaScale(AF1 scale, AU1 mip, AU1 slice){alphaScales.values[slice * 12 + mip] = scale;}
+// HLSL: void SpdStoreAlphaScale(AF1 scale, AU1 mip, AU1 slice){alphaScales[slice * 12 + mip] = scale;}
+// // Or a second dispatch over the same work groups rewrites the alpha of the mips in place, with the hooks above and
+// // SpdCoverageApply(workGroupID, localInvocationIndex, mips, slice) / SpdCoverageApplyH:
+// GLSL: AF1 SpdLoadAlphaScale(AU1 mip, AU1 slice){return alphaScales.values[slice * 12 + mip];}
+// HLSL: AF1 SpdLoadAlphaScale(AU1 mip, AU1 slice){return alphaScales[slice * 12 + mip];}
+
+// // [DEPTH] - hierarchical Z of a R32_FLOAT depth buffer, see DEPTH VERSION
+// #define SPD_DEPTH
+// // The farthest depth is the maximum, with reversed Z the minimum:
+// #define SPD_DEPTH_REVERSED_Z
+// // The depth version replaces the color versions in the shader, their hooks are not needed. All mips are read back by the
+// // last work group, declare all of them globallycoherent / coherent. Its hooks, all loads are inside of the image:
+// GLSL: layout(set=0,binding=0,r32f) uniform image2D imgSrc;
+// GLSL: layout(set=0,binding=1,r32f) uniform coherent image2D imgDst[12];
+// GLSL: AF1 SpdLoadSourceDepth(ASU2 p, AU1 slice){return imageLoad(imgSrc, p).x;}
+// GLSL: AF1 SpdLoadDepth(ASU2 p, AU1 mip, AU1 slice){return imageLoad(imgDst[mip], p).x;}
+// GLSL: void SpdStoreDepth(ASU2 p, AF1 value, AU1 mip, AU1 slice){imageStore(imgDst[mip], p, AF4(value, 0.0, 0.0, 0.0));}
+// HLSL: AF1 SpdLoadSourceDepth(ASU2 p, AU1 slice){return imgSrc[p];}
+// HLSL: AF1 SpdLoadDepth(ASU2 p, AU1 mip, AU1 slice){return imgDst[mip][p];}
+// HLSL: void SpdStoreDepth(ASU2 p, AF1 value, AU1 mip, AU1 slice){imgDst[mip][p] = value;}
+// // LDS of 32x32 single values, same size as the one of the color versions:
+// GLSL: shared AF1 spd_intermediateDepth[32][32];
+// GLSL: AF1 SpdLoadIntermediateDepth(AU1 x, AU1 y){return spd_intermediateDepth[x][y];}
+// GLSL: void SpdStoreIntermediateDepth(AU1 x, AU1 y, AF1 value){spd_intermediateDepth[x][y] = value;}
+// HLSL: groupshared AF1 spd_intermediateDepth[32][32];
+// HLSL: AF1 SpdLoadIntermediateDepth(AU1 x, AU1 y){return spd_intermediateDepth[x][y];}
+// HLSL: void SpdStoreIntermediateDepth(AU1 x, AU1 y, AF1 value){spd_intermediateDepth[x][y] = value;}
+// // plus SpdIncreaseAtomicCounter, SpdGetAtomicCounter and SpdResetAtomicCounter as above. The last work group always runs, also for mips <= 6.
+// // Call SpdDownsampleDepth, size is the size of the source in texels:
+// SpdDownsampleDepth(AU2(gl_WorkGroupID.xy), AU1(gl_LocalInvocationIndex), AU1(spdConstants.mips),
+//     AU1(spdConstants.numWorkGroups), AU1(gl_WorkGroupID.z), AU2(spdConstants.size));
+
+// // [FILTER] - 4 or 6 tap separable filters instead of the 2x2 reduction, see FILTER VERSION
+// #define SPD_FILTER SPD_FILTER_BINOMIAL // or SPD_FILTER_KAISER, SPD_FILTER_LANCZOS
+// // The filter version replaces the color versions in the shader, SpdReduce4 and the 16x16 intermediate are not needed.
+// // It uses SpdLoadSourceImage and SpdStore as above, and SpdLoadMip of EXTENDED for all mips: the last work group reads
+// // mips 2.. back, declare them globallycoherent / coherent. All loads are inside of the image.
+// // LDS of the tile with its apron, 44x44 texels (38x38 are enough for SPD_FILTER_BINOMIAL):
+// GLSL: shared AF4 spd_intermediateFilter[44][44];
+// GLSL: AF4 SpdLoadIntermediateFilter(AU1 x, AU1 y){return spd_intermediateFilter[x][y];}
+// GLSL: void SpdStoreIntermediateFilter(AU1 x, AU1 y, AF4 value){spd_intermediateFilter[x][y] = value;}
+// HLSL: groupshared AF4 spd_intermediateFilter[44][44];
+// HLSL: AF4 SpdLoadIntermediateFilter(AU1 x, AU1 y){return spd_intermediateFilter[x][y];}
+// HLSL: void SpdStoreIntermediateFilter(AU1 x, AU1 y, AF4 value){spd_intermediateFilter[x][y] = value;}
+// // plus SpdIncreaseAtomicCounter, SpdGetAtomicCounter and SpdResetAtomicCounter as above. Call SpdDownsampleFilter, size is the size of the source:
+// SpdDownsampleFilter(AU2(gl_WorkGroupID.xy), AU1(gl_LocalInvocationIndex), AU1(spdConstants.mips),
+//     AU1(spdConstants.numWorkGroups), AU1(gl_WorkGroupID.z), AU2(spdConstants.size));
+
+// // [DIRTY TILES] - only the 64x64 tiles that intersect dirty rectangles, see DIRTY TILES
+// #define SPD_DIRTY_TILES
+// // One work group per entry of a list of tiles, the mips of the other tiles keep their values. Sources up to 4096x4096.
+// // Mips 5 and up are read back by the last work group, declare them globallycoherent / coherent and provide SpdLoadMip /
+// // SpdLoadMipH as for SPD_EXTENDED. Additional hook, the tile of a list entry, x in the low and y in the high 16 bits:
+// GLSL: AU2 SpdLoadDirtyTile(AU1 index, AU1 slice){AU1 t = dirtyTiles.values[index]; return AU2(t & 0xffff, t >> 16);}
+// HLSL: AU2 SpdLoadDirtyTile(AU1 index, AU1 slice){AU1 t = dirtyTiles[index]; return AU2(t & 0xffff, t >> 16);}
+// // The list is in Morton order, e.g. built with SpdSetupDirtyTiles of ffx_spd_cpu.h. Dispatch numTiles work groups and call
+// // SpdDownsampleDirty / SpdDownsampleDirtyH with the work group index instead of the work group ID:
+// // The last work group keeps the texels just outside of mips 6 and up in the LDS, size is the size of the source:
+// SpdDownsampleDirty(AU1(gl_WorkGroupID.x), AU1(gl_LocalInvocationIndex), AU1(spdConstants.mips),
+//     AU1(spdConstants.numTiles), AU1(gl_WorkGroupID.z), AU2(spdConstants.size));
+
+// // [MIP RANGE] - mips baseMip + 1 .. baseMip + mips of a texture from its mip baseMip, e.g. after a mip was streamed in
+// // No define: SPD reads its source only with SpdLoadSourceImage and writes mip i of the result only with SpdStore(.., i, ..).
+// // Bind mip baseMip as the source and mip baseMip + 1 + i as imgDst[i], or offset the index in the hooks with a constant.
+// // numWorkGroups and the dispatch are the ones of the size of mip baseMip, mips is the count of mips to write:
+// GLSL: AF4 SpdLoadSourceImage(ASU2 p, AU1 slice){return imageLoad(imgMips[spdConstants.baseMip], p);}
+// GLSL: void SpdStore(ASU2 p, AF4 value, AU1 mip, AU1 slice){imageStore(imgMips[spdConstants.baseMip + 1 + mip], p, value);}
+// HLSL: AF4 SpdLoadSourceImage(ASU2 p, AU1 slice){return imgMips[baseMip][p];}
+// HLSL: void SpdStore(ASU2 p, AF4 value, AU1 mip, AU1 slice){imgMips[baseMip + 1 + mip][p] = value;}
+// // SpdLoad (mip 5 of the result) and SpdLoadMip read back mip baseMip + 6 and baseMip + 1 + mip of the texture.
+// // This is a downsample of mip baseMip, not the continuation of the dispatch that made the chain: the additions run in
+// // another order, and texels outside of mip baseMip read zero where the chain holds the reduction of the source. The mips
+// // are the same only for baseMip 5, otherwise they round differently, and for sizes that are not powers of two they can
+// // differ by more than rounding near the right and bottom edge.
+
+// // [RESIDENCY] - sparse sources, the 64x64 tiles of the source that are not resident are skipped
+// #define SPD_RESIDENCY
+// // Only SpdDownsample / SpdDownsampleExtended and their H versions, not with SPD_COVERAGE. The work group of a 64x64 tile
+// // that is not resident neither loads nor stores, it only increases the counters. The last work group reads the texel of
+// // mip 5 of such a tile as the fill, so mips 6 and up are complete. Additional hooks, nonzero for a resident tile, e.g. from
+// // a bitmap with one bit per tile. The last work group also asks for tiles outside of the source (up to 64x64 tiles of mip 5),
+// // return nonzero for them to keep the zeros that the loads outside of mip 5 return:
+// GLSL: AU1 SpdTileResident(AU2 tile, AU1 slice){return (residency.bits[tile.y * spdConstants.residencyPitch + tile.x / 32] >> (tile.x % 32)) & 1;}
+// HLSL: AU1 SpdTileResident(AU2 tile, AU1 slice){return (residency[tile.y * residencyPitch + tile.x / 32] >> (tile.x % 32)) & 1;}
+// AF4 SpdResidencyFill(AU1 slice){return AF4(0.5, 0.5, 0.5, 1.0);}
+// PACKED: AH4 SpdResidencyFillH(AU1 slice)
+
+// // [WAVE SHUFFLE] - mips 2..5 with cross-lane shuffles inside a wave, see WAVE SHUFFLE
+// #define SPD_WAVE_SHUFFLE
+// #define SPD_WAVE_SIZE 64 // optional, the wave size when it is known at compile time, default the subgroup size of the device
+// // Not with SPD_NO_WAVE_OPERATIONS. Needs the invocations of the work group in the lanes of the waves in the order of
+// // localInvocationIndex (lane = localInvocationIndex % wave size) and GL_KHR_shader_subgroup_shuffle in GLSL.
+// // Wave64 and larger: mips 2..4 inside the wave, one barrier before mip 5. Wave16 / wave32: mips 2 and 3 inside the wave,
+// // one barrier before mip 4. Smaller waves keep the barrier per mip.
+
+// // [RECT] - only a sub-rectangle of the source, e.g. the viewport of a dynamic resolution inside a fixed size target
+// // SpdSetup (A_CPU, see SETUP) returns the work groups to dispatch for the rectangle, numWorkGroups, the mips and the
+// // workGroupOffset. Pass workGroupOffset as the last argument of SpdDownsample / SpdDownsampleH:
+//  SpdDownsample(AU2(gl_WorkGroupID.xy), AU1(gl_LocalInvocationIndex), AU1(spdConstants.mips),
+//    AU1(spdConstants.numWorkGroups), AU1(gl_WorkGroupID.z), AU2(spdConstants.workGroupOffset));
+// // The work groups cover the 64x64 tiles that intersect the rectangle, in the texel coordinates of the whole target. Their
+// // loads outside of the rectangle read the target, clamp them in SpdLoadSourceImage if that area must not contribute.
+// // Mips 6 and up are computed from the up to 64x64 texels of mip 5 as without the rectangle, texels of mip 5 outside of
+// // the tiles keep what an earlier dispatch stored. Sources up to 4096x4096, not with SPD_EXTENDED or SPD_SPLIT_TAIL.
+
 // // Include this SPD (single pass downsampler) header file (or copy it in without an include).
 // #include "ffx_spd.h"
 // ...
@@ -241,46 +457,208 @@
 // void main(){
 //  // Call the downsampling function
 //  SpdDownsample(AU2(gl_WorkGroupID.xy), AU1(gl_LocalInvocationIndex), 
-//    AU1(spdConstants.mips), AU1(spdConstants.numWorkGroups));
+//    AU1(spdConstants.mips), AU1(spdConstants.numWorkGroups), AU1(gl_WorkGroupID.z));
 //
 // // PACKED:
 //  SpdDownsampleH(AU2(gl_WorkGroupID.xy), AU1(gl_LocalInvocationIndex), 
-//    AU1(spdConstants.mips), AU1(spdConstants.numWorkGroups));
+//    AU1(spdConstants.mips), AU1(spdConstants.numWorkGroups), AU1(gl_WorkGroupID.z));
 // ...
 // // HLSL:
 // [numthreads(256,1,1)]
 // void main(uint3 WorkGroupId : SV_GroupID, uint LocalThreadIndex : SV_GroupIndex) {
 //  SpdDownsample(AU2(WorkGroupId.xy), AU1(LocalThreadIndex),  
-//    AU1(mips), AU1(numWorkGroups));
+//    AU1(mips), AU1(numWorkGroups), AU1(WorkGroupId.z));
 //
 // // PACKED:
 //  SpdDownsampleH(AU2(WorkGroupId.xy), AU1(LocalThreadIndex),  
-//    AU1(mips), AU1(numWorkGroups));
+//    AU1(mips), AU1(numWorkGroups), AU1(WorkGroupId.z));
 // ...
 
 //
 //------------------------------------------------------------------------------------------------------------------------------
 
+//==============================================================================================================================
+//                                                          SETUP
+//------------------------------------------------------------------------------------------------------------------------------
+// Dispatch setup for a sub-rectangle of the source, see [RECT]. rectInfo is (left, top, width, height) in texels of the source.
+// Returns the work groups to dispatch in x and y, the workGroupOffset of SpdDownsample and numWorkGroups and the mips for the
+// constants. mips < 0 selects the mips of the rectangle down to 1x1, same as the full size (at most 12). An empty rectangle
+// dispatches no work groups.
+//==============================================================================================================================
+#ifdef A_CPU
+A_STATIC void SpdSetup(outAU2 dispatchThreadGroupCountXY, outAU2 workGroupOffset, outAU2 numWorkGroupsAndMips, inAU4 rectInfo, ASU1 mips)
+{
+    // the tiles of the first and the last texel of the rectangle
+    workGroupOffset[0] = rectInfo[0] / 64;
+    workGroupOffset[1] = rectInfo[1] / 64;
+    if (rectInfo[2] == 0 || rectInfo[3] == 0)
+    {
+        // the last texel would be the one before the first
+        dispatchThreadGroupCountXY[0] = dispatchThreadGroupCountXY[1] = 0;
+        numWorkGroupsAndMips[0] = numWorkGroupsAndMips[1] = 0;
+        return;
+    }
+    AU1 endIndexX = (rectInfo[0] + rectInfo[2] - 1) / 64;
+    AU1 endIndexY = (rectInfo[1] + rectInfo[3] - 1) / 64;
+
+    dispatchThreadGroupCountXY[0] = endIndexX + 1 - workGroupOffset[0];
+    dispatchThreadGroupCountXY[1] = endIndexY + 1 - workGroupOffset[1];
 
+    numWorkGroupsAndMips[0] = dispatchThreadGroupCountXY[0] * dispatchThreadGroupCountXY[1];
+    if (mips >= 0)
+    {
+        numWorkGroupsAndMips[1] = AU1(mips);
+    }
+    else
+    {
+        AU1 resolution = AMaxU1(rectInfo[2], rectInfo[3]);
+        numWorkGroupsAndMips[1] = AU1(AMinF1(AFloorF1(ALog2F1(AF1(resolution))), AF1(12)));
+    }
+}
+#endif // A_CPU
 
+#ifdef A_GPU
 //==============================================================================================================================
 //                                                     NON-PACKED VERSION
 //==============================================================================================================================
 
 #ifdef SPD_PACKED_ONLY
   // Avoid compiler error
-  AF4 SpdLoadSourceImage(ASU2 p){return AF4(0.0,0.0,0.0,0.0);}
-  AF4 SpdLoad(ASU2 p){return AF4(0.0,0.0,0.0,0.0);}
-  void SpdStore(ASU2 p, AF4 value, AU1 mip){}
+  AF4 SpdLoadSourceImage(ASU2 p, AU1 slice){return AF4(0.0,0.0,0.0,0.0);}
+  AF4 SpdLoad(ASU2 p, AU1 slice){return AF4(0.0,0.0,0.0,0.0);}
+  void SpdStore(ASU2 p, AF4 value, AU1 mip, AU1 slice){}
   AF4 SpdLoadIntermediate(AU1 x, AU1 y){return AF4(0.0,0.0,0.0,0.0);}
   void SpdStoreIntermediate(AU1 x, AU1 y, AF4 value){}
   AF4 SpdReduce4(AF4 v0, AF4 v1, AF4 v2, AF4 v3){return AF4(0.0,0.0,0.0,0.0);}
+  #if defined(SPD_EXTENDED) || defined(SPD_COVERAGE) || defined(SPD_DIRTY_TILES)
+  AF4 SpdLoadMip(ASU2 p, AU1 mip, AU1 slice){return AF4(0.0,0.0,0.0,0.0);}
+  #endif
+  #ifdef SPD_SPLIT_TAIL
+  void SpdStoreQuad(AU2 quad, AF4 value, AU1 slice){}
+  AF4 SpdLoadQuad(AU2 quad, AU1 slice){return AF4(0.0,0.0,0.0,0.0);}
+  #endif
+  #ifdef SPD_RESIDENCY
+  AF4 SpdResidencyFill(AU1 slice){return AF4(0.0,0.0,0.0,0.0);}
+  #endif
+#endif
+
+//==============================================================================================================================
+//                                                    BUILT-IN REDUCTIONS
+//------------------------------------------------------------------------------------------------------------------------------
+// #define SPD_REDUCTION to one of the modes below before the include, this header then defines SpdReduce4 and SpdReduce4H.
+// SPD_REDUCTION_MINMAX keeps the minimum in x and z and the maximum in y and w, e.g. a min/max depth pair in xy.
+// SPD_REDUCTION_LUMINANCE weights every texel with 1 / (1 + luma), which keeps single bright texels from dominating the mips.
+// SPD_REDUCTION_PREMULTIPLIED averages straight alpha colors as if they were premultiplied, alpha is the plain average.
+// SPD_REDUCTION_WEIGHTED weights every texel with the hook AF1 SpdReduceWeight(AF4 v) / AH1 SpdReduceWeightH(AH4 v).
+// SPD_REDUCTION_NORMAL is for normal maps: xyz is a unit tangent space normal in -1..1 (the hooks decode UNORM), w the
+// roughness alpha, alpha^2 being the variance of the slopes. The normals are averaged and renormalized, the length they lose
+// is the Toksvig variance (1 - |n|) / |n| of the footprint, which is added to the average alpha^2 of the texels, so
+// specular does not alias in the distant mips. The variances of all levels add up, no second pass over the mips is needed.
+// Texels with a zero normal are skipped, e.g. the zero outside of the source, so the decoding hooks should keep 0 as 0.
+// Min, max and min/max do not depend on the order of the values, the quads reduce them with two swaps instead of three.
+//==============================================================================================================================
+#define SPD_REDUCTION_AVERAGE 0
+#define SPD_REDUCTION_MIN 1
+#define SPD_REDUCTION_MAX 2
+#define SPD_REDUCTION_MINMAX 3
+#define SPD_REDUCTION_SUM 4
+#define SPD_REDUCTION_LUMINANCE 5
+#define SPD_REDUCTION_PREMULTIPLIED 6
+#define SPD_REDUCTION_WEIGHTED 7
+#define SPD_REDUCTION_NORMAL 8
+
+#if defined(SPD_REDUCTION) && (SPD_REDUCTION == SPD_REDUCTION_MIN || SPD_REDUCTION == SPD_REDUCTION_MAX || SPD_REDUCTION == SPD_REDUCTION_MINMAX)
+#define SPD_REDUCTION_PAIRWISE
+#endif
+
+AF4 SpdReduceAverage4(AF4 v0, AF4 v1, AF4 v2, AF4 v3){return (v0 + v1 + v2 + v3) * AF1_(0.25);}
+AF4 SpdReduceMin4(AF4 v0, AF4 v1, AF4 v2, AF4 v3){return min(min(v0, v1), min(v2, v3));}
+AF4 SpdReduceMax4(AF4 v0, AF4 v1, AF4 v2, AF4 v3){return max(max(v0, v1), max(v2, v3));}
+AF4 SpdReduceMinMax4(AF4 v0, AF4 v1, AF4 v2, AF4 v3)
+{
+    AF2 n = min(min(v0.xz, v1.xz), min(v2.xz, v3.xz));
+    AF2 x = max(max(v0.yw, v1.yw), max(v2.yw, v3.yw));
+    return AF4(n.x, x.x, n.y, x.y);
+}
+AF4 SpdReduceSum4(AF4 v0, AF4 v1, AF4 v2, AF4 v3){return v0 + v1 + v2 + v3;}
+// w holds the weights of v0..v3, all weights zero returns zero
+AF4 SpdReduceWeighted4(AF4 v0, AF4 v1, AF4 v2, AF4 v3, AF4 w)
+{
+    AF1 sum = w.x + w.y + w.z + w.w;
+    AF4 r = v0 * w.x + v1 * w.y + v2 * w.z + v3 * w.w;
+    return sum > AF1_(0.0) ? r * ARcpF1(sum) : AF4_(0.0);
+}
+AF1 SpdLuminanceWeight(AF4 v){return ARcpF1(AF1_(1.0) + dot(v.rgb, AF3(0.2126, 0.7152, 0.0722)));}
+AF4 SpdReduceLuminance4(AF4 v0, AF4 v1, AF4 v2, AF4 v3)
+{
+    return SpdReduceWeighted4(v0, v1, v2, v3, AF4(SpdLuminanceWeight(v0), SpdLuminanceWeight(v1), SpdLuminanceWeight(v2), SpdLuminanceWeight(v3)));
+}
+AF4 SpdReducePremultiplied4(AF4 v0, AF4 v1, AF4 v2, AF4 v3)
+{
+    AF1 a = v0.a + v1.a + v2.a + v3.a;
+    AF3 c = v0.rgb * v0.a + v1.rgb * v1.a + v2.rgb * v2.a + v3.rgb * v3.a;
+    return AF4(a > AF1_(0.0) ? c * ARcpF1(a) : AF3_(0.0), a * AF1_(0.25));
+}
+// texels without a normal (zero), e.g. outside of the source, are skipped, none at all stays zero
+AF4 SpdReduceNormal4(AF4 v0, AF4 v1, AF4 v2, AF4 v3)
+{
+    AF4 w = sign(AF4(dot(v0.xyz, v0.xyz), dot(v1.xyz, v1.xyz), dot(v2.xyz, v2.xyz), dot(v3.xyz, v3.xyz)));
+    AF1 count = w.x + w.y + w.z + w.w;
+    if (count == AF1_(0.0)) return AF4_(0.0);
+    AF1 rcp = ARcpF1(count);
+    AF3 n = (v0.xyz + v1.xyz + v2.xyz + v3.xyz) * rcp;
+    AF1 len = sqrt(dot(n, n));
+    AF1 variance = dot(AF4(v0.w, v1.w, v2.w, v3.w) * AF4(v0.w, v1.w, v2.w, v3.w), w) * rcp;
+    // the shorter the average normal, the rougher, normals that cancel out are the roughest
+    variance += len > AF1_(0.0) ? (AF1_(1.0) - len) * ARcpF1(len) : AF1_(1.0);
+    return AF4(len > AF1_(0.0) ? n * ARcpF1(len) : AF3(0.0, 0.0, 1.0), sqrt(min(variance, AF1_(1.0))));
+}
+
+#if defined(SPD_REDUCTION) && !defined(SPD_PACKED_ONLY)
+AF4 SpdReduce4(AF4 v0, AF4 v1, AF4 v2, AF4 v3)
+{
+#if SPD_REDUCTION == SPD_REDUCTION_MIN
+    return SpdReduceMin4(v0, v1, v2, v3);
+#elif SPD_REDUCTION == SPD_REDUCTION_MAX
+    return SpdReduceMax4(v0, v1, v2, v3);
+#elif SPD_REDUCTION == SPD_REDUCTION_MINMAX
+    return SpdReduceMinMax4(v0, v1, v2, v3);
+#elif SPD_REDUCTION == SPD_REDUCTION_SUM
+    return SpdReduceSum4(v0, v1, v2, v3);
+#elif SPD_REDUCTION == SPD_REDUCTION_LUMINANCE
+    return SpdReduceLuminance4(v0, v1, v2, v3);
+#elif SPD_REDUCTION == SPD_REDUCTION_PREMULTIPLIED
+    return SpdReducePremultiplied4(v0, v1, v2, v3);
+#elif SPD_REDUCTION == SPD_REDUCTION_WEIGHTED
+    return SpdReduceWeighted4(v0, v1, v2, v3, AF4(SpdReduceWeight(v0), SpdReduceWeight(v1), SpdReduceWeight(v2), SpdReduceWeight(v3)));
+#elif SPD_REDUCTION == SPD_REDUCTION_NORMAL
+    return SpdReduceNormal4(v0, v1, v2, v3);
+#else
+    return SpdReduceAverage4(v0, v1, v2, v3);
+#endif
+}
+#endif
+
+#ifdef SPD_REDUCTION_PAIRWISE
+AF4 SpdReducePair(AF4 a, AF4 b)
+{
+#if SPD_REDUCTION == SPD_REDUCTION_MIN
+    return min(a, b);
+#elif SPD_REDUCTION == SPD_REDUCTION_MAX
+    return max(a, b);
+#else
+    return AF4(min(a.x, b.x), max(a.y, b.y), min(a.z, b.z), max(a.w, b.w));
+#endif
+}
 #endif
 
 //_____________________________________________________________/\_______________________________________________________________
 #if defined(A_GLSL) && !defined(SPD_NO_WAVE_OPERATIONS)
 #extension GL_KHR_shader_subgroup_quad:require
 #endif
+#if defined(A_GLSL) && defined(SPD_WAVE_SHUFFLE) && !defined(SPD_NO_WAVE_OPERATIONS)
+#extension GL_KHR_shader_subgroup_shuffle:require
+#endif
 
 void SpdWorkgroupShuffleBarrier() {
 #ifdef A_GLSL
@@ -291,26 +669,429 @@ void SpdWorkgroupShuffleBarrier() {
 #endif
 }
 
+#if defined(SPD_WAVE_SHUFFLE) && !defined(SPD_NO_WAVE_OPERATIONS)
+AU1 SpdWaveSize()
+{
+#if defined(SPD_WAVE_SIZE)
+    return AU1(SPD_WAVE_SIZE);
+#elif defined(A_GLSL)
+    return gl_SubgroupSize;
+#else
+    return WaveGetLaneCount();
+#endif
+}
+#endif
+
+// Barrier that also makes the global memory writes of the work group visible to all of its invocations
+void SpdDeviceMemoryBarrier()
+{
+#ifdef A_GLSL
+    memoryBarrier();
+    barrier();
+#endif
+#ifdef A_HLSL
+    DeviceMemoryBarrierWithGroupSync();
+#endif
+}
+
 // Only last active workgroup should proceed
-bool SpdExitWorkgroup(AU1 numWorkGroups, AU1 localInvocationIndex) 
+bool SpdExitWorkgroup(AU1 numWorkGroups, AU1 localInvocationIndex, AU1 slice) 
 {
     // global atomic counter
     if (localInvocationIndex == 0)
     {
-        SpdIncreaseAtomicCounter();
+        SpdIncreaseAtomicCounter(slice);
+    }
+    SpdWorkgroupShuffleBarrier();
+    bool exit = (SpdGetAtomicCounter() != (numWorkGroups - 1));
+    // all other workgroups have increased the counter already, reset it for the next dispatch
+    if (!exit && localInvocationIndex == 0)
+    {
+        SpdResetAtomicCounter(slice);
+    }
+    return exit;
+}
+
+#if defined(SPD_EXTENDED) || defined(SPD_SPLIT_TAIL)
+// Only last active workgroup of the block should proceed
+bool SpdExitBlock(AU1 numWorkGroups, AU1 localInvocationIndex, AU1 block, AU1 slice)
+{
+    // block atomic counter
+    if (localInvocationIndex == 0)
+    {
+        SpdIncreaseBlockCounter(block, slice);
+    }
+    SpdWorkgroupShuffleBarrier();
+    bool exit = (SpdGetAtomicCounter() != (numWorkGroups - 1));
+    if (!exit && localInvocationIndex == 0)
+    {
+        SpdResetBlockCounter(block, slice);
+    }
+    return exit;
+}
+#endif
+
+//==============================================================================================================================
+//                                                         HISTOGRAM
+//------------------------------------------------------------------------------------------------------------------------------
+// SPD_HISTOGRAM: a log2 luminance histogram of mip 0 and the exposure of the source in the same dispatch as the mips.
+// Every work group counts its texels of mip 0 in the LDS and adds its bins to the global histogram of the slice, the last
+// work group computes the exposure from it. Texels outside of SpdHistogramSize are not counted. Bin 0 holds the texels below
+// the range, which includes black, and is left out of the exposure. Bins 1..SPD_HISTOGRAM_BINS-1 split the log2 range evenly.
+// SpdStoreExposure gets AF4(average, percentile average, low percentile, high percentile) as luminance: the average is the
+// geometric mean of the texels not below the range, the percentile average the one of the texels between the percentiles.
+//==============================================================================================================================
+#ifdef SPD_HISTOGRAM
+#ifndef SPD_HISTOGRAM_BINS
+#define SPD_HISTOGRAM_BINS 64
+#endif
+#ifndef SPD_HISTOGRAM_LOW_PERCENTILE
+#define SPD_HISTOGRAM_LOW_PERCENTILE 0.5
+#endif
+#ifndef SPD_HISTOGRAM_HIGH_PERCENTILE
+#define SPD_HISTOGRAM_HIGH_PERCENTILE 0.95
+#endif
+
+// range is AF2(log2 of the smallest luminance, log2 range) of SpdHistogramRange
+AU1 SpdHistogramBin(AF4 v, AF2 range)
+{
+    AF1 t = (log2(dot(v.rgb, AF3(0.2126, 0.7152, 0.0722))) - range.x) / range.y;
+    // also black and NaN
+    if (!(t >= AF1_(0.0))) return 0;
+    return 1 + min(AU1(min(t, AF1_(1.0)) * AF1_(SPD_HISTOGRAM_BINS - 1)), AU1(SPD_HISTOGRAM_BINS - 2));
+}
+
+// log2 luminance of the center of a bin
+AF1 SpdHistogramBinLog2(AU1 bin, AF2 range)
+{
+    return range.x + (AF1(bin) - AF1_(0.5)) * range.y / AF1_(SPD_HISTOGRAM_BINS - 1);
+}
+
+void SpdHistogramClear(AU1 localInvocationIndex)
+{
+    if (localInvocationIndex < SPD_HISTOGRAM_BINS)
+        SpdHistogramStoreLDS(localInvocationIndex, 0);
+    SpdWorkgroupShuffleBarrier();
+}
+
+// the four texels of mip 0 of an invocation at pix, pix + (16, 0), pix + (0, 16) and pix + (16, 16)
+void SpdHistogramAdd4(AF4 v0, AF4 v1, AF4 v2, AF4 v3, ASU2 pix, AU1 slice)
+{
+    AF2 range = SpdHistogramRange(slice);
+    ASU2 size = SpdHistogramSize(slice);
+    bool x0 = pix.x < size.x;
+    bool x1 = pix.x + 16 < size.x;
+    bool y0 = pix.y < size.y;
+    bool y1 = pix.y + 16 < size.y;
+    if (x0 && y0) SpdHistogramAddLDS(SpdHistogramBin(v0, range));
+    if (x1 && y0) SpdHistogramAddLDS(SpdHistogramBin(v1, range));
+    if (x0 && y1) SpdHistogramAddLDS(SpdHistogramBin(v2, range));
+    if (x1 && y1) SpdHistogramAddLDS(SpdHistogramBin(v3, range));
+}
+
+// Adds the bins of the work group to the global histogram, before the work group increases the counter.
+void SpdHistogramMerge(AU1 localInvocationIndex, AU1 slice)
+{
+    SpdWorkgroupShuffleBarrier();
+    if (localInvocationIndex < SPD_HISTOGRAM_BINS)
+    {
+        AU1 count = SpdHistogramLoadLDS(localInvocationIndex);
+        if (count != 0)
+            SpdHistogramAddGlobal(localInvocationIndex, count, slice);
+    }
+    SpdDeviceMemoryBarrier();
+}
+
+// Last work group: the exposure of the slice from the global histogram, which is reset for the next dispatch
+void SpdHistogramExposure(AU1 localInvocationIndex, AU1 slice)
+{
+    if (localInvocationIndex < SPD_HISTOGRAM_BINS)
+    {
+        SpdHistogramStoreLDS(localInvocationIndex, SpdHistogramLoadGlobal(localInvocationIndex, slice));
+        SpdHistogramResetGlobal(localInvocationIndex, slice);
+    }
+    SpdWorkgroupShuffleBarrier();
+    if (localInvocationIndex != 0) return;
+
+    AF2 range = SpdHistogramRange(slice);
+    AF1 total = AF1_(0.0);
+    AF1 sum = AF1_(0.0);
+    for (AU1 bin = 1; bin < SPD_HISTOGRAM_BINS; bin++)
+    {
+        AF1 count = AF1(SpdHistogramLoadLDS(bin));
+        total += count;
+        sum += count * SpdHistogramBinLog2(bin, range);
+    }
+
+    // the part of every bin between the low and the high percentile
+    AF1 low = total * AF1_(SPD_HISTOGRAM_LOW_PERCENTILE);
+    AF1 high = total * AF1_(SPD_HISTOGRAM_HIGH_PERCENTILE);
+    AF1 below = AF1_(0.0);
+    AF1 clippedCount = AF1_(0.0);
+    AF1 clippedSum = AF1_(0.0);
+    AF1 lowLog2 = range.x;
+    AF1 highLog2 = range.x;
+    for (AU1 bin = 1; bin < SPD_HISTOGRAM_BINS; bin++)
+    {
+        AF1 count = AF1(SpdHistogramLoadLDS(bin));
+        AF1 log2Luminance = SpdHistogramBinLog2(bin, range);
+        AF1 inside = clamp(below + count, low, high) - clamp(below, low, high);
+        clippedCount += inside;
+        clippedSum += inside * log2Luminance;
+        if (count > AF1_(0.0) && below <= low) lowLog2 = log2Luminance;
+        if (count > AF1_(0.0) && below < high) highLog2 = log2Luminance;
+        below += count;
+    }
+
+    if (total == AF1_(0.0))
+    {
+        SpdStoreExposure(AF4(0.0, 0.0, 0.0, 0.0), slice);
+        return;
+    }
+    AF1 average = exp2(sum / total);
+    AF1 clipped = clippedCount > AF1_(0.0) ? exp2(clippedSum / clippedCount) : exp2(lowLog2);
+    SpdStoreExposure(AF4(average, clipped, exp2(lowLog2), exp2(highLog2)), slice);
+}
+#endif // SPD_HISTOGRAM
+
+//==============================================================================================================================
+//                                                          COVERAGE
+//------------------------------------------------------------------------------------------------------------------------------
+// SPD_COVERAGE: alpha tested cutouts such as foliage and fences keep the coverage of the source in all mips. A plain average
+// shrinks the part of a mip with alpha >= the alpha reference, so distant cutouts thin out and vanish.
+// Every work group counts its source texels at or above the reference as it loads them, then reads back the texels of mips
+// 0..5 it stored into one alpha histogram per mip in the LDS, and adds both to the global bins of the slice before it
+// increases the counter. After the tail the last work group only solves a scale per mip: the histogram of the mip gives the
+// threshold with the same fraction of its texels at or above it as in the source, and the scale maps the threshold onto the
+// reference. Mips 0..5 take the global bins, the small mips 6 and up are read back twice, the second pass splits the bin of
+// the threshold into SPD_COVERAGE_BINS bins. The threshold moves up onto the next step of the stored alpha,
+// SPD_COVERAGE_ALPHA_STEP or SPD_COVERAGE_ALPHA_PRECISION, and the scale maps the middle between it and the step below onto
+// the reference, so the texels of the threshold stay at or above the reference after rounding.
+// The mips keep the plain average and are downsampled from the unscaled parents, like the bake tools do: the alpha test of a
+// mip compares alpha * scale with the reference, or a second dispatch over the same work groups rewrites the mips in place
+// with SpdCoverageApply. This replaces the binary search over the scale with one pass over the source and one readback of
+// mips 0..5, both fused into the work groups.
+//==============================================================================================================================
+#ifdef SPD_COVERAGE
+#ifndef SPD_COVERAGE_BINS
+#define SPD_COVERAGE_BINS 256
+#endif
+#ifndef SPD_COVERAGE_ALPHA_STEP
+#define SPD_COVERAGE_ALPHA_STEP 0.0
+#endif
+#ifndef SPD_COVERAGE_ALPHA_PRECISION
+#define SPD_COVERAGE_ALPHA_PRECISION (1.0 / 1048576.0)
+#endif
+// entry 0 counts the covered texels of the source, entry 1 + mip * SPD_COVERAGE_BINS + bin the histograms of mips 0..5
+#define SPD_COVERAGE_ENTRIES (1 + 6 * SPD_COVERAGE_BINS)
+
+// bin b holds the alpha around b / (SPD_COVERAGE_BINS - 1), so 256 bins hold the 8 bit UNORM alpha exactly
+AU1 SpdCoverageBin(AF1 alpha)
+{
+    return AU1(ASatF1(alpha) * AF1_(SPD_COVERAGE_BINS - 1) + AF1_(0.5));
+}
+
+void SpdCoverageClear(AU1 localInvocationIndex)
+{
+    for (AU1 i = localInvocationIndex; i < SPD_COVERAGE_ENTRIES; i += 256)
+        SpdCoverageStoreLDS(i, 0);
+    SpdWorkgroupShuffleBarrier();
+}
+
+// source texels at or above the reference, the zeros outside of the source are never counted
+void SpdCoverageAdd4(AF1 a0, AF1 a1, AF1 a2, AF1 a3, AU1 slice)
+{
+    AF1 reference = SpdAlphaReference(slice);
+    AU1 count = AU1(a0 >= reference) + AU1(a1 >= reference) + AU1(a2 >= reference) + AU1(a3 >= reference);
+    if (count != 0)
+        SpdCoverageAddLDS(0, count);
+}
+
+// Histograms of the texels of mips 0..5 the work group stored, as they read back in the format of the mips.
+void SpdCoverageTile(AU2 workGroupID, AU1 localInvocationIndex, AU1 mips, AU1 slice)
+{
+    // the stores of all invocations are visible
+    SpdDeviceMemoryBarrier();
+    AU2 size = SpdCoverageSize(slice);
+    for (AU1 mip = 0; mip < min(mips, AU1(6)); mip++)
+    {
+        AU1 tile = AU1(32) >> mip;
+        AU2 mipSize = max(size >> AU2(mip + 1, mip + 1), AU2(1, 1));
+        for (AU1 i = localInvocationIndex; i < tile * tile; i += 256)
+        {
+            AU2 pix = workGroupID * tile + AU2(i % tile, i / tile);
+            // the texels past the edge of the mip are not stored
+            if (pix.x < mipSize.x && pix.y < mipSize.y)
+                SpdCoverageAddLDS(1 + mip * SPD_COVERAGE_BINS + SpdCoverageBin(SpdLoadMip(ASU2(pix), mip, slice).a), 1);
+        }
+    }
+}
+
+// Adds the counts of the work group to the global ones, before the work group increases the counter.
+void SpdCoverageMerge(AU1 localInvocationIndex, AU1 slice)
+{
+    SpdWorkgroupShuffleBarrier();
+    for (AU1 i = localInvocationIndex; i < SPD_COVERAGE_ENTRIES; i += 256)
+    {
+        AU1 count = SpdCoverageLoadLDS(i);
+        if (count != 0)
+            SpdCoverageAddGlobal(i, count, slice);
+    }
+    SpdDeviceMemoryBarrier();
+}
+
+// bin of the second pass over bin parent, which is split into SPD_COVERAGE_BINS bins
+AU1 SpdCoverageSubBin(AF1 alpha, AU1 parent)
+{
+    return min(AU1(ASatF1(alpha * AF1_(SPD_COVERAGE_BINS - 1) - AF1(parent) + AF1_(0.5)) * AF1_(SPD_COVERAGE_BINS)), AU1(SPD_COVERAGE_BINS - 1));
+}
+
+// Histogram of a mip in the LDS entries 1..SPD_COVERAGE_BINS of the last work group: the global bins of mips 0..5, a readback
+// of the mips 6 and up of the tail. parent SPD_COVERAGE_BINS is the first pass, otherwise the second pass over the small mips
+// splits bin parent of the first pass and skips the other texels.
+void SpdCoverageHistogram(AU1 localInvocationIndex, AU2 mipSize, AU1 mip, AU1 slice, AU1 parent)
+{
+    // the previous histogram is no longer read, the mips of the tail are visible to all invocations
+    SpdDeviceMemoryBarrier();
+    for (AU1 bin = localInvocationIndex; bin < SPD_COVERAGE_BINS; bin += 256)
+        SpdCoverageStoreLDS(1 + bin, mip < 6 ? SpdCoverageLoadGlobal(1 + mip * SPD_COVERAGE_BINS + bin, slice) : 0);
+    SpdWorkgroupShuffleBarrier();
+    if (mip < 6)
+        return;
+    for (AU1 i = localInvocationIndex; i < mipSize.x * mipSize.y; i += 256)
+    {
+        AF1 alpha = SpdLoadMip(ASU2(i % mipSize.x, i / mipSize.x), mip, slice).a;
+        if (parent == SPD_COVERAGE_BINS)
+            SpdCoverageAddLDS(1 + SpdCoverageBin(alpha), 1);
+        else if (SpdCoverageBin(alpha) == parent)
+            SpdCoverageAddLDS(1 + SpdCoverageSubBin(alpha, parent), 1);
+    }
+    SpdWorkgroupShuffleBarrier();
+}
+
+// Scale that maps threshold onto the reference. The threshold moves up onto the next step of the stored alpha, the float error
+// of a threshold on a step does not move it, then the middle between it and the step below maps onto the reference. The step
+// of float mips is the one of their precision at the threshold.
+AF1 SpdCoverageAlphaScale(AF1 threshold, AF1 reference)
+{
+    AF1 step = AF1_(SPD_COVERAGE_ALPHA_STEP);
+    if (step > AF1_(0.0))
+        threshold = ceil(threshold / step - AF1_(1.0 / 64.0)) * step;
+    AF1 half = max(step, threshold * AF1_(SPD_COVERAGE_ALPHA_PRECISION)) * AF1_(0.5);
+    return reference / max(threshold - half, AF1_(0.5 / (SPD_COVERAGE_BINS * SPD_COVERAGE_BINS)));
+}
+
+// Scans the histogram in the LDS from the top: the bin in which the texels at and above it reach target, above counts the
+// texels of the bins above it.
+AU1 SpdCoverageFind(AF1 target, inout AF1 above)
+{
+    for (AU1 bin = SPD_COVERAGE_BINS; bin > 0; bin--)
+    {
+        AF1 count = AF1(SpdCoverageLoadLDS(bin));
+        if (above + count >= target)
+            return bin - 1;
+        above += count;
+    }
+    return 0;
+}
+
+// Alpha with target texels at or above it, from the histogram of the first pass or the second pass over bin parent.
+AF1 SpdCoverageThreshold(AF1 target, AF1 above, AU1 parent)
+{
+    AU1 bin = SpdCoverageFind(target, above);
+    // the texels of a bin are spread evenly over it
+    AF1 count = max(AF1(SpdCoverageLoadLDS(1 + bin)), AF1_(1.0));
+    AF1 position = AF1(bin + 1) - (target - above) / count;
+    if (parent < SPD_COVERAGE_BINS)
+        position = AF1(parent) + position * AF1_(1.0 / SPD_COVERAGE_BINS);
+    // bin b holds the alpha from b - 0.5 to b + 0.5 steps of 1 / (SPD_COVERAGE_BINS - 1)
+    return (position - AF1_(0.5)) * AF1_(1.0 / (SPD_COVERAGE_BINS - 1));
+}
+
+// Scale of a mip, from its histogram of the first pass, the small mips of the tail are read back once more to split the bin
+// of the threshold.
+AF1 SpdCoverageSolve(AU1 localInvocationIndex, AU2 mipSize, AU1 mip, AU1 slice, AF1 target, AF1 reference)
+{
+    SpdCoverageHistogram(localInvocationIndex, mipSize, mip, slice, SPD_COVERAGE_BINS);
+    AF1 above = AF1_(0.0);
+    AU1 parent = SPD_COVERAGE_BINS;
+    // not if every bin holds at most one step of the stored alpha, like 256 bins of 8 bit UNORM
+    if (mip >= 6 && AF1_(SPD_COVERAGE_ALPHA_STEP) * AF1_(SPD_COVERAGE_BINS - 1) < AF1_(0.5))
+    {
+        parent = SpdCoverageFind(target, above);
+        SpdCoverageHistogram(localInvocationIndex, mipSize, mip, slice, parent);
     }
+    return SpdCoverageAlphaScale(SpdCoverageThreshold(target, above, parent), reference);
+}
+
+// Last work group, after the scales: the global counts are no longer read and are reset for the next dispatch.
+void SpdCoverageReset(AU1 localInvocationIndex, AU1 slice)
+{
     SpdWorkgroupShuffleBarrier();
-    return (SpdGetAtomicCounter() != (numWorkGroups - 1));
+    for (AU1 i = localInvocationIndex; i < SPD_COVERAGE_ENTRIES; i += 256)
+        SpdCoverageResetGlobal(i, slice);
+}
+
+// Last work group, after the tail: the scale of every mip.
+void SpdCoverageScale(AU1 localInvocationIndex, AU1 mips, AU1 slice)
+{
+    AU2 size = SpdCoverageSize(slice);
+    AF1 reference = SpdAlphaReference(slice);
+    AF1 coverage = AF1(SpdCoverageLoadGlobal(0, slice)) / AF1(size.x * size.y);
+    for (AU1 mip = 0; mip < mips; mip++)
+    {
+        AU2 mipSize = max(size >> AU2(mip + 1, mip + 1), AU2(1, 1));
+        AF1 target = coverage * AF1(mipSize.x * mipSize.y);
+        AF1 scale = AF1_(1.0);
+        // no texel of the source passes, neither does an average of them
+        if (target > AF1_(0.0))
+            scale = SpdCoverageSolve(localInvocationIndex, mipSize, mip, slice, target, reference);
+        if (localInvocationIndex == 0)
+            SpdStoreAlphaScale(scale, mip, slice);
+    }
+    SpdCoverageReset(localInvocationIndex, slice);
+}
+
+// Second dispatch over the same work groups, after the first one: rewrites the alpha of the texels of mips 0..5 of the work
+// group with the scales, work group (0, 0) also the mips 6 and up. Every texel is read and written by one invocation.
+void SpdCoverageApply(AU2 workGroupID, AU1 localInvocationIndex, AU1 mips, AU1 slice)
+{
+    AU2 size = SpdCoverageSize(slice);
+    for (AU1 mip = 0; mip < mips; mip++)
+    {
+        AU2 mipSize = max(size >> AU2(mip + 1, mip + 1), AU2(1, 1));
+        if (mip >= 6 && (workGroupID.x | workGroupID.y) != 0)
+            return;
+        AU2 tile = mip < 6 ? AU2(AU1(32) >> mip, AU1(32) >> mip) : mipSize;
+        AF1 scale = SpdLoadAlphaScale(mip, slice);
+        for (AU1 i = localInvocationIndex; i < tile.x * tile.y; i += 256)
+        {
+            AU2 pix = workGroupID * tile + AU2(i % tile.x, i / tile.x);
+            if (pix.x < mipSize.x && pix.y < mipSize.y)
+            {
+                AF4 v = SpdLoadMip(ASU2(pix), mip, slice);
+                SpdStore(ASU2(pix), AF4(v.rgb, min(v.a * scale, AF1_(1.0))), mip, slice);
+            }
+        }
+    }
 }
+#endif // SPD_COVERAGE
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+#if !defined(SPD_DEPTH) && !defined(SPD_FILTER)
 // User defined: AF4 DSReduce4(AF4 v0, AF4 v1, AF4 v2, AF4 v3);
 
 AF4 SpdReduceQuad(AF4 v)
 {
-    #if defined(A_GLSL) && !defined(SPD_NO_WAVE_OPERATIONS)
+    #if defined(SPD_REDUCTION_PAIRWISE) && defined(A_GLSL) && !defined(SPD_NO_WAVE_OPERATIONS)
+    v = SpdReducePair(v, subgroupQuadSwapHorizontal(v));
+    return SpdReducePair(v, subgroupQuadSwapVertical(v));
+    #elif defined(SPD_REDUCTION_PAIRWISE) && defined(A_HLSL) && !defined(SPD_NO_WAVE_OPERATIONS)
+    v = SpdReducePair(v, WaveReadLaneAt(v, WaveGetLaneIndex() ^ 1));
+    return SpdReducePair(v, WaveReadLaneAt(v, WaveGetLaneIndex() ^ 2));
+    #elif defined(A_GLSL) && !defined(SPD_NO_WAVE_OPERATIONS)
     AF4 v0 = v;
     AF4 v1 = subgroupQuadSwapHorizontal(v);
     AF4 v2 = subgroupQuadSwapVertical(v);
@@ -349,6 +1130,36 @@ AF4 SpdReduceQuad(AF4 v)
     return AF4_x(0.0);
 }
 
+#if defined(SPD_WAVE_SHUFFLE) && !defined(SPD_NO_WAVE_OPERATIONS)
+// Same as SpdReduceQuad on the lanes base, base | dx, base | dy and base | dx | dy of the wave, base = lane & ~(dx | dy).
+// The result is the one of lane base.
+AF4 SpdReduceLanes(AF4 v, AU1 dx, AU1 dy)
+{
+    #if defined(SPD_REDUCTION_PAIRWISE) && defined(A_GLSL)
+    v = SpdReducePair(v, subgroupShuffleXor(v, dx));
+    return SpdReducePair(v, subgroupShuffleXor(v, dy));
+    #elif defined(SPD_REDUCTION_PAIRWISE) && defined(A_HLSL)
+    v = SpdReducePair(v, WaveReadLaneAt(v, WaveGetLaneIndex() ^ dx));
+    return SpdReducePair(v, WaveReadLaneAt(v, WaveGetLaneIndex() ^ dy));
+    #elif defined(A_GLSL)
+    AU1 base = gl_SubgroupInvocationID & ~(dx | dy);
+    AF4 v0 = v;
+    AF4 v1 = subgroupShuffle(v, base | dx);
+    AF4 v2 = subgroupShuffle(v, base | dy);
+    AF4 v3 = subgroupShuffle(v, base | dx | dy);
+    return SpdReduce4(v0, v1, v2, v3);
+    #elif defined(A_HLSL)
+    AU1 base = WaveGetLaneIndex() & ~(dx | dy);
+    AF4 v0 = v;
+    AF4 v1 = WaveReadLaneAt(v, base | dx);
+    AF4 v2 = WaveReadLaneAt(v, base | dy);
+    AF4 v3 = WaveReadLaneAt(v, base | dx | dy);
+    return SpdReduce4(v0, v1, v2, v3);
+    #endif
+    return AF4_x(0.0);
+}
+#endif
+
 AF4 SpdReduceIntermediate(AU2 i0, AU2 i1, AU2 i2, AU2 i3)
 {
     AF4 v0 = SpdLoadIntermediate(i0.x, i0.y);
@@ -358,69 +1169,91 @@ AF4 SpdReduceIntermediate(AU2 i0, AU2 i1, AU2 i2, AU2 i3)
     return SpdReduce4(v0, v1, v2, v3);
 }
 
-AF4 SpdReduceLoad4(AU2 i0, AU2 i1, AU2 i2, AU2 i3)
+#ifdef SPD_RESIDENCY
+// texel p of mip 5 is the one of tile p, it was not written if the tile is not resident
+AF4 SpdLoadResident(ASU2 p, AU1 slice)
+{
+    if (SpdTileResident(AU2(p), slice) == 0) return SpdResidencyFill(slice);
+    return SpdLoad(p, slice);
+}
+#endif
+
+AF4 SpdReduceLoad4(AU2 i0, AU2 i1, AU2 i2, AU2 i3, AU1 slice)
 {
-    AF4 v0 = SpdLoad(ASU2(i0));
-    AF4 v1 = SpdLoad(ASU2(i1));
-    AF4 v2 = SpdLoad(ASU2(i2));
-    AF4 v3 = SpdLoad(ASU2(i3));
+#ifdef SPD_RESIDENCY
+    AF4 v0 = SpdLoadResident(ASU2(i0), slice);
+    AF4 v1 = SpdLoadResident(ASU2(i1), slice);
+    AF4 v2 = SpdLoadResident(ASU2(i2), slice);
+    AF4 v3 = SpdLoadResident(ASU2(i3), slice);
+#else
+    AF4 v0 = SpdLoad(ASU2(i0), slice);
+    AF4 v1 = SpdLoad(ASU2(i1), slice);
+    AF4 v2 = SpdLoad(ASU2(i2), slice);
+    AF4 v3 = SpdLoad(ASU2(i3), slice);
+#endif
     return SpdReduce4(v0, v1, v2, v3);
 }
 
-AF4 SpdReduceLoad4(AU2 base)
+AF4 SpdReduceLoad4(AU2 base, AU1 slice)
 {
     return SpdReduceLoad4(
         AU2(base + AU2(0, 0)),
         AU2(base + AU2(0, 1)), 
         AU2(base + AU2(1, 0)), 
-        AU2(base + AU2(1, 1)));
+        AU2(base + AU2(1, 1)), slice);
 }
 
-AF4 SpdReduceLoadSourceImage4(AU2 i0, AU2 i1, AU2 i2, AU2 i3)
+AF4 SpdReduceLoadSourceImage4(AU2 i0, AU2 i1, AU2 i2, AU2 i3, AU1 slice)
 {
-    AF4 v0 = SpdLoadSourceImage(ASU2(i0));
-    AF4 v1 = SpdLoadSourceImage(ASU2(i1));
-    AF4 v2 = SpdLoadSourceImage(ASU2(i2));
-    AF4 v3 = SpdLoadSourceImage(ASU2(i3));
+    AF4 v0 = SpdLoadSourceImage(ASU2(i0), slice);
+    AF4 v1 = SpdLoadSourceImage(ASU2(i1), slice);
+    AF4 v2 = SpdLoadSourceImage(ASU2(i2), slice);
+    AF4 v3 = SpdLoadSourceImage(ASU2(i3), slice);
+#ifdef SPD_COVERAGE
+    SpdCoverageAdd4(v0.a, v1.a, v2.a, v3.a, slice);
+#endif
     return SpdReduce4(v0, v1, v2, v3);
 }
 
-AF4 SpdReduceLoadSourceImage4(AU2 base)
+AF4 SpdReduceLoadSourceImage4(AU2 base, AU1 slice)
 {
 #ifdef SPD_LINEAR_SAMPLER
-    return SpdLoadSourceImage(ASU2(base));
+    return SpdLoadSourceImage(ASU2(base), slice);
 #else
     return SpdReduceLoadSourceImage4(
         AU2(base + AU2(0, 0)),
         AU2(base + AU2(0, 1)), 
         AU2(base + AU2(1, 0)), 
-        AU2(base + AU2(1, 1)));
+        AU2(base + AU2(1, 1)), slice);
 #endif
 }
 
-void SpdDownsampleMips_0_1_Intrinsics(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mip)
+void SpdDownsampleMips_0_1_Intrinsics(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mip, AU1 slice)
 {
     AF4 v[4];
 
     ASU2 tex = ASU2(workGroupID.xy * 64) + ASU2(x * 2, y * 2);
     ASU2 pix = ASU2(workGroupID.xy * 32) + ASU2(x, y);
-    v[0] = SpdReduceLoadSourceImage4(tex);
-    SpdStore(pix, v[0], 0);
+    v[0] = SpdReduceLoadSourceImage4(tex, slice);
+    SpdStore(pix, v[0], 0, slice);
 
     tex = ASU2(workGroupID.xy * 64) + ASU2(x * 2 + 32, y * 2);
     pix = ASU2(workGroupID.xy * 32) + ASU2(x + 16, y);
-    v[1] = SpdReduceLoadSourceImage4(tex);
-    SpdStore(pix, v[1], 0);
+    v[1] = SpdReduceLoadSourceImage4(tex, slice);
+    SpdStore(pix, v[1], 0, slice);
     
     tex = ASU2(workGroupID.xy * 64) + ASU2(x * 2, y * 2 + 32);
     pix = ASU2(workGroupID.xy * 32) + ASU2(x, y + 16);
-    v[2] = SpdReduceLoadSourceImage4(tex);
-    SpdStore(pix, v[2], 0);
+    v[2] = SpdReduceLoadSourceImage4(tex, slice);
+    SpdStore(pix, v[2], 0, slice);
     
     tex = ASU2(workGroupID.xy * 64) + ASU2(x * 2 + 32, y * 2 + 32);
     pix = ASU2(workGroupID.xy * 32) + ASU2(x + 16, y + 16);
-    v[3] = SpdReduceLoadSourceImage4(tex);
-    SpdStore(pix, v[3], 0);
+    v[3] = SpdReduceLoadSourceImage4(tex, slice);
+    SpdStore(pix, v[3], 0, slice);
+#ifdef SPD_HISTOGRAM
+    SpdHistogramAdd4(v[0], v[1], v[2], v[3], ASU2(workGroupID.xy * 32) + ASU2(x, y), slice);
+#endif
 
     if (mip <= 1)
         return;
@@ -433,50 +1266,53 @@ void SpdDownsampleMips_0_1_Intrinsics(AU1 x, AU1 y, AU2 workGroupID, AU1 localIn
     if ((localInvocationIndex % 4) == 0)
     {
         SpdStore(ASU2(workGroupID.xy * 16) + 
-            ASU2(x/2, y/2), v[0], 1);
+            ASU2(x/2, y/2), v[0], 1, slice);
         SpdStoreIntermediate(
             x/2, y/2, v[0]);
 
         SpdStore(ASU2(workGroupID.xy * 16) + 
-            ASU2(x/2 + 8, y/2), v[1], 1);
+            ASU2(x/2 + 8, y/2), v[1], 1, slice);
         SpdStoreIntermediate(
             x/2 + 8, y/2, v[1]);
 
         SpdStore(ASU2(workGroupID.xy * 16) + 
-            ASU2(x/2, y/2 + 8), v[2], 1);
+            ASU2(x/2, y/2 + 8), v[2], 1, slice);
         SpdStoreIntermediate(
             x/2, y/2 + 8, v[2]);
 
         SpdStore(ASU2(workGroupID.xy * 16) + 
-            ASU2(x/2 + 8, y/2 + 8), v[3], 1);
+            ASU2(x/2 + 8, y/2 + 8), v[3], 1, slice);
         SpdStoreIntermediate(
             x/2 + 8, y/2 + 8, v[3]);
     }
 }
 
-void SpdDownsampleMips_0_1_LDS(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mip) 
+void SpdDownsampleMips_0_1_LDS(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mip, AU1 slice) 
 {
     AF4 v[4];
 
     ASU2 tex = ASU2(workGroupID.xy * 64) + ASU2(x * 2, y * 2);
     ASU2 pix = ASU2(workGroupID.xy * 32) + ASU2(x, y);
-    v[0] = SpdReduceLoadSourceImage4(tex);
-    SpdStore(pix, v[0], 0);
+    v[0] = SpdReduceLoadSourceImage4(tex, slice);
+    SpdStore(pix, v[0], 0, slice);
 
     tex = ASU2(workGroupID.xy * 64) + ASU2(x * 2 + 32, y * 2);
     pix = ASU2(workGroupID.xy * 32) + ASU2(x + 16, y);
-    v[1] = SpdReduceLoadSourceImage4(tex);
-    SpdStore(pix, v[1], 0);
+    v[1] = SpdReduceLoadSourceImage4(tex, slice);
+    SpdStore(pix, v[1], 0, slice);
     
     tex = ASU2(workGroupID.xy * 64) + ASU2(x * 2, y * 2 + 32);
     pix = ASU2(workGroupID.xy * 32) + ASU2(x, y + 16);
-    v[2] = SpdReduceLoadSourceImage4(tex);
-    SpdStore(pix, v[2], 0);
+    v[2] = SpdReduceLoadSourceImage4(tex, slice);
+    SpdStore(pix, v[2], 0, slice);
     
     tex = ASU2(workGroupID.xy * 64) + ASU2(x * 2 + 32, y * 2 + 32);
     pix = ASU2(workGroupID.xy * 32) + ASU2(x + 16, y + 16);
-    v[3] = SpdReduceLoadSourceImage4(tex);
-    SpdStore(pix, v[3], 0);
+    v[3] = SpdReduceLoadSourceImage4(tex, slice);
+    SpdStore(pix, v[3], 0, slice);
+#ifdef SPD_HISTOGRAM
+    SpdHistogramAdd4(v[0], v[1], v[2], v[3], ASU2(workGroupID.xy * 32) + ASU2(x, y), slice);
+#endif
 
     if (mip <= 1)
         return;
@@ -493,7 +1329,7 @@ void SpdDownsampleMips_0_1_LDS(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocatio
                 AU2(x * 2 + 0, y * 2 + 1),
                 AU2(x * 2 + 1, y * 2 + 1)
             );
-            SpdStore(ASU2(workGroupID.xy * 16) + ASU2(x + (i % 2) * 8, y + (i / 2) * 8), v[i], 1);
+            SpdStore(ASU2(workGroupID.xy * 16) + ASU2(x + (i % 2) * 8, y + (i / 2) * 8), v[i], 1, slice);
         }
         SpdWorkgroupShuffleBarrier();
     }
@@ -507,17 +1343,17 @@ void SpdDownsampleMips_0_1_LDS(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocatio
     }
 }
 
-void SpdDownsampleMips_0_1(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mip) 
+void SpdDownsampleMips_0_1(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mip, AU1 slice) 
 {
 #ifdef SPD_NO_WAVE_OPERATIONS
-    SpdDownsampleMips_0_1_LDS(x, y, workGroupID, localInvocationIndex, mip);
+    SpdDownsampleMips_0_1_LDS(x, y, workGroupID, localInvocationIndex, mip, slice);
 #else
-    SpdDownsampleMips_0_1_Intrinsics(x, y, workGroupID, localInvocationIndex, mip);
+    SpdDownsampleMips_0_1_Intrinsics(x, y, workGroupID, localInvocationIndex, mip, slice);
 #endif
 }
 
 
-void SpdDownsampleMip_2(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mip)
+void SpdDownsampleMip_2(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mip, AU1 slice)
 {
 #ifdef SPD_NO_WAVE_OPERATIONS
     if (localInvocationIndex < 64)
@@ -528,7 +1364,7 @@ void SpdDownsampleMip_2(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex,
             AU2(x * 2 + 0 + 0, y * 2 + 1),
             AU2(x * 2 + 0 + 1, y * 2 + 1)
         );
-        SpdStore(ASU2(workGroupID.xy * 8) + ASU2(x, y), v, mip);
+        SpdStore(ASU2(workGroupID.xy * 8) + ASU2(x, y), v, mip, slice);
         // store to LDS, try to reduce bank conflicts
         // x 0 x 0 x 0 x 0 x 0 x 0 x 0 x 0
         // 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0
@@ -545,13 +1381,13 @@ void SpdDownsampleMip_2(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex,
     // quad index 0 stores result
     if (localInvocationIndex % 4 == 0)
     {
-        SpdStore(ASU2(workGroupID.xy * 8) + ASU2(x/2, y/2), v, mip);
+        SpdStore(ASU2(workGroupID.xy * 8) + ASU2(x/2, y/2), v, mip, slice);
         SpdStoreIntermediate(x + (y/2) % 2, y, v);
     }
 #endif
 }
 
-void SpdDownsampleMip_3(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mip)
+void SpdDownsampleMip_3(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mip, AU1 slice)
 {
 #ifdef SPD_NO_WAVE_OPERATIONS
     if (localInvocationIndex < 16)
@@ -566,7 +1402,7 @@ void SpdDownsampleMip_3(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex,
             AU2(x * 4 + 0 + 1, y * 4 + 2),
             AU2(x * 4 + 2 + 1, y * 4 + 2)
         );
-        SpdStore(ASU2(workGroupID.xy * 4) + ASU2(x, y), v, mip);
+        SpdStore(ASU2(workGroupID.xy * 4) + ASU2(x, y), v, mip, slice);
         // store to LDS
         // x 0 0 0 x 0 0 0 x 0 0 0 x 0 0 0
         // 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0
@@ -588,14 +1424,14 @@ void SpdDownsampleMip_3(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex,
         // quad index 0 stores result
         if (localInvocationIndex % 4 == 0)
         {   
-            SpdStore(ASU2(workGroupID.xy * 4) + ASU2(x/2, y/2), v, mip);
+            SpdStore(ASU2(workGroupID.xy * 4) + ASU2(x/2, y/2), v, mip, slice);
             SpdStoreIntermediate(x * 2 + y/2, y * 2, v);
         }
     }
 #endif
 }
 
-void SpdDownsampleMip_4(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mip)
+void SpdDownsampleMip_4(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mip, AU1 slice)
 {
 #ifdef SPD_NO_WAVE_OPERATIONS
     if (localInvocationIndex < 4)
@@ -609,7 +1445,7 @@ void SpdDownsampleMip_4(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex,
             AU2(x * 8 + 0 + 1 + y * 2, y * 8 + 4),
             AU2(x * 8 + 4 + 1 + y * 2, y * 8 + 4)
         );
-        SpdStore(ASU2(workGroupID.xy * 2) + ASU2(x, y), v, mip);
+        SpdStore(ASU2(workGroupID.xy * 2) + ASU2(x, y), v, mip, slice);
         // store to LDS
         // x x x x 0 ...
         // 0 ...
@@ -623,14 +1459,14 @@ void SpdDownsampleMip_4(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex,
         // quad index 0 stores result
         if (localInvocationIndex % 4 == 0)
         {   
-            SpdStore(ASU2(workGroupID.xy * 2) + ASU2(x/2, y/2), v, mip);
+            SpdStore(ASU2(workGroupID.xy * 2) + ASU2(x/2, y/2), v, mip, slice);
             SpdStoreIntermediate(x / 2 + y, 0, v);
         }
     }
 #endif
 }
 
-void SpdDownsampleMip_5(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mip)
+void SpdDownsampleMip_5(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mip, AU1 slice)
 {
 #ifdef SPD_NO_WAVE_OPERATIONS
     if (localInvocationIndex < 1)
@@ -643,7 +1479,7 @@ void SpdDownsampleMip_5(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex,
             AU2(2, 0),
             AU2(3, 0)
         );
-        SpdStore(ASU2(workGroupID.xy), v, mip);
+        SpdStore(ASU2(workGroupID.xy), v, mip, slice);
     }
 #else
     if (localInvocationIndex < 4)
@@ -653,83 +1489,822 @@ void SpdDownsampleMip_5(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex,
         // quad index 0 stores result
         if (localInvocationIndex % 4 == 0)
         {   
-            SpdStore(ASU2(workGroupID.xy), v, mip);
+            SpdStore(ASU2(workGroupID.xy), v, mip, slice);
         }
     }
 #endif
 }
 
-void SpdDownsampleMips_6_7(AU1 x, AU1 y, AU1 mips)
+void SpdDownsampleMips_6_7(AU1 x, AU1 y, AU1 mips, AU1 slice)
 {
     ASU2 tex = ASU2(x * 4 + 0, y * 4 + 0);
     ASU2 pix = ASU2(x * 2 + 0, y * 2 + 0);
-    AF4 v0 = SpdReduceLoad4(tex);
-    SpdStore(pix, v0, 6);
+    AF4 v0 = SpdReduceLoad4(tex, slice);
+    SpdStore(pix, v0, 6, slice);
 
     tex = ASU2(x * 4 + 2, y * 4 + 0);
     pix = ASU2(x * 2 + 1, y * 2 + 0);
-    AF4 v1 = SpdReduceLoad4(tex);
-    SpdStore(pix, v1, 6);
+    AF4 v1 = SpdReduceLoad4(tex, slice);
+    SpdStore(pix, v1, 6, slice);
 
     tex = ASU2(x * 4 + 0, y * 4 + 2);
     pix = ASU2(x * 2 + 0, y * 2 + 1);
-    AF4 v2 = SpdReduceLoad4(tex);
-    SpdStore(pix, v2, 6);
+    AF4 v2 = SpdReduceLoad4(tex, slice);
+    SpdStore(pix, v2, 6, slice);
 
     tex = ASU2(x * 4 + 2, y * 4 + 2);
     pix = ASU2(x * 2 + 1, y * 2 + 1);
-    AF4 v3 = SpdReduceLoad4(tex);
-    SpdStore(pix, v3, 6);
+    AF4 v3 = SpdReduceLoad4(tex, slice);
+    SpdStore(pix, v3, 6, slice);
 
     if (mips <= 7) return;
     // no barrier needed, working on values only from the same thread
 
     AF4 v = SpdReduce4(v0, v1, v2, v3);
-    SpdStore(ASU2(x, y), v, 7);
+    SpdStore(ASU2(x, y), v, 7, slice);
     SpdStoreIntermediate(x, y, v);
 }
 
-void SpdDownsampleNextFour(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 baseMip, AU1 mips)
+#if defined(SPD_WAVE_SHUFFLE) && !defined(SPD_NO_WAVE_OPERATIONS)
+// Mips baseMip..baseMip + 3 from the 16x16 intermediate, after the barrier of SpdDownsampleNextFour.
+// Invocation (x, y) holds texel (x, y) of the intermediate, lane bits 0 and 3 are bits 0 and 1 of x, lane bits 1 and 2
+// bits 0 and 1 of y, lane bit 4 is bit 2 of x and lane bit 5 bit 2 of y (ARmpRed8x8). So each 2x2 reduction combines the
+// lanes at the distances 1 and 2, then 8 and 4, then 16 and 32, then 64 and 128. A wave of 16 lanes covers the first two,
+// a wave of 64 lanes the first three. Only the reduction that crosses waves goes through LDS. Every wave stores into the
+// texels of the intermediate that it has read itself, so no barrier is needed before the stores.
+void SpdDownsampleNextFourWave(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 baseMip, AU1 mips, AU1 slice)
+{
+    AF4 v = SpdLoadIntermediate(x, y);
+    v = SpdReduceQuad(v);
+    if (localInvocationIndex % 4 == 0)
+    {
+        SpdStore(ASU2(workGroupID.xy * 8) + ASU2(x/2, y/2), v, baseMip, slice);
+    }
+
+    if (mips <= baseMip + 1) return;
+    v = SpdReduceLanes(v, 8u, 4u);
+    if (localInvocationIndex % 16 == 0)
+    {
+        SpdStore(ASU2(workGroupID.xy * 4) + ASU2(x/4, y/4), v, baseMip + 1, slice);
+    }
+
+    if (mips <= baseMip + 2) return;
+    if (SpdWaveSize() >= 64)
+    {
+        v = SpdReduceLanes(v, 16u, 32u);
+        if (localInvocationIndex % 64 == 0)
+        {
+            SpdStore(ASU2(workGroupID.xy * 2) + ASU2(x/8, y/8), v, baseMip + 2, slice);
+            SpdStoreIntermediate(x, y, v);
+        }
+
+        if (mips <= baseMip + 3) return;
+        SpdWorkgroupShuffleBarrier();
+        if (localInvocationIndex < 4)
+        {
+            // lanes 0..3 are (0, 0), (1, 0), (0, 1), (1, 1)
+            v = SpdLoadIntermediate(x * 8, y * 8);
+            v = SpdReduceQuad(v);
+            if (localInvocationIndex == 0)
+            {
+                SpdStore(ASU2(workGroupID.xy), v, baseMip + 3, slice);
+            }
+        }
+    }
+    else
+    {
+        if (localInvocationIndex % 16 == 0)
+        {
+            SpdStoreIntermediate(x, y, v);
+        }
+
+        SpdWorkgroupShuffleBarrier();
+        if (localInvocationIndex < 16)
+        {
+            // texel (x, y) of mip baseMip + 1 is at (x * 4, y * 4)
+            v = SpdLoadIntermediate(x * 4, y * 4);
+            v = SpdReduceQuad(v);
+            if (localInvocationIndex % 4 == 0)
+            {
+                SpdStore(ASU2(workGroupID.xy * 2) + ASU2(x/2, y/2), v, baseMip + 2, slice);
+            }
+
+            if (mips > baseMip + 3)
+            {
+                v = SpdReduceLanes(v, 8u, 4u);
+                if (localInvocationIndex == 0)
+                {
+                    SpdStore(ASU2(workGroupID.xy), v, baseMip + 3, slice);
+                }
+            }
+        }
+    }
+}
+#endif
+
+void SpdDownsampleNextFour(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 baseMip, AU1 mips, AU1 slice)
 {
     if (mips <= baseMip) return;
     SpdWorkgroupShuffleBarrier();
-    SpdDownsampleMip_2(x, y, workGroupID, localInvocationIndex, baseMip);
+#if defined(SPD_WAVE_SHUFFLE) && !defined(SPD_NO_WAVE_OPERATIONS)
+    if (SpdWaveSize() >= 16)
+    {
+        SpdDownsampleNextFourWave(x, y, workGroupID, localInvocationIndex, baseMip, mips, slice);
+        return;
+    }
+#endif
+    SpdDownsampleMip_2(x, y, workGroupID, localInvocationIndex, baseMip, slice);
 
     if (mips <= baseMip + 1) return;
     SpdWorkgroupShuffleBarrier();
-    SpdDownsampleMip_3(x, y, workGroupID, localInvocationIndex, baseMip + 1);
+    SpdDownsampleMip_3(x, y, workGroupID, localInvocationIndex, baseMip + 1, slice);
 
     if (mips <= baseMip + 2) return;
     SpdWorkgroupShuffleBarrier();
-    SpdDownsampleMip_4(x, y, workGroupID, localInvocationIndex, baseMip + 2);
+    SpdDownsampleMip_4(x, y, workGroupID, localInvocationIndex, baseMip + 2, slice);
 
     if (mips <= baseMip + 3) return;
     SpdWorkgroupShuffleBarrier();
-    SpdDownsampleMip_5(x, y, workGroupID, localInvocationIndex, baseMip + 3);
+    SpdDownsampleMip_5(x, y, workGroupID, localInvocationIndex, baseMip + 3, slice);
 }
 
 void SpdDownsample(
     AU2 workGroupID,
     AU1 localInvocationIndex,
     AU1 mips,
-    AU1 numWorkGroups
+    AU1 numWorkGroups,
+    AU1 slice
 ) {
     AU2 sub_xy = ARmpRed8x8(localInvocationIndex % 64);
     AU1 x = sub_xy.x + 8 * ((localInvocationIndex >> 6) % 2);
     AU1 y = sub_xy.y + 8 * ((localInvocationIndex >> 7));
-    SpdDownsampleMips_0_1(x, y, workGroupID, localInvocationIndex, mips);
+#ifdef SPD_HISTOGRAM
+    SpdHistogramClear(localInvocationIndex);
+#endif
+#ifdef SPD_COVERAGE
+    SpdCoverageClear(localInvocationIndex);
+#endif
+#ifdef SPD_RESIDENCY
+    // a tile that is not resident is neither read nor written, it only counts for the last work group
+    if (SpdTileResident(workGroupID, slice) != 0)
+#endif
+    {
+        SpdDownsampleMips_0_1(x, y, workGroupID, localInvocationIndex, mips, slice);
+
+        SpdDownsampleNextFour(x, y, workGroupID, localInvocationIndex, 2, mips, slice);
+#ifdef SPD_COVERAGE
+        SpdCoverageTile(workGroupID, localInvocationIndex, mips, slice);
+#endif
+    }
+
+#if defined(SPD_HISTOGRAM) || defined(SPD_COVERAGE)
+    // the exposure and the alpha scales need the last work group for any number of mips
+#ifdef SPD_HISTOGRAM
+    SpdHistogramMerge(localInvocationIndex, slice);
+#endif
+#ifdef SPD_COVERAGE
+    SpdCoverageMerge(localInvocationIndex, slice);
+#endif
 
-    SpdDownsampleNextFour(x, y, workGroupID, localInvocationIndex, 2, mips);
+    if (SpdExitWorkgroup(numWorkGroups, localInvocationIndex, slice)) return;
 
+#ifdef SPD_HISTOGRAM
+    SpdHistogramExposure(localInvocationIndex, slice);
+#endif
+#else
     if (mips <= 6) return;
 
-    if (SpdExitWorkgroup(numWorkGroups, localInvocationIndex)) return;
+    if (SpdExitWorkgroup(numWorkGroups, localInvocationIndex, slice)) return;
+#endif
 
-    // After mip 6 there is only a single workgroup left that downsamples the remaining up to 64x64 texels.
-    SpdDownsampleMips_6_7(x, y, mips);
+    if (mips > 6)
+    {
+        // After mip 6 there is only a single workgroup left that downsamples the remaining up to 64x64 texels.
+        SpdDownsampleMips_6_7(x, y, mips, slice);
 
-    SpdDownsampleNextFour(x, y, AU2(0,0), localInvocationIndex, 8, mips);
-}
+        SpdDownsampleNextFour(x, y, AU2(0,0), localInvocationIndex, 8, mips, slice);
+    }
+
+#ifdef SPD_COVERAGE
+    SpdCoverageScale(localInvocationIndex, mips, slice);
+#endif
+}
+
+// Sub-rectangle, see [RECT]: workGroupID counts from 0 in the dispatch of SpdSetup, workGroupOffset is the one of SpdSetup.
+void SpdDownsample(
+    AU2 workGroupID,
+    AU1 localInvocationIndex,
+    AU1 mips,
+    AU1 numWorkGroups,
+    AU1 slice,
+    AU2 workGroupOffset
+) {
+    SpdDownsample(workGroupID + workGroupOffset, localInvocationIndex, mips, numWorkGroups, slice);
+}
+
+#if defined(SPD_EXTENDED) || defined(SPD_DIRTY_TILES)
+AF4 SpdReduceLoadMip4(AU2 base, AU1 mip, AU1 slice)
+{
+#ifdef SPD_RESIDENCY
+    if (mip == 5)
+    {
+        AF4 v0 = SpdLoadResident(ASU2(base + AU2(0, 0)), slice);
+        AF4 v1 = SpdLoadResident(ASU2(base + AU2(0, 1)), slice);
+        AF4 v2 = SpdLoadResident(ASU2(base + AU2(1, 0)), slice);
+        AF4 v3 = SpdLoadResident(ASU2(base + AU2(1, 1)), slice);
+        return SpdReduce4(v0, v1, v2, v3);
+    }
+#endif
+    AF4 v0 = SpdLoadMip(ASU2(base + AU2(0, 0)), mip, slice);
+    AF4 v1 = SpdLoadMip(ASU2(base + AU2(0, 1)), mip, slice);
+    AF4 v2 = SpdLoadMip(ASU2(base + AU2(1, 0)), mip, slice);
+    AF4 v3 = SpdLoadMip(ASU2(base + AU2(1, 1)), mip, slice);
+    return SpdReduce4(v0, v1, v2, v3);
+}
+#endif
+
+#ifdef SPD_EXTENDED
+
+// Mips baseMip and baseMip + 1 of a block from the up to 64x64 texels of mip baseMip - 1, same as SpdDownsampleMips_6_7
+void SpdDownsampleBlockMips(AU1 x, AU1 y, AU2 blockID, AU1 baseMip, AU1 mips, AU1 slice)
+{
+    AU2 tex = blockID * 64 + AU2(x * 4, y * 4);
+    AU2 pix = blockID * 32 + AU2(x * 2, y * 2);
+    AF4 v0 = SpdReduceLoadMip4(tex + AU2(0, 0), baseMip - 1, slice);
+    SpdStore(ASU2(pix + AU2(0, 0)), v0, baseMip, slice);
+
+    AF4 v1 = SpdReduceLoadMip4(tex + AU2(2, 0), baseMip - 1, slice);
+    SpdStore(ASU2(pix + AU2(1, 0)), v1, baseMip, slice);
+
+    AF4 v2 = SpdReduceLoadMip4(tex + AU2(0, 2), baseMip - 1, slice);
+    SpdStore(ASU2(pix + AU2(0, 1)), v2, baseMip, slice);
+
+    AF4 v3 = SpdReduceLoadMip4(tex + AU2(2, 2), baseMip - 1, slice);
+    SpdStore(ASU2(pix + AU2(1, 1)), v3, baseMip, slice);
+
+    if (mips <= baseMip + 1) return;
+    // no barrier needed, working on values only from the same thread
+
+    AF4 v = SpdReduce4(v0, v1, v2, v3);
+    SpdStore(ASU2(blockID * 16 + AU2(x, y)), v, baseMip + 1, slice);
+    SpdStoreIntermediate(x, y, v);
+}
+
+void SpdDownsampleExtended(
+    AU2 workGroupID,
+    AU1 localInvocationIndex,
+    AU1 mips,
+    AU2 numWorkGroups,
+    AU1 slice
+) {
+    AU2 sub_xy = ARmpRed8x8(localInvocationIndex % 64);
+    AU1 x = sub_xy.x + 8 * ((localInvocationIndex >> 6) % 2);
+    AU1 y = sub_xy.y + 8 * ((localInvocationIndex >> 7));
+#ifdef SPD_RESIDENCY
+    if (SpdTileResident(workGroupID, slice) != 0)
+#endif
+    {
+        SpdDownsampleMips_0_1(x, y, workGroupID, localInvocationIndex, mips, slice);
+
+        SpdDownsampleNextFour(x, y, workGroupID, localInvocationIndex, 2, mips, slice);
+    }
+
+    if (mips <= 6) return;
+
+    // The last workgroup of each block of 64x64 workgroups downsamples the up to 64x64 texels of mip 5 of the block.
+    AU2 blockID = workGroupID / 64;
+    AU2 blockSize = min(AU2(64, 64), numWorkGroups - blockID * 64);
+    AU2 numBlocks = (numWorkGroups + 63) / 64;
+    if (SpdExitBlock(blockSize.x * blockSize.y, localInvocationIndex, blockID.y * numBlocks.x + blockID.x, slice)) return;
+
+    SpdDownsampleBlockMips(x, y, blockID, 6, mips, slice);
+
+    SpdDownsampleNextFour(x, y, blockID, localInvocationIndex, 8, mips, slice);
+
+    if (mips <= 12) return;
+
+    // After mip 12 there is only a single workgroup left that downsamples the remaining up to 64x64 texels of mip 11.
+    if (SpdExitWorkgroup(numBlocks.x * numBlocks.y, localInvocationIndex, slice)) return;
+
+    SpdDownsampleBlockMips(x, y, AU2(0, 0), 12, mips, slice);
+
+    SpdDownsampleNextFour(x, y, AU2(0, 0), localInvocationIndex, 14, mips, slice);
+}
+#endif // SPD_EXTENDED
+
+//==============================================================================================================================
+//                                                         SPLIT TAIL
+//------------------------------------------------------------------------------------------------------------------------------
+// SPD_SPLIT_TAIL: the single last work group of SpdDownsample reads all of the up to 64x64 texels of mip 5, 16 per
+// invocation, and is the critical path of a large dispatch while the rest of the GPU is idle. Here the last work group of
+// each quad of 4x4 work groups computes the 2x2 texels of mip 6 and the texel of mip 7 of the quad with one invocation, same
+// as the invocation (quadID.x, quadID.y) of SpdDownsampleMips_6_7. The last quad of the slice only loads the up to 16x16
+// texels of mip 7, one per invocation, and computes mips 8..11. Mip 7 comes from SpdStoreQuad before the store rounds it,
+// the invocations outside of the quads compute the padding of SpdDownsampleMips_6_7, so the result is the same as
+// SpdDownsample in every format.
+//==============================================================================================================================
+#ifdef SPD_SPLIT_TAIL
+void SpdDownsampleSplitTail(
+    AU2 workGroupID,
+    AU1 localInvocationIndex,
+    AU1 mips,
+    AU2 numWorkGroups,
+    AU1 slice
+) {
+    AU2 sub_xy = ARmpRed8x8(localInvocationIndex % 64);
+    AU1 x = sub_xy.x + 8 * ((localInvocationIndex >> 6) % 2);
+    AU1 y = sub_xy.y + 8 * ((localInvocationIndex >> 7));
+#ifdef SPD_RESIDENCY
+    if (SpdTileResident(workGroupID, slice) != 0)
+#endif
+    {
+        SpdDownsampleMips_0_1(x, y, workGroupID, localInvocationIndex, mips, slice);
+
+        SpdDownsampleNextFour(x, y, workGroupID, localInvocationIndex, 2, mips, slice);
+    }
+
+    if (mips <= 6) return;
+
+    // The last workgroup of each quad of 4x4 workgroups downsamples the 4x4 texels of mip 5 of the quad.
+    AU2 quadID = workGroupID / 4;
+    AU2 quadSize = min(AU2(4, 4), numWorkGroups - quadID * 4);
+    AU2 numQuads = (numWorkGroups + 3) / 4;
+    if (SpdExitBlock(quadSize.x * quadSize.y, localInvocationIndex, quadID.y * numQuads.x + quadID.x, slice)) return;
+
+    if (localInvocationIndex == 0)
+    {
+        SpdDownsampleMips_6_7(quadID.x, quadID.y, mips, slice);
+        // same invocation, SpdDownsampleMips_6_7 left the unrounded mip 7 in the intermediate
+        if (mips > 8) SpdStoreQuad(quadID, SpdLoadIntermediate(quadID.x, quadID.y), slice);
+    }
+
+    if (mips <= 8) return;
+
+    // mip 7 of the quad is visible to all invocations before the counter publishes it
+    SpdDeviceMemoryBarrier();
+
+    // After mip 7 there is only a single workgroup left that downsamples the remaining up to 16x16 texels.
+    if (SpdExitWorkgroup(numQuads.x * numQuads.y, localInvocationIndex, slice)) return;
+
+    if (x < numQuads.x && y < numQuads.y)
+        SpdStoreIntermediate(x, y, SpdLoadQuad(AU2(x, y), slice));
+    else
+        SpdDownsampleMips_6_7(x, y, mips, slice);
+
+    SpdDownsampleNextFour(x, y, AU2(0, 0), localInvocationIndex, 8, mips, slice);
+}
+#endif // SPD_SPLIT_TAIL
+
+//==============================================================================================================================
+//                                                         DIRTY TILES
+//------------------------------------------------------------------------------------------------------------------------------
+// SPD_DIRTY_TILES: textures that change in a few places per frame, such as decals and painted splat maps, are updated in
+// place. Only the tiles of the list run, so the cost follows the edited area and not the size of the texture. Each of them
+// recomputes mips 0..5 of its 64x64 texels of the source. The last one recomputes the texels of mips 6 and up above the tiles
+// of the list from the stored mips, instead of all of mips 6..11 from the LDS. The texels just outside of a mip, which the
+// LDS of SpdDownsample holds where a mip below is 1 texel wide or high, are recomputed in full at every mip, so the result
+// is the one of SpdDownsample for any size. Formats that store less precision than the LDS can round differently.
+//==============================================================================================================================
+#ifdef SPD_DIRTY_TILES
+// Texel p of mip as the LDS of the tail of SpdDownsample holds it: stored inside of the mip, the edge next to it in the LDS,
+// and z (the reduction of the zero loads) beyond the edge. Only the edge can differ from zero padding, it is the column
+// p.x == mipSize.x for p.y 0..mipSize.y, entries 128 * (mip % 2) + p.y, and the row p.y == mipSize.y, entries
+// 128 * (mip % 2) + mipSize.y + 1 + p.x.
+AF4 SpdLoadDirtyTexel(AU2 p, AU1 mip, AU1 slice, AU2 size, AF4 z)
+{
+    AU2 mipSize = max(size >> AU2(mip + 1, mip + 1), AU2(1, 1));
+    if (p.x < mipSize.x && p.y < mipSize.y) return SpdLoadMip(ASU2(p), mip, slice);
+    AU1 entry = 128 * (mip % 2);
+    if (p.x == mipSize.x && p.y <= mipSize.y) entry += p.y;
+    else if (p.y == mipSize.y && p.x < mipSize.x) entry += mipSize.y + 1 + p.x;
+    else return z;
+    return SpdLoadIntermediate(entry % 16, entry / 16);
+}
+
+// Texel p of mip 6 and up from the 2x2 texels of the mip below, in the order of the tail of SpdDownsample.
+// z is the reduction of the zero loads in the mip below.
+AF4 SpdReduceDirtyTexel(AU2 p, AU1 mip, AU1 slice, AU2 size, AF4 z)
+{
+    if (mip == 6) return SpdReduceLoadMip4(p * 2, 5, slice);
+    AF4 v0 = SpdLoadDirtyTexel(p * 2 + AU2(0, 0), mip - 1, slice, size, z);
+    AF4 v1 = SpdLoadDirtyTexel(p * 2 + AU2(1, 0), mip - 1, slice, size, z);
+    AF4 v2 = SpdLoadDirtyTexel(p * 2 + AU2(0, 1), mip - 1, slice, size, z);
+    AF4 v3 = SpdLoadDirtyTexel(p * 2 + AU2(1, 1), mip - 1, slice, size, z);
+    return SpdReduce4(v0, v1, v2, v3);
+}
+
+// Last work group: the texels of mips 6 and up above the tiles of the list, each from the 2x2 texels of the mip below.
+// Where a mip is 1 texel wide or high, the tail of SpdDownsample also reduces the texels of the mip below that are outside
+// of it, which hold the odd last column or row of the mips above. These are not stored, so every mip recomputes its edge
+// in full (up to 65 texels) into the LDS first, one texel per invocation. size is the size of the source.
+void SpdDownsampleDirtyAncestors(AU1 localInvocationIndex, AU1 mips, AU1 numTiles, AU1 slice, AU2 size)
+{
+    // the reduction of the zero loads of mip 5
+    AF4 z = AF4(0.0, 0.0, 0.0, 0.0);
+    for (AU1 mip = 6; mip < mips; mip++)
+    {
+        // the texels of mip - 1 are visible to all invocations
+        SpdDeviceMemoryBarrier();
+        AU2 mipSize = max(size >> AU2(mip + 1, mip + 1), AU2(1, 1));
+        if (localInvocationIndex < mipSize.x + mipSize.y + 1)
+        {
+            AU2 pix = localInvocationIndex <= mipSize.y ? AU2(mipSize.x, localInvocationIndex) : AU2(localInvocationIndex - mipSize.y - 1, mipSize.y);
+            AU1 entry = 128 * (mip % 2) + localInvocationIndex;
+            SpdStoreIntermediate(entry % 16, entry / 16, SpdReduceDirtyTexel(pix, mip, slice, size, z));
+        }
+        AU1 shift = mip - 5;
+        for (AU1 i = localInvocationIndex; i < numTiles; i += 256)
+        {
+            AU2 pix = SpdLoadDirtyTile(i, slice) >> AU2(shift, shift);
+            if (i > 0)
+            {
+                // in Morton order the tiles below a texel are next to each other, the first of them computes it
+                AU2 previous = SpdLoadDirtyTile(i - 1, slice) >> AU2(shift, shift);
+                if (previous.x == pix.x && previous.y == pix.y) continue;
+            }
+            SpdStore(ASU2(pix), SpdReduceDirtyTexel(pix, mip, slice, size, z), mip, slice);
+        }
+        z = SpdReduce4(z, z, z, z);
+        // the edge of mip is visible, and the one of mip - 1 is read, before the next mip overwrites it
+        SpdWorkgroupShuffleBarrier();
+    }
+}
+
+void SpdDownsampleDirty(
+    AU1 tileIndex,
+    AU1 localInvocationIndex,
+    AU1 mips,
+    AU1 numTiles,
+    AU1 slice,
+    AU2 size
+) {
+    AU2 sub_xy = ARmpRed8x8(localInvocationIndex % 64);
+    AU1 x = sub_xy.x + 8 * ((localInvocationIndex >> 6) % 2);
+    AU1 y = sub_xy.y + 8 * ((localInvocationIndex >> 7));
+    AU2 workGroupID = SpdLoadDirtyTile(tileIndex, slice);
+    SpdDownsampleMips_0_1(x, y, workGroupID, localInvocationIndex, mips, slice);
+
+    SpdDownsampleNextFour(x, y, workGroupID, localInvocationIndex, 2, mips, slice);
+
+    if (mips <= 6) return;
+
+    if (SpdExitWorkgroup(numTiles, localInvocationIndex, slice)) return;
+
+    SpdDownsampleDirtyAncestors(localInvocationIndex, mips, numTiles, slice, size);
+}
+#endif // SPD_DIRTY_TILES
+#endif // !SPD_DEPTH && !SPD_FILTER
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//==============================================================================================================================
+//                                                        DEPTH VERSION
+//------------------------------------------------------------------------------------------------------------------------------
+// Hierarchical Z: every texel keeps the farthest depth of its footprint, the maximum or with SPD_DEPTH_REVERSED_Z the minimum.
+// The footprint is 2x2 texels of the parent, 3 wide where the parent width is odd and 3 high where the parent height is odd,
+// clamped to the parent. These are all parent texels that overlap the texel in uv space, so the mips are conservative for
+// any size of the source.
+// Each work group computes mips 0..5 of its tile, mip 0 from the source and the others in a 32x32 intermediate. Where a
+// parent size is odd, a texel in the last column or row of a tile also needs the first column or row of the next tile,
+// so the last work group recomputes these edges from the stored mips 0..4 before it computes mips 6..11 from mip 5.
+// Only the sizes with odd mips 0..4 pay for it, e.g. 1920x1080 recomputes one row per tile in mips 4 and 5.
+//==============================================================================================================================
+#ifdef SPD_DEPTH
+AF1 SpdReduceDepth(AF1 a, AF1 b)
+{
+#ifdef SPD_DEPTH_REVERSED_Z
+    return min(a, b);
+#else
+    return max(a, b);
+#endif
+}
+
+// size of the parent of mip, the source for mip 0
+AU2 SpdDepthParentSize(AU2 size, AU1 mip)
+{
+    return max(size >> AU2(mip, mip), AU2(1, 1));
+}
+
+AF1 SpdLoadDepthParent(AU2 p, AU1 mip, AU1 slice)
+{
+    if (mip == 0)
+        return SpdLoadSourceDepth(ASU2(p), slice);
+    return SpdLoadDepth(ASU2(p), mip - 1, slice);
+}
+
+// Texel p of mip from the parent in memory, the footprint is 2x2 with an optional third column and row
+AF1 SpdReduceLoadDepth(AU2 p, AU1 mip, AU1 slice, AU2 size)
+{
+    AU2 parentSize = SpdDepthParentSize(size, mip);
+    AU2 first = min(p * 2, parentSize - 1);
+    AU2 last = min(p * 2 + 1 + (parentSize & 1), parentSize - 1);
+    AU2 second = min(first + 1, last);
+    AF1 v = SpdReduceDepth(
+        SpdReduceDepth(SpdLoadDepthParent(first, mip, slice), SpdLoadDepthParent(AU2(second.x, first.y), mip, slice)),
+        SpdReduceDepth(SpdLoadDepthParent(AU2(first.x, second.y), mip, slice), SpdLoadDepthParent(second, mip, slice)));
+    if (last.x != second.x)
+        v = SpdReduceDepth(v, SpdReduceDepth(SpdLoadDepthParent(AU2(last.x, first.y), mip, slice), SpdLoadDepthParent(AU2(last.x, second.y), mip, slice)));
+    if (last.y != second.y)
+    {
+        for (AU1 x = first.x; x <= last.x; x++)
+            v = SpdReduceDepth(v, SpdLoadDepthParent(AU2(x, last.y), mip, slice));
+    }
+    return v;
+}
+
+// Mips baseMip..baseMip+5 of a tile of 32x32 texels of baseMip: the first one from memory, the others in the intermediate.
+// A texel in the last column or row of the tile only sees the parent texels inside of the tile.
+void SpdDownsampleDepthTile(AU2 tile, AU1 localInvocationIndex, AU1 baseMip, AU1 mips, AU1 slice, AU2 size)
+{
+    AU2 mipSize = SpdDepthParentSize(size, baseMip + 1);
+    for (AU1 i = 0; i < 4; i++)
+    {
+        // texels outside of the mip are never part of a footprint
+        AU2 p = AU2(localInvocationIndex % 32, localInvocationIndex / 32 + i * 8);
+        AU2 pix = tile * 32 + p;
+        AF1 v = AF1_(0.0);
+        if (pix.x < mipSize.x && pix.y < mipSize.y)
+        {
+            v = SpdReduceLoadDepth(pix, baseMip, slice, size);
+            SpdStoreDepth(ASU2(pix), v, baseMip, slice);
+        }
+        SpdStoreIntermediateDepth(p.x, p.y, v);
+    }
+
+    for (AU1 i = 1; i < 6; i++)
+    {
+        AU1 mip = baseMip + i;
+        if (mips <= mip) return;
+
+        AU1 tileSize = 32 >> i;
+        AU2 parentSize = mipSize;
+        mipSize = SpdDepthParentSize(size, mip + 1);
+        AU2 p = AU2(localInvocationIndex % tileSize, localInvocationIndex / tileSize);
+        AU2 pix = tile * tileSize + p;
+        bool active = localInvocationIndex < tileSize * tileSize && pix.x < mipSize.x && pix.y < mipSize.y;
+        SpdWorkgroupShuffleBarrier();
+        AF1 v = AF1_(0.0);
+        if (active)
+        {
+            AU2 origin = tile * tileSize * 2;
+            AU2 first = min(pix * 2, parentSize - 1) - origin;
+            AU2 last = min(min(pix * 2 + 1 + (parentSize & 1), parentSize - 1) - origin, AU2(tileSize * 2 - 1, tileSize * 2 - 1));
+            v = SpdLoadIntermediateDepth(first.x, first.y);
+            for (AU1 y = first.y; y <= last.y; y++)
+                for (AU1 x = first.x; x <= last.x; x++)
+                    v = SpdReduceDepth(v, SpdLoadIntermediateDepth(x, y));
+        }
+        SpdWorkgroupShuffleBarrier();
+        if (active)
+        {
+            SpdStoreDepth(ASU2(pix), v, mip, slice);
+            SpdStoreIntermediateDepth(p.x, p.y, v);
+        }
+    }
+}
+
+// Last work group: recomputes the texels of mips 1..5 in the last column and row of every tile from the stored mips.
+// They are only incomplete once a parent width or height on the way is odd.
+void SpdDownsampleDepthEdges(AU1 localInvocationIndex, AU1 mips, AU1 slice, AU2 size)
+{
+    // the stores of this work group are visible to all of its invocations
+    SpdDeviceMemoryBarrier();
+
+    AU2 fix = AU2(0, 0);
+    for (AU1 mip = 1; mip < min(mips, AU1(6)); mip++)
+    {
+        fix |= SpdDepthParentSize(size, mip) & AU2(1, 1);
+        if (fix.x == 0 && fix.y == 0) continue;
+
+        // the last columns, then the last rows of the tiles, the corners are computed twice
+        AU1 tileSize = 32 >> mip;
+        AU2 mipSize = SpdDepthParentSize(size, mip + 1);
+        AU2 edges = fix * (mipSize / tileSize);
+        AU1 columns = edges.x * mipSize.y;
+        AU1 count = columns + edges.y * mipSize.x;
+        for (AU1 i = localInvocationIndex; i < count; i += 256)
+        {
+            AU2 pix;
+            if (i < columns)
+                pix = AU2((i % edges.x) * tileSize + tileSize - 1, i / edges.x);
+            else
+                pix = AU2((i - columns) % mipSize.x, ((i - columns) / mipSize.x) * tileSize + tileSize - 1);
+            SpdStoreDepth(ASU2(pix), SpdReduceLoadDepth(pix, mip, slice, size), mip, slice);
+        }
+        SpdDeviceMemoryBarrier();
+    }
+}
+
+void SpdDownsampleDepth(
+    AU2 workGroupID,
+    AU1 localInvocationIndex,
+    AU1 mips,
+    AU1 numWorkGroups,
+    AU1 slice,
+    AU2 size
+) {
+    SpdDownsampleDepthTile(workGroupID, localInvocationIndex, 0, mips, slice, size);
+
+    if (mips <= 1) return;
+
+    if (SpdExitWorkgroup(numWorkGroups, localInvocationIndex, slice)) return;
+
+    // All tiles are stored, the edges see the next tile now.
+    SpdDownsampleDepthEdges(localInvocationIndex, mips, slice, size);
+
+    if (mips <= 6) return;
+
+    // Mip 5 holds up to 64x64 texels, one tile of mips 6..11 covers all of them.
+    SpdDownsampleDepthTile(AU2(0, 0), localInvocationIndex, 6, mips, slice, size);
+}
+#endif // SPD_DEPTH
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//==============================================================================================================================
+//                                                       FILTER VERSION
+//------------------------------------------------------------------------------------------------------------------------------
+// SPD_FILTER: separable filters wider than the 2x2 box, which alias less, e.g. for cone traced reflections or Gaussian
+// pyramids. Texel p of a mip is the weighted sum of the parent texels 2p-1..2p+2 (4 taps) or 2p-2..2p+3 (6 taps) in x and
+// in y, clamped to the edge of the parent:
+//  SPD_FILTER_BINOMIAL - 4 taps, 1 3 3 1 / 8
+//  SPD_FILTER_KAISER   - 6 taps, the sinc of the mip in a Kaiser window (beta 4) of 3 parent texels
+//  SPD_FILTER_LANCZOS  - 6 taps, the sinc of the mip in a Lanczos window of 3 parent texels, a bit sharper than Kaiser
+// The 6 tap filters have negative lobes and can ring at hard edges.
+// The footprints of the texels at the edge of a tile reach into the next tiles. Each work group computes mip 0 and mip 1 of
+// its tile with an apron, so that mip 2 of the tile is exact: mip 0 with 3 * SPD_FILTER_RADIUS texels on each side from the
+// source, mip 1 with SPD_FILTER_RADIUS texels on each side from mip 0 in the intermediate. That is 1.4 (4 taps) or 1.9
+// (6 taps) times the texels of mip 0. A wider apron for mips 3..5 does not fit into the LDS, the last work group computes
+// mips 3.. from the stored mips instead, one mip after the other.
+//==============================================================================================================================
+#define SPD_FILTER_BINOMIAL 1
+#define SPD_FILTER_KAISER 2
+#define SPD_FILTER_LANCZOS 3
+
+#ifdef SPD_FILTER
+#if SPD_FILTER == SPD_FILTER_BINOMIAL
+#define SPD_FILTER_RADIUS 1
+#else
+#define SPD_FILTER_RADIUS 2
+#endif
+#define SPD_FILTER_TAPS (2 * SPD_FILTER_RADIUS + 2)
+// apron of mip 0 in the intermediate, 38x38 or 44x44 texels
+#define SPD_FILTER_APRON (3 * SPD_FILTER_RADIUS)
+
+// weight of tap t, the first tap is the parent texel 2p - SPD_FILTER_RADIUS
+AF1 SpdFilterWeight(AU1 t)
+{
+#if SPD_FILTER == SPD_FILTER_BINOMIAL
+    return (t == 0 || t == 3) ? AF1_(0.125) : AF1_(0.375);
+#else
+    // distance 0.5, 1.5 and 2.5 parent texels from the center, normalized to a sum of 1
+    AU1 d = t < 3 ? 2 - t : t - 3;
+#if SPD_FILTER == SPD_FILTER_KAISER
+    return d == 0 ? AF1_(0.42649015) : (d == 1 ? AF1_(0.09450233) : AF1_(-0.02099248));
+#else
+    return d == 0 ? AF1_(0.42293233) : (d == 1 ? AF1_(0.09398496) : AF1_(-0.01691729));
+#endif
+#endif
+}
+
+// size of the parent of mip, the source for mip 0
+AU2 SpdFilterParentSize(AU2 size, AU1 mip)
+{
+    return max(size >> AU2(mip, mip), AU2(1, 1));
+}
+
+AF4 SpdLoadFilterParent(ASU2 p, AU1 mip, AU1 slice)
+{
+    if (mip == 0)
+        return SpdLoadSourceImage(p, slice);
+    return SpdLoadMip(p, mip - 1, slice);
+}
+
+// Texel p of mip from the parent in memory
+AF4 SpdReduceLoadFilter(ASU2 p, AU1 mip, AU1 slice, AU2 size)
+{
+    ASU2 last = ASU2(SpdFilterParentSize(size, mip)) - ASU2(1, 1);
+    ASU2 first = p * 2 - ASU2(SPD_FILTER_RADIUS, SPD_FILTER_RADIUS);
+    AF4 v = AF4_(0.0);
+    for (AU1 y = 0; y < SPD_FILTER_TAPS; y++)
+    {
+        AF4 row = AF4_(0.0);
+        for (AU1 x = 0; x < SPD_FILTER_TAPS; x++)
+            row += SpdFilterWeight(x) * SpdLoadFilterParent(clamp(first + ASU2(x, y), ASU2(0, 0), last), mip, slice);
+        v += SpdFilterWeight(y) * row;
+    }
+    return v;
+}
+
+// Texel p of mip from the parent in the intermediate, which holds the parent texels from origin on
+AF4 SpdReduceIntermediateFilter(ASU2 p, ASU2 origin, AU2 parentSize)
+{
+    ASU2 last = ASU2(parentSize) - ASU2(1, 1);
+    ASU2 first = p * 2 - ASU2(SPD_FILTER_RADIUS, SPD_FILTER_RADIUS);
+    AF4 v = AF4_(0.0);
+    for (AU1 y = 0; y < SPD_FILTER_TAPS; y++)
+    {
+        AF4 row = AF4_(0.0);
+        for (AU1 x = 0; x < SPD_FILTER_TAPS; x++)
+        {
+            AU2 q = AU2(clamp(first + ASU2(x, y), ASU2(0, 0), last) - origin);
+            row += SpdFilterWeight(x) * SpdLoadIntermediateFilter(q.x, q.y);
+        }
+        v += SpdFilterWeight(y) * row;
+    }
+    return v;
+}
+
+// Mips 0..2 of a tile: mip 0 and mip 1 with their aprons in the intermediate, texels outside of the mips are skipped.
+void SpdDownsampleFilterMips_0_2(AU2 workGroupID, AU1 localInvocationIndex, AU1 mips, AU1 slice, AU2 size)
+{
+    AU1 apron = SPD_FILTER_APRON;
+    AU1 width = 32 + 2 * apron;
+    ASU2 origin = ASU2(workGroupID * 32) - ASU2(apron, apron);
+    AU2 mipSize = SpdFilterParentSize(size, 1);
+    for (AU1 i = localInvocationIndex; i < width * width; i += 256)
+    {
+        AU2 p = AU2(i % width, i / width);
+        ASU2 pix = origin + ASU2(p);
+        if (pix.x < 0 || pix.y < 0 || pix.x >= ASU1(mipSize.x) || pix.y >= ASU1(mipSize.y)) continue;
+        AF4 v = SpdReduceLoadFilter(pix, 0, slice, size);
+        SpdStoreIntermediateFilter(p.x, p.y, v);
+        if (p.x - apron < 32 && p.y - apron < 32)
+            SpdStore(pix, v, 0, slice);
+    }
+
+    for (AU1 mip = 1; mip < 3; mip++)
+    {
+        if (mips <= mip) return;
+
+        // mip 1 replaces mip 0 in the intermediate, mip 2 is the tile without apron
+        AU1 parentApron = apron;
+        ASU2 parentOrigin = origin;
+        AU2 parentSize = mipSize;
+        apron = mip == 1 ? SPD_FILTER_RADIUS : 0;
+        width = (32 >> mip) + 2 * apron;
+        origin = ASU2(workGroupID * (32 >> mip)) - ASU2(apron, apron);
+        mipSize = SpdFilterParentSize(size, mip + 1);
+        AF4 v[2];
+        v[0] = AF4_(0.0);
+        v[1] = AF4_(0.0);
+        SpdWorkgroupShuffleBarrier();
+        for (AU1 j = 0; j < 2; j++)
+        {
+            AU1 i = localInvocationIndex + j * 256;
+            ASU2 pix = origin + ASU2(i % width, i / width);
+            if (i < width * width && pix.x >= 0 && pix.y >= 0 && pix.x < ASU1(mipSize.x) && pix.y < ASU1(mipSize.y))
+                v[j] = SpdReduceIntermediateFilter(pix, parentOrigin, parentSize);
+        }
+        SpdWorkgroupShuffleBarrier();
+        for (AU1 j = 0; j < 2; j++)
+        {
+            AU1 i = localInvocationIndex + j * 256;
+            AU2 p = AU2(i % width, i / width);
+            ASU2 pix = origin + ASU2(p);
+            if (i >= width * width || pix.x < 0 || pix.y < 0 || pix.x >= ASU1(mipSize.x) || pix.y >= ASU1(mipSize.y)) continue;
+            SpdStoreIntermediateFilter(p.x, p.y, v[j]);
+            if (p.x - apron < (32 >> mip) && p.y - apron < (32 >> mip))
+                SpdStore(pix, v[j], mip, slice);
+        }
+    }
+}
+
+// Last work group: mips 3.. from the stored parents, one mip after the other
+void SpdDownsampleFilterTail(AU1 localInvocationIndex, AU1 mips, AU1 slice, AU2 size)
+{
+    for (AU1 mip = 3; mip < mips; mip++)
+    {
+        // the stores of the parent are visible to all invocations
+        SpdDeviceMemoryBarrier();
+        AU2 mipSize = SpdFilterParentSize(size, mip + 1);
+        for (AU1 i = localInvocationIndex; i < mipSize.x * mipSize.y; i += 256)
+        {
+            ASU2 pix = ASU2(i % mipSize.x, i / mipSize.x);
+            SpdStore(pix, SpdReduceLoadFilter(pix, mip, slice, size), mip, slice);
+        }
+    }
+}
+
+void SpdDownsampleFilter(
+    AU2 workGroupID,
+    AU1 localInvocationIndex,
+    AU1 mips,
+    AU1 numWorkGroups,
+    AU1 slice,
+    AU2 size
+) {
+    SpdDownsampleFilterMips_0_2(workGroupID, localInvocationIndex, mips, slice, size);
+
+    if (mips <= 3) return;
+
+    if (SpdExitWorkgroup(numWorkGroups, localInvocationIndex, slice)) return;
+
+    SpdDownsampleFilterTail(localInvocationIndex, mips, slice, size);
+}
+#endif // SPD_FILTER
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -738,15 +2313,100 @@ void SpdDownsample(
 //                                                       PACKED VERSION
 //==============================================================================================================================
 
-#ifdef A_HALF // A_HALF
+#if defined(A_HALF) && !defined(SPD_DEPTH) && !defined(SPD_FILTER) // A_HALF
 
 #ifdef A_GLSL
 #extension GL_EXT_shader_subgroup_extended_types_float16:require
 #endif
 
+// built-in reductions, see BUILT-IN REDUCTIONS
+AH4 SpdReduceAverage4H(AH4 v0, AH4 v1, AH4 v2, AH4 v3){return (v0 + v1 + v2 + v3) * AH1_(0.25);}
+AH4 SpdReduceMin4H(AH4 v0, AH4 v1, AH4 v2, AH4 v3){return min(min(v0, v1), min(v2, v3));}
+AH4 SpdReduceMax4H(AH4 v0, AH4 v1, AH4 v2, AH4 v3){return max(max(v0, v1), max(v2, v3));}
+AH4 SpdReduceMinMax4H(AH4 v0, AH4 v1, AH4 v2, AH4 v3)
+{
+    AH2 n = min(min(v0.xz, v1.xz), min(v2.xz, v3.xz));
+    AH2 x = max(max(v0.yw, v1.yw), max(v2.yw, v3.yw));
+    return AH4(n.x, x.x, n.y, x.y);
+}
+AH4 SpdReduceSum4H(AH4 v0, AH4 v1, AH4 v2, AH4 v3){return v0 + v1 + v2 + v3;}
+AH4 SpdReduceWeighted4H(AH4 v0, AH4 v1, AH4 v2, AH4 v3, AH4 w)
+{
+    AH1 sum = w.x + w.y + w.z + w.w;
+    AH4 r = v0 * w.x + v1 * w.y + v2 * w.z + v3 * w.w;
+    return sum > AH1_(0.0) ? r * ARcpH1(sum) : AH4_(0.0);
+}
+AH1 SpdLuminanceWeightH(AH4 v){return ARcpH1(AH1_(1.0) + dot(v.rgb, AH3(0.2126, 0.7152, 0.0722)));}
+AH4 SpdReduceLuminance4H(AH4 v0, AH4 v1, AH4 v2, AH4 v3)
+{
+    return SpdReduceWeighted4H(v0, v1, v2, v3, AH4(SpdLuminanceWeightH(v0), SpdLuminanceWeightH(v1), SpdLuminanceWeightH(v2), SpdLuminanceWeightH(v3)));
+}
+AH4 SpdReducePremultiplied4H(AH4 v0, AH4 v1, AH4 v2, AH4 v3)
+{
+    AH1 a = v0.a + v1.a + v2.a + v3.a;
+    AH3 c = v0.rgb * v0.a + v1.rgb * v1.a + v2.rgb * v2.a + v3.rgb * v3.a;
+    return AH4(a > AH1_(0.0) ? c * ARcpH1(a) : AH3_(0.0), a * AH1_(0.25));
+}
+AH4 SpdReduceNormal4H(AH4 v0, AH4 v1, AH4 v2, AH4 v3)
+{
+    AH4 w = sign(AH4(dot(v0.xyz, v0.xyz), dot(v1.xyz, v1.xyz), dot(v2.xyz, v2.xyz), dot(v3.xyz, v3.xyz)));
+    AH1 count = w.x + w.y + w.z + w.w;
+    if (count == AH1_(0.0)) return AH4_(0.0);
+    AH1 rcp = ARcpH1(count);
+    AH3 n = (v0.xyz + v1.xyz + v2.xyz + v3.xyz) * rcp;
+    AH1 len = sqrt(dot(n, n));
+    AH1 variance = dot(AH4(v0.w, v1.w, v2.w, v3.w) * AH4(v0.w, v1.w, v2.w, v3.w), w) * rcp;
+    variance += len > AH1_(0.0) ? (AH1_(1.0) - len) * ARcpH1(len) : AH1_(1.0);
+    return AH4(len > AH1_(0.0) ? n * ARcpH1(len) : AH3(0.0, 0.0, 1.0), sqrt(min(variance, AH1_(1.0))));
+}
+
+#ifdef SPD_REDUCTION
+AH4 SpdReduce4H(AH4 v0, AH4 v1, AH4 v2, AH4 v3)
+{
+#if SPD_REDUCTION == SPD_REDUCTION_MIN
+    return SpdReduceMin4H(v0, v1, v2, v3);
+#elif SPD_REDUCTION == SPD_REDUCTION_MAX
+    return SpdReduceMax4H(v0, v1, v2, v3);
+#elif SPD_REDUCTION == SPD_REDUCTION_MINMAX
+    return SpdReduceMinMax4H(v0, v1, v2, v3);
+#elif SPD_REDUCTION == SPD_REDUCTION_SUM
+    return SpdReduceSum4H(v0, v1, v2, v3);
+#elif SPD_REDUCTION == SPD_REDUCTION_LUMINANCE
+    return SpdReduceLuminance4H(v0, v1, v2, v3);
+#elif SPD_REDUCTION == SPD_REDUCTION_PREMULTIPLIED
+    return SpdReducePremultiplied4H(v0, v1, v2, v3);
+#elif SPD_REDUCTION == SPD_REDUCTION_WEIGHTED
+    return SpdReduceWeighted4H(v0, v1, v2, v3, AH4(SpdReduceWeightH(v0), SpdReduceWeightH(v1), SpdReduceWeightH(v2), SpdReduceWeightH(v3)));
+#elif SPD_REDUCTION == SPD_REDUCTION_NORMAL
+    return SpdReduceNormal4H(v0, v1, v2, v3);
+#else
+    return SpdReduceAverage4H(v0, v1, v2, v3);
+#endif
+}
+#endif
+
+#ifdef SPD_REDUCTION_PAIRWISE
+AH4 SpdReducePairH(AH4 a, AH4 b)
+{
+#if SPD_REDUCTION == SPD_REDUCTION_MIN
+    return min(a, b);
+#elif SPD_REDUCTION == SPD_REDUCTION_MAX
+    return max(a, b);
+#else
+    return AH4(min(a.x, b.x), max(a.y, b.y), min(a.z, b.z), max(a.w, b.w));
+#endif
+}
+#endif
+
 AH4 SpdReduceQuadH(AH4 v)
 {
-    #if defined(A_GLSL) && !defined(SPD_NO_WAVE_OPERATIONS)
+    #if defined(SPD_REDUCTION_PAIRWISE) && defined(A_GLSL) && !defined(SPD_NO_WAVE_OPERATIONS)
+    v = SpdReducePairH(v, subgroupQuadSwapHorizontal(v));
+    return SpdReducePairH(v, subgroupQuadSwapVertical(v));
+    #elif defined(SPD_REDUCTION_PAIRWISE) && defined(A_HLSL) && !defined(SPD_NO_WAVE_OPERATIONS)
+    v = SpdReducePairH(v, WaveReadLaneAt(v, WaveGetLaneIndex() ^ 1));
+    return SpdReducePairH(v, WaveReadLaneAt(v, WaveGetLaneIndex() ^ 2));
+    #elif defined(A_GLSL) && !defined(SPD_NO_WAVE_OPERATIONS)
     AH4 v0 = v;
     AH4 v1 = subgroupQuadSwapHorizontal(v);
     AH4 v2 = subgroupQuadSwapVertical(v);
@@ -786,6 +2446,36 @@ AH4 SpdReduceQuadH(AH4 v)
 
 }
 
+#if defined(SPD_WAVE_SHUFFLE) && !defined(SPD_NO_WAVE_OPERATIONS)
+// Same as SpdReduceQuadH on the lanes base, base | dx, base | dy and base | dx | dy of the wave, base = lane & ~(dx | dy).
+// The result is the one of lane base.
+AH4 SpdReduceLanesH(AH4 v, AU1 dx, AU1 dy)
+{
+    #if defined(SPD_REDUCTION_PAIRWISE) && defined(A_GLSL)
+    v = SpdReducePairH(v, subgroupShuffleXor(v, dx));
+    return SpdReducePairH(v, subgroupShuffleXor(v, dy));
+    #elif defined(SPD_REDUCTION_PAIRWISE) && defined(A_HLSL)
+    v = SpdReducePairH(v, WaveReadLaneAt(v, WaveGetLaneIndex() ^ dx));
+    return SpdReducePairH(v, WaveReadLaneAt(v, WaveGetLaneIndex() ^ dy));
+    #elif defined(A_GLSL)
+    AU1 base = gl_SubgroupInvocationID & ~(dx | dy);
+    AH4 v0 = v;
+    AH4 v1 = subgroupShuffle(v, base | dx);
+    AH4 v2 = subgroupShuffle(v, base | dy);
+    AH4 v3 = subgroupShuffle(v, base | dx | dy);
+    return SpdReduce4H(v0, v1, v2, v3);
+    #elif defined(A_HLSL)
+    AU1 base = WaveGetLaneIndex() & ~(dx | dy);
+    AH4 v0 = v;
+    AH4 v1 = WaveReadLaneAt(v, base | dx);
+    AH4 v2 = WaveReadLaneAt(v, base | dy);
+    AH4 v3 = WaveReadLaneAt(v, base | dx | dy);
+    return SpdReduce4H(v0, v1, v2, v3);
+    #endif
+    return AH4(0.0, 0.0, 0.0, 0.0);
+}
+#endif
+
 AH4 SpdReduceIntermediateH(AU2 i0, AU2 i1, AU2 i2, AU2 i3)
 {
     AH4 v0 = SpdLoadIntermediateH(i0.x, i0.y);
@@ -795,69 +2485,90 @@ AH4 SpdReduceIntermediateH(AU2 i0, AU2 i1, AU2 i2, AU2 i3)
     return SpdReduce4H(v0, v1, v2, v3);
 }
 
-AH4 SpdReduceLoad4H(AU2 i0, AU2 i1, AU2 i2, AU2 i3)
+#ifdef SPD_RESIDENCY
+AH4 SpdLoadResidentH(ASU2 p, AU1 slice)
 {
-    AH4 v0 = SpdLoadH(ASU2(i0));
-    AH4 v1 = SpdLoadH(ASU2(i1));
-    AH4 v2 = SpdLoadH(ASU2(i2));
-    AH4 v3 = SpdLoadH(ASU2(i3));
+    if (SpdTileResident(AU2(p), slice) == 0) return SpdResidencyFillH(slice);
+    return SpdLoadH(p, slice);
+}
+#endif
+
+AH4 SpdReduceLoad4H(AU2 i0, AU2 i1, AU2 i2, AU2 i3, AU1 slice)
+{
+#ifdef SPD_RESIDENCY
+    AH4 v0 = SpdLoadResidentH(ASU2(i0), slice);
+    AH4 v1 = SpdLoadResidentH(ASU2(i1), slice);
+    AH4 v2 = SpdLoadResidentH(ASU2(i2), slice);
+    AH4 v3 = SpdLoadResidentH(ASU2(i3), slice);
+#else
+    AH4 v0 = SpdLoadH(ASU2(i0), slice);
+    AH4 v1 = SpdLoadH(ASU2(i1), slice);
+    AH4 v2 = SpdLoadH(ASU2(i2), slice);
+    AH4 v3 = SpdLoadH(ASU2(i3), slice);
+#endif
     return SpdReduce4H(v0, v1, v2, v3);
 }
 
-AH4 SpdReduceLoad4H(AU2 base)
+AH4 SpdReduceLoad4H(AU2 base, AU1 slice)
 {
     return SpdReduceLoad4H(
         AU2(base + AU2(0, 0)),
         AU2(base + AU2(0, 1)), 
         AU2(base + AU2(1, 0)), 
-        AU2(base + AU2(1, 1)));
+        AU2(base + AU2(1, 1)), slice);
 }
 
-AH4 SpdReduceLoadSourceImage4H(AU2 i0, AU2 i1, AU2 i2, AU2 i3)
+AH4 SpdReduceLoadSourceImage4H(AU2 i0, AU2 i1, AU2 i2, AU2 i3, AU1 slice)
 {
-    AH4 v0 = SpdLoadSourceImageH(ASU2(i0));
-    AH4 v1 = SpdLoadSourceImageH(ASU2(i1));
-    AH4 v2 = SpdLoadSourceImageH(ASU2(i2));
-    AH4 v3 = SpdLoadSourceImageH(ASU2(i3));
+    AH4 v0 = SpdLoadSourceImageH(ASU2(i0), slice);
+    AH4 v1 = SpdLoadSourceImageH(ASU2(i1), slice);
+    AH4 v2 = SpdLoadSourceImageH(ASU2(i2), slice);
+    AH4 v3 = SpdLoadSourceImageH(ASU2(i3), slice);
+#ifdef SPD_COVERAGE
+    SpdCoverageAdd4(AF1(v0.a), AF1(v1.a), AF1(v2.a), AF1(v3.a), slice);
+#endif
     return SpdReduce4H(v0, v1, v2, v3);
 }
 
-AH4 SpdReduceLoadSourceImage4H(AU2 base)
+AH4 SpdReduceLoadSourceImage4H(AU2 base, AU1 slice)
 {
 #ifdef SPD_LINEAR_SAMPLER
-    return SpdLoadSourceImageH(ASU2(base));
+    return SpdLoadSourceImageH(ASU2(base), slice);
 #else
     return SpdReduceLoadSourceImage4H(
         AU2(base + AU2(0, 0)),
         AU2(base + AU2(0, 1)), 
         AU2(base + AU2(1, 0)), 
-        AU2(base + AU2(1, 1)));
+        AU2(base + AU2(1, 1)), slice);
 #endif
 }
 
-void SpdDownsampleMips_0_1_IntrinsicsH(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mips)
+void SpdDownsampleMips_0_1_IntrinsicsH(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mips, AU1 slice)
 {
     AH4 v[4];
 
     ASU2 tex = ASU2(workGroupID.xy * 64) + ASU2(x * 2, y * 2);
     ASU2 pix = ASU2(workGroupID.xy * 32) + ASU2(x, y);
-    v[0] = SpdReduceLoadSourceImage4H(tex);
-    SpdStoreH(pix, v[0], 0);
+    v[0] = SpdReduceLoadSourceImage4H(tex, slice);
+    SpdStoreH(pix, v[0], 0, slice);
 
     tex = ASU2(workGroupID.xy * 64) + ASU2(x * 2 + 32, y * 2);
     pix = ASU2(workGroupID.xy * 32) + ASU2(x + 16, y);
-    v[1] = SpdReduceLoadSourceImage4H(tex);
-    SpdStoreH(pix, v[1], 0);
+    v[1] = SpdReduceLoadSourceImage4H(tex, slice);
+    SpdStoreH(pix, v[1], 0, slice);
 
     tex = ASU2(workGroupID.xy * 64) + ASU2(x * 2, y * 2 + 32);
     pix = ASU2(workGroupID.xy * 32) + ASU2(x, y + 16);
-    v[2] = SpdReduceLoadSourceImage4H(tex);
-    SpdStoreH(pix, v[2], 0);
+    v[2] = SpdReduceLoadSourceImage4H(tex, slice);
+    SpdStoreH(pix, v[2], 0, slice);
 
     tex = ASU2(workGroupID.xy * 64) + ASU2(x * 2 + 32, y * 2 + 32);
     pix = ASU2(workGroupID.xy * 32) + ASU2(x + 16, y + 16);
-    v[3] = SpdReduceLoadSourceImage4H(tex);
-    SpdStoreH(pix, v[3], 0);
+    v[3] = SpdReduceLoadSourceImage4H(tex, slice);
+    SpdStoreH(pix, v[3], 0, slice);
+#ifdef SPD_HISTOGRAM
+    SpdHistogramAdd4(AF4(v[0]), AF4(v[1]), AF4(v[2]), AF4(v[3]), ASU2(workGroupID.xy * 32) + ASU2(x, y), slice);
+#endif
 
     if (mips <= 1)
         return;
@@ -869,43 +2580,46 @@ void SpdDownsampleMips_0_1_IntrinsicsH(AU1 x, AU1 y, AU2 workGroupID, AU1 localI
 
     if ((localInvocationIndex % 4) == 0)
     {
-        SpdStoreH(ASU2(workGroupID.xy * 16) + ASU2(x/2, y/2), v[0], 1);
+        SpdStoreH(ASU2(workGroupID.xy * 16) + ASU2(x/2, y/2), v[0], 1, slice);
         SpdStoreIntermediateH(x/2, y/2, v[0]);
 
-        SpdStoreH(ASU2(workGroupID.xy * 16) + ASU2(x/2 + 8, y/2), v[1], 1);
+        SpdStoreH(ASU2(workGroupID.xy * 16) + ASU2(x/2 + 8, y/2), v[1], 1, slice);
         SpdStoreIntermediateH(x/2 + 8, y/2, v[1]);
 
-        SpdStoreH(ASU2(workGroupID.xy * 16) + ASU2(x/2, y/2 + 8), v[2], 1);
+        SpdStoreH(ASU2(workGroupID.xy * 16) + ASU2(x/2, y/2 + 8), v[2], 1, slice);
         SpdStoreIntermediateH(x/2, y/2 + 8, v[2]);
 
-        SpdStoreH(ASU2(workGroupID.xy * 16) + ASU2(x/2 + 8, y/2 + 8), v[3], 1);
+        SpdStoreH(ASU2(workGroupID.xy * 16) + ASU2(x/2 + 8, y/2 + 8), v[3], 1, slice);
         SpdStoreIntermediateH(x/2 + 8, y/2 + 8, v[3]);
     }
 }
 
-void SpdDownsampleMips_0_1_LDSH(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mips) 
+void SpdDownsampleMips_0_1_LDSH(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mips, AU1 slice) 
 {
     AH4 v[4];
 
     ASU2 tex = ASU2(workGroupID.xy * 64) + ASU2(x * 2, y * 2);
     ASU2 pix = ASU2(workGroupID.xy * 32) + ASU2(x, y);
-    v[0] = SpdReduceLoadSourceImage4H(tex);
-    SpdStoreH(pix, v[0], 0);
+    v[0] = SpdReduceLoadSourceImage4H(tex, slice);
+    SpdStoreH(pix, v[0], 0, slice);
 
     tex = ASU2(workGroupID.xy * 64) + ASU2(x * 2 + 32, y * 2);
     pix = ASU2(workGroupID.xy * 32) + ASU2(x + 16, y);
-    v[1] = SpdReduceLoadSourceImage4H(tex);
-    SpdStoreH(pix, v[1], 0);
+    v[1] = SpdReduceLoadSourceImage4H(tex, slice);
+    SpdStoreH(pix, v[1], 0, slice);
 
     tex = ASU2(workGroupID.xy * 64) + ASU2(x * 2, y * 2 + 32);
     pix = ASU2(workGroupID.xy * 32) + ASU2(x, y + 16);
-    v[2] = SpdReduceLoadSourceImage4H(tex);
-    SpdStoreH(pix, v[2], 0);
+    v[2] = SpdReduceLoadSourceImage4H(tex, slice);
+    SpdStoreH(pix, v[2], 0, slice);
 
     tex = ASU2(workGroupID.xy * 64) + ASU2(x * 2 + 32, y * 2 + 32);
     pix = ASU2(workGroupID.xy * 32) + ASU2(x + 16, y + 16);
-    v[3] = SpdReduceLoadSourceImage4H(tex);
-    SpdStoreH(pix, v[3], 0);
+    v[3] = SpdReduceLoadSourceImage4H(tex, slice);
+    SpdStoreH(pix, v[3], 0, slice);
+#ifdef SPD_HISTOGRAM
+    SpdHistogramAdd4(AF4(v[0]), AF4(v[1]), AF4(v[2]), AF4(v[3]), ASU2(workGroupID.xy * 32) + ASU2(x, y), slice);
+#endif
 
     if (mips <= 1)
         return;
@@ -922,7 +2636,7 @@ void SpdDownsampleMips_0_1_LDSH(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocati
                 AU2(x * 2 + 0, y * 2 + 1),
                 AU2(x * 2 + 1, y * 2 + 1)
             );
-            SpdStoreH(ASU2(workGroupID.xy * 16) + ASU2(x + (i % 2) * 8, y + (i / 2) * 8), v[i], 1);
+            SpdStoreH(ASU2(workGroupID.xy * 16) + ASU2(x + (i % 2) * 8, y + (i / 2) * 8), v[i], 1, slice);
         }
         SpdWorkgroupShuffleBarrier();
     }
@@ -936,17 +2650,17 @@ void SpdDownsampleMips_0_1_LDSH(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocati
     }
 }
 
-void SpdDownsampleMips_0_1H(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mips) 
+void SpdDownsampleMips_0_1H(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mips, AU1 slice) 
 {
 #ifdef SPD_NO_WAVE_OPERATIONS
-    SpdDownsampleMips_0_1_LDSH(x, y, workGroupID, localInvocationIndex, mips);
+    SpdDownsampleMips_0_1_LDSH(x, y, workGroupID, localInvocationIndex, mips, slice);
 #else
-    SpdDownsampleMips_0_1_IntrinsicsH(x, y, workGroupID, localInvocationIndex, mips);
+    SpdDownsampleMips_0_1_IntrinsicsH(x, y, workGroupID, localInvocationIndex, mips, slice);
 #endif
 }
 
 
-void SpdDownsampleMip_2H(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mip)
+void SpdDownsampleMip_2H(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mip, AU1 slice)
 {
 #ifdef SPD_NO_WAVE_OPERATIONS
     if (localInvocationIndex < 64)
@@ -957,7 +2671,7 @@ void SpdDownsampleMip_2H(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex
             AU2(x * 2 + 0 + 0, y * 2 + 1),
             AU2(x * 2 + 0 + 1, y * 2 + 1)
         );
-        SpdStoreH(ASU2(workGroupID.xy * 8) + ASU2(x, y), v, mip);
+        SpdStoreH(ASU2(workGroupID.xy * 8) + ASU2(x, y), v, mip, slice);
         // store to LDS, try to reduce bank conflicts
         // x 0 x 0 x 0 x 0 x 0 x 0 x 0 x 0
         // 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0
@@ -974,13 +2688,13 @@ void SpdDownsampleMip_2H(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex
     // quad index 0 stores result
     if (localInvocationIndex % 4 == 0)
     {   
-        SpdStoreH(ASU2(workGroupID.xy * 8) + ASU2(x/2, y/2), v, mip);
+        SpdStoreH(ASU2(workGroupID.xy * 8) + ASU2(x/2, y/2), v, mip, slice);
         SpdStoreIntermediateH(x + (y/2) % 2, y, v);
     }
 #endif
 }
 
-void SpdDownsampleMip_3H(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mip)
+void SpdDownsampleMip_3H(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mip, AU1 slice)
 {
 #ifdef SPD_NO_WAVE_OPERATIONS
     if (localInvocationIndex < 16)
@@ -995,7 +2709,7 @@ void SpdDownsampleMip_3H(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex
             AU2(x * 4 + 0 + 1, y * 4 + 2),
             AU2(x * 4 + 2 + 1, y * 4 + 2)
         );
-        SpdStoreH(ASU2(workGroupID.xy * 4) + ASU2(x, y), v, mip);
+        SpdStoreH(ASU2(workGroupID.xy * 4) + ASU2(x, y), v, mip, slice);
         // store to LDS
         // x 0 0 0 x 0 0 0 x 0 0 0 x 0 0 0
         // 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0
@@ -1017,14 +2731,14 @@ void SpdDownsampleMip_3H(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex
         // quad index 0 stores result
         if (localInvocationIndex % 4 == 0)
         {   
-            SpdStoreH(ASU2(workGroupID.xy * 4) + ASU2(x/2, y/2), v, mip);
+            SpdStoreH(ASU2(workGroupID.xy * 4) + ASU2(x/2, y/2), v, mip, slice);
             SpdStoreIntermediateH(x * 2 + y/2, y * 2, v);
         }
     }
 #endif
 }
 
-void SpdDownsampleMip_4H(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mip)
+void SpdDownsampleMip_4H(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mip, AU1 slice)
 {
 #ifdef SPD_NO_WAVE_OPERATIONS
     if (localInvocationIndex < 4)
@@ -1038,7 +2752,7 @@ void SpdDownsampleMip_4H(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex
             AU2(x * 8 + 0 + 1 + y * 2, y * 8 + 4),
             AU2(x * 8 + 4 + 1 + y * 2, y * 8 + 4)
         );
-        SpdStoreH(ASU2(workGroupID.xy * 2) + ASU2(x, y), v, mip);
+        SpdStoreH(ASU2(workGroupID.xy * 2) + ASU2(x, y), v, mip, slice);
         // store to LDS
         // x x x x 0 ...
         // 0 ...
@@ -1052,14 +2766,14 @@ void SpdDownsampleMip_4H(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex
         // quad index 0 stores result
         if (localInvocationIndex % 4 == 0)
         {   
-            SpdStoreH(ASU2(workGroupID.xy * 2) + ASU2(x/2, y/2), v, mip);
+            SpdStoreH(ASU2(workGroupID.xy * 2) + ASU2(x/2, y/2), v, mip, slice);
             SpdStoreIntermediateH(x / 2 + y, 0, v);
         }
     }
 #endif
 }
 
-void SpdDownsampleMip_5H(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mip)
+void SpdDownsampleMip_5H(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 mip, AU1 slice)
 {
 #ifdef SPD_NO_WAVE_OPERATIONS
     if (localInvocationIndex < 1)
@@ -1072,7 +2786,7 @@ void SpdDownsampleMip_5H(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex
             AU2(2, 0),
             AU2(3, 0)
         );
-        SpdStoreH(ASU2(workGroupID.xy), v, mip);
+        SpdStoreH(ASU2(workGroupID.xy), v, mip, slice);
     }
 #else
     if (localInvocationIndex < 4)
@@ -1082,83 +2796,525 @@ void SpdDownsampleMip_5H(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex
         // quad index 0 stores result
         if (localInvocationIndex % 4 == 0)
         {   
-            SpdStoreH(ASU2(workGroupID.xy), v, mip);
+            SpdStoreH(ASU2(workGroupID.xy), v, mip, slice);
         }
     }
 #endif
 }
 
-void SpdDownsampleMips_6_7H(AU1 x, AU1 y, AU1 mips)
+void SpdDownsampleMips_6_7H(AU1 x, AU1 y, AU1 mips, AU1 slice)
 {
     ASU2 tex = ASU2(x * 4 + 0, y * 4 + 0);
     ASU2 pix = ASU2(x * 2 + 0, y * 2 + 0);
-    AH4 v0 = SpdReduceLoad4H(tex);
-    SpdStoreH(pix, v0, 6);
+    AH4 v0 = SpdReduceLoad4H(tex, slice);
+    SpdStoreH(pix, v0, 6, slice);
 
     tex = ASU2(x * 4 + 2, y * 4 + 0);
     pix = ASU2(x * 2 + 1, y * 2 + 0);
-    AH4 v1 = SpdReduceLoad4H(tex);
-    SpdStoreH(pix, v1, 6);
+    AH4 v1 = SpdReduceLoad4H(tex, slice);
+    SpdStoreH(pix, v1, 6, slice);
 
     tex = ASU2(x * 4 + 0, y * 4 + 2);
     pix = ASU2(x * 2 + 0, y * 2 + 1);
-    AH4 v2 = SpdReduceLoad4H(tex);
-    SpdStoreH(pix, v2, 6);
+    AH4 v2 = SpdReduceLoad4H(tex, slice);
+    SpdStoreH(pix, v2, 6, slice);
 
     tex = ASU2(x * 4 + 2, y * 4 + 2);
     pix = ASU2(x * 2 + 1, y * 2 + 1);
-    AH4 v3 = SpdReduceLoad4H(tex);
-    SpdStoreH(pix, v3, 6);
+    AH4 v3 = SpdReduceLoad4H(tex, slice);
+    SpdStoreH(pix, v3, 6, slice);
 
     if (mips < 8) return;
     // no barrier needed, working on values only from the same thread
 
     AH4 v = SpdReduce4H(v0, v1, v2, v3);
-    SpdStoreH(ASU2(x, y), v, 7);
+    SpdStoreH(ASU2(x, y), v, 7, slice);
     SpdStoreIntermediateH(x, y, v);
 }
 
-void SpdDownsampleNextFourH(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 baseMip, AU1 mips)
+#if defined(SPD_WAVE_SHUFFLE) && !defined(SPD_NO_WAVE_OPERATIONS)
+// Mips baseMip..baseMip + 3 from the 16x16 intermediate, after the barrier of SpdDownsampleNextFourH.
+// Invocation (x, y) holds texel (x, y) of the intermediate, lane bits 0 and 3 are bits 0 and 1 of x, lane bits 1 and 2
+// bits 0 and 1 of y, lane bit 4 is bit 2 of x and lane bit 5 bit 2 of y (ARmpRed8x8). So each 2x2 reduction combines the
+// lanes at the distances 1 and 2, then 8 and 4, then 16 and 32, then 64 and 128. A wave of 16 lanes covers the first two,
+// a wave of 64 lanes the first three. Only the reduction that crosses waves goes through LDS. Every wave stores into the
+// texels of the intermediate that it has read itself, so no barrier is needed before the stores.
+void SpdDownsampleNextFourWaveH(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 baseMip, AU1 mips, AU1 slice)
+{
+    AH4 v = SpdLoadIntermediateH(x, y);
+    v = SpdReduceQuadH(v);
+    if (localInvocationIndex % 4 == 0)
+    {
+        SpdStoreH(ASU2(workGroupID.xy * 8) + ASU2(x/2, y/2), v, baseMip, slice);
+    }
+
+    if (mips <= baseMip + 1) return;
+    v = SpdReduceLanesH(v, 8u, 4u);
+    if (localInvocationIndex % 16 == 0)
+    {
+        SpdStoreH(ASU2(workGroupID.xy * 4) + ASU2(x/4, y/4), v, baseMip + 1, slice);
+    }
+
+    if (mips <= baseMip + 2) return;
+    if (SpdWaveSize() >= 64)
+    {
+        v = SpdReduceLanesH(v, 16u, 32u);
+        if (localInvocationIndex % 64 == 0)
+        {
+            SpdStoreH(ASU2(workGroupID.xy * 2) + ASU2(x/8, y/8), v, baseMip + 2, slice);
+            SpdStoreIntermediateH(x, y, v);
+        }
+
+        if (mips <= baseMip + 3) return;
+        SpdWorkgroupShuffleBarrier();
+        if (localInvocationIndex < 4)
+        {
+            // lanes 0..3 are (0, 0), (1, 0), (0, 1), (1, 1)
+            v = SpdLoadIntermediateH(x * 8, y * 8);
+            v = SpdReduceQuadH(v);
+            if (localInvocationIndex == 0)
+            {
+                SpdStoreH(ASU2(workGroupID.xy), v, baseMip + 3, slice);
+            }
+        }
+    }
+    else
+    {
+        if (localInvocationIndex % 16 == 0)
+        {
+            SpdStoreIntermediateH(x, y, v);
+        }
+
+        SpdWorkgroupShuffleBarrier();
+        if (localInvocationIndex < 16)
+        {
+            // texel (x, y) of mip baseMip + 1 is at (x * 4, y * 4)
+            v = SpdLoadIntermediateH(x * 4, y * 4);
+            v = SpdReduceQuadH(v);
+            if (localInvocationIndex % 4 == 0)
+            {
+                SpdStoreH(ASU2(workGroupID.xy * 2) + ASU2(x/2, y/2), v, baseMip + 2, slice);
+            }
+
+            if (mips > baseMip + 3)
+            {
+                v = SpdReduceLanesH(v, 8u, 4u);
+                if (localInvocationIndex == 0)
+                {
+                    SpdStoreH(ASU2(workGroupID.xy), v, baseMip + 3, slice);
+                }
+            }
+        }
+    }
+}
+#endif
+
+void SpdDownsampleNextFourH(AU1 x, AU1 y, AU2 workGroupID, AU1 localInvocationIndex, AU1 baseMip, AU1 mips, AU1 slice)
 {
     if (mips <= baseMip) return;
     SpdWorkgroupShuffleBarrier();
-    SpdDownsampleMip_2H(x, y, workGroupID, localInvocationIndex, baseMip);
+#if defined(SPD_WAVE_SHUFFLE) && !defined(SPD_NO_WAVE_OPERATIONS)
+    if (SpdWaveSize() >= 16)
+    {
+        SpdDownsampleNextFourWaveH(x, y, workGroupID, localInvocationIndex, baseMip, mips, slice);
+        return;
+    }
+#endif
+    SpdDownsampleMip_2H(x, y, workGroupID, localInvocationIndex, baseMip, slice);
 
     if (mips <= baseMip + 1) return;
     SpdWorkgroupShuffleBarrier();
-    SpdDownsampleMip_3H(x, y, workGroupID, localInvocationIndex, baseMip + 1);
+    SpdDownsampleMip_3H(x, y, workGroupID, localInvocationIndex, baseMip + 1, slice);
 
     if (mips <= baseMip + 2) return;
     SpdWorkgroupShuffleBarrier();
-    SpdDownsampleMip_4H(x, y, workGroupID, localInvocationIndex, baseMip + 2);
+    SpdDownsampleMip_4H(x, y, workGroupID, localInvocationIndex, baseMip + 2, slice);
 
     if (mips <= baseMip + 3) return;
     SpdWorkgroupShuffleBarrier();
-    SpdDownsampleMip_5H(x, y, workGroupID, localInvocationIndex, baseMip + 3);
+    SpdDownsampleMip_5H(x, y, workGroupID, localInvocationIndex, baseMip + 3, slice);
+}
+
+#ifdef SPD_COVERAGE
+// Same as SpdCoverageTile, SpdCoverageHistogram, SpdCoverageSolve, SpdCoverageScale and SpdCoverageApply on the packed hooks
+void SpdCoverageTileH(AU2 workGroupID, AU1 localInvocationIndex, AU1 mips, AU1 slice)
+{
+    SpdDeviceMemoryBarrier();
+    AU2 size = SpdCoverageSize(slice);
+    for (AU1 mip = 0; mip < min(mips, AU1(6)); mip++)
+    {
+        AU1 tile = AU1(32) >> mip;
+        AU2 mipSize = max(size >> AU2(mip + 1, mip + 1), AU2(1, 1));
+        for (AU1 i = localInvocationIndex; i < tile * tile; i += 256)
+        {
+            AU2 pix = workGroupID * tile + AU2(i % tile, i / tile);
+            if (pix.x < mipSize.x && pix.y < mipSize.y)
+                SpdCoverageAddLDS(1 + mip * SPD_COVERAGE_BINS + SpdCoverageBin(AF1(SpdLoadMipH(ASU2(pix), mip, slice).a)), 1);
+        }
+    }
+}
+
+void SpdCoverageHistogramH(AU1 localInvocationIndex, AU2 mipSize, AU1 mip, AU1 slice, AU1 parent)
+{
+    SpdDeviceMemoryBarrier();
+    for (AU1 bin = localInvocationIndex; bin < SPD_COVERAGE_BINS; bin += 256)
+        SpdCoverageStoreLDS(1 + bin, mip < 6 ? SpdCoverageLoadGlobal(1 + mip * SPD_COVERAGE_BINS + bin, slice) : 0);
+    SpdWorkgroupShuffleBarrier();
+    if (mip < 6)
+        return;
+    for (AU1 i = localInvocationIndex; i < mipSize.x * mipSize.y; i += 256)
+    {
+        AF1 alpha = AF1(SpdLoadMipH(ASU2(i % mipSize.x, i / mipSize.x), mip, slice).a);
+        if (parent == SPD_COVERAGE_BINS)
+            SpdCoverageAddLDS(1 + SpdCoverageBin(alpha), 1);
+        else if (SpdCoverageBin(alpha) == parent)
+            SpdCoverageAddLDS(1 + SpdCoverageSubBin(alpha, parent), 1);
+    }
+    SpdWorkgroupShuffleBarrier();
 }
 
+AF1 SpdCoverageSolveH(AU1 localInvocationIndex, AU2 mipSize, AU1 mip, AU1 slice, AF1 target, AF1 reference)
+{
+    SpdCoverageHistogramH(localInvocationIndex, mipSize, mip, slice, SPD_COVERAGE_BINS);
+    AF1 above = AF1_(0.0);
+    AU1 parent = SPD_COVERAGE_BINS;
+    if (mip >= 6 && AF1_(SPD_COVERAGE_ALPHA_STEP) * AF1_(SPD_COVERAGE_BINS - 1) < AF1_(0.5))
+    {
+        parent = SpdCoverageFind(target, above);
+        SpdCoverageHistogramH(localInvocationIndex, mipSize, mip, slice, parent);
+    }
+    return SpdCoverageAlphaScale(SpdCoverageThreshold(target, above, parent), reference);
+}
+
+void SpdCoverageScaleH(AU1 localInvocationIndex, AU1 mips, AU1 slice)
+{
+    AU2 size = SpdCoverageSize(slice);
+    AF1 reference = SpdAlphaReference(slice);
+    AF1 coverage = AF1(SpdCoverageLoadGlobal(0, slice)) / AF1(size.x * size.y);
+    for (AU1 mip = 0; mip < mips; mip++)
+    {
+        AU2 mipSize = max(size >> AU2(mip + 1, mip + 1), AU2(1, 1));
+        AF1 target = coverage * AF1(mipSize.x * mipSize.y);
+        AF1 scale = AF1_(1.0);
+        if (target > AF1_(0.0))
+            scale = SpdCoverageSolveH(localInvocationIndex, mipSize, mip, slice, target, reference);
+        if (localInvocationIndex == 0)
+            SpdStoreAlphaScale(scale, mip, slice);
+    }
+    SpdCoverageReset(localInvocationIndex, slice);
+}
+
+void SpdCoverageApplyH(AU2 workGroupID, AU1 localInvocationIndex, AU1 mips, AU1 slice)
+{
+    AU2 size = SpdCoverageSize(slice);
+    for (AU1 mip = 0; mip < mips; mip++)
+    {
+        AU2 mipSize = max(size >> AU2(mip + 1, mip + 1), AU2(1, 1));
+        if (mip >= 6 && (workGroupID.x | workGroupID.y) != 0)
+            return;
+        AU2 tile = mip < 6 ? AU2(AU1(32) >> mip, AU1(32) >> mip) : mipSize;
+        AF1 scale = SpdLoadAlphaScale(mip, slice);
+        for (AU1 i = localInvocationIndex; i < tile.x * tile.y; i += 256)
+        {
+            AU2 pix = workGroupID * tile + AU2(i % tile.x, i / tile.x);
+            if (pix.x < mipSize.x && pix.y < mipSize.y)
+            {
+                AH4 v = SpdLoadMipH(ASU2(pix), mip, slice);
+                SpdStoreH(ASU2(pix), AH4(v.rgb, AH1(min(AF1(v.a) * scale, AF1_(1.0)))), mip, slice);
+            }
+        }
+    }
+}
+#endif // SPD_COVERAGE
+
 void SpdDownsampleH(
     AU2 workGroupID,
     AU1 localInvocationIndex,
     AU1 mips,
-    AU1 numWorkGroups
+    AU1 numWorkGroups,
+    AU1 slice
 ) {
     AU2 sub_xy = ARmpRed8x8(localInvocationIndex % 64);
     AU1 x = sub_xy.x + 8 * ((localInvocationIndex >> 6) % 2);
     AU1 y = sub_xy.y + 8 * ((localInvocationIndex >> 7));
 
-    SpdDownsampleMips_0_1H(x, y, workGroupID, localInvocationIndex, mips);
+#ifdef SPD_HISTOGRAM
+    SpdHistogramClear(localInvocationIndex);
+#endif
+#ifdef SPD_COVERAGE
+    SpdCoverageClear(localInvocationIndex);
+#endif
+#ifdef SPD_RESIDENCY
+    if (SpdTileResident(workGroupID, slice) != 0)
+#endif
+    {
+        SpdDownsampleMips_0_1H(x, y, workGroupID, localInvocationIndex, mips, slice);
+
+        SpdDownsampleNextFourH(x, y, workGroupID, localInvocationIndex, 2, mips, slice);
+#ifdef SPD_COVERAGE
+        SpdCoverageTileH(workGroupID, localInvocationIndex, mips, slice);
+#endif
+    }
+
+#if defined(SPD_HISTOGRAM) || defined(SPD_COVERAGE)
+    // the exposure and the alpha scales need the last work group for any number of mips
+#ifdef SPD_HISTOGRAM
+    SpdHistogramMerge(localInvocationIndex, slice);
+#endif
+#ifdef SPD_COVERAGE
+    SpdCoverageMerge(localInvocationIndex, slice);
+#endif
 
-    SpdDownsampleNextFourH(x, y, workGroupID, localInvocationIndex, 2, mips);
+    if (SpdExitWorkgroup(numWorkGroups, localInvocationIndex, slice)) return;
 
+#ifdef SPD_HISTOGRAM
+    SpdHistogramExposure(localInvocationIndex, slice);
+#endif
+#else
     if (mips < 7) return;
 
-    if (SpdExitWorkgroup(numWorkGroups, localInvocationIndex)) return;
+    if (SpdExitWorkgroup(numWorkGroups, localInvocationIndex, slice)) return;
+#endif
 
-    // After mip 6 there is only a single workgroup left that downsamples the remaining up to 64x64 texels.
-    SpdDownsampleMips_6_7H(x, y, mips);
+    if (mips > 6)
+    {
+        // After mip 6 there is only a single workgroup left that downsamples the remaining up to 64x64 texels.
+        SpdDownsampleMips_6_7H(x, y, mips, slice);
+
+        SpdDownsampleNextFourH(x, y, AU2(0,0), localInvocationIndex, 8, mips, slice);
+    }
+
+#ifdef SPD_COVERAGE
+    SpdCoverageScaleH(localInvocationIndex, mips, slice);
+#endif
+}
+
+// Sub-rectangle, see [RECT]: workGroupID counts from 0 in the dispatch of SpdSetup, workGroupOffset is the one of SpdSetup.
+void SpdDownsampleH(
+    AU2 workGroupID,
+    AU1 localInvocationIndex,
+    AU1 mips,
+    AU1 numWorkGroups,
+    AU1 slice,
+    AU2 workGroupOffset
+) {
+    SpdDownsampleH(workGroupID + workGroupOffset, localInvocationIndex, mips, numWorkGroups, slice);
+}
 
-    SpdDownsampleNextFourH(x, y, AU2(0,0), localInvocationIndex, 8, mips);
+#if defined(SPD_EXTENDED) || defined(SPD_DIRTY_TILES)
+AH4 SpdReduceLoadMip4H(AU2 base, AU1 mip, AU1 slice)
+{
+#ifdef SPD_RESIDENCY
+    if (mip == 5)
+    {
+        AH4 v0 = SpdLoadResidentH(ASU2(base + AU2(0, 0)), slice);
+        AH4 v1 = SpdLoadResidentH(ASU2(base + AU2(0, 1)), slice);
+        AH4 v2 = SpdLoadResidentH(ASU2(base + AU2(1, 0)), slice);
+        AH4 v3 = SpdLoadResidentH(ASU2(base + AU2(1, 1)), slice);
+        return SpdReduce4H(v0, v1, v2, v3);
+    }
+#endif
+    AH4 v0 = SpdLoadMipH(ASU2(base + AU2(0, 0)), mip, slice);
+    AH4 v1 = SpdLoadMipH(ASU2(base + AU2(0, 1)), mip, slice);
+    AH4 v2 = SpdLoadMipH(ASU2(base + AU2(1, 0)), mip, slice);
+    AH4 v3 = SpdLoadMipH(ASU2(base + AU2(1, 1)), mip, slice);
+    return SpdReduce4H(v0, v1, v2, v3);
 }
+#endif
+
+#ifdef SPD_EXTENDED
+
+// Mips baseMip and baseMip + 1 of a block from the up to 64x64 texels of mip baseMip - 1, same as SpdDownsampleMips_6_7H
+void SpdDownsampleBlockMipsH(AU1 x, AU1 y, AU2 blockID, AU1 baseMip, AU1 mips, AU1 slice)
+{
+    AU2 tex = blockID * 64 + AU2(x * 4, y * 4);
+    AU2 pix = blockID * 32 + AU2(x * 2, y * 2);
+    AH4 v0 = SpdReduceLoadMip4H(tex + AU2(0, 0), baseMip - 1, slice);
+    SpdStoreH(ASU2(pix + AU2(0, 0)), v0, baseMip, slice);
+
+    AH4 v1 = SpdReduceLoadMip4H(tex + AU2(2, 0), baseMip - 1, slice);
+    SpdStoreH(ASU2(pix + AU2(1, 0)), v1, baseMip, slice);
+
+    AH4 v2 = SpdReduceLoadMip4H(tex + AU2(0, 2), baseMip - 1, slice);
+    SpdStoreH(ASU2(pix + AU2(0, 1)), v2, baseMip, slice);
+
+    AH4 v3 = SpdReduceLoadMip4H(tex + AU2(2, 2), baseMip - 1, slice);
+    SpdStoreH(ASU2(pix + AU2(1, 1)), v3, baseMip, slice);
+
+    if (mips <= baseMip + 1) return;
+    // no barrier needed, working on values only from the same thread
+
+    AH4 v = SpdReduce4H(v0, v1, v2, v3);
+    SpdStoreH(ASU2(blockID * 16 + AU2(x, y)), v, baseMip + 1, slice);
+    SpdStoreIntermediateH(x, y, v);
+}
+
+void SpdDownsampleExtendedH(
+    AU2 workGroupID,
+    AU1 localInvocationIndex,
+    AU1 mips,
+    AU2 numWorkGroups,
+    AU1 slice
+) {
+    AU2 sub_xy = ARmpRed8x8(localInvocationIndex % 64);
+    AU1 x = sub_xy.x + 8 * ((localInvocationIndex >> 6) % 2);
+    AU1 y = sub_xy.y + 8 * ((localInvocationIndex >> 7));
+#ifdef SPD_RESIDENCY
+    if (SpdTileResident(workGroupID, slice) != 0)
+#endif
+    {
+        SpdDownsampleMips_0_1H(x, y, workGroupID, localInvocationIndex, mips, slice);
+
+        SpdDownsampleNextFourH(x, y, workGroupID, localInvocationIndex, 2, mips, slice);
+    }
+
+    if (mips <= 6) return;
+
+    // The last workgroup of each block of 64x64 workgroups downsamples the up to 64x64 texels of mip 5 of the block.
+    AU2 blockID = workGroupID / 64;
+    AU2 blockSize = min(AU2(64, 64), numWorkGroups - blockID * 64);
+    AU2 numBlocks = (numWorkGroups + 63) / 64;
+    if (SpdExitBlock(blockSize.x * blockSize.y, localInvocationIndex, blockID.y * numBlocks.x + blockID.x, slice)) return;
+
+    SpdDownsampleBlockMipsH(x, y, blockID, 6, mips, slice);
+
+    SpdDownsampleNextFourH(x, y, blockID, localInvocationIndex, 8, mips, slice);
+
+    if (mips <= 12) return;
+
+    // After mip 12 there is only a single workgroup left that downsamples the remaining up to 64x64 texels of mip 11.
+    if (SpdExitWorkgroup(numBlocks.x * numBlocks.y, localInvocationIndex, slice)) return;
+
+    SpdDownsampleBlockMipsH(x, y, AU2(0, 0), 12, mips, slice);
 
-#endif
\ No newline at end of file
+    SpdDownsampleNextFourH(x, y, AU2(0, 0), localInvocationIndex, 14, mips, slice);
+}
+#endif // SPD_EXTENDED
+
+#ifdef SPD_SPLIT_TAIL
+// Same as SpdDownsampleSplitTail on the packed hooks
+void SpdDownsampleSplitTailH(
+    AU2 workGroupID,
+    AU1 localInvocationIndex,
+    AU1 mips,
+    AU2 numWorkGroups,
+    AU1 slice
+) {
+    AU2 sub_xy = ARmpRed8x8(localInvocationIndex % 64);
+    AU1 x = sub_xy.x + 8 * ((localInvocationIndex >> 6) % 2);
+    AU1 y = sub_xy.y + 8 * ((localInvocationIndex >> 7));
+#ifdef SPD_RESIDENCY
+    if (SpdTileResident(workGroupID, slice) != 0)
+#endif
+    {
+        SpdDownsampleMips_0_1H(x, y, workGroupID, localInvocationIndex, mips, slice);
+
+        SpdDownsampleNextFourH(x, y, workGroupID, localInvocationIndex, 2, mips, slice);
+    }
+
+    if (mips <= 6) return;
+
+    AU2 quadID = workGroupID / 4;
+    AU2 quadSize = min(AU2(4, 4), numWorkGroups - quadID * 4);
+    AU2 numQuads = (numWorkGroups + 3) / 4;
+    if (SpdExitBlock(quadSize.x * quadSize.y, localInvocationIndex, quadID.y * numQuads.x + quadID.x, slice)) return;
+
+    if (localInvocationIndex == 0)
+    {
+        SpdDownsampleMips_6_7H(quadID.x, quadID.y, mips, slice);
+        if (mips > 8) SpdStoreQuadH(quadID, SpdLoadIntermediateH(quadID.x, quadID.y), slice);
+    }
+
+    if (mips <= 8) return;
+
+    SpdDeviceMemoryBarrier();
+
+    if (SpdExitWorkgroup(numQuads.x * numQuads.y, localInvocationIndex, slice)) return;
+
+    if (x < numQuads.x && y < numQuads.y)
+        SpdStoreIntermediateH(x, y, SpdLoadQuadH(AU2(x, y), slice));
+    else
+        SpdDownsampleMips_6_7H(x, y, mips, slice);
+
+    SpdDownsampleNextFourH(x, y, AU2(0, 0), localInvocationIndex, 8, mips, slice);
+}
+#endif // SPD_SPLIT_TAIL
+
+#ifdef SPD_DIRTY_TILES
+// Same as SpdLoadDirtyTexel, SpdReduceDirtyTexel, SpdDownsampleDirtyAncestors and SpdDownsampleDirty on the packed hooks
+AH4 SpdLoadDirtyTexelH(AU2 p, AU1 mip, AU1 slice, AU2 size, AH4 z)
+{
+    AU2 mipSize = max(size >> AU2(mip + 1, mip + 1), AU2(1, 1));
+    if (p.x < mipSize.x && p.y < mipSize.y) return SpdLoadMipH(ASU2(p), mip, slice);
+    AU1 entry = 128 * (mip % 2);
+    if (p.x == mipSize.x && p.y <= mipSize.y) entry += p.y;
+    else if (p.y == mipSize.y && p.x < mipSize.x) entry += mipSize.y + 1 + p.x;
+    else return z;
+    return SpdLoadIntermediateH(entry % 16, entry / 16);
+}
+
+AH4 SpdReduceDirtyTexelH(AU2 p, AU1 mip, AU1 slice, AU2 size, AH4 z)
+{
+    if (mip == 6) return SpdReduceLoadMip4H(p * 2, 5, slice);
+    AH4 v0 = SpdLoadDirtyTexelH(p * 2 + AU2(0, 0), mip - 1, slice, size, z);
+    AH4 v1 = SpdLoadDirtyTexelH(p * 2 + AU2(1, 0), mip - 1, slice, size, z);
+    AH4 v2 = SpdLoadDirtyTexelH(p * 2 + AU2(0, 1), mip - 1, slice, size, z);
+    AH4 v3 = SpdLoadDirtyTexelH(p * 2 + AU2(1, 1), mip - 1, slice, size, z);
+    return SpdReduce4H(v0, v1, v2, v3);
+}
+
+void SpdDownsampleDirtyAncestorsH(AU1 localInvocationIndex, AU1 mips, AU1 numTiles, AU1 slice, AU2 size)
+{
+    AH4 z = AH4(0.0, 0.0, 0.0, 0.0);
+    for (AU1 mip = 6; mip < mips; mip++)
+    {
+        SpdDeviceMemoryBarrier();
+        AU2 mipSize = max(size >> AU2(mip + 1, mip + 1), AU2(1, 1));
+        if (localInvocationIndex < mipSize.x + mipSize.y + 1)
+        {
+            AU2 pix = localInvocationIndex <= mipSize.y ? AU2(mipSize.x, localInvocationIndex) : AU2(localInvocationIndex - mipSize.y - 1, mipSize.y);
+            AU1 entry = 128 * (mip % 2) + localInvocationIndex;
+            SpdStoreIntermediateH(entry % 16, entry / 16, SpdReduceDirtyTexelH(pix, mip, slice, size, z));
+        }
+        AU1 shift = mip - 5;
+        for (AU1 i = localInvocationIndex; i < numTiles; i += 256)
+        {
+            AU2 pix = SpdLoadDirtyTile(i, slice) >> AU2(shift, shift);
+            if (i > 0)
+            {
+                AU2 previous = SpdLoadDirtyTile(i - 1, slice) >> AU2(shift, shift);
+                if (previous.x == pix.x && previous.y == pix.y) continue;
+            }
+            SpdStoreH(ASU2(pix), SpdReduceDirtyTexelH(pix, mip, slice, size, z), mip, slice);
+        }
+        z = SpdReduce4H(z, z, z, z);
+        SpdWorkgroupShuffleBarrier();
+    }
+}
+
+void SpdDownsampleDirtyH(
+    AU1 tileIndex,
+    AU1 localInvocationIndex,
+    AU1 mips,
+    AU1 numTiles,
+    AU1 slice,
+    AU2 size
+) {
+    AU2 sub_xy = ARmpRed8x8(localInvocationIndex % 64);
+    AU1 x = sub_xy.x + 8 * ((localInvocationIndex >> 6) % 2);
+    AU1 y = sub_xy.y + 8 * ((localInvocationIndex >> 7));
+    AU2 workGroupID = SpdLoadDirtyTile(tileIndex, slice);
+    SpdDownsampleMips_0_1H(x, y, workGroupID, localInvocationIndex, mips, slice);
+
+    SpdDownsampleNextFourH(x, y, workGroupID, localInvocationIndex, 2, mips, slice);
+
+    if (mips <= 6) return;
+
+    if (SpdExitWorkgroup(numTiles, localInvocationIndex, slice)) return;
+
+    SpdDownsampleDirtyAncestorsH(localInvocationIndex, mips, numTiles, slice, size);
+}
+#endif // SPD_DIRTY_TILES
+
+#endif
+#endif // A_GPU
@@ -0,0 +1,1992 @@
+//_____________________________________________________________/\_______________________________________________________________
+//==============================================================================================================================
+//
+//                                      [FFX SPD] Single Pass Downsampler 1.0 - CPU PORT
+//
+//==============================================================================================================================
+// LICENSE
+// =======
+// Copyright (c) 2017-2020 Advanced Micro Devices, Inc. All rights reserved.
+// -------
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+// -------
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+// Software.
+// -------
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+// WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//------------------------------------------------------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------------------------------------------------------
+// ABOUT
+// =====
+// C++ port of ffx_spd.h on top of the A_CPU path of ffx_a.h.
+// It keeps the structure of the shader version:
+//  - one work group downsamples one 64x64 tile of the source into mips 0..5
+//  - every work group increases the atomic counter of its slice, the last one of the slice computes mips 6..11 from mip 5
+//  - all texture access goes through the same user defined hooks (SpdLoadSourceImage, SpdLoad, SpdStore, SpdReduce4)
+// The 256 invocations of a work group are executed by one CPU thread, so no barriers are needed.
+// The LDS (spd_intermediate[16][16]) becomes a small per thread scratch block owned by the caller.
+// Work groups can run on any number of CPU threads in any order, the atomic counter elects the last one.
+//
+// INTEGRATION SUMMARY
+// ===================
+// // Setup pre-portability-header defines
+// #define A_CPU 1
+// #define A_GCC 1 // when using a GCC compatible compiler
+// #include <stdint.h>
+// #include <math.h>
+// #include "ffx_a.h"
+// #include "ffx_spd_cpu.h"
+//
+// // Define the hooks as members of a struct.
+// // Loads outside of the image should return zero (same as an UAV load on the GPU), stores outside should be dropped.
+// // slice is the slice of a texture array or cube map (workGroupID.z on the GPU), 0 for a 2D texture.
+// struct MySpd
+// {
+//     // NON-PACKED
+//     void SpdLoadSourceImage(outAF4 d, ASU1 x, ASU1 y, AU1 slice);
+//     // loads mip 5, only used by the last work group
+//     void SpdLoad(outAF4 d, ASU1 x, ASU1 y, AU1 slice);
+//     void SpdStore(ASU1 x, ASU1 y, inAF4 value, AU1 mip, AU1 slice);
+//     void SpdReduce4(outAF4 d, inAF4 v0, inAF4 v1, inAF4 v2, inAF4 v3){
+//         for (int i = 0; i < 4; i++) d[i] = (v0[i] + v1[i] + v2[i] + v3[i]) * 0.25f;}
+//
+//     // PACKED - values are four fp16 bit patterns
+//     void SpdLoadSourceImageH(outAH4 d, ASU1 x, ASU1 y, AU1 slice);
+//     void SpdLoadH(outAH4 d, ASU1 x, ASU1 y, AU1 slice);
+//     void SpdStoreH(ASU1 x, ASU1 y, inAH4 value, AU1 mip, AU1 slice);
+//     void SpdReduce4H(outAH4 d, inAH4 v0, inAH4 v1, inAH4 v2, inAH4 v3);
+//
+//     // one counter per slice, returns the value before the increase, e.g. std::atomic<AU1>::fetch_add(1)
+//     AU1 SpdIncreaseAtomicCounter(AU1 slice);
+//     // sets the counter back to 0, called by the last work group so the next dispatch needs no clear
+//     void SpdResetAtomicCounter(AU1 slice);
+//
+//     // EXTENDED only - mip is 5 or 11, block = blockID.y * ((numWorkGroupsX + 63) / 64) + blockID.x
+//     // SPLIT TAIL uses the block counters as well - block = quadID.y * ((numWorkGroupsX + 3) / 4) + quadID.x
+//     void SpdLoadMip(outAF4 d, ASU1 x, ASU1 y, AU1 mip, AU1 slice);
+//     void SpdLoadMipH(outAH4 d, ASU1 x, ASU1 y, AU1 mip, AU1 slice);
+//     AU1 SpdIncreaseBlockCounter(AU1 block, AU1 slice);
+//     void SpdResetBlockCounter(AU1 block, AU1 slice);
+//
+//     // SPLIT TAIL only - the unrounded texel of mip 7 of each quad, 16x16 per slice, stored before the slice counter
+//     void SpdStoreQuad(ASU1 x, ASU1 y, inAF4 value, AU1 slice);
+//     void SpdLoadQuad(outAF4 d, ASU1 x, ASU1 y, AU1 slice);
+//     void SpdStoreQuadH(ASU1 x, ASU1 y, inAH4 value, AU1 slice);
+//     void SpdLoadQuadH(outAH4 d, ASU1 x, ASU1 y, AU1 slice);
+//
+//     // RESIDENCY only - nonzero for a resident tile and for the tiles outside of the source, the fill of mip 5 of the others
+//     AU1 SpdTileResident(AU1 x, AU1 y, AU1 slice);
+//     void SpdResidencyFill(outAF4 d, AU1 slice);
+//     void SpdResidencyFillH(outAH4 d, AU1 slice);
+// };
+//
+// // LDS replacement, one per CPU thread
+// SpdIntermediate lds; // PACKED: SpdIntermediateH
+//
+// // For each work group numWorkGroups = ((widthInPixels+63)>>6) * ((heightInPixels+63)>>6) of each slice, on any thread:
+// varAU2(workGroupID) = initAU2(x, y);
+// SpdDownsample(spd, lds, workGroupID, mips, numWorkGroups, slice);
+// // PACKED:
+// SpdDownsampleH(spd, ldsH, workGroupID, mips, numWorkGroups, slice);
+// // RECT, only the tiles of a sub-rectangle, workGroupOffset and numWorkGroups from SpdSetup of ffx_spd.h:
+// SpdDownsample(spd, lds, workGroupID, mips, numWorkGroups, slice, workGroupOffset);
+// // EXTENDED, sources larger than 4096x4096, numWorkGroups is the count in x and y:
+// SpdDownsampleExtended(spd, lds, workGroupID, mips, numWorkGroupsXY, slice);
+// // HISTOGRAM, the exposure of mip 0 with the hooks of HISTOGRAM, PACKED: SpdDownsampleHistogramH:
+// SpdDownsampleHistogram(spd, lds, workGroupID, mips, numWorkGroups, slice, params);
+// // COVERAGE, the alpha test coverage of the source in all mips with the hooks of COVERAGE, PACKED: SpdDownsampleCoverageH:
+// SpdDownsampleCoverage(spd, lds, workGroupID, mips, numWorkGroups, slice, params);
+// // DEPTH, hierarchical Z of a R32_FLOAT depth buffer with the hooks of DEPTH VERSION, size is the size of the source:
+// SpdIntermediateDepth ldsDepth;
+// SpdDownsampleDepth(spd, ldsDepth, workGroupID, mips, numWorkGroups, slice, size, reversedZ);
+// // FILTER, 4 and 6 tap filters with the hooks of FILTER VERSION, size is the size of the source:
+// SpdIntermediateFilter ldsFilter;
+// SpdDownsampleFilter(spd, ldsFilter, workGroupID, mips, numWorkGroups, slice, size, SPD_FILTER_LANCZOS);
+// // DIRTY TILES, only the tiles of a list built by SpdSetupDirtyTiles, numTiles work groups, PACKED: SpdDownsampleDirtyH:
+// AU1 numTiles = SpdSetupDirtyTiles(tiles, rects, rectCount, width, height);
+// SpdDownsampleDirty(spd, lds, tiles, tileIndex, mips, numTiles, slice, size);
+// // RESIDENCY, tiles that are not resident are skipped, numWorkGroups is the count in x and y, PACKED: SpdDownsampleResidentH:
+// SpdDownsampleResident(spd, lds, workGroupID, mips, numWorkGroupsXY, slice);
+// // SPLIT TAIL, mips 6 and 7 by the last work group of each quad of 4x4 work groups, PACKED: SpdDownsampleSplitTailH:
+// SpdDownsampleSplitTail(spd, lds, workGroupID, mips, numWorkGroupsXY, slice);
+// // WAVE SHUFFLE, emulation of the lanes of SPD_WAVE_SHUFFLE with the given wave size, PACKED: SpdDownsampleWaveH:
+// SpdDownsampleWave(spd, lds, workGroupID, mips, numWorkGroups, slice, waveSize);
+//------------------------------------------------------------------------------------------------------------------------------
+
+//==============================================================================================================================
+//                                                       PACKED TYPES
+//------------------------------------------------------------------------------------------------------------------------------
+// ffx_a.h has no 16-bit float type on the CPU, packed values are carried as their fp16 bit patterns.
+// Arithmetic on them is done in fp32, values are rounded back to fp16 when stored.
+// retAH4 has no restrict, it is ignored on a returned pointer and warns with -Wignored-qualifiers.
+//==============================================================================================================================
+#define retAH4 AW1 *
+#define inAH4 AW1 *A_RESTRICT
+#define outAH4 AW1 *A_RESTRICT
+#define varAH4(x) AW1 x[4]
+//------------------------------------------------------------------------------------------------------------------------------
+// Inverse of AU1_AH1_AF1(), supports denormals.
+A_STATIC AF1 AF1_AH1_AU1(AU1 h)
+{
+    AU1 s = (h & 0x8000) << 16;
+    AU1 e = (h >> 10) & 0x1f;
+    AU1 m = h & 0x3ff;
+    union{AF1 f;AU1 u;}bits;
+    if (e == 0)
+    {
+        // zero / denormal: m * 2^-24
+        bits.f = AF1_(m) * (1.0f / 16777216.0f);
+        bits.u |= s;
+        return bits.f;
+    }
+    if (e == 0x1f) bits.u = s | 0x7f800000 | (m << 13);
+    else bits.u = s | ((e + 112) << 23) | (m << 13);
+    return bits.f;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+A_STATIC retAF4 opAF4_AH4(outAF4 d, inAH4 a){d[0]=AF1_AH1_AU1(a[0]);d[1]=AF1_AH1_AU1(a[1]);d[2]=AF1_AH1_AU1(a[2]);d[3]=AF1_AH1_AU1(a[3]);return d;}
+A_STATIC retAH4 opAH4_AF4(outAH4 d, inAF4 a){d[0]=AW1(AU1_AH1_AF1(a[0]));d[1]=AW1(AU1_AH1_AF1(a[1]));d[2]=AW1(AU1_AH1_AF1(a[2]));d[3]=AW1(AU1_AH1_AF1(a[3]));return d;}
+A_STATIC retAH4 opACpyH4(outAH4 d, inAH4 a){d[0]=a[0];d[1]=a[1];d[2]=a[2];d[3]=a[3];return d;}
+
+//==============================================================================================================================
+//                                                     INTERMEDIATE (LDS)
+//==============================================================================================================================
+// Replacement for 'shared AF4 spd_intermediate[16][16]', stored row major ([y][x]).
+struct SpdIntermediate
+{
+    AF1 v[16][16][4];
+};
+
+// PACKED: replacement for 'shared AH4 spd_intermediate[16][16]'
+struct SpdIntermediateH
+{
+    AW1 v[16][16][4];
+};
+
+//==============================================================================================================================
+//                                                    BUILT-IN REDUCTIONS
+//------------------------------------------------------------------------------------------------------------------------------
+// The reductions of SPD_REDUCTION in ffx_spd.h, to be called from SpdReduce4 of the hooks, e.g.
+//     void SpdReduce4(outAF4 d, inAF4 v0, inAF4 v1, inAF4 v2, inAF4 v3){SpdReduceMin4(d, v0, v1, v2, v3);}
+// The packed hooks convert to fp32 and call the same functions.
+// Min and max return the second value if the values are equal or one of them is NaN (same as SSE minps / maxps).
+//==============================================================================================================================
+A_STATIC void SpdReduceAverage4(outAF4 d, inAF4 v0, inAF4 v1, inAF4 v2, inAF4 v3)
+{
+    for (int i = 0; i < 4; i++) d[i] = (v0[i] + v1[i] + v2[i] + v3[i]) * 0.25f;
+}
+A_STATIC void SpdReduceMin4(outAF4 d, inAF4 v0, inAF4 v1, inAF4 v2, inAF4 v3)
+{
+    for (int i = 0; i < 4; i++) d[i] = AMinF1(AMinF1(v0[i], v1[i]), AMinF1(v2[i], v3[i]));
+}
+A_STATIC void SpdReduceMax4(outAF4 d, inAF4 v0, inAF4 v1, inAF4 v2, inAF4 v3)
+{
+    for (int i = 0; i < 4; i++) d[i] = AMaxF1(AMaxF1(v0[i], v1[i]), AMaxF1(v2[i], v3[i]));
+}
+// minimum in x and z, maximum in y and w
+A_STATIC void SpdReduceMinMax4(outAF4 d, inAF4 v0, inAF4 v1, inAF4 v2, inAF4 v3)
+{
+    for (int i = 0; i < 4; i += 2) d[i] = AMinF1(AMinF1(v0[i], v1[i]), AMinF1(v2[i], v3[i]));
+    for (int i = 1; i < 4; i += 2) d[i] = AMaxF1(AMaxF1(v0[i], v1[i]), AMaxF1(v2[i], v3[i]));
+}
+A_STATIC void SpdReduceSum4(outAF4 d, inAF4 v0, inAF4 v1, inAF4 v2, inAF4 v3)
+{
+    for (int i = 0; i < 4; i++) d[i] = v0[i] + v1[i] + v2[i] + v3[i];
+}
+// w holds the weights of v0..v3, all weights zero returns zero
+A_STATIC void SpdReduceWeighted4(outAF4 d, inAF4 v0, inAF4 v1, inAF4 v2, inAF4 v3, inAF4 w)
+{
+    AF1 sum = w[0] + w[1] + w[2] + w[3];
+    AF1 rcp = sum > 0.0f ? ARcpF1(sum) : 0.0f;
+    for (int i = 0; i < 4; i++) d[i] = (v0[i] * w[0] + v1[i] * w[1] + v2[i] * w[2] + v3[i] * w[3]) * rcp;
+}
+A_STATIC AF1 SpdLuminanceWeight(inAF4 v)
+{
+    return ARcpF1(1.0f + v[0] * 0.2126f + v[1] * 0.7152f + v[2] * 0.0722f);
+}
+// weights 1 / (1 + luma), single bright texels do not dominate the mips
+A_STATIC void SpdReduceLuminance4(outAF4 d, inAF4 v0, inAF4 v1, inAF4 v2, inAF4 v3)
+{
+    AF1 w[4] = { SpdLuminanceWeight(v0), SpdLuminanceWeight(v1), SpdLuminanceWeight(v2), SpdLuminanceWeight(v3) };
+    SpdReduceWeighted4(d, v0, v1, v2, v3, w);
+}
+// straight alpha colors averaged as if they were premultiplied, alpha is the plain average
+A_STATIC void SpdReducePremultiplied4(outAF4 d, inAF4 v0, inAF4 v1, inAF4 v2, inAF4 v3)
+{
+    AF1 a = v0[3] + v1[3] + v2[3] + v3[3];
+    AF1 rcp = a > 0.0f ? ARcpF1(a) : 0.0f;
+    for (int i = 0; i < 3; i++) d[i] = (v0[i] * v0[3] + v1[i] * v1[3] + v2[i] * v2[3] + v3[i] * v3[3]) * rcp;
+    d[3] = a * 0.25f;
+}
+// normal maps, xyz is a unit normal in -1..1 and w the roughness alpha: the normals are renormalized, the length they lose
+// adds the Toksvig variance (1 - |n|) / |n| to the average alpha^2. Texels with a zero normal are skipped.
+A_STATIC void SpdReduceNormal4(outAF4 d, inAF4 v0, inAF4 v1, inAF4 v2, inAF4 v3)
+{
+    const AF1 *v[4] = { v0, v1, v2, v3 };
+    AF1 n[3] = { 0.0f, 0.0f, 0.0f };
+    AF1 variance = 0.0f;
+    AF1 count = 0.0f;
+    for (int j = 0; j < 4; j++)
+    {
+        if (v[j][0] * v[j][0] + v[j][1] * v[j][1] + v[j][2] * v[j][2] <= 0.0f) continue;
+        for (int i = 0; i < 3; i++) n[i] += v[j][i];
+        variance += v[j][3] * v[j][3];
+        count += 1.0f;
+    }
+    if (count == 0.0f)
+    {
+        d[0] = d[1] = d[2] = d[3] = 0.0f;
+        return;
+    }
+    AF1 rcp = ARcpF1(count);
+    for (int i = 0; i < 3; i++) n[i] *= rcp;
+    AF1 len = ASqrtF1(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    variance = variance * rcp + (len > 0.0f ? (1.0f - len) * ARcpF1(len) : 1.0f);
+    for (int i = 0; i < 3; i++) d[i] = len > 0.0f ? n[i] * ARcpF1(len) : (i == 2 ? 1.0f : 0.0f);
+    d[3] = ASqrtF1(AMinF1(variance, 1.0f));
+}
+
+//==============================================================================================================================
+//                                                        SHARED CODE
+//------------------------------------------------------------------------------------------------------------------------------
+// Both the non-packed and the packed version run the same code below.
+// T is the element type (AF1 or AW1), Spd provides the hooks without the 'H' suffix.
+// SpdDownsampleH() maps the packed hooks with SpdPackedHooks.
+//==============================================================================================================================
+template<class Spd, class T>
+void SpdReduceLoadSourceImage4(Spd &spd, T *A_RESTRICT d, ASU1 x, ASU1 y, AU1 slice)
+{
+    T v0[4]; T v1[4]; T v2[4]; T v3[4];
+    spd.SpdLoadSourceImage(v0, x + 0, y + 0, slice);
+    spd.SpdLoadSourceImage(v1, x + 0, y + 1, slice);
+    spd.SpdLoadSourceImage(v2, x + 1, y + 0, slice);
+    spd.SpdLoadSourceImage(v3, x + 1, y + 1, slice);
+    spd.SpdReduce4(d, v0, v1, v2, v3);
+}
+
+template<class Spd, class T>
+void SpdReduceLoad4(Spd &spd, T *A_RESTRICT d, ASU1 x, ASU1 y, AU1 slice)
+{
+    T v0[4]; T v1[4]; T v2[4]; T v3[4];
+    spd.SpdLoad(v0, x + 0, y + 0, slice);
+    spd.SpdLoad(v1, x + 0, y + 1, slice);
+    spd.SpdLoad(v2, x + 1, y + 0, slice);
+    spd.SpdLoad(v3, x + 1, y + 1, slice);
+    spd.SpdReduce4(d, v0, v1, v2, v3);
+}
+
+template<class Spd, class T>
+void SpdReduceIntermediate(Spd &spd, T *A_RESTRICT d, T (*lds)[16][4], AU1 x, AU1 y)
+{
+    spd.SpdReduce4(d, lds[y + 0][x + 0], lds[y + 0][x + 1], lds[y + 1][x + 0], lds[y + 1][x + 1]);
+}
+
+// Each GPU invocation (x,y) of the 16x16 group handles one texel in each of the four 32x32 quadrants of the tile.
+// The quad reduction of mip 1 combines the invocations (x,y), (x+1,y), (x,y+1), (x+1,y+1).
+template<class Spd, class T>
+void SpdDownsampleMips_0_1(Spd &spd, T (*lds)[16][4], inAU2 workGroupID, AU1 mips, AU1 slice)
+{
+    for (AU1 i = 0; i < 4; i++)
+    {
+        AU1 qx = (i % 2) * 16;
+        AU1 qy = (i / 2) * 16;
+        for (AU1 y = 0; y < 16; y += 2)
+        {
+            for (AU1 x = 0; x < 16; x += 2)
+            {
+                T v[4][4];
+                for (AU1 j = 0; j < 4; j++)
+                {
+                    AU1 px = qx + x + (j % 2);
+                    AU1 py = qy + y + (j / 2);
+                    SpdReduceLoadSourceImage4(spd, v[j],
+                        ASU1(workGroupID[0] * 64 + px * 2),
+                        ASU1(workGroupID[1] * 64 + py * 2), slice);
+                    spd.SpdStore(ASU1(workGroupID[0] * 32 + px), ASU1(workGroupID[1] * 32 + py), v[j], 0, slice);
+                }
+
+                if (mips <= 1)
+                    continue;
+
+                AU1 ix = (qx + x) / 2;
+                AU1 iy = (qy + y) / 2;
+                spd.SpdReduce4(lds[iy][ix], v[0], v[1], v[2], v[3]);
+                spd.SpdStore(ASU1(workGroupID[0] * 16 + ix), ASU1(workGroupID[1] * 16 + iy), lds[iy][ix], 1, slice);
+            }
+        }
+    }
+}
+
+// Reduces the 16x16 intermediate in place down to 1x1, storing mips baseMip..baseMip+3.
+template<class Spd, class T>
+void SpdDownsampleNextFour(Spd &spd, T (*lds)[16][4], inAU2 workGroupID, AU1 baseMip, AU1 mips, AU1 slice)
+{
+    for (AU1 i = 0; i < 4; i++)
+    {
+        AU1 mip = baseMip + i;
+        if (mips <= mip) return;
+
+        AU1 size = 8 >> i;
+        for (AU1 y = 0; y < size; y++)
+        {
+            for (AU1 x = 0; x < size; x++)
+            {
+                // writing (x,y) never overwrites a texel that is read later on
+                T v[4];
+                SpdReduceIntermediate(spd, v, lds, x * 2, y * 2);
+                spd.SpdStore(ASU1(workGroupID[0] * size + x), ASU1(workGroupID[1] * size + y), v, mip, slice);
+                for (AU1 c = 0; c < 4; c++) lds[y][x][c] = v[c];
+            }
+        }
+    }
+}
+
+// Invocation (x,y) of SpdDownsampleMips_6_7: the 4x4 texels of mip 5 at (x * 4, y * 4) to 2x2 of mip 6 and d of mip 7.
+template<class Spd, class T>
+void SpdDownsampleInvocationMips_6_7(Spd &spd, T *A_RESTRICT d, AU1 x, AU1 y, AU1 mips, AU1 slice)
+{
+    T v[4][4];
+    for (AU1 j = 0; j < 4; j++)
+    {
+        AU1 px = x * 2 + (j % 2);
+        AU1 py = y * 2 + (j / 2);
+        SpdReduceLoad4(spd, v[j], ASU1(px * 2), ASU1(py * 2), slice);
+        spd.SpdStore(ASU1(px), ASU1(py), v[j], 6, slice);
+    }
+
+    if (mips <= 7) return;
+
+    spd.SpdReduce4(d, v[0], v[1], v[2], v[3]);
+    spd.SpdStore(ASU1(x), ASU1(y), d, 7, slice);
+}
+
+// Last work group: reads the up to 64x64 texels of mip 5 and writes mips 6 and 7.
+template<class Spd, class T>
+void SpdDownsampleMips_6_7(Spd &spd, T (*lds)[16][4], AU1 mips, AU1 slice)
+{
+    for (AU1 y = 0; y < 16; y++)
+    {
+        for (AU1 x = 0; x < 16; x++)
+        {
+            SpdDownsampleInvocationMips_6_7(spd, lds[y][x], x, y, mips, slice);
+        }
+    }
+}
+
+// Only last active workgroup of the slice should proceed
+template<class Spd>
+bool SpdExitWorkgroup(Spd &spd, AU1 numWorkGroups, AU1 slice)
+{
+    if (spd.SpdIncreaseAtomicCounter(slice) != (numWorkGroups - 1)) return true;
+    // all other workgroups have increased the counter already, reset it for the next dispatch
+    spd.SpdResetAtomicCounter(slice);
+    return false;
+}
+
+// Only last active workgroup of the block should proceed (extended version)
+template<class Spd>
+bool SpdExitBlock(Spd &spd, AU1 numWorkGroups, AU1 block, AU1 slice)
+{
+    if (spd.SpdIncreaseBlockCounter(block, slice) != (numWorkGroups - 1)) return true;
+    spd.SpdResetBlockCounter(block, slice);
+    return false;
+}
+
+// Mips 6 and up, after mips 0..5 of the tile
+template<class Spd, class T>
+void SpdDownsampleTail(Spd &spd, T (*lds)[16][4], AU1 mips, AU1 numWorkGroups, AU1 slice)
+{
+    if (mips <= 6) return;
+
+    if (SpdExitWorkgroup(spd, numWorkGroups, slice)) return;
+
+    // After mip 6 there is only a single workgroup left that downsamples the remaining up to 64x64 texels.
+    SpdDownsampleMips_6_7(spd, lds, mips, slice);
+
+    varAU2(tailID) = initAU2(0, 0);
+    SpdDownsampleNextFour(spd, lds, tailID, 8, mips, slice);
+}
+
+template<class Spd, class T>
+void SpdDownsampleT(Spd &spd, T (*lds)[16][4], inAU2 workGroupID, AU1 mips, AU1 numWorkGroups, AU1 slice)
+{
+    SpdDownsampleMips_0_1(spd, lds, workGroupID, mips, slice);
+
+    SpdDownsampleNextFour(spd, lds, workGroupID, 2, mips, slice);
+
+    SpdDownsampleTail(spd, lds, mips, numWorkGroups, slice);
+}
+
+//==============================================================================================================================
+//                                                     EXTENDED VERSION
+//------------------------------------------------------------------------------------------------------------------------------
+// Sources larger than 4096x4096 in one dispatch, up to 18 mips. The work groups form blocks of 64x64 work groups, the last
+// one of a block computes mips 6..11 of the block, the last block of the slice computes mips 12..17 from mip 11.
+//==============================================================================================================================
+template<class Spd, class T>
+void SpdReduceLoadMip4(Spd &spd, T *A_RESTRICT d, ASU1 x, ASU1 y, AU1 mip, AU1 slice)
+{
+    T v0[4]; T v1[4]; T v2[4]; T v3[4];
+    spd.SpdLoadMip(v0, x + 0, y + 0, mip, slice);
+    spd.SpdLoadMip(v1, x + 0, y + 1, mip, slice);
+    spd.SpdLoadMip(v2, x + 1, y + 0, mip, slice);
+    spd.SpdLoadMip(v3, x + 1, y + 1, mip, slice);
+    spd.SpdReduce4(d, v0, v1, v2, v3);
+}
+
+// Mips baseMip and baseMip + 1 of a block from the up to 64x64 texels of mip baseMip - 1, same as SpdDownsampleMips_6_7.
+template<class Spd, class T>
+void SpdDownsampleBlockMips(Spd &spd, T (*lds)[16][4], inAU2 blockID, AU1 baseMip, AU1 mips, AU1 slice)
+{
+    for (AU1 y = 0; y < 16; y++)
+    {
+        for (AU1 x = 0; x < 16; x++)
+        {
+            T v[4][4];
+            for (AU1 j = 0; j < 4; j++)
+            {
+                AU1 px = x * 2 + (j % 2);
+                AU1 py = y * 2 + (j / 2);
+                SpdReduceLoadMip4(spd, v[j], ASU1(blockID[0] * 64 + px * 2), ASU1(blockID[1] * 64 + py * 2), baseMip - 1, slice);
+                spd.SpdStore(ASU1(blockID[0] * 32 + px), ASU1(blockID[1] * 32 + py), v[j], baseMip, slice);
+            }
+
+            if (mips <= baseMip + 1) continue;
+
+            spd.SpdReduce4(lds[y][x], v[0], v[1], v[2], v[3]);
+            spd.SpdStore(ASU1(blockID[0] * 16 + x), ASU1(blockID[1] * 16 + y), lds[y][x], baseMip + 1, slice);
+        }
+    }
+}
+
+// Mips 6 and up, after mips 0..5 of the tile
+template<class Spd, class T>
+void SpdDownsampleExtendedTail(Spd &spd, T (*lds)[16][4], inAU2 workGroupID, AU1 mips, inAU2 numWorkGroups, AU1 slice)
+{
+    if (mips <= 6) return;
+
+    varAU2(blockID) = initAU2(workGroupID[0] / 64, workGroupID[1] / 64);
+    AU1 blockWidth = AMinU1(64, numWorkGroups[0] - blockID[0] * 64);
+    AU1 blockHeight = AMinU1(64, numWorkGroups[1] - blockID[1] * 64);
+    AU1 blocksX = (numWorkGroups[0] + 63) / 64;
+    AU1 blocksY = (numWorkGroups[1] + 63) / 64;
+    if (SpdExitBlock(spd, blockWidth * blockHeight, blockID[1] * blocksX + blockID[0], slice)) return;
+
+    SpdDownsampleBlockMips(spd, lds, blockID, 6, mips, slice);
+
+    SpdDownsampleNextFour(spd, lds, blockID, 8, mips, slice);
+
+    if (mips <= 12) return;
+
+    if (SpdExitWorkgroup(spd, blocksX * blocksY, slice)) return;
+
+    varAU2(tailID) = initAU2(0, 0);
+    SpdDownsampleBlockMips(spd, lds, tailID, 12, mips, slice);
+
+    SpdDownsampleNextFour(spd, lds, tailID, 14, mips, slice);
+}
+
+template<class Spd, class T>
+void SpdDownsampleExtendedT(Spd &spd, T (*lds)[16][4], inAU2 workGroupID, AU1 mips, inAU2 numWorkGroups, AU1 slice)
+{
+    SpdDownsampleMips_0_1(spd, lds, workGroupID, mips, slice);
+
+    SpdDownsampleNextFour(spd, lds, workGroupID, 2, mips, slice);
+
+    SpdDownsampleExtendedTail(spd, lds, workGroupID, mips, numWorkGroups, slice);
+}
+
+//==============================================================================================================================
+//                                                     NON-PACKED VERSION
+//==============================================================================================================================
+template<class Spd>
+void SpdDownsample(
+    Spd &spd,
+    SpdIntermediate &lds,
+    inAU2 workGroupID,
+    AU1 mips,
+    AU1 numWorkGroups,
+    AU1 slice
+) {
+    SpdDownsampleT(spd, lds.v, workGroupID, mips, numWorkGroups, slice);
+}
+
+// Sub-rectangle, same as [RECT] of ffx_spd.h: workGroupID counts from 0 in the dispatch of SpdSetup.
+template<class Spd>
+void SpdDownsample(
+    Spd &spd,
+    SpdIntermediate &lds,
+    inAU2 workGroupID,
+    AU1 mips,
+    AU1 numWorkGroups,
+    AU1 slice,
+    inAU2 workGroupOffset
+) {
+    varAU2(tile) = initAU2(workGroupID[0] + workGroupOffset[0], workGroupID[1] + workGroupOffset[1]);
+    SpdDownsampleT(spd, lds.v, tile, mips, numWorkGroups, slice);
+}
+
+template<class Spd>
+void SpdDownsampleExtended(
+    Spd &spd,
+    SpdIntermediate &lds,
+    inAU2 workGroupID,
+    AU1 mips,
+    inAU2 numWorkGroups,
+    AU1 slice
+) {
+    SpdDownsampleExtendedT(spd, lds.v, workGroupID, mips, numWorkGroups, slice);
+}
+
+//==============================================================================================================================
+//                                                       PACKED VERSION
+//==============================================================================================================================
+template<class Spd>
+struct SpdPackedHooks
+{
+    Spd &spd;
+    void SpdLoadSourceImage(outAH4 d, ASU1 x, ASU1 y, AU1 slice){spd.SpdLoadSourceImageH(d, x, y, slice);}
+    void SpdLoad(outAH4 d, ASU1 x, ASU1 y, AU1 slice){spd.SpdLoadH(d, x, y, slice);}
+    void SpdStore(ASU1 x, ASU1 y, inAH4 value, AU1 mip, AU1 slice){spd.SpdStoreH(x, y, value, mip, slice);}
+    void SpdReduce4(outAH4 d, inAH4 v0, inAH4 v1, inAH4 v2, inAH4 v3){spd.SpdReduce4H(d, v0, v1, v2, v3);}
+    AU1 SpdIncreaseAtomicCounter(AU1 slice){return spd.SpdIncreaseAtomicCounter(slice);}
+    void SpdResetAtomicCounter(AU1 slice){spd.SpdResetAtomicCounter(slice);}
+    void SpdLoadMip(outAH4 d, ASU1 x, ASU1 y, AU1 mip, AU1 slice){spd.SpdLoadMipH(d, x, y, mip, slice);}
+    AU1 SpdIncreaseBlockCounter(AU1 block, AU1 slice){return spd.SpdIncreaseBlockCounter(block, slice);}
+    void SpdResetBlockCounter(AU1 block, AU1 slice){spd.SpdResetBlockCounter(block, slice);}
+    void SpdStoreQuad(ASU1 x, ASU1 y, inAH4 value, AU1 slice){spd.SpdStoreQuadH(x, y, value, slice);}
+    void SpdLoadQuad(outAH4 d, ASU1 x, ASU1 y, AU1 slice){spd.SpdLoadQuadH(d, x, y, slice);}
+    AU1 SpdTileResident(AU1 x, AU1 y, AU1 slice){return spd.SpdTileResident(x, y, slice);}
+    void SpdResidencyFill(outAH4 d, AU1 slice){spd.SpdResidencyFillH(d, slice);}
+};
+
+template<class Spd>
+void SpdDownsampleH(
+    Spd &spd,
+    SpdIntermediateH &lds,
+    inAU2 workGroupID,
+    AU1 mips,
+    AU1 numWorkGroups,
+    AU1 slice
+) {
+    SpdPackedHooks<Spd> hooks = { spd };
+    SpdDownsampleT(hooks, lds.v, workGroupID, mips, numWorkGroups, slice);
+}
+
+template<class Spd>
+void SpdDownsampleH(
+    Spd &spd,
+    SpdIntermediateH &lds,
+    inAU2 workGroupID,
+    AU1 mips,
+    AU1 numWorkGroups,
+    AU1 slice,
+    inAU2 workGroupOffset
+) {
+    SpdPackedHooks<Spd> hooks = { spd };
+    varAU2(tile) = initAU2(workGroupID[0] + workGroupOffset[0], workGroupID[1] + workGroupOffset[1]);
+    SpdDownsampleT(hooks, lds.v, tile, mips, numWorkGroups, slice);
+}
+
+template<class Spd>
+void SpdDownsampleExtendedH(
+    Spd &spd,
+    SpdIntermediateH &lds,
+    inAU2 workGroupID,
+    AU1 mips,
+    inAU2 numWorkGroups,
+    AU1 slice
+) {
+    SpdPackedHooks<Spd> hooks = { spd };
+    SpdDownsampleExtendedT(hooks, lds.v, workGroupID, mips, numWorkGroups, slice);
+}
+
+//==============================================================================================================================
+//                                                         HISTOGRAM
+//------------------------------------------------------------------------------------------------------------------------------
+// Log2 luminance histogram of mip 0 and the exposure of the source in the same run, see HISTOGRAM in ffx_spd.h.
+// The bin count, the range, the percentiles and the size of mip 0 are runtime values of SpdHistogramParams. The texels are
+// counted as they are passed to SpdStore for mip 0, the ones outside of the size are not counted. Additional hooks:
+//     // one set of bins per slice, atomic, e.g. std::atomic<AU1>::fetch_add(count), zeroed once, reset by the last work group
+//     void SpdHistogramAddGlobal(AU1 bin, AU1 count, AU1 slice);
+//     AU1 SpdHistogramLoadGlobal(AU1 bin, AU1 slice);
+//     void SpdHistogramResetGlobal(AU1 bin, AU1 slice);
+//     // AF4(average, percentile average, low percentile, high percentile) luminance
+//     void SpdStoreExposure(inAF4 value, AU1 slice);
+// The last work group always runs, also for mips <= 6.
+//==============================================================================================================================
+#define SPD_HISTOGRAM_MAX_BINS 256
+
+struct SpdHistogramParams
+{
+    AU1 bins; // 2..SPD_HISTOGRAM_MAX_BINS, bin 0 holds the texels below the range
+    AF1 minLog2Luminance;
+    AF1 log2Range;
+    AF1 lowPercentile; // e.g. 0.5
+    AF1 highPercentile; // e.g. 0.95
+    AU1 width; // of mip 0
+    AU1 height;
+};
+
+A_STATIC AU1 SpdHistogramBin(inAF4 v, const SpdHistogramParams &params)
+{
+    AF1 t = (ALog2F1(v[0] * 0.2126f + v[1] * 0.7152f + v[2] * 0.0722f) - params.minLog2Luminance) / params.log2Range;
+    // also black and NaN
+    if (!(t >= 0.0f)) return 0;
+    return 1 + AMinU1(AU1(AMinF1(t, 1.0f) * AF1(params.bins - 1)), params.bins - 2);
+}
+
+A_STATIC AU1 SpdHistogramBin(inAH4 v, const SpdHistogramParams &params)
+{
+    varAF4(f);
+    opAF4_AH4(f, v);
+    return SpdHistogramBin(f, params);
+}
+
+// log2 luminance of the center of a bin
+A_STATIC AF1 SpdHistogramBinLog2(AU1 bin, const SpdHistogramParams &params)
+{
+    return params.minLog2Luminance + (AF1(bin) - 0.5f) * params.log2Range / AF1(params.bins - 1);
+}
+
+// Same as SpdHistogramExposure of ffx_spd.h on the params.bins counts of a slice.
+A_STATIC void SpdHistogramExposure(outAF4 d, const AU1 *counts, const SpdHistogramParams &params)
+{
+    AF1 total = 0.0f;
+    AF1 sum = 0.0f;
+    for (AU1 bin = 1; bin < params.bins; bin++)
+    {
+        total += AF1(counts[bin]);
+        sum += AF1(counts[bin]) * SpdHistogramBinLog2(bin, params);
+    }
+
+    // the part of every bin between the low and the high percentile
+    AF1 low = total * params.lowPercentile;
+    AF1 high = total * params.highPercentile;
+    AF1 below = 0.0f;
+    AF1 clippedCount = 0.0f;
+    AF1 clippedSum = 0.0f;
+    AF1 lowLog2 = params.minLog2Luminance;
+    AF1 highLog2 = params.minLog2Luminance;
+    for (AU1 bin = 1; bin < params.bins; bin++)
+    {
+        AF1 count = AF1(counts[bin]);
+        AF1 log2Luminance = SpdHistogramBinLog2(bin, params);
+        AF1 inside = AMinF1(AMaxF1(below + count, low), high) - AMinF1(AMaxF1(below, low), high);
+        clippedCount += inside;
+        clippedSum += inside * log2Luminance;
+        if (count > 0.0f && below <= low) lowLog2 = log2Luminance;
+        if (count > 0.0f && below < high) highLog2 = log2Luminance;
+        below += count;
+    }
+
+    if (total == 0.0f)
+    {
+        d[0] = d[1] = d[2] = d[3] = 0.0f;
+        return;
+    }
+    d[0] = AExp2F1(sum / total);
+    d[1] = clippedCount > 0.0f ? AExp2F1(clippedSum / clippedCount) : AExp2F1(lowLog2);
+    d[2] = AExp2F1(lowLog2);
+    d[3] = AExp2F1(highLog2);
+}
+
+// Counts the texels of mip 0 of one work group, the bins replace 'shared AU1 spd_histogram[SPD_HISTOGRAM_BINS]'.
+template<class Spd, class T>
+struct SpdHistogramHooks
+{
+    Spd &spd;
+    const SpdHistogramParams &params;
+    AU1 bins[SPD_HISTOGRAM_MAX_BINS];
+    void SpdLoadSourceImage(T *A_RESTRICT d, ASU1 x, ASU1 y, AU1 slice){spd.SpdLoadSourceImage(d, x, y, slice);}
+    void SpdLoad(T *A_RESTRICT d, ASU1 x, ASU1 y, AU1 slice){spd.SpdLoad(d, x, y, slice);}
+    void SpdStore(ASU1 x, ASU1 y, T *A_RESTRICT value, AU1 mip, AU1 slice){
+        if (mip == 0 && AU1(x) < params.width && AU1(y) < params.height) bins[SpdHistogramBin(value, params)]++;
+        spd.SpdStore(x, y, value, mip, slice);}
+    void SpdReduce4(T *A_RESTRICT d, T *A_RESTRICT v0, T *A_RESTRICT v1, T *A_RESTRICT v2, T *A_RESTRICT v3){spd.SpdReduce4(d, v0, v1, v2, v3);}
+};
+
+// Hooks are the ones of the value type T (SpdPackedHooks for the packed version), spd provides the histogram hooks.
+template<class Spd, class Hooks, class T>
+void SpdDownsampleHistogramT(Spd &spd, Hooks &hooks, T (*lds)[16][4], inAU2 workGroupID, AU1 mips, AU1 numWorkGroups, AU1 slice, const SpdHistogramParams &params)
+{
+    SpdHistogramHooks<Hooks, T> histogram = { hooks, params, {} };
+    SpdDownsampleMips_0_1(histogram, lds, workGroupID, mips, slice);
+
+    SpdDownsampleNextFour(histogram, lds, workGroupID, 2, mips, slice);
+
+    // the counter publishes the bins of the work group to the last one
+    for (AU1 bin = 0; bin < params.bins; bin++)
+        if (histogram.bins[bin] != 0) spd.SpdHistogramAddGlobal(bin, histogram.bins[bin], slice);
+
+    if (SpdExitWorkgroup(hooks, numWorkGroups, slice)) return;
+
+    AU1 counts[SPD_HISTOGRAM_MAX_BINS];
+    for (AU1 bin = 0; bin < params.bins; bin++)
+    {
+        counts[bin] = spd.SpdHistogramLoadGlobal(bin, slice);
+        spd.SpdHistogramResetGlobal(bin, slice);
+    }
+    varAF4(exposure);
+    SpdHistogramExposure(exposure, counts, params);
+    spd.SpdStoreExposure(exposure, slice);
+
+    if (mips <= 6) return;
+
+    SpdDownsampleMips_6_7(hooks, lds, mips, slice);
+
+    varAU2(tailID) = initAU2(0, 0);
+    SpdDownsampleNextFour(hooks, lds, tailID, 8, mips, slice);
+}
+
+template<class Spd>
+void SpdDownsampleHistogram(
+    Spd &spd,
+    SpdIntermediate &lds,
+    inAU2 workGroupID,
+    AU1 mips,
+    AU1 numWorkGroups,
+    AU1 slice,
+    const SpdHistogramParams &params
+) {
+    SpdDownsampleHistogramT(spd, spd, lds.v, workGroupID, mips, numWorkGroups, slice, params);
+}
+
+template<class Spd>
+void SpdDownsampleHistogramH(
+    Spd &spd,
+    SpdIntermediateH &lds,
+    inAU2 workGroupID,
+    AU1 mips,
+    AU1 numWorkGroups,
+    AU1 slice,
+    const SpdHistogramParams &params
+) {
+    SpdPackedHooks<Spd> hooks = { spd };
+    SpdDownsampleHistogramT(spd, hooks, lds.v, workGroupID, mips, numWorkGroups, slice, params);
+}
+
+//==============================================================================================================================
+//                                                          COVERAGE
+//------------------------------------------------------------------------------------------------------------------------------
+// Alpha test coverage of the source kept in all mips, see COVERAGE in ffx_spd.h. The alpha reference, the bin count, the steps
+// of the stored alpha and the size of the source are runtime values of SpdCoverageParams. The source texels are counted as
+// they are loaded with SpdLoadSourceImage, the texels of mips 0..5 of a work group are read back with SpdLoadMip into one
+// histogram per mip. The last work group always runs, also for mips <= 6, and only solves the scales. SpdCoverageApply
+// rewrites the mips after the dispatch, one work group at a time. Always with the hooks of the non-packed version, also in
+// the packed version. Additional hooks:
+//     // SPD_COVERAGE_ENTRIES(bins) counts per slice, atomic, e.g. std::atomic<AU1>::fetch_add(count), zeroed once, reset by
+//     // the last work group
+//     void SpdCoverageAddGlobal(AU1 index, AU1 count, AU1 slice);
+//     AU1 SpdCoverageLoadGlobal(AU1 index, AU1 slice);
+//     void SpdCoverageResetGlobal(AU1 index, AU1 slice);
+//     // mips 0..
+//     void SpdLoadMip(outAF4 d, ASU1 x, ASU1 y, AU1 mip, AU1 slice);
+//     void SpdStoreAlphaScale(AF1 scale, AU1 mip, AU1 slice);
+//     // SpdCoverageApply only
+//     AF1 SpdLoadAlphaScale(AU1 mip, AU1 slice);
+//==============================================================================================================================
+#define SPD_COVERAGE_MAX_BINS 256
+// entry 0 counts the covered texels of the source, entry 1 + mip * bins + bin the histograms of mips 0..5
+#define SPD_COVERAGE_ENTRIES(bins) (1 + 6 * (bins))
+
+struct SpdCoverageParams
+{
+    AU1 bins; // 2..SPD_COVERAGE_MAX_BINS
+    AF1 alphaReference; // > 0
+    AF1 alphaOne; // alpha of 1.0 in the hooks
+    AF1 alphaStep; // step of the stored alpha in the hooks, 0 for float mips
+    AF1 alphaPrecision; // relative step of float mips, see SPD_COVERAGE_ALPHA_PRECISION
+    AU1 width; // of the source
+    AU1 height;
+};
+
+A_STATIC AU1 SpdCoverageBin(AF1 alpha, const SpdCoverageParams &params)
+{
+    return AU1(ASatF1(alpha / params.alphaOne) * AF1(params.bins - 1) + 0.5f);
+}
+
+A_STATIC AF1 SpdCoverageAlpha(inAF4 v)
+{
+    return v[3];
+}
+
+A_STATIC AF1 SpdCoverageAlpha(inAH4 v)
+{
+    return AF1_AH1_AU1(v[3]);
+}
+
+// Same as SpdCoverageAlphaScale of ffx_spd.h, threshold in 0..1.
+A_STATIC AF1 SpdCoverageAlphaScale(AF1 threshold, const SpdCoverageParams &params)
+{
+    AF1 step = params.alphaStep / params.alphaOne;
+    if (step > 0.0f)
+        threshold = ceilf(threshold / step - 1.0f / 64.0f) * step;
+    AF1 half = AMaxF1(step, threshold * params.alphaPrecision) * 0.5f;
+    AF1 bins = AF1(params.bins);
+    return params.alphaReference / params.alphaOne / AMaxF1(threshold - half, 0.5f / (bins * bins));
+}
+
+A_STATIC AU1 SpdCoverageSubBin(AF1 alpha, AU1 parent, const SpdCoverageParams &params)
+{
+    return AMinU1(AU1(ASatF1(alpha / params.alphaOne * AF1(params.bins - 1) - AF1(parent) + 0.5f) * AF1(params.bins)), params.bins - 1);
+}
+
+// Same as SpdCoverageFind of ffx_spd.h on the params.bins counts of a histogram pass.
+A_STATIC AU1 SpdCoverageFind(const AU1 *counts, AF1 target, AF1 &above, const SpdCoverageParams &params)
+{
+    for (AU1 bin = params.bins; bin > 0; bin--)
+    {
+        AF1 count = AF1(counts[bin - 1]);
+        if (above + count >= target)
+            return bin - 1;
+        above += count;
+    }
+    return 0;
+}
+
+// Same as SpdCoverageThreshold of ffx_spd.h, alpha in 0..1.
+A_STATIC AF1 SpdCoverageThreshold(const AU1 *counts, AF1 target, AF1 above, AU1 parent, const SpdCoverageParams &params)
+{
+    AU1 bin = SpdCoverageFind(counts, target, above, params);
+    AF1 count = AMaxF1(AF1(counts[bin]), 1.0f);
+    AF1 position = AF1(bin + 1) - (target - above) / count;
+    if (parent < params.bins)
+        position = AF1(parent) + position / AF1(params.bins);
+    return (position - 0.5f) / AF1(params.bins - 1);
+}
+
+// Counts the covered source texels of one work group, count replaces the entry 0 of 'shared AU1 spd_coverage[]'.
+template<class Spd, class T>
+struct SpdCoverageHooks
+{
+    Spd &spd;
+    const SpdCoverageParams &params;
+    AU1 count;
+    void SpdLoadSourceImage(T *A_RESTRICT d, ASU1 x, ASU1 y, AU1 slice){
+        spd.SpdLoadSourceImage(d, x, y, slice);
+        if (SpdCoverageAlpha(d) >= params.alphaReference) count++;}
+    void SpdLoad(T *A_RESTRICT d, ASU1 x, ASU1 y, AU1 slice){spd.SpdLoad(d, x, y, slice);}
+    void SpdStore(ASU1 x, ASU1 y, T *A_RESTRICT value, AU1 mip, AU1 slice){spd.SpdStore(x, y, value, mip, slice);}
+    void SpdReduce4(T *A_RESTRICT d, T *A_RESTRICT v0, T *A_RESTRICT v1, T *A_RESTRICT v2, T *A_RESTRICT v3){spd.SpdReduce4(d, v0, v1, v2, v3);}
+};
+
+// Same as SpdCoverageTile and SpdCoverageMerge of ffx_spd.h, count is the one of the source texels.
+template<class Spd>
+void SpdCoverageTile(Spd &spd, inAU2 workGroupID, AU1 mips, AU1 slice, AU1 count, const SpdCoverageParams &params)
+{
+    AU1 counts[SPD_COVERAGE_ENTRIES(SPD_COVERAGE_MAX_BINS)];
+    AU1 entries = SPD_COVERAGE_ENTRIES(params.bins);
+    for (AU1 i = 1; i < entries; i++) counts[i] = 0;
+    counts[0] = count;
+    for (AU1 mip = 0; mip < AMinU1(mips, 6); mip++)
+    {
+        AU1 tile = 32 >> mip;
+        AU1 mipWidth = AMaxU1(params.width >> (mip + 1), 1);
+        AU1 mipHeight = AMaxU1(params.height >> (mip + 1), 1);
+        // the texels past the edge of the mip are not stored
+        for (AU1 y = workGroupID[1] * tile; y < AMinU1((workGroupID[1] + 1) * tile, mipHeight); y++)
+        {
+            for (AU1 x = workGroupID[0] * tile; x < AMinU1((workGroupID[0] + 1) * tile, mipWidth); x++)
+            {
+                varAF4(v);
+                spd.SpdLoadMip(v, ASU1(x), ASU1(y), mip, slice);
+                counts[1 + mip * params.bins + SpdCoverageBin(v[3], params)]++;
+            }
+        }
+    }
+    for (AU1 i = 0; i < entries; i++)
+        if (counts[i] != 0) spd.SpdCoverageAddGlobal(i, counts[i], slice);
+}
+
+// Same as SpdCoverageHistogram of ffx_spd.h, parent params.bins is the first pass.
+template<class Spd>
+void SpdCoverageHistogram(Spd &spd, AU1 *counts, AU1 width, AU1 height, AU1 mip, AU1 slice, AU1 parent, const SpdCoverageParams &params)
+{
+    for (AU1 bin = 0; bin < params.bins; bin++)
+        counts[bin] = mip < 6 ? spd.SpdCoverageLoadGlobal(1 + mip * params.bins + bin, slice) : 0;
+    if (mip < 6)
+        return;
+    for (AU1 y = 0; y < height; y++)
+    {
+        for (AU1 x = 0; x < width; x++)
+        {
+            varAF4(v);
+            spd.SpdLoadMip(v, ASU1(x), ASU1(y), mip, slice);
+            if (parent == params.bins)
+                counts[SpdCoverageBin(v[3], params)]++;
+            else if (SpdCoverageBin(v[3], params) == parent)
+                counts[SpdCoverageSubBin(v[3], parent, params)]++;
+        }
+    }
+}
+
+// Same as SpdCoverageSolve of ffx_spd.h.
+template<class Spd>
+AF1 SpdCoverageSolve(Spd &spd, AU1 width, AU1 height, AU1 mip, AU1 slice, AF1 target, const SpdCoverageParams &params)
+{
+    AU1 counts[SPD_COVERAGE_MAX_BINS];
+    SpdCoverageHistogram(spd, counts, width, height, mip, slice, params.bins, params);
+    AF1 above = 0.0f;
+    AU1 parent = params.bins;
+    if (mip >= 6 && params.alphaStep / params.alphaOne * AF1(params.bins - 1) < 0.5f)
+    {
+        parent = SpdCoverageFind(counts, target, above, params);
+        SpdCoverageHistogram(spd, counts, width, height, mip, slice, parent, params);
+    }
+    return SpdCoverageAlphaScale(SpdCoverageThreshold(counts, target, above, parent, params), params);
+}
+
+// Same as SpdCoverageScale and SpdCoverageReset of ffx_spd.h.
+template<class Spd>
+void SpdCoverageScale(Spd &spd, AU1 mips, AU1 slice, const SpdCoverageParams &params)
+{
+    AF1 coverage = AF1(spd.SpdCoverageLoadGlobal(0, slice)) / (AF1(params.width) * AF1(params.height));
+    for (AU1 mip = 0; mip < mips; mip++)
+    {
+        AU1 width = AMaxU1(params.width >> (mip + 1), 1);
+        AU1 height = AMaxU1(params.height >> (mip + 1), 1);
+        AF1 target = coverage * AF1(width) * AF1(height);
+        AF1 scale = 1.0f;
+        // no texel of the source passes, neither does an average of them
+        if (target > 0.0f)
+            scale = SpdCoverageSolve(spd, width, height, mip, slice, target, params);
+        spd.SpdStoreAlphaScale(scale, mip, slice);
+    }
+    for (AU1 i = 0; i < SPD_COVERAGE_ENTRIES(params.bins); i++)
+        spd.SpdCoverageResetGlobal(i, slice);
+}
+
+// Same as SpdCoverageApply of ffx_spd.h, after all work groups of the dispatch.
+template<class Spd>
+void SpdCoverageApply(Spd &spd, inAU2 workGroupID, AU1 mips, AU1 slice, const SpdCoverageParams &params)
+{
+    for (AU1 mip = 0; mip < mips; mip++)
+    {
+        AU1 mipWidth = AMaxU1(params.width >> (mip + 1), 1);
+        AU1 mipHeight = AMaxU1(params.height >> (mip + 1), 1);
+        if (mip >= 6 && (workGroupID[0] | workGroupID[1]) != 0)
+            return;
+        AU1 tileX = mip < 6 ? 32 >> mip : mipWidth;
+        AU1 tileY = mip < 6 ? 32 >> mip : mipHeight;
+        AF1 scale = spd.SpdLoadAlphaScale(mip, slice);
+        for (AU1 y = workGroupID[1] * tileY; y < AMinU1((workGroupID[1] + 1) * tileY, mipHeight); y++)
+        {
+            for (AU1 x = workGroupID[0] * tileX; x < AMinU1((workGroupID[0] + 1) * tileX, mipWidth); x++)
+            {
+                varAF4(v);
+                spd.SpdLoadMip(v, ASU1(x), ASU1(y), mip, slice);
+                v[3] = AMinF1(v[3] * scale, params.alphaOne);
+                spd.SpdStore(ASU1(x), ASU1(y), v, mip, slice);
+            }
+        }
+    }
+}
+
+// Hooks are the ones of the value type T (SpdPackedHooks for the packed version), spd provides the coverage hooks.
+template<class Spd, class Hooks, class T>
+void SpdDownsampleCoverageT(Spd &spd, Hooks &hooks, T (*lds)[16][4], inAU2 workGroupID, AU1 mips, AU1 numWorkGroups, AU1 slice, const SpdCoverageParams &params)
+{
+    SpdCoverageHooks<Hooks, T> coverage = { hooks, params, 0 };
+    SpdDownsampleMips_0_1(coverage, lds, workGroupID, mips, slice);
+
+    SpdDownsampleNextFour(coverage, lds, workGroupID, 2, mips, slice);
+
+    // the counter publishes the counts of the work group to the last one
+    SpdCoverageTile(spd, workGroupID, mips, slice, coverage.count, params);
+
+    if (SpdExitWorkgroup(hooks, numWorkGroups, slice)) return;
+
+    if (mips > 6)
+    {
+        SpdDownsampleMips_6_7(hooks, lds, mips, slice);
+
+        varAU2(tailID) = initAU2(0, 0);
+        SpdDownsampleNextFour(hooks, lds, tailID, 8, mips, slice);
+    }
+
+    SpdCoverageScale(spd, mips, slice, params);
+}
+
+template<class Spd>
+void SpdDownsampleCoverage(
+    Spd &spd,
+    SpdIntermediate &lds,
+    inAU2 workGroupID,
+    AU1 mips,
+    AU1 numWorkGroups,
+    AU1 slice,
+    const SpdCoverageParams &params
+) {
+    SpdDownsampleCoverageT(spd, spd, lds.v, workGroupID, mips, numWorkGroups, slice, params);
+}
+
+template<class Spd>
+void SpdDownsampleCoverageH(
+    Spd &spd,
+    SpdIntermediateH &lds,
+    inAU2 workGroupID,
+    AU1 mips,
+    AU1 numWorkGroups,
+    AU1 slice,
+    const SpdCoverageParams &params
+) {
+    SpdPackedHooks<Spd> hooks = { spd };
+    SpdDownsampleCoverageT(spd, hooks, lds.v, workGroupID, mips, numWorkGroups, slice, params);
+}
+
+//==============================================================================================================================
+//                                                       DEPTH VERSION
+//------------------------------------------------------------------------------------------------------------------------------
+// Hierarchical Z of a R32_FLOAT depth buffer, see DEPTH VERSION in ffx_spd.h. Every texel keeps the farthest depth of its
+// footprint: 2x2 texels of the parent, 3 wide where the parent width is odd and 3 high where the parent height is odd.
+// Hooks, all loads are inside of the source or the mip, the footprints are clamped to the parent size:
+//     AF1 SpdLoadSourceDepth(ASU1 x, ASU1 y, AU1 slice);
+//     // mips 0..5, only used by the last work group
+//     AF1 SpdLoadDepth(ASU1 x, ASU1 y, AU1 mip, AU1 slice);
+//     void SpdStoreDepth(ASU1 x, ASU1 y, AF1 value, AU1 mip, AU1 slice);
+//     AU1 SpdIncreaseAtomicCounter(AU1 slice);
+//     void SpdResetAtomicCounter(AU1 slice);
+// The last work group needs the counter even for mips <= 6, it fixes the tile edges.
+//==============================================================================================================================
+// Replacement for 'shared AF1 spd_intermediateDepth[32][32]', stored row major ([y][x]).
+struct SpdIntermediateDepth
+{
+    AF1 v[32][32];
+};
+
+// farthest depth: the maximum, the minimum with reversed Z
+A_STATIC AF1 SpdReduceDepth(AF1 a, AF1 b, bool reversedZ)
+{
+    return reversedZ ? AMinF1(a, b) : AMaxF1(a, b);
+}
+
+// Parent texels first..last of texel p in one dimension, parentSize is the source size for mip 0.
+A_STATIC void SpdDepthFootprint(AU1 &first, AU1 &last, AU1 p, AU1 parentSize)
+{
+    first = AMinU1(p * 2, parentSize - 1);
+    last = AMinU1(p * 2 + 1 + (parentSize & 1), parentSize - 1);
+}
+
+// size of the parent of mip in one dimension, the source for mip 0
+A_STATIC AU1 SpdDepthParentSize(AU1 size, AU1 mip)
+{
+    return AMaxU1(size >> mip, 1);
+}
+
+// Parent of mip 0: the source
+template<class Spd>
+struct SpdDepthSource
+{
+    Spd &spd;
+    AU1 slice;
+    AF1 operator()(AU1 x, AU1 y) const { return spd.SpdLoadSourceDepth(ASU1(x), ASU1(y), slice); }
+};
+
+template<class Spd>
+struct SpdDepthMip
+{
+    Spd &spd;
+    AU1 mip;
+    AU1 slice;
+    AF1 operator()(AU1 x, AU1 y) const { return spd.SpdLoadDepth(ASU1(x), ASU1(y), mip, slice); }
+};
+
+// Farthest depth of the parent texels (x0..x1, y0..y1), load is one of the above.
+// The footprint is 2x2 with an optional third column and row, or smaller where the parent is a single texel.
+template<class Load>
+AF1 SpdReduceLoadDepth(const Load &load, AU1 x0, AU1 y0, AU1 x1, AU1 y1, bool reversedZ)
+{
+    AU1 xa = AMinU1(x0 + 1, x1);
+    AU1 ya = AMinU1(y0 + 1, y1);
+    AF1 v = SpdReduceDepth(
+        SpdReduceDepth(load(x0, y0), load(xa, y0), reversedZ),
+        SpdReduceDepth(load(x0, ya), load(xa, ya), reversedZ), reversedZ);
+    if (x1 != xa)
+        v = SpdReduceDepth(v, SpdReduceDepth(load(x1, y0), load(x1, ya), reversedZ), reversedZ);
+    if (y1 != ya)
+    {
+        for (AU1 x = x0; x <= x1; x++)
+            v = SpdReduceDepth(v, load(x, y1), reversedZ);
+    }
+    return v;
+}
+
+// Texel (x,y) of mip from the parent in memory, returns the stored value.
+template<class Spd>
+AF1 SpdDownsampleDepthTexel(Spd &spd, AU1 x, AU1 y, AU1 mip, AU1 slice, inAU2 size, bool reversedZ)
+{
+    AU1 x0, x1, y0, y1;
+    SpdDepthFootprint(x0, x1, x, SpdDepthParentSize(size[0], mip));
+    SpdDepthFootprint(y0, y1, y, SpdDepthParentSize(size[1], mip));
+    AF1 v;
+    if (mip == 0)
+    {
+        SpdDepthSource<Spd> load = { spd, slice };
+        v = SpdReduceLoadDepth(load, x0, y0, x1, y1, reversedZ);
+    }
+    else
+    {
+        SpdDepthMip<Spd> load = { spd, mip - 1, slice };
+        v = SpdReduceLoadDepth(load, x0, y0, x1, y1, reversedZ);
+    }
+    spd.SpdStoreDepth(ASU1(x), ASU1(y), v, mip, slice);
+    return v;
+}
+
+// Mips baseMip..baseMip+5 of a tile of 32x32 texels of baseMip: the first one from memory, the others in the intermediate.
+// A texel in the last column or row of the tile only sees the parent texels inside of the tile.
+template<class Spd>
+void SpdDownsampleDepthTile(Spd &spd, AF1 (*lds)[32], inAU2 tile, AU1 baseMip, AU1 mips, AU1 slice, inAU2 size, bool reversedZ)
+{
+    AU1 width = SpdDepthParentSize(size[0], baseMip + 1);
+    AU1 height = SpdDepthParentSize(size[1], baseMip + 1);
+    for (AU1 y = 0; y < 32; y++)
+    {
+        for (AU1 x = 0; x < 32; x++)
+        {
+            // texels outside of the mip are never part of a footprint
+            AU1 px = tile[0] * 32 + x;
+            AU1 py = tile[1] * 32 + y;
+            lds[y][x] = px < width && py < height ? SpdDownsampleDepthTexel(spd, px, py, baseMip, slice, size, reversedZ) : 0.0f;
+        }
+    }
+
+    for (AU1 i = 1; i < 6; i++)
+    {
+        AU1 mip = baseMip + i;
+        if (mips <= mip) return;
+
+        AU1 tileSize = 32 >> i;
+        AU1 parentWidth = width;
+        AU1 parentHeight = height;
+        width = SpdDepthParentSize(size[0], mip + 1);
+        height = SpdDepthParentSize(size[1], mip + 1);
+        for (AU1 y = 0; y < tileSize; y++)
+        {
+            for (AU1 x = 0; x < tileSize; x++)
+            {
+                // writing (x,y) never overwrites a texel that is read later on
+                AU1 px = tile[0] * tileSize + x;
+                AU1 py = tile[1] * tileSize + y;
+                AF1 v = 0.0f;
+                if (px < width && py < height)
+                {
+                    AU1 x0, x1, y0, y1;
+                    SpdDepthFootprint(x0, x1, px, parentWidth);
+                    SpdDepthFootprint(y0, y1, py, parentHeight);
+                    x0 -= tile[0] * tileSize * 2;
+                    y0 -= tile[1] * tileSize * 2;
+                    x1 = AMinU1(x1 - tile[0] * tileSize * 2, tileSize * 2 - 1);
+                    y1 = AMinU1(y1 - tile[1] * tileSize * 2, tileSize * 2 - 1);
+                    v = lds[y0][x0];
+                    for (AU1 ly = y0; ly <= y1; ly++)
+                        for (AU1 lx = x0; lx <= x1; lx++)
+                            v = SpdReduceDepth(v, lds[ly][lx], reversedZ);
+                    spd.SpdStoreDepth(ASU1(px), ASU1(py), v, mip, slice);
+                }
+                lds[y][x] = v;
+            }
+        }
+    }
+}
+
+// Last work group: recomputes the texels of mips 1..5 in the last column and row of every tile from the stored mips.
+// They are only incomplete once a parent width or height on the way is odd, most sizes skip some or all of the mips.
+template<class Spd>
+void SpdDownsampleDepthEdges(Spd &spd, AU1 mips, AU1 slice, inAU2 size, bool reversedZ)
+{
+    bool fixX = false;
+    bool fixY = false;
+    for (AU1 mip = 1; mip < AMinU1(mips, 6); mip++)
+    {
+        AU1 parentWidth = SpdDepthParentSize(size[0], mip);
+        AU1 parentHeight = SpdDepthParentSize(size[1], mip);
+        fixX = fixX || (parentWidth & 1) != 0;
+        fixY = fixY || (parentHeight & 1) != 0;
+        if (!fixX && !fixY) continue;
+
+        // the last columns, then the last rows of the tiles, the corners are computed twice
+        AU1 tileSize = 32 >> mip;
+        AU1 width = SpdDepthParentSize(size[0], mip + 1);
+        AU1 height = SpdDepthParentSize(size[1], mip + 1);
+        if (fixX)
+            for (AU1 y = 0; y < height; y++)
+                for (AU1 x = tileSize - 1; x < width; x += tileSize)
+                    SpdDownsampleDepthTexel(spd, x, y, mip, slice, size, reversedZ);
+        if (fixY)
+            for (AU1 y = tileSize - 1; y < height; y += tileSize)
+                for (AU1 x = 0; x < width; x++)
+                    SpdDownsampleDepthTexel(spd, x, y, mip, slice, size, reversedZ);
+    }
+}
+
+// size is the size of the source, numWorkGroups = ((size.x+63)>>6) * ((size.y+63)>>6) of each slice.
+template<class Spd>
+void SpdDownsampleDepth(
+    Spd &spd,
+    SpdIntermediateDepth &lds,
+    inAU2 workGroupID,
+    AU1 mips,
+    AU1 numWorkGroups,
+    AU1 slice,
+    inAU2 size,
+    bool reversedZ
+) {
+    SpdDownsampleDepthTile(spd, lds.v, workGroupID, 0, mips, slice, size, reversedZ);
+
+    if (mips <= 1) return;
+
+    if (SpdExitWorkgroup(spd, numWorkGroups, slice)) return;
+
+    // All tiles are stored, the edges see the next tile now.
+    SpdDownsampleDepthEdges(spd, mips, slice, size, reversedZ);
+
+    if (mips <= 6) return;
+
+    // Mip 5 holds up to 64x64 texels, one tile of mips 6..11 covers all of them.
+    varAU2(tailID) = initAU2(0, 0);
+    SpdDownsampleDepthTile(spd, lds.v, tailID, 6, mips, slice, size, reversedZ);
+}
+
+//==============================================================================================================================
+//                                                       FILTER VERSION
+//------------------------------------------------------------------------------------------------------------------------------
+// 4 and 6 tap separable filters instead of the 2x2 reduction, see FILTER VERSION in ffx_spd.h, the filter is a runtime value.
+// Each work group computes mips 0..2 of its tile with the aprons in the intermediate, the last one mips 3.. from memory.
+// Hooks, all loads are inside of the source or the mip:
+//     void SpdLoadSourceImage(outAF4 d, ASU1 x, ASU1 y, AU1 slice);
+//     // mips 2.., only used by the last work group
+//     void SpdLoadMip(outAF4 d, ASU1 x, ASU1 y, AU1 mip, AU1 slice);
+//     void SpdStore(ASU1 x, ASU1 y, inAF4 value, AU1 mip, AU1 slice);
+//     AU1 SpdIncreaseAtomicCounter(AU1 slice);
+//     void SpdResetAtomicCounter(AU1 slice);
+//==============================================================================================================================
+#define SPD_FILTER_BINOMIAL 1
+#define SPD_FILTER_KAISER 2
+#define SPD_FILTER_LANCZOS 3
+
+// Replacement for 'shared AF4 spd_intermediateFilter[44][44]', stored row major ([y][x]).
+// Mip 1 has a buffer of its own, the CPU has no barrier between reading mip 0 and writing mip 1.
+struct SpdIntermediateFilter
+{
+    AF1 v[44][44][4];
+    AF1 v1[20][20][4];
+};
+
+// Taps of a filter, tap t is the parent texel 2p - radius + t.
+struct SpdFilterKernel
+{
+    AU1 radius;
+    AF1 w[6];
+};
+
+A_STATIC void SpdFilterSetup(SpdFilterKernel &kernel, AU1 filter)
+{
+    if (filter == SPD_FILTER_BINOMIAL)
+    {
+        kernel.radius = 1;
+        kernel.w[0] = kernel.w[3] = 0.125f;
+        kernel.w[1] = kernel.w[2] = 0.375f;
+        return;
+    }
+    // distance 0.5, 1.5 and 2.5 parent texels from the center, normalized to a sum of 1
+    kernel.radius = 2;
+    bool kaiser = filter == SPD_FILTER_KAISER;
+    kernel.w[2] = kernel.w[3] = kaiser ? 0.42649015f : 0.42293233f;
+    kernel.w[1] = kernel.w[4] = kaiser ? 0.09450233f : 0.09398496f;
+    kernel.w[0] = kernel.w[5] = kaiser ? -0.02099248f : -0.01691729f;
+}
+
+// size of the parent of mip in one dimension, the source for mip 0
+A_STATIC AU1 SpdFilterParentSize(AU1 size, AU1 mip)
+{
+    return AMaxU1(size >> mip, 1);
+}
+
+A_STATIC ASU1 SpdFilterClamp(ASU1 v, ASU1 last)
+{
+    return v < 0 ? 0 : (v > last ? last : v);
+}
+
+A_STATIC ASU1 SpdFilterMin(ASU1 a, ASU1 b)
+{
+    return a < b ? a : b;
+}
+
+template<class Spd>
+struct SpdFilterSource
+{
+    Spd &spd;
+    AU1 slice;
+    void operator()(outAF4 d, ASU1 x, ASU1 y) const { spd.SpdLoadSourceImage(d, x, y, slice); }
+};
+
+template<class Spd>
+struct SpdFilterMip
+{
+    Spd &spd;
+    AU1 mip;
+    AU1 slice;
+    void operator()(outAF4 d, ASU1 x, ASU1 y) const { spd.SpdLoadMip(d, x, y, mip, slice); }
+};
+
+// parent texels in the intermediate, starting at (x0,y0)
+struct SpdFilterIntermediate
+{
+    AF1 *v;
+    AU1 stride;
+    ASU1 x0;
+    ASU1 y0;
+    void operator()(outAF4 d, ASU1 x, ASU1 y) const { opACpyF4(d, v + (AU1(y - y0) * stride + AU1(x - x0)) * 4); }
+};
+
+// Texel (x,y) of a mip from its parent, the taps are clamped to the parent texels 0..last.
+template<class Load>
+void SpdReduceLoadFilter(outAF4 d, const Load &load, const SpdFilterKernel &kernel, ASU1 x, ASU1 y, ASU1 lastX, ASU1 lastY)
+{
+    AU1 taps = 2 * kernel.radius + 2;
+    ASU1 px[6];
+    for (AU1 t = 0; t < taps; t++)
+        px[t] = SpdFilterClamp(x * 2 - ASU1(kernel.radius) + ASU1(t), lastX);
+    d[0] = d[1] = d[2] = d[3] = 0.0f;
+    for (AU1 ty = 0; ty < taps; ty++)
+    {
+        ASU1 py = SpdFilterClamp(y * 2 - ASU1(kernel.radius) + ASU1(ty), lastY);
+        AF1 row[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (AU1 tx = 0; tx < taps; tx++)
+        {
+            varAF4(v);
+            load(v, px[tx], py);
+            for (AU1 c = 0; c < 4; c++) row[c] += kernel.w[tx] * v[c];
+        }
+        for (AU1 c = 0; c < 4; c++) d[c] += kernel.w[ty] * row[c];
+    }
+}
+
+// Mips 0..2 of a tile: mip 0 with 3 * radius texels on each side, mip 1 with radius texels on each side, so mip 2 is exact.
+template<class Spd>
+void SpdDownsampleFilterMips_0_2(Spd &spd, SpdIntermediateFilter &lds, inAU2 workGroupID, AU1 mips, AU1 slice, inAU2 size, const SpdFilterKernel &kernel)
+{
+    ASU1 apron = ASU1(3 * kernel.radius);
+    ASU1 x0 = ASU1(workGroupID[0] * 32) - apron;
+    ASU1 y0 = ASU1(workGroupID[1] * 32) - apron;
+    ASU1 width = ASU1(SpdFilterParentSize(size[0], 1));
+    ASU1 height = ASU1(SpdFilterParentSize(size[1], 1));
+    SpdFilterSource<Spd> source = { spd, slice };
+    for (ASU1 y = SpdFilterClamp(y0, height); y < SpdFilterMin(y0 + 32 + 2 * apron, height); y++)
+    {
+        for (ASU1 x = SpdFilterClamp(x0, width); x < SpdFilterMin(x0 + 32 + 2 * apron, width); x++)
+        {
+            AF1 *v = lds.v[y - y0][x - x0];
+            SpdReduceLoadFilter(v, source, kernel, x, y, ASU1(size[0]) - 1, ASU1(size[1]) - 1);
+            if (AU1(x - x0 - apron) < 32 && AU1(y - y0 - apron) < 32)
+                spd.SpdStore(x, y, v, 0, slice);
+        }
+    }
+
+    if (mips <= 1) return;
+
+    SpdFilterIntermediate mip0 = { &lds.v[0][0][0], 44, x0, y0 };
+    apron = ASU1(kernel.radius);
+    x0 = ASU1(workGroupID[0] * 16) - apron;
+    y0 = ASU1(workGroupID[1] * 16) - apron;
+    ASU1 parentWidth = width;
+    ASU1 parentHeight = height;
+    width = ASU1(SpdFilterParentSize(size[0], 2));
+    height = ASU1(SpdFilterParentSize(size[1], 2));
+    for (ASU1 y = SpdFilterClamp(y0, height); y < SpdFilterMin(y0 + 16 + 2 * apron, height); y++)
+    {
+        for (ASU1 x = SpdFilterClamp(x0, width); x < SpdFilterMin(x0 + 16 + 2 * apron, width); x++)
+        {
+            AF1 *v = lds.v1[y - y0][x - x0];
+            SpdReduceLoadFilter(v, mip0, kernel, x, y, parentWidth - 1, parentHeight - 1);
+            if (AU1(x - x0 - apron) < 16 && AU1(y - y0 - apron) < 16)
+                spd.SpdStore(x, y, v, 1, slice);
+        }
+    }
+
+    if (mips <= 2) return;
+
+    SpdFilterIntermediate mip1 = { &lds.v1[0][0][0], 20, x0, y0 };
+    x0 = ASU1(workGroupID[0] * 8);
+    y0 = ASU1(workGroupID[1] * 8);
+    parentWidth = width;
+    parentHeight = height;
+    width = ASU1(SpdFilterParentSize(size[0], 3));
+    height = ASU1(SpdFilterParentSize(size[1], 3));
+    for (ASU1 y = y0; y < SpdFilterMin(y0 + 8, height); y++)
+    {
+        for (ASU1 x = x0; x < SpdFilterMin(x0 + 8, width); x++)
+        {
+            varAF4(v);
+            SpdReduceLoadFilter(v, mip1, kernel, x, y, parentWidth - 1, parentHeight - 1);
+            spd.SpdStore(x, y, v, 2, slice);
+        }
+    }
+}
+
+// Last work group: mips 3.. from the stored parents, one mip after the other.
+template<class Spd>
+void SpdDownsampleFilterTail(Spd &spd, AU1 mips, AU1 slice, inAU2 size, const SpdFilterKernel &kernel)
+{
+    for (AU1 mip = 3; mip < mips; mip++)
+    {
+        SpdFilterMip<Spd> parent = { spd, mip - 1, slice };
+        ASU1 lastX = ASU1(SpdFilterParentSize(size[0], mip)) - 1;
+        ASU1 lastY = ASU1(SpdFilterParentSize(size[1], mip)) - 1;
+        ASU1 width = ASU1(SpdFilterParentSize(size[0], mip + 1));
+        ASU1 height = ASU1(SpdFilterParentSize(size[1], mip + 1));
+        for (ASU1 y = 0; y < height; y++)
+        {
+            for (ASU1 x = 0; x < width; x++)
+            {
+                varAF4(v);
+                SpdReduceLoadFilter(v, parent, kernel, x, y, lastX, lastY);
+                spd.SpdStore(x, y, v, mip, slice);
+            }
+        }
+    }
+}
+
+// size is the size of the source, numWorkGroups = ((size.x+63)>>6) * ((size.y+63)>>6) of each slice.
+// filter is SPD_FILTER_BINOMIAL, SPD_FILTER_KAISER or SPD_FILTER_LANCZOS.
+template<class Spd>
+void SpdDownsampleFilter(
+    Spd &spd,
+    SpdIntermediateFilter &lds,
+    inAU2 workGroupID,
+    AU1 mips,
+    AU1 numWorkGroups,
+    AU1 slice,
+    inAU2 size,
+    AU1 filter
+) {
+    SpdFilterKernel kernel;
+    SpdFilterSetup(kernel, filter);
+    SpdDownsampleFilterMips_0_2(spd, lds, workGroupID, mips, slice, size, kernel);
+
+    if (mips <= 3) return;
+
+    if (SpdExitWorkgroup(spd, numWorkGroups, slice)) return;
+
+    SpdDownsampleFilterTail(spd, mips, slice, size, kernel);
+}
+
+//==============================================================================================================================
+//                                                         DIRTY TILES
+//------------------------------------------------------------------------------------------------------------------------------
+// Same as DIRTY TILES of ffx_spd.h: one work group per entry of a list of tiles in Morton order, the last one recomputes the
+// texels of mips 6 and up above the tiles of the list from the stored mips and the edges it keeps in the LDS, which gives the
+// values of a full dispatch for any size. The list is an array, an entry is x | (y << 16) of a tile. Additional hooks, mip
+// is 5 and up:
+//     void SpdLoadMip(outAF4 d, ASU1 x, ASU1 y, AU1 mip, AU1 slice);
+//     void SpdLoadMipH(outAH4 d, ASU1 x, ASU1 y, AU1 mip, AU1 slice);
+//==============================================================================================================================
+#define SPD_DIRTY_MAX_TILES 4096 // 64x64 tiles, sources up to 4096x4096
+
+// x in the even and y in the odd bits
+A_STATIC AU1 SpdDirtyTileMorton(AU1 x, AU1 y)
+{
+    AU1 code = 0;
+    for (AU1 i = 0; i < 6; i++)
+        code |= (((x >> i) & 1) << (2 * i)) | (((y >> i) & 1) << (2 * i + 1));
+    return code;
+}
+
+A_STATIC AU1 SpdDirtyTileOfMorton(AU1 code)
+{
+    AU1 x = 0;
+    AU1 y = 0;
+    for (AU1 i = 0; i < 6; i++)
+    {
+        x |= ((code >> (2 * i)) & 1) << i;
+        y |= ((code >> (2 * i + 1)) & 1) << i;
+    }
+    return x | (y << 16);
+}
+
+// The list of the tiles of a width x height source that intersect the rectangles, in Morton order and without duplicates,
+// returns the count of the list. rects holds x, y, width and height in texels of each rectangle, tiles has room for
+// ((width+63)>>6) * ((height+63)>>6) entries. Also builds the list of the GPU version.
+A_STATIC AU1 SpdSetupDirtyTiles(AU1 *tiles, const AU1 *rects, AU1 rectCount, AU1 width, AU1 height)
+{
+    AU1 mask[SPD_DIRTY_MAX_TILES / 32] = {};
+    for (AU1 i = 0; i < rectCount; i++)
+    {
+        const AU1 *rect = rects + i * 4;
+        if (rect[2] == 0 || rect[3] == 0 || rect[0] >= width || rect[1] >= height) continue;
+        AU1 lastX = (rect[0] + AMinU1(rect[2], width - rect[0]) - 1) >> 6;
+        AU1 lastY = (rect[1] + AMinU1(rect[3], height - rect[1]) - 1) >> 6;
+        for (AU1 y = rect[1] >> 6; y <= lastY; y++)
+        {
+            for (AU1 x = rect[0] >> 6; x <= lastX; x++)
+            {
+                AU1 code = SpdDirtyTileMorton(x, y);
+                mask[code >> 5] |= 1u << (code & 31);
+            }
+        }
+    }
+    AU1 count = 0;
+    for (AU1 word = 0; word < SPD_DIRTY_MAX_TILES / 32; word++)
+    {
+        if (mask[word] == 0) continue;
+        for (AU1 bit = 0; bit < 32; bit++)
+        {
+            if ((mask[word] >> bit) & 1)
+                tiles[count++] = SpdDirtyTileOfMorton(word * 32 + bit);
+        }
+    }
+    return count;
+}
+
+// Texel (x, y) of mip as the LDS of the tail of a full dispatch holds it: stored inside of the mip, the edge next to it in
+// lds, and z (the reduction of the zero loads) beyond the edge. Only the edge can differ from zero padding, it is the column
+// x == width for y 0..height, entries 128 * (mip % 2) + y, and the row y == height, entries 128 * (mip % 2) + height + 1 + x.
+template<class Spd, class T>
+void SpdLoadDirtyTexel(Spd &spd, T *A_RESTRICT d, T (*lds)[16][4], AU1 x, AU1 y, AU1 mip, AU1 slice, inAU2 size, const T *z)
+{
+    AU1 width = AMaxU1(size[0] >> (mip + 1), 1);
+    AU1 height = AMaxU1(size[1] >> (mip + 1), 1);
+    if (x < width && y < height)
+    {
+        spd.SpdLoadMip(d, ASU1(x), ASU1(y), mip, slice);
+        return;
+    }
+    const T *v = z;
+    AU1 entry = 128 * (mip % 2);
+    if (x == width && y <= height)
+    {
+        entry += y;
+        v = lds[entry / 16][entry % 16];
+    }
+    else if (y == height && x < width)
+    {
+        entry += height + 1 + x;
+        v = lds[entry / 16][entry % 16];
+    }
+    for (AU1 c = 0; c < 4; c++) d[c] = v[c];
+}
+
+// Texel (x, y) of mip 6 and up from the 2x2 texels of the mip below, in the order of the tail of a full dispatch.
+// z is the reduction of the zero loads in the mip below.
+template<class Spd, class T>
+void SpdReduceDirtyTexel(Spd &spd, T *A_RESTRICT d, T (*lds)[16][4], AU1 x, AU1 y, AU1 mip, AU1 slice, inAU2 size, const T *z)
+{
+    if (mip == 6)
+    {
+        SpdReduceLoadMip4(spd, d, ASU1(x * 2), ASU1(y * 2), 5, slice);
+        return;
+    }
+    T v0[4]; T v1[4]; T v2[4]; T v3[4];
+    SpdLoadDirtyTexel(spd, v0, lds, x * 2 + 0, y * 2 + 0, mip - 1, slice, size, z);
+    SpdLoadDirtyTexel(spd, v1, lds, x * 2 + 1, y * 2 + 0, mip - 1, slice, size, z);
+    SpdLoadDirtyTexel(spd, v2, lds, x * 2 + 0, y * 2 + 1, mip - 1, slice, size, z);
+    SpdLoadDirtyTexel(spd, v3, lds, x * 2 + 1, y * 2 + 1, mip - 1, slice, size, z);
+    spd.SpdReduce4(d, v0, v1, v2, v3);
+}
+
+// Last work group: the texels of mips 6 and up above the tiles of the list, each from the 2x2 texels of the mip below.
+// Where a mip is 1 texel wide or high, the tail of a full dispatch also reduces the texels of the mip below that are outside
+// of it, which hold the odd last column or row of the mips above. These are not stored, so every mip recomputes its edge
+// in full (up to 65 texels) into lds first. size is the size of the source.
+template<class Spd, class T>
+void SpdDownsampleDirtyAncestors(Spd &spd, T (*lds)[16][4], const AU1 *tiles, AU1 mips, AU1 numTiles, AU1 slice, inAU2 size)
+{
+    // the reduction of the zero loads of mip 5
+    T z[4] = {};
+    for (AU1 mip = 6; mip < mips; mip++)
+    {
+        AU1 width = AMaxU1(size[0] >> (mip + 1), 1);
+        AU1 height = AMaxU1(size[1] >> (mip + 1), 1);
+        for (AU1 e = 0; e < width + height + 1; e++)
+        {
+            AU1 x = e <= height ? width : e - height - 1;
+            AU1 y = e <= height ? e : height;
+            AU1 entry = 128 * (mip % 2) + e;
+            SpdReduceDirtyTexel(spd, lds[entry / 16][entry % 16], lds, x, y, mip, slice, size, z);
+        }
+
+        AU1 shift = mip - 5;
+        for (AU1 i = 0; i < numTiles; i++)
+        {
+            AU1 x = (tiles[i] & 0xffff) >> shift;
+            AU1 y = (tiles[i] >> 16) >> shift;
+            // in Morton order the tiles below a texel are next to each other, the first of them computes it
+            if (i > 0 && ((tiles[i - 1] & 0xffff) >> shift) == x && ((tiles[i - 1] >> 16) >> shift) == y) continue;
+            T v[4];
+            SpdReduceDirtyTexel(spd, v, lds, x, y, mip, slice, size, z);
+            spd.SpdStore(ASU1(x), ASU1(y), v, mip, slice);
+        }
+
+        T v0[4]; T v1[4]; T v2[4]; T v3[4];
+        for (AU1 c = 0; c < 4; c++) v0[c] = v1[c] = v2[c] = v3[c] = z[c];
+        spd.SpdReduce4(z, v0, v1, v2, v3);
+    }
+}
+
+template<class Spd, class T>
+void SpdDownsampleDirtyT(Spd &spd, T (*lds)[16][4], const AU1 *tiles, AU1 tileIndex, AU1 mips, AU1 numTiles, AU1 slice, inAU2 size)
+{
+    varAU2(workGroupID) = initAU2(tiles[tileIndex] & 0xffff, tiles[tileIndex] >> 16);
+    SpdDownsampleMips_0_1(spd, lds, workGroupID, mips, slice);
+
+    SpdDownsampleNextFour(spd, lds, workGroupID, 2, mips, slice);
+
+    if (mips <= 6) return;
+
+    if (SpdExitWorkgroup(spd, numTiles, slice)) return;
+
+    SpdDownsampleDirtyAncestors(spd, lds, tiles, mips, numTiles, slice, size);
+}
+
+// tileIndex is the entry of the list of this work group, numTiles work groups of each slice, size is the size of the source.
+template<class Spd>
+void SpdDownsampleDirty(
+    Spd &spd,
+    SpdIntermediate &lds,
+    const AU1 *tiles,
+    AU1 tileIndex,
+    AU1 mips,
+    AU1 numTiles,
+    AU1 slice,
+    inAU2 size
+) {
+    SpdDownsampleDirtyT(spd, lds.v, tiles, tileIndex, mips, numTiles, slice, size);
+}
+
+template<class Spd>
+void SpdDownsampleDirtyH(
+    Spd &spd,
+    SpdIntermediateH &lds,
+    const AU1 *tiles,
+    AU1 tileIndex,
+    AU1 mips,
+    AU1 numTiles,
+    AU1 slice,
+    inAU2 size
+) {
+    SpdPackedHooks<Spd> hooks = { spd };
+    SpdDownsampleDirtyT(hooks, lds.v, tiles, tileIndex, mips, numTiles, slice, size);
+}
+
+//==============================================================================================================================
+//                                                          RESIDENCY
+//------------------------------------------------------------------------------------------------------------------------------
+// Same as RESIDENCY of ffx_spd.h: the tile of a work group that is not resident is neither read nor written, it only
+// increases the counters. The last work group reads the texel of mip 5 of such a tile as the fill. Hooks of the mode:
+//     AU1 SpdTileResident(AU1 x, AU1 y, AU1 slice);
+//     void SpdResidencyFill(outAF4 d, AU1 slice);
+//     void SpdResidencyFillH(outAH4 d, AU1 slice);
+//==============================================================================================================================
+// Texel (x,y) of mip 5 is the one of tile (x,y), the loads of the others are forwarded.
+template<class Spd, class T>
+struct SpdResidencyHooks
+{
+    Spd &spd;
+    void SpdLoadSourceImage(T *A_RESTRICT d, ASU1 x, ASU1 y, AU1 slice){spd.SpdLoadSourceImage(d, x, y, slice);}
+    void SpdLoad(T *A_RESTRICT d, ASU1 x, ASU1 y, AU1 slice){
+        if (spd.SpdTileResident(AU1(x), AU1(y), slice)) spd.SpdLoad(d, x, y, slice); else spd.SpdResidencyFill(d, slice);}
+    void SpdLoadMip(T *A_RESTRICT d, ASU1 x, ASU1 y, AU1 mip, AU1 slice){
+        if (mip != 5 || spd.SpdTileResident(AU1(x), AU1(y), slice)) spd.SpdLoadMip(d, x, y, mip, slice); else spd.SpdResidencyFill(d, slice);}
+    void SpdStore(ASU1 x, ASU1 y, T *A_RESTRICT value, AU1 mip, AU1 slice){spd.SpdStore(x, y, value, mip, slice);}
+    void SpdReduce4(T *A_RESTRICT d, T *A_RESTRICT v0, T *A_RESTRICT v1, T *A_RESTRICT v2, T *A_RESTRICT v3){spd.SpdReduce4(d, v0, v1, v2, v3);}
+    AU1 SpdIncreaseAtomicCounter(AU1 slice){return spd.SpdIncreaseAtomicCounter(slice);}
+    void SpdResetAtomicCounter(AU1 slice){spd.SpdResetAtomicCounter(slice);}
+    AU1 SpdIncreaseBlockCounter(AU1 block, AU1 slice){return spd.SpdIncreaseBlockCounter(block, slice);}
+    void SpdResetBlockCounter(AU1 block, AU1 slice){spd.SpdResetBlockCounter(block, slice);}
+};
+
+// numWorkGroups is the count in x and y, more than 64 in either runs the extended version
+template<class Spd, class T>
+void SpdDownsampleResidentT(Spd &spd, T (*lds)[16][4], inAU2 workGroupID, AU1 mips, inAU2 numWorkGroups, AU1 slice)
+{
+    if (spd.SpdTileResident(workGroupID[0], workGroupID[1], slice))
+    {
+        SpdDownsampleMips_0_1(spd, lds, workGroupID, mips, slice);
+
+        SpdDownsampleNextFour(spd, lds, workGroupID, 2, mips, slice);
+    }
+
+    SpdResidencyHooks<Spd, T> resident = { spd };
+    if (numWorkGroups[0] > 64 || numWorkGroups[1] > 64)
+        SpdDownsampleExtendedTail(resident, lds, workGroupID, mips, numWorkGroups, slice);
+    else
+        SpdDownsampleTail(resident, lds, mips, numWorkGroups[0] * numWorkGroups[1], slice);
+}
+
+template<class Spd>
+void SpdDownsampleResident(
+    Spd &spd,
+    SpdIntermediate &lds,
+    inAU2 workGroupID,
+    AU1 mips,
+    inAU2 numWorkGroups,
+    AU1 slice
+) {
+    SpdDownsampleResidentT(spd, lds.v, workGroupID, mips, numWorkGroups, slice);
+}
+
+template<class Spd>
+void SpdDownsampleResidentH(
+    Spd &spd,
+    SpdIntermediateH &lds,
+    inAU2 workGroupID,
+    AU1 mips,
+    inAU2 numWorkGroups,
+    AU1 slice
+) {
+    SpdPackedHooks<Spd> hooks = { spd };
+    SpdDownsampleResidentT(hooks, lds.v, workGroupID, mips, numWorkGroups, slice);
+}
+
+//==============================================================================================================================
+//                                                         SPLIT TAIL
+//------------------------------------------------------------------------------------------------------------------------------
+// Same as SPLIT TAIL of ffx_spd.h, sources up to 4096x4096: the last work group of each quad of 4x4 work groups computes
+// mips 6 and 7 of the quad, the last quad of the slice computes mips 8..11 from mip 7 as the quads computed it, which
+// SpdStoreQuad / SpdLoadQuad carry since the stored mip 7 can be rounded. Same result as SpdDownsample in every format.
+// The block counters of EXTENDED count the quads.
+//==============================================================================================================================
+// Mips 6 and up, after mips 0..5 of the tile
+template<class Spd, class T>
+void SpdDownsampleQuadTail(Spd &spd, T (*lds)[16][4], inAU2 workGroupID, AU1 mips, inAU2 numWorkGroups, AU1 slice)
+{
+    if (mips <= 6) return;
+
+    varAU2(quadID) = initAU2(workGroupID[0] / 4, workGroupID[1] / 4);
+    AU1 quadWidth = AMinU1(4, numWorkGroups[0] - quadID[0] * 4);
+    AU1 quadHeight = AMinU1(4, numWorkGroups[1] - quadID[1] * 4);
+    AU1 quadsX = (numWorkGroups[0] + 3) / 4;
+    AU1 quadsY = (numWorkGroups[1] + 3) / 4;
+    if (SpdExitBlock(spd, quadWidth * quadHeight, quadID[1] * quadsX + quadID[0], slice)) return;
+
+    T v[4];
+    SpdDownsampleInvocationMips_6_7(spd, v, quadID[0], quadID[1], mips, slice);
+
+    if (mips <= 8) return;
+
+    // mip 7 of the quad as computed, the stored one can be rounded
+    spd.SpdStoreQuad(ASU1(quadID[0]), ASU1(quadID[1]), v, slice);
+
+    if (SpdExitWorkgroup(spd, quadsX * quadsY, slice)) return;
+
+    // the up to 16x16 texels of mip 7, one per quad, the ones outside of the quads are the padding of SpdDownsampleMips_6_7
+    for (AU1 y = 0; y < 16; y++)
+    {
+        for (AU1 x = 0; x < 16; x++)
+        {
+            if (x < quadsX && y < quadsY)
+                spd.SpdLoadQuad(lds[y][x], ASU1(x), ASU1(y), slice);
+            else
+                SpdDownsampleInvocationMips_6_7(spd, lds[y][x], x, y, mips, slice);
+        }
+    }
+
+    varAU2(tailID) = initAU2(0, 0);
+    SpdDownsampleNextFour(spd, lds, tailID, 8, mips, slice);
+}
+
+template<class Spd, class T>
+void SpdDownsampleSplitTailT(Spd &spd, T (*lds)[16][4], inAU2 workGroupID, AU1 mips, inAU2 numWorkGroups, AU1 slice)
+{
+    SpdDownsampleMips_0_1(spd, lds, workGroupID, mips, slice);
+
+    SpdDownsampleNextFour(spd, lds, workGroupID, 2, mips, slice);
+
+    SpdDownsampleQuadTail(spd, lds, workGroupID, mips, numWorkGroups, slice);
+}
+
+template<class Spd>
+void SpdDownsampleSplitTail(
+    Spd &spd,
+    SpdIntermediate &lds,
+    inAU2 workGroupID,
+    AU1 mips,
+    inAU2 numWorkGroups,
+    AU1 slice
+) {
+    SpdDownsampleSplitTailT(spd, lds.v, workGroupID, mips, numWorkGroups, slice);
+}
+
+template<class Spd>
+void SpdDownsampleSplitTailH(
+    Spd &spd,
+    SpdIntermediateH &lds,
+    inAU2 workGroupID,
+    AU1 mips,
+    inAU2 numWorkGroups,
+    AU1 slice
+) {
+    SpdPackedHooks<Spd> hooks = { spd };
+    SpdDownsampleSplitTailT(hooks, lds.v, workGroupID, mips, numWorkGroups, slice);
+}
+
+//==============================================================================================================================
+//                                                        WAVE SHUFFLE
+//------------------------------------------------------------------------------------------------------------------------------
+// Emulation of SPD_WAVE_SHUFFLE of ffx_spd.h, to check its lane patterns for a wave size without a GPU. The 256 invocations
+// keep their values in lane registers and run SpdDownsampleNextFourWave step by step. A shuffle from a lane of another
+// wave reads zero, so a pattern that would cross waves changes the result. For wave sizes of 16 and up the result is the
+// one of SpdDownsample, smaller waves run SpdDownsampleNextFour like the shader.
+//==============================================================================================================================
+// Invocation (x, y) of the 16x16 intermediate, same as ARmpRed8x8 of ffx_a.h and the 8x8 blocks of 64 invocations.
+A_STATIC void SpdInvocationXY(AU1 &x, AU1 &y, AU1 localInvocationIndex)
+{
+    AU1 a = localInvocationIndex;
+    x = (a & 1) | ((a >> 2) & 6) | (((a >> 6) & 1) << 3);
+    y = ((a >> 1) & 3) | ((a >> 3) & 4) | ((a >> 7) << 3);
+}
+
+// SpdReduceLanes of the lanes [0, count) with a multiple of step as index, the only ones whose results are read later.
+template<class Spd, class T>
+void SpdReduceLanes(Spd &spd, T (*lanes)[4], AU1 count, AU1 step, AU1 dx, AU1 dy, AU1 waveSize)
+{
+    T zero[4] = { 0, 0, 0, 0 };
+    for (AU1 lane = 0; lane < count; lane += step)
+    {
+        AU1 base = lane & ~(dx | dy);
+        T *v[4];
+        AU1 src[4] = { lane, base | dx, base | dy, base | dx | dy };
+        for (AU1 i = 0; i < 4; i++)
+            v[i] = (src[i] / waveSize == lane / waveSize) ? lanes[src[i]] : zero;
+        T d[4];
+        spd.SpdReduce4(d, v[0], v[1], v[2], v[3]);
+        for (AU1 c = 0; c < 4; c++) lanes[lane][c] = d[c];
+    }
+}
+
+// Stores the lanes [0, count) with a multiple of step as index, invocation (x, y) stores texel (x >> shift, y >> shift) of
+// the size x size texels of mip of the work group.
+template<class Spd, class T>
+void SpdStoreLanes(Spd &spd, T (*lanes)[4], inAU2 workGroupID, AU1 count, AU1 step, AU1 shift, AU1 size, AU1 mip, AU1 slice)
+{
+    for (AU1 lane = 0; lane < count; lane += step)
+    {
+        AU1 x, y;
+        SpdInvocationXY(x, y, lane);
+        spd.SpdStore(ASU1(workGroupID[0] * size + (x >> shift)), ASU1(workGroupID[1] * size + (y >> shift)), lanes[lane], mip, slice);
+    }
+}
+
+// Same as SpdDownsampleNextFourWave of ffx_spd.h, the barriers are the points where all lanes are done.
+template<class Spd, class T>
+void SpdDownsampleNextFourWave(Spd &spd, T (*lds)[16][4], inAU2 workGroupID, AU1 baseMip, AU1 mips, AU1 slice, AU1 waveSize)
+{
+    if (mips <= baseMip) return;
+    if (waveSize < 16)
+    {
+        SpdDownsampleNextFour(spd, lds, workGroupID, baseMip, mips, slice);
+        return;
+    }
+
+    T lanes[256][4];
+    for (AU1 lane = 0; lane < 256; lane++)
+    {
+        AU1 x, y;
+        SpdInvocationXY(x, y, lane);
+        for (AU1 c = 0; c < 4; c++) lanes[lane][c] = lds[y][x][c];
+    }
+    SpdReduceLanes(spd, lanes, 256, 4, 1, 2, waveSize);
+    SpdStoreLanes(spd, lanes, workGroupID, 256, 4, 1, 8, baseMip, slice);
+
+    if (mips <= baseMip + 1) return;
+    SpdReduceLanes(spd, lanes, 256, 16, 8, 4, waveSize);
+    SpdStoreLanes(spd, lanes, workGroupID, 256, 16, 2, 4, baseMip + 1, slice);
+
+    if (mips <= baseMip + 2) return;
+    if (waveSize >= 64)
+    {
+        SpdReduceLanes(spd, lanes, 256, 64, 16, 32, waveSize);
+        SpdStoreLanes(spd, lanes, workGroupID, 256, 64, 3, 2, baseMip + 2, slice);
+        for (AU1 lane = 0; lane < 256; lane += 64)
+        {
+            AU1 x, y;
+            SpdInvocationXY(x, y, lane);
+            for (AU1 c = 0; c < 4; c++) lds[y][x][c] = lanes[lane][c];
+        }
+
+        if (mips <= baseMip + 3) return;
+        // barrier
+        for (AU1 lane = 0; lane < 4; lane++)
+        {
+            AU1 x, y;
+            SpdInvocationXY(x, y, lane);
+            for (AU1 c = 0; c < 4; c++) lanes[lane][c] = lds[y * 8][x * 8][c];
+        }
+        SpdReduceLanes(spd, lanes, 4, 4, 1, 2, waveSize);
+        SpdStoreLanes(spd, lanes, workGroupID, 1, 1, 0, 1, baseMip + 3, slice);
+        return;
+    }
+
+    for (AU1 lane = 0; lane < 256; lane += 16)
+    {
+        AU1 x, y;
+        SpdInvocationXY(x, y, lane);
+        for (AU1 c = 0; c < 4; c++) lds[y][x][c] = lanes[lane][c];
+    }
+    // barrier
+    for (AU1 lane = 0; lane < 16; lane++)
+    {
+        AU1 x, y;
+        SpdInvocationXY(x, y, lane);
+        for (AU1 c = 0; c < 4; c++) lanes[lane][c] = lds[y * 4][x * 4][c];
+    }
+    SpdReduceLanes(spd, lanes, 16, 4, 1, 2, waveSize);
+    SpdStoreLanes(spd, lanes, workGroupID, 16, 4, 1, 2, baseMip + 2, slice);
+
+    if (mips <= baseMip + 3) return;
+    SpdReduceLanes(spd, lanes, 16, 16, 8, 4, waveSize);
+    SpdStoreLanes(spd, lanes, workGroupID, 1, 1, 0, 1, baseMip + 3, slice);
+}
+
+template<class Spd, class T>
+void SpdDownsampleWaveT(Spd &spd, T (*lds)[16][4], inAU2 workGroupID, AU1 mips, AU1 numWorkGroups, AU1 slice, AU1 waveSize)
+{
+    SpdDownsampleMips_0_1(spd, lds, workGroupID, mips, slice);
+
+    SpdDownsampleNextFourWave(spd, lds, workGroupID, 2, mips, slice, waveSize);
+
+    if (mips <= 6) return;
+
+    if (SpdExitWorkgroup(spd, numWorkGroups, slice)) return;
+
+    SpdDownsampleMips_6_7(spd, lds, mips, slice);
+
+    varAU2(tailID) = initAU2(0, 0);
+    SpdDownsampleNextFourWave(spd, lds, tailID, 8, mips, slice, waveSize);
+}
+
+template<class Spd>
+void SpdDownsampleWave(
+    Spd &spd,
+    SpdIntermediate &lds,
+    inAU2 workGroupID,
+    AU1 mips,
+    AU1 numWorkGroups,
+    AU1 slice,
+    AU1 waveSize
+) {
+    SpdDownsampleWaveT(spd, lds.v, workGroupID, mips, numWorkGroups, slice, waveSize);
+}
+
+template<class Spd>
+void SpdDownsampleWaveH(
+    Spd &spd,
+    SpdIntermediateH &lds,
+    inAU2 workGroupID,
+    AU1 mips,
+    AU1 numWorkGroups,
+    AU1 slice,
+    AU1 waveSize
+) {
+    SpdPackedHooks<Spd> hooks = { spd };
+    SpdDownsampleWaveT(hooks, lds.v, workGroupID, mips, numWorkGroups, slice, waveSize);
+}
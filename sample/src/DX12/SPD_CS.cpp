@@ -27,6 +27,10 @@
 #include "base\Helper.h"
 #include "Base\ShaderCompilerHelper.h"
 
+#define A_CPU
+#include "../../../ffx-spd/ffx_a.h"
+#include "../../../ffx-spd/ffx_spd.h"
+
 #include "SPD_CS.h"
 
 namespace CAULDRON_DX12
@@ -174,6 +178,7 @@ namespace CAULDRON_DX12
             &CD3DX12_RESOURCE_DESC::Buffer(sizeof(uint32_t), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
             sizeof(uint32_t), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
         m_globalCounterBuffer.CreateBufferUAV(0, NULL, &m_globalCounter);
+        m_globalCounterCleared = false;
     }
 
     void SPD_CS::OnDestroyWindowSizeDependentResources()
@@ -202,16 +207,26 @@ namespace CAULDRON_DX12
         UserMarker marker(pCommandList, "SPD_CS");
 
         // downsample
-        uint32_t dispatchX = (((m_Width + 63) >> (6)));
-        uint32_t dispatchY = (((m_Height + 63) >> (6)));
+        // only the tiles of the rectangle, the whole texture here (e.g. the viewport of a dynamic resolution instead)
+        varAU2(dispatchThreadGroupCountXY);
+        varAU2(workGroupOffset);
+        varAU2(numWorkGroupsAndMips);
+        varAU4(rectInfo) = initAU4(0, 0, m_Width, m_Height);
+        SpdSetup(dispatchThreadGroupCountXY, workGroupOffset, numWorkGroupsAndMips, rectInfo, m_mipCount);
+
+        uint32_t dispatchX = dispatchThreadGroupCountXY[0];
+        uint32_t dispatchY = dispatchThreadGroupCountXY[1];
         uint32_t dispatchZ = 1;
 
         D3D12_GPU_VIRTUAL_ADDRESS cbHandle;
         uint32_t* pConstMem;
         m_pConstantBufferRing->AllocConstantBuffer(sizeof(cbDownscale), (void**)&pConstMem, &cbHandle);
         cbDownscale constants;
-        constants.mips = m_mipCount;
-        constants.numWorkGroups = dispatchX * dispatchY * dispatchZ;
+        constants.mips = numWorkGroupsAndMips[1];
+        // per slice, every slice (dispatchZ) has its own counter
+        constants.numWorkGroups = numWorkGroupsAndMips[0];
+        constants.workGroupOffset[0] = workGroupOffset[0];
+        constants.workGroupOffset[1] = workGroupOffset[1];
         memcpy(pConstMem, &constants, sizeof(cbDownscale));
 
         D3D12_RANGE range = { 0, sizeof(uint32_t) };
@@ -234,14 +249,21 @@ namespace CAULDRON_DX12
         //
         pCommandList->SetPipelineState(m_pPipeline);
 
-        // set counter to 0
-        pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_globalCounterBuffer.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_DEST, 0));
+        // set counter to 0 once, the last work group of every dispatch resets it for the next one
+        if (!m_globalCounterCleared)
+        {
+            pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_globalCounterBuffer.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_DEST, 0));
+
+            D3D12_WRITEBUFFERIMMEDIATE_PARAMETER pParams = { m_globalCounterBuffer.GetResource()->GetGPUVirtualAddress(), 0 };
+            pCommandList->WriteBufferImmediate(1, &pParams, NULL);
 
-        D3D12_WRITEBUFFERIMMEDIATE_PARAMETER pParams = { m_globalCounterBuffer.GetResource()->GetGPUVirtualAddress(), 0 };
-        pCommandList->WriteBufferImmediate(1, &pParams, NULL);
+            pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_globalCounterBuffer.GetResource(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, 0));
+            m_globalCounterCleared = true;
+        }
 
+        // the reset of the previous dispatch has to be visible to this one
         D3D12_RESOURCE_BARRIER resourceBarriers[2] = {
-            CD3DX12_RESOURCE_BARRIER::Transition(m_globalCounterBuffer.GetResource(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, 0),
+            CD3DX12_RESOURCE_BARRIER::UAV(m_globalCounterBuffer.GetResource()),
             CD3DX12_RESOURCE_BARRIER::Transition(m_result.GetResource(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
         };
         pCommandList->ResourceBarrier(2, resourceBarriers);
@@ -43,7 +43,7 @@ namespace CAULDRON_DX12
         {
             int mips;
             int numWorkGroups;
-            int padding[2];
+            int workGroupOffset[2];
         };
 
     private:
@@ -60,6 +60,7 @@ namespace CAULDRON_DX12
 
         CBV_SRV_UAV                   m_globalCounter;
         Texture                       m_globalCounterBuffer;
+        bool                          m_globalCounterCleared = false;
 
         ResourceViewHeaps            *m_pResourceViewHeaps;
         DynamicBufferRing            *m_pConstantBufferRing;
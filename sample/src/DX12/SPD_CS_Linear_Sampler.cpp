@@ -189,6 +189,7 @@ namespace CAULDRON_DX12
             &CD3DX12_RESOURCE_DESC::Buffer(sizeof(uint32_t), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
             sizeof(uint32_t), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
         m_globalCounterBuffer.CreateBufferUAV(0, NULL, &m_globalCounter);
+        m_globalCounterCleared = false;
     }
 
     void SPD_CS_Linear_Sampler::OnDestroyWindowSizeDependentResources()
@@ -226,7 +227,8 @@ namespace CAULDRON_DX12
         m_pConstantBufferRing->AllocConstantBuffer(sizeof(cbDownscale), (void**)&pConstMem, &cbHandle);
         cbDownscale constants;
         constants.mips = m_mipCount;
-        constants.numWorkGroups = dispatchX * dispatchY * dispatchZ;
+        // per slice, every slice (dispatchZ) has its own counter
+        constants.numWorkGroups = dispatchX * dispatchY;
         constants.invInputSize[0] = 1.0f / m_Width;
         constants.invInputSize[1] = 1.0f / m_Height;
         memcpy(pConstMem, &constants, sizeof(cbDownscale));
@@ -251,14 +253,21 @@ namespace CAULDRON_DX12
         //
         pCommandList->SetPipelineState(m_pPipeline);
 
-        // set counter to 0
-        pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_globalCounterBuffer.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_DEST, 0));
+        // set counter to 0 once, the last work group of every dispatch resets it for the next one
+        if (!m_globalCounterCleared)
+        {
+            pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_globalCounterBuffer.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_DEST, 0));
+
+            D3D12_WRITEBUFFERIMMEDIATE_PARAMETER pParams = { m_globalCounterBuffer.GetResource()->GetGPUVirtualAddress(), 0 };
+            pCommandList->WriteBufferImmediate(1, &pParams, NULL);
 
-        D3D12_WRITEBUFFERIMMEDIATE_PARAMETER pParams = { m_globalCounterBuffer.GetResource()->GetGPUVirtualAddress(), 0 };
-        pCommandList->WriteBufferImmediate(1, &pParams, NULL);
+            pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_globalCounterBuffer.GetResource(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, 0));
+            m_globalCounterCleared = true;
+        }
 
+        // the reset of the previous dispatch has to be visible to this one
         D3D12_RESOURCE_BARRIER resourceBarriers[2] = {
-            CD3DX12_RESOURCE_BARRIER::Transition(m_globalCounterBuffer.GetResource(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, 0),
+            CD3DX12_RESOURCE_BARRIER::UAV(m_globalCounterBuffer.GetResource()),
             CD3DX12_RESOURCE_BARRIER::Transition(m_result.GetResource(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
         };
         pCommandList->ResourceBarrier(2, resourceBarriers);
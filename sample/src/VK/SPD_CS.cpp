@@ -23,6 +23,10 @@
 #include "Base\ExtDebugMarkers.h"
 #include "Base\Imgui.h"
 
+#define A_CPU
+#include "../../../ffx-spd/ffx_a.h"
+#include "../../../ffx-spd/ffx_spd.h"
+
 #include "SPD_CS.h"
 
 namespace CAULDRON_VK
@@ -92,6 +96,11 @@ namespace CAULDRON_VK
             VmaAllocationInfo bufferAllocInfo = {};
             vmaCreateBuffer(m_pDevice->GetAllocator(), &bufferInfo, &bufferAllocCreateInfo, &m_globalCounter, 
                 &m_globalCounterAllocation, &bufferAllocInfo);
+
+            // initialize global atomic counter to 0 once, the last work group of every dispatch resets it for the next one
+            vmaMapMemory(m_pDevice->GetAllocator(), m_globalCounterAllocation, (void**)&m_pCounter);
+            *m_pCounter = 0;
+            vmaUnmapMemory(m_pDevice->GetAllocator(), m_globalCounterAllocation);
         }
 
         VkPipelineShaderStageCreateInfo computeShader;
@@ -293,14 +302,13 @@ namespace CAULDRON_VK
         // downsample
         //
 
-        // initialize global atomic counter to 0
-        vmaMapMemory(m_pDevice->GetAllocator(), m_globalCounterAllocation, (void**)&m_pCounter);
-        *m_pCounter = 0;
-        vmaUnmapMemory(m_pDevice->GetAllocator(), m_globalCounterAllocation);
-
-        // transition general layout if detination image to shader read only for source image
+        // the reset of the global atomic counter by the previous dispatch has to be visible to this one
+        VkMemoryBarrier counterBarrier = {};
+        counterBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        counterBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        counterBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
         vkCmdPipelineBarrier(cmd_buf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-            0, 0, nullptr, 0, nullptr, 0, nullptr);
+            0, 1, &counterBarrier, 0, nullptr, 0, nullptr);
 
         SetPerfMarkerBegin(cmd_buf, "SPD_CS");
 
@@ -308,9 +316,15 @@ namespace CAULDRON_VK
         //
         vkCmdBindPipeline(cmd_buf, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
 
-        // should be / 64
-        uint32_t dispatchX = (((m_Width + 63) >> (6)));
-        uint32_t dispatchY = (((m_Height + 63) >> (6)));
+        // only the tiles of the rectangle, the whole texture here (e.g. the viewport of a dynamic resolution instead)
+        varAU2(dispatchThreadGroupCountXY);
+        varAU2(workGroupOffset);
+        varAU2(numWorkGroupsAndMips);
+        varAU4(rectInfo) = initAU4(0, 0, m_Width, m_Height);
+        SpdSetup(dispatchThreadGroupCountXY, workGroupOffset, numWorkGroupsAndMips, rectInfo, m_mipCount);
+
+        uint32_t dispatchX = dispatchThreadGroupCountXY[0];
+        uint32_t dispatchY = dispatchThreadGroupCountXY[1];
         uint32_t dispatchZ = 1;
 
         // single pass for storage buffer?
@@ -320,8 +334,11 @@ namespace CAULDRON_VK
         // Bind push constants
         //
         PushConstants data;
-        data.mips = m_mipCount;
-        data.numWorkGroups = dispatchX * dispatchY * dispatchZ;
+        data.mips = numWorkGroupsAndMips[1];
+        // per slice, every slice (dispatchZ) has its own counter
+        data.numWorkGroups = numWorkGroupsAndMips[0];
+        data.workGroupOffset[0] = workGroupOffset[0];
+        data.workGroupOffset[1] = workGroupOffset[1];
         vkCmdPushConstants(cmd_buf, m_pipelineLayout,
             VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), (void*)&data);
 
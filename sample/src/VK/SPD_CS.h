@@ -44,7 +44,7 @@ namespace CAULDRON_VK
         {
             int mips;
             int numWorkGroups;
-            int padding[2];
+            int workGroupOffset[2];
         };
 
     private:
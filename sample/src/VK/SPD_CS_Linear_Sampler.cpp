@@ -120,6 +120,11 @@ namespace CAULDRON_VK
             VmaAllocationInfo bufferAllocInfo = {};
             vmaCreateBuffer(m_pDevice->GetAllocator(), &bufferInfo, &bufferAllocCreateInfo, &m_globalCounter, 
                 &m_globalCounterAllocation, &bufferAllocInfo);
+
+            // initialize global atomic counter to 0 once, the last work group of every dispatch resets it for the next one
+            vmaMapMemory(m_pDevice->GetAllocator(), m_globalCounterAllocation, (void**)&m_pCounter);
+            *m_pCounter = 0;
+            vmaUnmapMemory(m_pDevice->GetAllocator(), m_globalCounterAllocation);
         }
 
         VkPipelineShaderStageCreateInfo computeShader;
@@ -335,14 +340,13 @@ namespace CAULDRON_VK
         // downsample
         //
 
-        // initialize global atomic counter to 0
-        vmaMapMemory(m_pDevice->GetAllocator(), m_globalCounterAllocation, (void**)&m_pCounter);
-        *m_pCounter = 0;
-        vmaUnmapMemory(m_pDevice->GetAllocator(), m_globalCounterAllocation);
-
-        // transition general layout if detination image to shader read only for source image
+        // the reset of the global atomic counter by the previous dispatch has to be visible to this one
+        VkMemoryBarrier counterBarrier = {};
+        counterBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        counterBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        counterBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
         vkCmdPipelineBarrier(cmd_buf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-            0, 0, nullptr, 0, nullptr, 0, nullptr);
+            0, 1, &counterBarrier, 0, nullptr, 0, nullptr);
 
         SetPerfMarkerBegin(cmd_buf, "SPD_CS_Linear_Sampler");
 
@@ -363,7 +367,8 @@ namespace CAULDRON_VK
         //
         PushConstants data;
         data.mips = m_mipCount;
-        data.numWorkGroups = dispatchX * dispatchY * dispatchZ;
+        // per slice, every slice (dispatchZ) has its own counter
+        data.numWorkGroups = dispatchX * dispatchY;
         data.invInputSize[0] = 1.0f / m_Width;
         data.invInputSize[1] = 1.0f / m_Height;
         vkCmdPushConstants(cmd_buf, m_pipelineLayout,
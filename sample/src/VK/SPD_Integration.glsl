@@ -32,6 +32,7 @@ layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
 layout(push_constant) uniform pushConstants {
     uint mips;
     uint numWorkGroups;
+    uvec2 workGroupOffset;
 } spdConstants;
 
 //--------------------------------------------------------------------------------------
@@ -45,7 +46,7 @@ layout(set=0, binding=1, rgba16f) coherent uniform image2D imgDst[12];
 //--------------------------------------------------------------------------------------
 layout(std430, binding=2) coherent buffer globalAtomicBuffer
 {
-    uint counter;
+    uint counter[];
 } globalAtomic;
 
 #define A_GPU
@@ -61,11 +62,12 @@ shared AF1 spd_intermediateR[16][16];
 shared AF1 spd_intermediateG[16][16];
 shared AF1 spd_intermediateB[16][16];
 shared AF1 spd_intermediateA[16][16];
-AF4 SpdLoadSourceImage(ASU2 p){return imageLoad(imgSrc, p);}
-AF4 SpdLoad(ASU2 p){return imageLoad(imgDst[5],p);}
-void SpdStore(ASU2 p, AF4 value, AU1 mip){imageStore(imgDst[mip], p, value);}
-void SpdIncreaseAtomicCounter(){spd_counter = atomicAdd(globalAtomic.counter, 1);}
+AF4 SpdLoadSourceImage(ASU2 p, AU1 slice){return imageLoad(imgSrc, p);}
+AF4 SpdLoad(ASU2 p, AU1 slice){return imageLoad(imgDst[5],p);}
+void SpdStore(ASU2 p, AF4 value, AU1 mip, AU1 slice){imageStore(imgDst[mip], p, value);}
+void SpdIncreaseAtomicCounter(AU1 slice){spd_counter = atomicAdd(globalAtomic.counter[slice], 1);}
 AU1 SpdGetAtomicCounter(){return spd_counter;}
+void SpdResetAtomicCounter(AU1 slice){globalAtomic.counter[slice] = 0;}
 AF4 SpdLoadIntermediate(AU1 x, AU1 y){
     return AF4(
     spd_intermediateR[x][y], 
@@ -84,11 +86,12 @@ AF4 SpdReduce4(AF4 v0, AF4 v1, AF4 v2, AF4 v3){return (v0+v1+v2+v3)*0.25;}
 #ifdef A_HALF
 shared AH2 spd_intermediateRG[16][16];
 shared AH2 spd_intermediateBA[16][16];
-AH4 SpdLoadSourceImageH(ASU2 p){return AH4(imageLoad(imgSrc, p));}
-AH4 SpdLoadH(ASU2 p){return AH4(imageLoad(imgDst[5],p));}
-void SpdStoreH(ASU2 p, AH4 value, AU1 mip){imageStore(imgDst[mip], p, AF4(value));}
-void SpdIncreaseAtomicCounter(){spd_counter = atomicAdd(globalAtomic.counter, 1);}
+AH4 SpdLoadSourceImageH(ASU2 p, AU1 slice){return AH4(imageLoad(imgSrc, p));}
+AH4 SpdLoadH(ASU2 p, AU1 slice){return AH4(imageLoad(imgDst[5],p));}
+void SpdStoreH(ASU2 p, AH4 value, AU1 mip, AU1 slice){imageStore(imgDst[mip], p, AF4(value));}
+void SpdIncreaseAtomicCounter(AU1 slice){spd_counter = atomicAdd(globalAtomic.counter[slice], 1);}
 AU1 SpdGetAtomicCounter(){return spd_counter;}
+void SpdResetAtomicCounter(AU1 slice){globalAtomic.counter[slice] = 0;}
 AH4 SpdLoadIntermediateH(AU1 x, AU1 y){
     return AH4(
     spd_intermediateRG[x][y].x,
@@ -113,12 +116,16 @@ void main()
         AU2(gl_WorkGroupID.xy), 
         AU1(gl_LocalInvocationIndex), 
         AU1(spdConstants.mips), 
-        AU1(spdConstants.numWorkGroups));
+        AU1(spdConstants.numWorkGroups),
+        AU1(gl_WorkGroupID.z),
+        AU2(spdConstants.workGroupOffset));
 #else
     SpdDownsampleH(
         AU2(gl_WorkGroupID.xy), 
         AU1(gl_LocalInvocationIndex), 
         AU1(spdConstants.mips), 
-        AU1(spdConstants.numWorkGroups));
+        AU1(spdConstants.numWorkGroups),
+        AU1(gl_WorkGroupID.z),
+        AU2(spdConstants.workGroupOffset));
 #endif
 }
\ No newline at end of file
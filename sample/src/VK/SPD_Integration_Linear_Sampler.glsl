@@ -50,7 +50,7 @@ layout(set=0, binding=3) uniform sampler srcSampler;
 //--------------------------------------------------------------------------------------
 layout(std430, binding=2) coherent buffer globalAtomicBuffer
 {
-    uint counter;
+    uint counter[];
 } globalAtomic;
 
 #define A_GPU
@@ -68,14 +68,15 @@ shared AF1 spd_intermediateB[16][16];
 shared AF1 spd_intermediateA[16][16];
 //AF4 SPDLoadSourceImage(ASU2 p){return imageLoad(imgSrc, p);}
 // [SAMPLER] use sampler for accessing source image
-AF4 SpdLoadSourceImage(ASU2 p){
+AF4 SpdLoadSourceImage(ASU2 p, AU1 slice){
     AF2 textureCoord = p * spdConstants.invInputSize + spdConstants.invInputSize;
     return texture(sampler2D(imgSrc, srcSampler), textureCoord);
     }
-AF4 SpdLoad(ASU2 p){return imageLoad(imgDst[5],p);}
-void SpdStore(ASU2 p, AF4 value, AU1 mip){imageStore(imgDst[mip], p, value);}
-void SpdIncreaseAtomicCounter(){spd_counter = atomicAdd(globalAtomic.counter, 1);}
+AF4 SpdLoad(ASU2 p, AU1 slice){return imageLoad(imgDst[5],p);}
+void SpdStore(ASU2 p, AF4 value, AU1 mip, AU1 slice){imageStore(imgDst[mip], p, value);}
+void SpdIncreaseAtomicCounter(AU1 slice){spd_counter = atomicAdd(globalAtomic.counter[slice], 1);}
 AU1 SpdGetAtomicCounter(){return spd_counter;}
+void SpdResetAtomicCounter(AU1 slice){globalAtomic.counter[slice] = 0;}
 AF4 SpdLoadIntermediate(AU1 x, AU1 y){
     return AF4(
     spd_intermediateR[x][y], 
@@ -94,14 +95,15 @@ AF4 SpdReduce4(AF4 v0, AF4 v1, AF4 v2, AF4 v3){return (v0+v1+v2+v3)*0.25;}
 #ifdef A_HALF
 shared AH2 spd_intermediateRG[16][16];
 shared AH2 spd_intermediateBA[16][16];
-AH4 SpdLoadSourceImageH(ASU2 p){
+AH4 SpdLoadSourceImageH(ASU2 p, AU1 slice){
     AF2 textureCoord = p * spdConstants.invInputSize + spdConstants.invInputSize;
     return AH4(texture(sampler2D(imgSrc, srcSampler), textureCoord));
     }
-AH4 SpdLoadH(ASU2 p){return AH4(imageLoad(imgDst[5],p));}
-void SpdStoreH(ASU2 p, AH4 value, AU1 mip){imageStore(imgDst[mip], p, AF4(value));}
-void SpdIncreaseAtomicCounter(){spd_counter = atomicAdd(globalAtomic.counter, 1);}
+AH4 SpdLoadH(ASU2 p, AU1 slice){return AH4(imageLoad(imgDst[5],p));}
+void SpdStoreH(ASU2 p, AH4 value, AU1 mip, AU1 slice){imageStore(imgDst[mip], p, AF4(value));}
+void SpdIncreaseAtomicCounter(AU1 slice){spd_counter = atomicAdd(globalAtomic.counter[slice], 1);}
 AU1 SpdGetAtomicCounter(){return spd_counter;}
+void SpdResetAtomicCounter(AU1 slice){globalAtomic.counter[slice] = 0;}
 AH4 SpdLoadIntermediateH(AU1 x, AU1 y){
     return AH4(
     spd_intermediateRG[x][y].x,
@@ -128,12 +130,14 @@ void main()
         AU2(gl_WorkGroupID.xy), 
         AU1(gl_LocalInvocationIndex), 
         AU1(spdConstants.mips), 
-        AU1(spdConstants.numWorkGroups));
+        AU1(spdConstants.numWorkGroups),
+        AU1(gl_WorkGroupID.z));
 #else
     SpdDownsampleH(
         AU2(gl_WorkGroupID.xy), 
         AU1(gl_LocalInvocationIndex), 
         AU1(spdConstants.mips), 
-        AU1(spdConstants.numWorkGroups));
+        AU1(spdConstants.numWorkGroups),
+        AU1(gl_WorkGroupID.z));
 #endif
 }
\ No newline at end of file
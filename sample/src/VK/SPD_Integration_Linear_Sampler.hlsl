@@ -59,14 +59,15 @@ groupshared AF1 spd_intermediateB[16][16];
 groupshared AF1 spd_intermediateA[16][16];
 //AF4 DSLoadSourceImage(ASU2 tex){return imgSrc[tex];}
 //[SAMPLER]
-AF4 SpdLoadSourceImage(ASU2 p){
+AF4 SpdLoadSourceImage(ASU2 p, AU1 slice){
     AF2 textureCoord = p * invInputSize + invInputSize;
     return imgSrc.SampleLevel(srcSampler, textureCoord, 0);
 }
-AF4 SpdLoad(ASU2 tex){return imgDst[5][tex];}
-void SpdStore(ASU2 pix, AF4 outValue, AU1 index){imgDst[index][pix] = outValue;}
-void SpdIncreaseAtomicCounter(){InterlockedAdd(globalAtomic[0].counter, 1, spd_counter);}
+AF4 SpdLoad(ASU2 tex, AU1 slice){return imgDst[5][tex];}
+void SpdStore(ASU2 pix, AF4 outValue, AU1 index, AU1 slice){imgDst[index][pix] = outValue;}
+void SpdIncreaseAtomicCounter(AU1 slice){InterlockedAdd(globalAtomic[slice].counter, 1, spd_counter);}
 AU1 SpdGetAtomicCounter(){return spd_counter;}
+void SpdResetAtomicCounter(AU1 slice){globalAtomic[slice].counter = 0;}
 AF4 SpdLoadIntermediate(AU1 x, AU1 y){
     return AF4(
     spd_intermediateR[x][y], 
@@ -85,14 +86,15 @@ AF4 SpdReduce4(AF4 v0, AF4 v1, AF4 v2, AF4 v3){return (v0+v1+v2+v3)*0.25;}
 #ifdef A_HALF
 groupshared AH2 spd_intermediateRG[16][16];
 groupshared AH2 spd_intermediateBA[16][16];
-AH4 SpdLoadSourceImageH(ASU2 p){
+AH4 SpdLoadSourceImageH(ASU2 p, AU1 slice){
     AF2 textureCoord = p * invInputSize + invInputSize;
     return AH4(imgSrc.SampleLevel(srcSampler, textureCoord, 0));
 }
-AH4 SpdLoadH(ASU2 p){return AH4(imgDst[5][p]);}
-void SpdStoreH(ASU2 p, AH4 value, AU1 mip){imgDst[mip][p] = AF4(value);}
-void SpdIncreaseAtomicCounter(){InterlockedAdd(globalAtomic[0].counter, 1, spd_counter);}
+AH4 SpdLoadH(ASU2 p, AU1 slice){return AH4(imgDst[5][p]);}
+void SpdStoreH(ASU2 p, AH4 value, AU1 mip, AU1 slice){imgDst[mip][p] = AF4(value);}
+void SpdIncreaseAtomicCounter(AU1 slice){InterlockedAdd(globalAtomic[slice].counter, 1, spd_counter);}
 AU1 SpdGetAtomicCounter(){return spd_counter;}
+void SpdResetAtomicCounter(AU1 slice){globalAtomic[slice].counter = 0;}
 AH4 SpdLoadIntermediateH(AU1 x, AU1 y){
     return AH4(
     spd_intermediateRG[x][y].x,
@@ -120,12 +122,14 @@ void main(uint3 WorkGroupId : SV_GroupID, uint LocalThreadIndex : SV_GroupIndex)
         AU2(WorkGroupId.xy), 
         AU1(LocalThreadIndex),  
         AU1(mips),
-        AU1(numWorkGroups));
+        AU1(numWorkGroups),
+        AU1(WorkGroupId.z));
 #else
     SpdDownsampleH(
         AU2(WorkGroupId.xy), 
         AU1(LocalThreadIndex),  
         AU1(mips),
-        AU1(numWorkGroups));
+        AU1(numWorkGroups),
+        AU1(WorkGroupId.z));
 #endif
 }
\ No newline at end of file